@@ -24,6 +24,7 @@
 #include "catalog/gp_fastsequence.h"
 #include "cdb/cdbvars.h"
 #include "cdb/cdbappendonlyblockdirectory.h"
+#include "cdb/cdbappendonlydecompress.h"
 #include "cdb/cdbappendonlystoragelayer.h"
 #include "cdb/cdbappendonlystorageread.h"
 #include "cdb/cdbappendonlystoragewrite.h"
@@ -257,6 +258,71 @@ static void close_ds_write(DatumStreamWrite **ds, int nvp)
 }
 
 
+/* Most blocks a column decompresses ahead of the scan */
+#define AOCS_MAX_DECOMPRESS_AHEAD 8
+
+/*
+ * Have the projected columns whose codec allows it decompressed ahead of
+ * the scan by gp_aocs_decompress_workers threads.
+ *
+ * Each block decompressed ahead holds a compressed and an uncompressed
+ * buffer of the column's block size; the columns share
+ * gp_aocs_decompress_memory evenly, and a column that cannot get at least
+ * two blocks is read the regular way.
+ */
+static void
+aocs_decompress_ahead_init(AOCSScanDesc scan)
+{
+	int			nvp = scan->relationTupleDesc->natts;
+	int			ncols = 0;
+	int64		memoryPerColumn;
+	int			i;
+
+	if (gp_aocs_decompress_workers <= 0)
+		return;
+
+	for (i = 0; i < nvp; i++)
+	{
+		const CompressionCodec *codec;
+
+		if (scan->ds[i] == NULL || !scan->ds[i]->ao_attr.compress)
+			continue;
+		codec = GetCompressionCodec(scan->ds[i]->ao_attr.compressType);
+		if (codec != NULL && codec->decompress_r != NULL)
+			ncols++;
+	}
+	if (ncols == 0)
+		return;
+
+	if (scan->decompressPool == NULL)
+	{
+		scan->decompressPool =
+			AppendOnlyDecompressPool_Create(gp_aocs_decompress_workers);
+		if (scan->decompressPool == NULL)
+			return;
+	}
+
+	memoryPerColumn = (int64) gp_aocs_decompress_memory * 1024L / ncols;
+
+	for (i = 0; i < nvp; i++)
+	{
+		AppendOnlyStorageRead *storageRead;
+		int64		depth;
+
+		if (scan->ds[i] == NULL)
+			continue;
+		storageRead = &scan->ds[i]->ao_read;
+
+		depth = memoryPerColumn / (2 * (int64) storageRead->maxBufferLen);
+		if (depth > AOCS_MAX_DECOMPRESS_AHEAD)
+			depth = AOCS_MAX_DECOMPRESS_AHEAD;
+
+		AppendOnlyStorageRead_SetDecompressAhead(storageRead,
+												 scan->decompressPool,
+												 (int) depth);
+	}
+}
+
 static void aocs_initscan(AOCSScanDesc scan)
 {
     scan->cur_seg = -1;
@@ -267,6 +333,8 @@ static void aocs_initscan(AOCSScanDesc scan)
     open_ds_read(scan->aos_rel, scan->ds, scan->relationTupleDesc,
 				 scan->proj, scan->aoEntry->version, scan->aoEntry->checksum);
 
+	aocs_decompress_ahead_init(scan);
+
     pgstat_count_heap_scan(scan->aos_rel);
 }
 
@@ -341,6 +409,10 @@ static int open_next_scan_seg(AOCSScanDesc scan)
 											  nvp,
 											  scan->blockDirectory);
 
+				if (scan->zoneMap != NULL)
+					AppendOnlyZoneMap_LoadSegment(scan->zoneMap,
+												  curSegInfo->segno);
+
 				return scan->cur_seg;
 			}
 		}
@@ -490,6 +562,7 @@ aocs_beginscan_internal(Relation relation,
 
 	scan->buildBlockDirectory = false;
 	scan->blockDirectory = NULL;
+	scan->zoneMap = NULL;
 
 	AppendOnlyVisimap_Init(&scan->visibilityMap,
 						   aoentry->visimaprelid,
@@ -516,6 +589,12 @@ void aocs_endscan(AOCSScanDesc scan)
 	close_cur_scan_seg(scan);
     close_ds_read(scan->ds, scan->relationTupleDesc->natts);
 
+	if (scan->decompressPool != NULL)
+	{
+		AppendOnlyDecompressPool_Destroy(scan->decompressPool);
+		scan->decompressPool = NULL;
+	}
+
     pfree(scan->ds);
 
     for(i=0; i<scan->total_seg; ++i)
@@ -531,10 +610,46 @@ void aocs_endscan(AOCSScanDesc scan)
 
 	AppendOnlyVisimap_Finish(&scan->visibilityMap, AccessShareLock);
 
+	if (scan->zoneMap != NULL)
+		AppendOnlyZoneMap_EndScan(scan->zoneMap);
+
 	pfree(scan->aoEntry);
     pfree(scan);
 }
 
+/*
+ * aocs_zonemap_skip
+ *
+ * Skip the rows of the current segment file the zone maps rule out,
+ * starting at rowNum, the next row the projected columns will return or
+ * have just returned.  All columns hold the same rows, so each one can skip
+ * on its own and they all end up positioned before the same row.
+ *
+ * Returns 1 if the columns were repositioned, 0 if rowNum cannot be skipped
+ * and -1 if the rest of the segment file was skipped.  *boundaryRowNum is
+ * set as by AppendOnlyZoneMap_SkipRow.
+ */
+static int
+aocs_zonemap_skip(AOCSScanDesc scan, int ncol, int64 rowNum,
+				  int64 *boundaryRowNum)
+{
+	int i;
+
+	Assert(scan->zoneMap != NULL);
+
+	if (!AppendOnlyZoneMap_SkipRow(scan->zoneMap, rowNum, boundaryRowNum))
+		return 0;
+
+	for (i = 0; i < ncol; i++)
+	{
+		if (scan->proj[i] &&
+			datumstreamread_skip_to_row(scan->ds[i], *boundaryRowNum) < 0)
+			return -1;
+	}
+
+	return 1;
+}
+
 void aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot)
 {
 	int ncol;
@@ -622,6 +737,24 @@ ReadNext:
 			}
 		}
 
+		/*
+		 * Skip the rows the zone maps rule out.  This needs real row
+		 * numbers, which blocks written before 4.0 do not have.
+		 */
+		if (scan->zoneMap != NULL && rowNum != INT64CONST(-1))
+		{
+			int64 boundaryRowNum;
+
+			err = aocs_zonemap_skip(scan, ncol, rowNum, &boundaryRowNum);
+			if (err != 0)
+			{
+				if (err < 0)
+					close_cur_scan_seg(scan);
+				rowNum = INT64CONST(-1);
+				goto ReadNext;
+			}
+		}
+
 		AOTupleIdInit_Init(&aoTupleId);
 		AOTupleIdInit_segmentFileNum(&aoTupleId,
 									 scan->seginfo[scan->cur_seg]->segno);
@@ -834,6 +967,9 @@ AOCSInsertDesc aocs_insert_init(Relation rel, int segno, bool update_mode)
 		(FileSegInfo *)desc->fsInfo, desc->lastSequence,
 		rel, segno, tupleDesc->natts, true);
 
+	AppendOnlyZoneMap_Init_forInsert(&desc->zoneMap, &desc->blockDirectory,
+									 tupleDesc, desc->lastSequence);
+
     return desc;
 }
 
@@ -888,6 +1024,10 @@ Oid aocs_insert_values(AOCSInsertDesc idesc, Datum *d, bool * null, AOTupleId *a
 					AppendOnlyStorageWrite_LastWriteBeginPosition(&idesc->ds[i]->ao_write),
 					itemCount);
 
+				AppendOnlyZoneMap_FinishBlock(&idesc->zoneMap, i,
+											  idesc->ds[i]->blockFirstRowNum,
+											  itemCount);
+
 				/* since we have written all up to the new tuple,
 				 * the new blockFirstRowNum is the inserted tuple's row number
 				 */
@@ -932,7 +1072,11 @@ Oid aocs_insert_values(AOCSInsertDesc idesc, Datum *d, bool * null, AOTupleId *a
 				 */
 				idesc->ds[i]->blockFirstRowNum = idesc->lastSequence + 2;
 			}
+			else
+				AppendOnlyZoneMap_AddValue(&idesc->zoneMap, i, datum, null[i]);
 		}
+		else
+			AppendOnlyZoneMap_AddValue(&idesc->zoneMap, i, datum, null[i]);
 
 		if (toFree1 != NULL)
 		{
@@ -990,9 +1134,14 @@ void aocs_insert_finish(AOCSInsertDesc idesc)
 			AppendOnlyStorageWrite_LastWriteBeginPosition(&idesc->ds[i]->ao_write),
 			itemCount);
 
+		AppendOnlyZoneMap_FinishBlock(&idesc->zoneMap, i,
+									  idesc->ds[i]->blockFirstRowNum,
+									  itemCount);
+
 		datumstreamwrite_close_file(idesc->ds[i]);
 	}
 
+	AppendOnlyZoneMap_End_forInsert(&idesc->zoneMap);
 	AppendOnlyBlockDirectory_End_forInsert(&(idesc->blockDirectory));
 
 	UpdateAOCSFileSegInfo(idesc);
@@ -1284,6 +1433,10 @@ aocs_fetch_init(Relation relation,
 								   relation->rd_rel->relname.data,
 								   /* title */ titleBuf.data);
 
+			/* Fetches jump around the file; reading ahead would be wasted */
+			AppendOnlyStorageRead_SetPrefetchDepth(
+				&aocsFetchDesc->datumStreamFetchDesc[colno]->datumStream->ao_read,
+				0);
 		}
 		if (opts[colno])
 		{
@@ -2149,6 +2302,12 @@ NextSeg:
 
     if (ctxt->seg_status == SEG_SINGLE_MODE) {
         int row = 0;
+
+        if (ctxt->runs != NULL) {
+            for (int col = 0; col < ctxt->ncol; col++) {
+                ctxt->runs[col] = NULL;
+            }
+        }
         // Roughly same code as aocs_getnext.
         while (nfill == 0) {
             for (int col = 0; col < ctxt->ncol; col++) {
@@ -2174,6 +2333,22 @@ NextSeg:
                 }
             }
 
+            if (scan->zoneMap != NULL && rowNum != -1) {
+                int64 boundaryRowNum;
+
+                err = aocs_zonemap_skip(scan, scan->relationTupleDesc->natts,
+                                        rowNum, &boundaryRowNum);
+                if (err < 0) {
+                    close_cur_scan_seg(scan);
+                    ctxt->seg_status = SEG_NOT_OPEN;
+                    goto NextSeg;
+                }
+                if (err > 0) {
+                    rowNum = -1;
+                    continue;
+                }
+            }
+
             AOTupleId aotid;
             AOTupleIdInit_Init(&aotid); 
             AOTupleIdInit_segmentFileNum(&aotid, scan->seginfo[scan->cur_seg]->segno);
@@ -2219,10 +2394,38 @@ NextSeg:
 
     if (rowNum == -1) {
         rowNum = scan->cur_seg_row + 1; 
+    } else if (scan->zoneMap != NULL) {
+        // Skip what the zone maps rule out, or stop the batch where the next
+        // skippable range starts.
+        int64 boundaryRowNum;
+
+        err = aocs_zonemap_skip(scan, scan->relationTupleDesc->natts,
+                                rowNum, &boundaryRowNum);
+        if (err < 0) {
+            close_cur_scan_seg(scan);
+            ctxt->seg_status = SEG_NOT_OPEN;
+            goto NextSeg;
+        }
+        if (err > 0) {
+            for (int i = 0; i < ctxt->ncol; i++) {
+                DatumStreamRead *ds = scan->ds[ctxt->colattrs[i] - 1];
+                ctxt->row_available[i] = ds->blockRead.logical_row_count -
+                    (datumstreamread_nth(ds) + 1);
+                if (ds->largeObjectState != DatumStreamLargeObjectState_None) {
+                    ctxt->seg_status = SEG_SINGLE_MODE;
+                }
+            }
+            goto NextSeg;
+        }
+        if (boundaryRowNum - rowNum < nfillmax) {
+            nfillmax = boundaryRowNum - rowNum;
+        }
     }
 
     Assert( nfillmax > 0);
 
+    bool vis[nfillmax];
+
     if (isSnapshotAny) {
         // All rows are good.
         nfill = nfillmax;
@@ -2235,18 +2438,7 @@ NextSeg:
                 AOTupleIdInit_rowNum(&ctxt->aotid[i], rowNum + i); 
             } 
         }
-
-        for (int col = 0; col < ctxt->ncol; col++) {
-            DatumStreamRead *ds = scan->ds[ctxt->colattrs[col] - 1];
-            for (int row = 0; row < nfill; row++) {
-                err = DatumStreamBlockRead_Advance(&ds->blockRead);
-                Assert( err > 0);
-                DatumStreamBlockRead_Get(&ds->blockRead, &ctxt->datum[row][col], &ctxt->isnull[row][col]);
-            }
-            ctxt->row_available[col] -= nfill;
-        }
     } else {
-        bool vis[nfillmax];
         AOTupleId aotid;
 
         Assert(nfill == 0);
@@ -2264,22 +2456,33 @@ NextSeg:
                 nfill++;
             }
         }
+    }
 
-        for (int col = 0; col < ctxt->ncol; col++) {
-            DatumStreamRead *ds = scan->ds[ctxt->colattrs[col] - 1];
-            int row = 0;
-            for (int lrow = 0; lrow < nfillmax; lrow++) {
-                err = DatumStreamBlockRead_Advance(&ds->blockRead);
-                Assert( err > 0);
-                if (vis[lrow]) {
-                    DatumStreamBlockRead_Get(&ds->blockRead, &ctxt->datum[row][col], &ctxt->isnull[row][col]);
-                    row++;
-                }
+    // Decode each column a batch at a time, then spread it over the rows.
+    for (int col = 0; col < ctxt->ncol; col++) {
+        DatumStreamRead *ds = scan->ds[ctxt->colattrs[col] - 1];
+        Datum values[nfillmax];
+        bool nulls[nfillmax];
+        int32 *runids = NULL;
+        int n;
+
+        if (ctxt->runs != NULL) {
+            if (ds->blockRead.rle_block_was_compressed) {
+                runids = &ctxt->runbuf[col * ctxt->maxrows];
             }
-            Assert( row == nfill);
-            Assert( nfillmax <= ctxt->row_available[col]);
-            ctxt->row_available[col] -= nfillmax;
+            ctxt->runs[col] = runids;
+        }
+
+        n = DatumStreamBlockRead_GetBatch(&ds->blockRead, nfillmax,
+                                          isSnapshotAny ? NULL : vis,
+                                          values, nulls, runids);
+        Assert( n == nfill);
+        for (int row = 0; row < n; row++) {
+            ctxt->datum[row][col] = values[row];
+            ctxt->isnull[row][col] = nulls[row];
         }
+        Assert( nfillmax <= ctxt->row_available[col]);
+        ctxt->row_available[col] -= nfillmax;
     }
 
     scan->cur_seg_row += nfillmax;
@@ -0,0 +1,1069 @@
+/*-----------------------------------------------------------------------------
+ *
+ * appendonly_zonemap
+ *    maintain per-block min/max zone maps for append-only relations and
+ *    use them to skip blocks during scans.
+ *
+ * See access/appendonly_zonemap.h for an overview.
+ *
+ * The writer follows the block directory closely: it keeps the last zone
+ * map page of every covered column in memory, appends one entry per block
+ * written, and writes the page out to the block directory relation when it
+ * is full and at the end of the insert.
+ *
+ * The reader turns the simple conjuncts of a scan qual ("Var op Const" with
+ * a btree operator of the column's default operator class, and IS [NOT]
+ * NULL) into keys, and when a segment file is opened, loads the zone maps
+ * of the columns with keys into a sorted list of row ranges no row of which
+ * can pass the qual.  The scans then step over those ranges.
+ *
+ *-----------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/appendonly_zonemap.h"
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/nbtree.h"
+#include "catalog/aoblkdir.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
+#include "cdb/cdbvars.h"
+#include "commands/defrem.h"
+#include "nodes/primnodes.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/*
+ * How to compare two values of a column.  Common integer-like types are
+ * compared inline, everything else through the btree comparison function.
+ */
+typedef enum ZoneMapCompareKind
+{
+	ZONEMAP_CMP_PROC = 0,
+	ZONEMAP_CMP_INT16,
+	ZONEMAP_CMP_INT32,
+	ZONEMAP_CMP_INT64
+} ZoneMapCompareKind;
+
+typedef struct ZoneMapCompare
+{
+	Oid typid;
+	Oid opclass;
+	ZoneMapCompareKind kind;
+	FmgrInfo cmpProc;
+} ZoneMapCompare;
+
+/*
+ * Per-column state of the writer.
+ */
+typedef struct AppendOnlyZoneMapColumn
+{
+	bool tracked;
+	ZoneMapCompare cmp;
+
+	/* Summary of the block currently being filled */
+	int64 rowCount;
+	int64 nullCount;
+	Datum min;
+	Datum max;
+
+	/* The last zone map page of the column */
+	AppendOnlyZoneMapPage *page;
+	uint32 numEntries;
+	bool dirty;
+	ItemPointerData tupleTid;
+} AppendOnlyZoneMapColumn;
+
+/*
+ * A qual key the reader checks zone map entries against.  strategy is a
+ * btree strategy number, or InvalidStrategy for a NULL test.
+ */
+typedef struct ZoneMapScanKey
+{
+	StrategyNumber strategy;
+	Datum value;
+	NullTestType nullTestType;
+} ZoneMapScanKey;
+
+typedef struct ZoneMapScanColumn
+{
+	AttrNumber attno;
+	ZoneMapCompare cmp;
+	int numKeys;
+	ZoneMapScanKey *keys;
+} ZoneMapScanColumn;
+
+/*
+ * A range of rows [firstRowNum, afterRowNum) that can be skipped.
+ */
+typedef struct ZoneMapSkipRange
+{
+	int64 firstRowNum;
+	int64 afterRowNum;
+} ZoneMapSkipRange;
+
+struct AppendOnlyZoneMapScan
+{
+	MemoryContext memoryContext;
+
+	Relation aoRel;
+	Relation blkdirRel;
+	Relation blkdirIdx;
+	Snapshot appendOnlyMetaDataSnapshot;
+
+	/* Columns that have keys, at most one per attribute */
+	int numColumns;
+	ZoneMapScanColumn *columns;
+
+	/* Skippable ranges of the current segment file, sorted and disjoint */
+	int numRanges;
+	int maxRanges;
+	ZoneMapSkipRange *ranges;
+
+	/* Index of the first range that ends after the last row looked up */
+	int nextRange;
+};
+
+static inline uint32
+zonemap_page_size(uint32 nEntry)
+{
+	return offsetof(AppendOnlyZoneMapPage, entry) +
+		sizeof(AppendOnlyZoneMapEntry) * nEntry;
+}
+
+/*
+ * zonemap_init_compare
+ *
+ * Set up the comparison for values of type typid.  Returns false if zone
+ * maps cannot cover the type.
+ */
+static bool
+zonemap_init_compare(ZoneMapCompare *cmp, Oid typid, MemoryContext mcxt)
+{
+	int16 typlen;
+	bool typbyval;
+	Oid cmpProcOid;
+
+	get_typlenbyval(typid, &typlen, &typbyval);
+	if (!typbyval || typlen <= 0 || typlen > (int16) sizeof(int64))
+		return false;
+
+	cmp->opclass = GetDefaultOpClass(typid, BTREE_AM_OID);
+	if (!OidIsValid(cmp->opclass))
+		return false;
+
+	cmpProcOid = get_opclass_proc(cmp->opclass, InvalidOid, BTORDER_PROC);
+	if (!RegProcedureIsValid(cmpProcOid))
+		return false;
+
+	cmp->typid = typid;
+	fmgr_info_cxt(cmpProcOid, &cmp->cmpProc, mcxt);
+
+	switch (typid)
+	{
+		case INT2OID:
+			cmp->kind = ZONEMAP_CMP_INT16;
+			break;
+		case INT4OID:
+		case DATEOID:
+			cmp->kind = ZONEMAP_CMP_INT32;
+			break;
+		case INT8OID:
+#ifdef HAVE_INT64_TIMESTAMP
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			cmp->kind = ZONEMAP_CMP_INT64;
+			break;
+		default:
+			cmp->kind = ZONEMAP_CMP_PROC;
+			break;
+	}
+
+	return true;
+}
+
+static inline int
+zonemap_compare(ZoneMapCompare *cmp, Datum a, Datum b)
+{
+	switch (cmp->kind)
+	{
+		case ZONEMAP_CMP_INT16:
+			return (DatumGetInt16(a) > DatumGetInt16(b)) -
+				(DatumGetInt16(a) < DatumGetInt16(b));
+		case ZONEMAP_CMP_INT32:
+			return (DatumGetInt32(a) > DatumGetInt32(b)) -
+				(DatumGetInt32(a) < DatumGetInt32(b));
+		case ZONEMAP_CMP_INT64:
+			return (DatumGetInt64(a) > DatumGetInt64(b)) -
+				(DatumGetInt64(a) < DatumGetInt64(b));
+		default:
+			return DatumGetInt32(FunctionCall2(&cmp->cmpProc, a, b));
+	}
+}
+
+/*
+ * load_last_page
+ *
+ * Load the last zone map page of a column of the current segment file,
+ * the same way the block directory loads its last minipage, so that new
+ * entries are appended to it instead of starting a new row per insert.
+ */
+static void
+load_last_page(AppendOnlyZoneMapInsert *zoneMap,
+			   int columnNo,
+			   int64 lastSequence)
+{
+	AppendOnlyBlockDirectory *blockDirectory = zoneMap->blockDirectory;
+	AppendOnlyZoneMapColumn *column = &zoneMap->columns[columnNo];
+	Relation blkdirRel = blockDirectory->blkdirRel;
+	TupleDesc heapTupleDesc = RelationGetDescr(blkdirRel);
+	ScanKey scanKeys = blockDirectory->scanKeys;
+	IndexScanDesc idxScanDesc;
+	HeapTuple tuple;
+
+	Assert(blockDirectory->numScanKeys == 3);
+
+	if (lastSequence == 0)
+		lastSequence = 1;
+
+	scanKeys[0].sk_argument =
+		Int32GetDatum(blockDirectory->currentSegmentFileNum);
+	scanKeys[1].sk_argument =
+		Int32GetDatum(AppendOnlyZoneMap_ColumnGroupNo(columnNo + 1));
+	scanKeys[2].sk_argument = Int64GetDatum(lastSequence);
+
+	idxScanDesc = index_beginscan(blkdirRel, blockDirectory->blkdirIdx,
+								  blockDirectory->appendOnlyMetaDataSnapshot,
+								  blockDirectory->numScanKeys, scanKeys);
+
+	tuple = index_getnext(idxScanDesc, BackwardScanDirection);
+	if (tuple != NULL)
+	{
+		bool isnull;
+		Datum value;
+		AppendOnlyZoneMapPage *page;
+
+		value = heap_getattr(tuple, Anum_pg_aoblkdir_minipage,
+							 heapTupleDesc, &isnull);
+		Assert(!isnull);
+
+		page = (AppendOnlyZoneMapPage *) pg_detoast_datum(
+			(struct varlena *) DatumGetPointer(value));
+
+		/*
+		 * A page built for another type, e.g. before the column was
+		 * rewritten, is left alone; a new page is started after it.
+		 */
+		if (page->version == APPENDONLY_ZONEMAP_VERSION &&
+			page->typid == column->cmp.typid &&
+			page->nEntry <= NUM_ZONEMAP_ENTRIES)
+		{
+			memcpy(column->page, page, VARSIZE(page));
+			column->numEntries = page->nEntry;
+			ItemPointerCopy(&tuple->t_self, &column->tupleTid);
+
+			/* Drop entries of rows that were never committed. */
+			while (column->numEntries > 0 &&
+				   column->page->entry[column->numEntries - 1].firstRowNum > lastSequence)
+				column->numEntries--;
+		}
+
+		if ((Pointer) page != DatumGetPointer(value))
+			pfree(page);
+	}
+
+	index_endscan(idxScanDesc);
+}
+
+/*
+ * write_page
+ *
+ * Write the in-memory zone map page of a column to the block directory
+ * relation.
+ */
+static void
+write_page(AppendOnlyZoneMapInsert *zoneMap, int columnNo)
+{
+	AppendOnlyBlockDirectory *blockDirectory = zoneMap->blockDirectory;
+	AppendOnlyZoneMapColumn *column = &zoneMap->columns[columnNo];
+	Relation blkdirRel = blockDirectory->blkdirRel;
+	TupleDesc heapTupleDesc = RelationGetDescr(blkdirRel);
+	Datum *values = blockDirectory->values;
+	bool *nulls = blockDirectory->nulls;
+	HeapTuple tuple;
+	MemoryContext oldcxt;
+
+	Assert(column->numEntries > 0);
+
+	oldcxt = MemoryContextSwitchTo(zoneMap->memoryContext);
+
+	values[Anum_pg_aoblkdir_segno - 1] =
+		Int32GetDatum(blockDirectory->currentSegmentFileNum);
+	nulls[Anum_pg_aoblkdir_segno - 1] = false;
+
+	values[Anum_pg_aoblkdir_columngroupno - 1] =
+		Int32GetDatum(AppendOnlyZoneMap_ColumnGroupNo(columnNo + 1));
+	nulls[Anum_pg_aoblkdir_columngroupno - 1] = false;
+
+	values[Anum_pg_aoblkdir_firstrownum - 1] =
+		Int64GetDatum(column->page->entry[0].firstRowNum);
+	nulls[Anum_pg_aoblkdir_firstrownum - 1] = false;
+
+	SET_VARSIZE(column->page, zonemap_page_size(column->numEntries));
+	column->page->version = APPENDONLY_ZONEMAP_VERSION;
+	column->page->nEntry = column->numEntries;
+	column->page->typid = column->cmp.typid;
+	values[Anum_pg_aoblkdir_minipage - 1] = PointerGetDatum(column->page);
+	nulls[Anum_pg_aoblkdir_minipage - 1] = false;
+
+	tuple = heaptuple_form_to(heapTupleDesc, values, nulls, NULL, NULL);
+
+	ereportif(Debug_appendonly_print_blockdirectory, LOG,
+			  (errmsg("Append-only zone map %s a page: "
+					  "(segno, attno, nEntries, firstRowNum) = "
+					  "(%d, %d, %u, " INT64_FORMAT ")",
+					  ItemPointerIsValid(&column->tupleTid) ? "update" : "insert",
+					  blockDirectory->currentSegmentFileNum,
+					  columnNo + 1, column->numEntries,
+					  column->page->entry[0].firstRowNum)));
+
+	if (ItemPointerIsValid(&column->tupleTid))
+		simple_heap_update(blkdirRel, &column->tupleTid, tuple);
+	else
+		simple_heap_insert(blkdirRel, tuple);
+
+	CatalogUpdateIndexes(blkdirRel, tuple);
+
+	heap_freetuple(tuple);
+
+	column->dirty = false;
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * AppendOnlyZoneMap_Init_forInsert
+ *
+ * Initialize the zone maps for an insert into the segment file the block
+ * directory was initialized for.  Zone maps are only maintained when the
+ * relation has a block directory.
+ */
+void
+AppendOnlyZoneMap_Init_forInsert(
+	AppendOnlyZoneMapInsert *zoneMap,
+	AppendOnlyBlockDirectory *blockDirectory,
+	TupleDesc tupleDesc,
+	int64 lastSequence)
+{
+	MemoryContext oldcxt;
+	int columnNo;
+	bool anyTracked = false;
+
+	zoneMap->blockDirectory = NULL;
+	zoneMap->columns = NULL;
+	zoneMap->numColumns = 0;
+
+	if (!gp_appendonly_zonemaps ||
+		blockDirectory->blkdirRel == NULL ||
+		blockDirectory->blkdirIdx == NULL)
+		return;
+
+	zoneMap->blockDirectory = blockDirectory;
+	zoneMap->memoryContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "ZoneMapInsertContext",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+
+	oldcxt = MemoryContextSwitchTo(zoneMap->memoryContext);
+
+	zoneMap->numColumns = tupleDesc->natts;
+	zoneMap->columns =
+		palloc0(sizeof(AppendOnlyZoneMapColumn) * tupleDesc->natts);
+
+	for (columnNo = 0; columnNo < tupleDesc->natts; columnNo++)
+	{
+		Form_pg_attribute attr = tupleDesc->attrs[columnNo];
+		AppendOnlyZoneMapColumn *column = &zoneMap->columns[columnNo];
+
+		if (attr->attisdropped ||
+			!zonemap_init_compare(&column->cmp, attr->atttypid,
+								  zoneMap->memoryContext))
+			continue;
+
+		column->tracked = true;
+		column->page = palloc0(zonemap_page_size(NUM_ZONEMAP_ENTRIES));
+		ItemPointerSetInvalid(&column->tupleTid);
+
+		load_last_page(zoneMap, columnNo, lastSequence);
+
+		anyTracked = true;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (!anyTracked)
+	{
+		MemoryContextDelete(zoneMap->memoryContext);
+		zoneMap->blockDirectory = NULL;
+		zoneMap->columns = NULL;
+		zoneMap->numColumns = 0;
+	}
+}
+
+/*
+ * AppendOnlyZoneMap_AddValue
+ *
+ * Account for a value of a column that went into the block currently
+ * being filled.
+ */
+void
+AppendOnlyZoneMap_AddValue(
+	AppendOnlyZoneMapInsert *zoneMap,
+	int columnNo,
+	Datum value,
+	bool isnull)
+{
+	AppendOnlyZoneMapColumn *column;
+
+	if (zoneMap->columns == NULL)
+		return;
+
+	Assert(columnNo >= 0 && columnNo < zoneMap->numColumns);
+	column = &zoneMap->columns[columnNo];
+	if (!column->tracked)
+		return;
+
+	column->rowCount++;
+	if (isnull)
+	{
+		column->nullCount++;
+		return;
+	}
+
+	if (column->rowCount - column->nullCount == 1)
+	{
+		column->min = value;
+		column->max = value;
+	}
+	else if (zonemap_compare(&column->cmp, value, column->min) < 0)
+		column->min = value;
+	else if (zonemap_compare(&column->cmp, value, column->max) > 0)
+		column->max = value;
+}
+
+/*
+ * AppendOnlyZoneMap_AddMemTuple
+ *
+ * Account for all covered columns of a row of a row-oriented table.
+ */
+void
+AppendOnlyZoneMap_AddMemTuple(
+	AppendOnlyZoneMapInsert *zoneMap,
+	MemTuple tuple,
+	MemTupleBinding *mt_bind)
+{
+	int columnNo;
+
+	if (zoneMap->columns == NULL)
+		return;
+
+	for (columnNo = 0; columnNo < zoneMap->numColumns; columnNo++)
+	{
+		Datum value;
+		bool isnull;
+
+		if (!zoneMap->columns[columnNo].tracked)
+			continue;
+
+		value = memtuple_getattr(tuple, mt_bind, columnNo + 1, &isnull);
+		AppendOnlyZoneMap_AddValue(zoneMap, columnNo, value, isnull);
+	}
+}
+
+/*
+ * AppendOnlyZoneMap_FinishBlock
+ *
+ * A block of a column holding rows [firstRowNum, firstRowNum + rowCount)
+ * has been written.  Add its zone map entry.
+ *
+ * If the values accounted for do not match the block, no entry is added
+ * and the block simply has no zone map.
+ */
+void
+AppendOnlyZoneMap_FinishBlock(
+	AppendOnlyZoneMapInsert *zoneMap,
+	int columnNo,
+	int64 firstRowNum,
+	int64 rowCount)
+{
+	AppendOnlyZoneMapColumn *column;
+	AppendOnlyZoneMapEntry *entry;
+
+	if (zoneMap->columns == NULL)
+		return;
+
+	Assert(columnNo >= 0 && columnNo < zoneMap->numColumns);
+	column = &zoneMap->columns[columnNo];
+	if (!column->tracked)
+		return;
+
+	if (rowCount > 0 && column->rowCount == rowCount && firstRowNum > 0)
+	{
+		if (column->numEntries >= (uint32) NUM_ZONEMAP_ENTRIES)
+		{
+			write_page(zoneMap, columnNo);
+
+			ItemPointerSetInvalid(&column->tupleTid);
+			column->numEntries = 0;
+		}
+
+		Assert(column->numEntries == 0 ||
+			   column->page->entry[column->numEntries - 1].firstRowNum < firstRowNum);
+
+		entry = &column->page->entry[column->numEntries];
+		entry->firstRowNum = firstRowNum;
+		entry->rowCount = rowCount;
+		entry->nullCount = column->nullCount;
+		entry->min = (int64) column->min;
+		entry->max = (int64) column->max;
+
+		column->numEntries++;
+		column->dirty = true;
+	}
+
+	column->rowCount = 0;
+	column->nullCount = 0;
+}
+
+/*
+ * AppendOnlyZoneMap_FinishAllBlocks
+ *
+ * As AppendOnlyZoneMap_FinishBlock, for all columns of a row-oriented
+ * block.
+ */
+void
+AppendOnlyZoneMap_FinishAllBlocks(
+	AppendOnlyZoneMapInsert *zoneMap,
+	int64 firstRowNum,
+	int64 rowCount)
+{
+	int columnNo;
+
+	for (columnNo = 0; columnNo < zoneMap->numColumns; columnNo++)
+		AppendOnlyZoneMap_FinishBlock(zoneMap, columnNo, firstRowNum, rowCount);
+}
+
+/*
+ * AppendOnlyZoneMap_End_forInsert
+ *
+ * Write out the pending zone map pages.  Must be called before the block
+ * directory is ended, as its relation is used to store the pages.
+ */
+void
+AppendOnlyZoneMap_End_forInsert(
+	AppendOnlyZoneMapInsert *zoneMap)
+{
+	int columnNo;
+
+	if (zoneMap->columns == NULL)
+		return;
+
+	for (columnNo = 0; columnNo < zoneMap->numColumns; columnNo++)
+	{
+		AppendOnlyZoneMapColumn *column = &zoneMap->columns[columnNo];
+
+		if (column->tracked && column->dirty && column->numEntries > 0)
+			write_page(zoneMap, columnNo);
+	}
+
+	MemoryContextDelete(zoneMap->memoryContext);
+	zoneMap->blockDirectory = NULL;
+	zoneMap->columns = NULL;
+	zoneMap->numColumns = 0;
+}
+
+/*
+ * zonemap_scan_column
+ *
+ * Find or add the scan column of attribute attno, whose type is expected
+ * to be typid.  Returns NULL if the column is not covered by zone maps.
+ */
+static ZoneMapScanColumn *
+zonemap_scan_column(AppendOnlyZoneMapScan *zoneMapScan,
+					AttrNumber attno, Oid typid)
+{
+	TupleDesc tupleDesc = RelationGetDescr(zoneMapScan->aoRel);
+	ZoneMapScanColumn *column;
+	Form_pg_attribute attr;
+	int i;
+
+	if (attno <= 0 || attno > tupleDesc->natts)
+		return NULL;
+
+	attr = tupleDesc->attrs[attno - 1];
+	if (attr->attisdropped || attr->atttypid != typid)
+		return NULL;
+
+	for (i = 0; i < zoneMapScan->numColumns; i++)
+	{
+		if (zoneMapScan->columns[i].attno == attno)
+			return &zoneMapScan->columns[i];
+	}
+
+	column = &zoneMapScan->columns[zoneMapScan->numColumns];
+	MemSet(column, 0, sizeof(ZoneMapScanColumn));
+	if (!zonemap_init_compare(&column->cmp, typid, zoneMapScan->memoryContext))
+		return NULL;
+
+	column->attno = attno;
+	column->keys = palloc(sizeof(ZoneMapScanKey) * 4);
+	zoneMapScan->numColumns++;
+
+	return column;
+}
+
+static void
+zonemap_add_key(ZoneMapScanColumn *column, ZoneMapScanKey *key)
+{
+	/* keys starts out with 4 slots and doubles whenever it is full */
+	if (column->numKeys >= 4 && (column->numKeys & (column->numKeys - 1)) == 0)
+		column->keys = repalloc(column->keys,
+								sizeof(ZoneMapScanKey) * column->numKeys * 2);
+
+	column->keys[column->numKeys++] = *key;
+}
+
+/*
+ * zonemap_add_qual
+ *
+ * Add a key for one conjunct of the scan qual, if it is a form the zone
+ * maps can decide.
+ */
+static void
+zonemap_add_qual(AppendOnlyZoneMapScan *zoneMapScan, Expr *clause,
+				 Index scanrelid)
+{
+	ZoneMapScanColumn *column;
+	ZoneMapScanKey key;
+
+	if (IsA(clause, OpExpr))
+	{
+		OpExpr *opexpr = (OpExpr *) clause;
+		Oid opno = opexpr->opno;
+		Expr *leftop;
+		Expr *rightop;
+		Var *var;
+		Const *con;
+		Oid lefttype;
+		Oid righttype;
+		int strategy;
+
+		if (list_length(opexpr->args) != 2)
+			return;
+
+		leftop = (Expr *) linitial(opexpr->args);
+		rightop = (Expr *) lsecond(opexpr->args);
+
+		if (IsA(leftop, Const) && IsA(rightop, Var))
+		{
+			Expr *tmp = leftop;
+
+			leftop = rightop;
+			rightop = tmp;
+			opno = get_commutator(opno);
+			if (!OidIsValid(opno))
+				return;
+		}
+
+		if (!IsA(leftop, Var) || !IsA(rightop, Const))
+			return;
+
+		var = (Var *) leftop;
+		con = (Const *) rightop;
+
+		if (var->varno != scanrelid || var->varlevelsup != 0 ||
+			con->constisnull || con->consttype != var->vartype)
+			return;
+
+		op_input_types(opno, &lefttype, &righttype);
+		if (lefttype != var->vartype || righttype != var->vartype)
+			return;
+
+		column = zonemap_scan_column(zoneMapScan, var->varattno, var->vartype);
+		if (column == NULL)
+			return;
+
+		strategy = get_op_opclass_strategy(opno, column->cmp.opclass);
+		if (strategy < BTLessStrategyNumber || strategy > BTMaxStrategyNumber)
+			return;
+
+		key.strategy = strategy;
+		key.value = con->constvalue;
+		key.nullTestType = IS_NOT_NULL;
+		zonemap_add_key(column, &key);
+	}
+	else if (IsA(clause, NullTest))
+	{
+		NullTest *ntest = (NullTest *) clause;
+		Var *var;
+
+		if (!IsA(ntest->arg, Var))
+			return;
+
+		var = (Var *) ntest->arg;
+		if (var->varno != scanrelid || var->varlevelsup != 0)
+			return;
+
+		column = zonemap_scan_column(zoneMapScan, var->varattno, var->vartype);
+		if (column == NULL)
+			return;
+
+		key.strategy = InvalidStrategy;
+		key.value = (Datum) 0;
+		key.nullTestType = ntest->nulltesttype;
+		zonemap_add_key(column, &key);
+	}
+}
+
+/*
+ * AppendOnlyZoneMap_BeginScan
+ *
+ * Prepare to skip blocks of a scan of aoRel with the given qual, a list of
+ * implicitly AND'ed clauses over range table entry scanrelid.  Returns
+ * NULL if the zone maps cannot help the scan.
+ */
+AppendOnlyZoneMapScan *
+AppendOnlyZoneMap_BeginScan(
+	Relation aoRel,
+	AppendOnlyEntry *aoEntry,
+	Snapshot appendOnlyMetaDataSnapshot,
+	List *quals,
+	Index scanrelid)
+{
+	AppendOnlyZoneMapScan *zoneMapScan;
+	MemoryContext memoryContext;
+	MemoryContext oldcxt;
+	ListCell *lc;
+
+	if (!gp_appendonly_zonemaps || quals == NIL ||
+		!OidIsValid(aoEntry->blkdirrelid))
+		return NULL;
+
+	memoryContext = AllocSetContextCreate(CurrentMemoryContext,
+										  "ZoneMapScanContext",
+										  ALLOCSET_SMALL_MINSIZE,
+										  ALLOCSET_SMALL_INITSIZE,
+										  ALLOCSET_DEFAULT_MAXSIZE);
+	oldcxt = MemoryContextSwitchTo(memoryContext);
+
+	zoneMapScan = palloc0(sizeof(AppendOnlyZoneMapScan));
+	zoneMapScan->memoryContext = memoryContext;
+	zoneMapScan->aoRel = aoRel;
+	zoneMapScan->appendOnlyMetaDataSnapshot = appendOnlyMetaDataSnapshot;
+	zoneMapScan->columns =
+		palloc(sizeof(ZoneMapScanColumn) * list_length(quals));
+
+	foreach(lc, quals)
+		zonemap_add_qual(zoneMapScan, (Expr *) lfirst(lc), scanrelid);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (zoneMapScan->numColumns == 0)
+	{
+		MemoryContextDelete(memoryContext);
+		return NULL;
+	}
+
+	Assert(OidIsValid(aoEntry->blkdiridxid));
+	zoneMapScan->blkdirRel = heap_open(aoEntry->blkdirrelid, AccessShareLock);
+	zoneMapScan->blkdirIdx = index_open(aoEntry->blkdiridxid, AccessShareLock);
+
+	return zoneMapScan;
+}
+
+/*
+ * zonemap_entry_excluded
+ *
+ * Can no row summarized by entry satisfy all keys of the column?
+ */
+static bool
+zonemap_entry_excluded(ZoneMapScanColumn *column,
+					   AppendOnlyZoneMapEntry *entry)
+{
+	bool allNull = (entry->nullCount == entry->rowCount);
+	Datum min = (Datum) entry->min;
+	Datum max = (Datum) entry->max;
+	int i;
+
+	for (i = 0; i < column->numKeys; i++)
+	{
+		ZoneMapScanKey *key = &column->keys[i];
+
+		if (key->strategy == InvalidStrategy)
+		{
+			if (key->nullTestType == IS_NULL && entry->nullCount == 0)
+				return true;
+			if (key->nullTestType == IS_NOT_NULL && allNull)
+				return true;
+			continue;
+		}
+
+		/* btree operators are strict, so NULLs never pass */
+		if (allNull)
+			return true;
+
+		switch (key->strategy)
+		{
+			case BTLessStrategyNumber:
+				if (zonemap_compare(&column->cmp, min, key->value) >= 0)
+					return true;
+				break;
+			case BTLessEqualStrategyNumber:
+				if (zonemap_compare(&column->cmp, min, key->value) > 0)
+					return true;
+				break;
+			case BTEqualStrategyNumber:
+				if (zonemap_compare(&column->cmp, min, key->value) > 0 ||
+					zonemap_compare(&column->cmp, max, key->value) < 0)
+					return true;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				if (zonemap_compare(&column->cmp, max, key->value) < 0)
+					return true;
+				break;
+			case BTGreaterStrategyNumber:
+				if (zonemap_compare(&column->cmp, max, key->value) <= 0)
+					return true;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return false;
+}
+
+static int
+zonemap_range_cmp(const void *a, const void *b)
+{
+	const ZoneMapSkipRange *ra = (const ZoneMapSkipRange *) a;
+	const ZoneMapSkipRange *rb = (const ZoneMapSkipRange *) b;
+
+	if (ra->firstRowNum != rb->firstRowNum)
+		return (ra->firstRowNum > rb->firstRowNum) ? 1 : -1;
+	return 0;
+}
+
+static void
+zonemap_add_range(AppendOnlyZoneMapScan *zoneMapScan,
+				  int64 firstRowNum, int64 afterRowNum)
+{
+	ZoneMapSkipRange *range;
+
+	/* Entries come in row order per column; extend the last range if we can */
+	if (zoneMapScan->numRanges > 0)
+	{
+		range = &zoneMapScan->ranges[zoneMapScan->numRanges - 1];
+		if (range->afterRowNum == firstRowNum)
+		{
+			range->afterRowNum = afterRowNum;
+			return;
+		}
+	}
+
+	if (zoneMapScan->numRanges >= zoneMapScan->maxRanges)
+	{
+		zoneMapScan->maxRanges = Max(64, zoneMapScan->maxRanges * 2);
+		if (zoneMapScan->ranges == NULL)
+			zoneMapScan->ranges = MemoryContextAlloc(
+				zoneMapScan->memoryContext,
+				sizeof(ZoneMapSkipRange) * zoneMapScan->maxRanges);
+		else
+			zoneMapScan->ranges = repalloc(
+				zoneMapScan->ranges,
+				sizeof(ZoneMapSkipRange) * zoneMapScan->maxRanges);
+	}
+
+	range = &zoneMapScan->ranges[zoneMapScan->numRanges++];
+	range->firstRowNum = firstRowNum;
+	range->afterRowNum = afterRowNum;
+}
+
+/*
+ * AppendOnlyZoneMap_LoadSegment
+ *
+ * Load the skippable row ranges of segment file segno.
+ */
+void
+AppendOnlyZoneMap_LoadSegment(
+	AppendOnlyZoneMapScan *zoneMapScan,
+	int segno)
+{
+	TupleDesc heapTupleDesc = RelationGetDescr(zoneMapScan->blkdirRel);
+	int columnNo;
+	int i;
+	int n;
+
+	zoneMapScan->numRanges = 0;
+	zoneMapScan->nextRange = 0;
+
+	for (columnNo = 0; columnNo < zoneMapScan->numColumns; columnNo++)
+	{
+		ZoneMapScanColumn *column = &zoneMapScan->columns[columnNo];
+		ScanKeyData scanKeys[2];
+		IndexScanDesc idxScanDesc;
+		HeapTuple tuple;
+
+		ScanKeyInit(&scanKeys[0],
+					Anum_pg_aoblkdir_segno,
+					BTEqualStrategyNumber,
+					F_INT4EQ,
+					Int32GetDatum(segno));
+		ScanKeyInit(&scanKeys[1],
+					Anum_pg_aoblkdir_columngroupno,
+					BTEqualStrategyNumber,
+					F_INT4EQ,
+					Int32GetDatum(AppendOnlyZoneMap_ColumnGroupNo(column->attno)));
+
+		idxScanDesc = index_beginscan(zoneMapScan->blkdirRel,
+									  zoneMapScan->blkdirIdx,
+									  zoneMapScan->appendOnlyMetaDataSnapshot,
+									  2, scanKeys);
+
+		while ((tuple = index_getnext(idxScanDesc, ForwardScanDirection)) != NULL)
+		{
+			bool isnull;
+			Datum value;
+			AppendOnlyZoneMapPage *page;
+			uint32 entryNo;
+
+			value = heap_getattr(tuple, Anum_pg_aoblkdir_minipage,
+								 heapTupleDesc, &isnull);
+			if (isnull)
+				continue;
+
+			page = (AppendOnlyZoneMapPage *) pg_detoast_datum(
+				(struct varlena *) DatumGetPointer(value));
+
+			if (page->version == APPENDONLY_ZONEMAP_VERSION &&
+				page->typid == column->cmp.typid)
+			{
+				for (entryNo = 0; entryNo < page->nEntry; entryNo++)
+				{
+					AppendOnlyZoneMapEntry *entry = &page->entry[entryNo];
+
+					if (zonemap_entry_excluded(column, entry))
+						zonemap_add_range(zoneMapScan, entry->firstRowNum,
+										  entry->firstRowNum + entry->rowCount);
+				}
+			}
+
+			if ((Pointer) page != DatumGetPointer(value))
+				pfree(page);
+		}
+
+		index_endscan(idxScanDesc);
+	}
+
+	if (zoneMapScan->numRanges <= 1)
+		return;
+
+	/* Sort and merge the ranges of all columns */
+	qsort(zoneMapScan->ranges, zoneMapScan->numRanges,
+		  sizeof(ZoneMapSkipRange), zonemap_range_cmp);
+
+	n = 0;
+	for (i = 1; i < zoneMapScan->numRanges; i++)
+	{
+		ZoneMapSkipRange *last = &zoneMapScan->ranges[n];
+		ZoneMapSkipRange *range = &zoneMapScan->ranges[i];
+
+		if (range->firstRowNum <= last->afterRowNum)
+			last->afterRowNum = Max(last->afterRowNum, range->afterRowNum);
+		else
+			zoneMapScan->ranges[++n] = *range;
+	}
+	zoneMapScan->numRanges = n + 1;
+
+	ereportif(Debug_appendonly_print_scan, LOG,
+			  (errmsg("Append-only zone map for table '%s' segment file %d: "
+					  "%d skippable row ranges",
+					  RelationGetRelationName(zoneMapScan->aoRel), segno,
+					  zoneMapScan->numRanges)));
+}
+
+/*
+ * AppendOnlyZoneMap_SkipRow
+ *
+ * Can row rowNum of the current segment file be skipped?  If so, set
+ * *boundaryRowNum to the first row after the skippable range, otherwise
+ * to the first row of the next skippable range (INT64_MAX if none).
+ *
+ * Rows are normally looked up in increasing order, which is cheap.
+ */
+bool
+AppendOnlyZoneMap_SkipRow(
+	AppendOnlyZoneMapScan *zoneMapScan,
+	int64 rowNum,
+	int64 *boundaryRowNum)
+{
+	ZoneMapSkipRange *ranges = zoneMapScan->ranges;
+	int i = zoneMapScan->nextRange;
+
+	if (i > 0 && ranges[i - 1].afterRowNum > rowNum)
+		i = 0;
+
+	while (i < zoneMapScan->numRanges && ranges[i].afterRowNum <= rowNum)
+		i++;
+
+	zoneMapScan->nextRange = i;
+
+	if (i >= zoneMapScan->numRanges)
+	{
+		*boundaryRowNum = INT64CONST(0x7FFFFFFFFFFFFFFF);
+		return false;
+	}
+
+	if (rowNum >= ranges[i].firstRowNum)
+	{
+		*boundaryRowNum = ranges[i].afterRowNum;
+		return true;
+	}
+
+	*boundaryRowNum = ranges[i].firstRowNum;
+	return false;
+}
+
+/*
+ * AppendOnlyZoneMap_SkipRange
+ *
+ * Can all rows [firstRowNum, firstRowNum + rowCount) be skipped?
+ */
+bool
+AppendOnlyZoneMap_SkipRange(
+	AppendOnlyZoneMapScan *zoneMapScan,
+	int64 firstRowNum,
+	int64 rowCount)
+{
+	int64 boundaryRowNum;
+
+	return (AppendOnlyZoneMap_SkipRow(zoneMapScan, firstRowNum, &boundaryRowNum) &&
+			boundaryRowNum >= firstRowNum + rowCount);
+}
+
+void
+AppendOnlyZoneMap_EndScan(
+	AppendOnlyZoneMapScan *zoneMapScan)
+{
+	index_close(zoneMapScan->blkdirIdx, AccessShareLock);
+	heap_close(zoneMapScan->blkdirRel, AccessShareLock);
+
+	MemoryContextDelete(zoneMapScan->memoryContext);
+}
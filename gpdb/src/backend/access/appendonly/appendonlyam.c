@@ -363,6 +363,9 @@ SetNextFileSegForRead(AppendOnlyScanDesc scan)
 								&scan->executorReadBlock,
 								/* blockFirstRowNum */ 1);
 
+	if (scan->zoneMap != NULL)
+		AppendOnlyZoneMap_LoadSegment(scan->zoneMap, segno);
+
 	/* ready to go! */
 	scan->aos_need_new_segfile = false;
 
@@ -1345,20 +1348,38 @@ getNextBlock(
 			return false;
 	}
 
-	if (!AppendOnlyExecutorReadBlock_GetBlockInfo(
-									&scan->storageRead,
-									&scan->executorReadBlock))
+	while (true)
 	{
-		if (scan->buildBlockDirectory)
+		if (!AppendOnlyExecutorReadBlock_GetBlockInfo(
+										&scan->storageRead,
+										&scan->executorReadBlock))
 		{
-			Assert(scan->blockDirectory != NULL);
-			AppendOnlyBlockDirectory_End_forInsert(scan->blockDirectory);
+			if (scan->buildBlockDirectory)
+			{
+				Assert(scan->blockDirectory != NULL);
+				AppendOnlyBlockDirectory_End_forInsert(scan->blockDirectory);
+			}
+
+			/* done reading the file */
+			CloseScannedFileSeg(scan);
+
+			return false;
 		}
 
-		/* done reading the file */
-		CloseScannedFileSeg(scan);
+		/*
+		 * Skip the block without reading its content if the zone maps
+		 * say none of its rows can pass the scan qual.
+		 */
+		if (scan->zoneMap == NULL ||
+			scan->buildBlockDirectory ||
+			!AppendOnlyZoneMap_SkipRange(
+									scan->zoneMap,
+									scan->executorReadBlock.blockFirstRowNum,
+									scan->executorReadBlock.rowCount))
+			break;
 
-		return false;
+		AppendOnlyStorageRead_SkipCurrentBlock(&scan->storageRead);
+		AppendOnlyExecutionReadBlock_FinishedScanBlock(&scan->executorReadBlock);
 	}
 
 	if (scan->buildBlockDirectory)
@@ -1617,6 +1638,11 @@ finishWriteBlock(AppendOnlyInsertDesc aoInsertDesc)
 		AppendOnlyStorageWrite_LastWriteBeginPosition(&aoInsertDesc->storageWrite),
 		itemCount);
 
+	AppendOnlyZoneMap_FinishAllBlocks(
+		&aoInsertDesc->zoneMap,
+		aoInsertDesc->blockFirstRowNum,
+		itemCount);
+
 	Assert(aoInsertDesc->nonCompressedData == NULL);
 	Assert(!AppendOnlyStorageWrite_IsBufferAllocated(&aoInsertDesc->storageWrite));
 }
@@ -1749,6 +1775,7 @@ appendonly_beginrangescan_internal(Relation relation,
 
 	scan->buildBlockDirectory = false;
 	scan->blockDirectory = NULL;
+	scan->zoneMap = NULL;
 
 	AppendOnlyVisimap_Init(&scan->visibilityMap,
 			aoentry->visimaprelid,
@@ -1885,6 +1912,10 @@ appendonly_endscan(AppendOnlyScanDesc scan)
 	AppendOnlyExecutorReadBlock_Finish(&scan->executorReadBlock);
 
 	AppendOnlyVisimap_Finish(&scan->visibilityMap, AccessShareLock);
+
+	if (scan->zoneMap != NULL)
+		AppendOnlyZoneMap_EndScan(scan->zoneMap);
+
 	pfree(scan->aos_filenamepath);
 
 	pfree(scan->aoEntry);
@@ -2369,6 +2400,9 @@ appendonly_fetch_init(
 						aoFetchDesc->title,
 						&aoFetchDesc->storageAttributes);
 
+	/* Fetches jump around the file; reading ahead would be wasted */
+	AppendOnlyStorageRead_SetPrefetchDepth(&aoFetchDesc->storageRead, 0);
+
 
 	fns = get_funcs_for_compression(aoentry->compresstype);
 	aoFetchDesc->storageRead.compression_functions = fns;
@@ -3031,6 +3065,16 @@ appendonly_insert_init(Relation rel, Snapshot appendOnlyMetaDataSnapshot, int se
 		aoInsertDesc->fsInfo, aoInsertDesc->lastSequence,
 		rel, segno, 1, false);
 
+	/*
+	 * Initialize the zone maps.  Large content rows are numbered apart from
+	 * the blocks around them, so keep no zone maps when they can be written.
+	 */
+	if (!aoInsertDesc->useNoToast)
+		AppendOnlyZoneMap_Init_forInsert(&aoInsertDesc->zoneMap,
+										 &aoInsertDesc->blockDirectory,
+										 RelationGetDescr(rel),
+										 aoInsertDesc->lastSequence);
+
 	return aoInsertDesc;
 }
 
@@ -3238,6 +3282,9 @@ appendonly_insert_init(Relation rel, Snapshot appendOnlyMetaDataSnapshot, int se
 
 		if (itemLen > 0)
 			memcpy(itemPtr, tup, itemLen);
+
+		AppendOnlyZoneMap_AddMemTuple(&aoInsertDesc->zoneMap, tup,
+									  aoInsertDesc->mt_bind);
 	}
 	else
 	{
@@ -3338,6 +3385,7 @@ appendonly_insert_finish(AppendOnlyInsertDesc aoInsertDesc)
 
 	CloseWritableFileSeg(aoInsertDesc);
 
+	AppendOnlyZoneMap_End_forInsert(&aoInsertDesc->zoneMap);
 	AppendOnlyBlockDirectory_End_forInsert(&(aoInsertDesc->blockDirectory));
 
 	AppendOnlyStorageWrite_FinishSession(&aoInsertDesc->storageWrite);
@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "access/reloptions.h"
+#include "catalog/pg_compression.h"
 #include "catalog/pg_type.h"
 #include "cdb/cdbappendonlyam.h"
 #include "cdb/cdbvars.h"
@@ -1454,6 +1455,7 @@ void validateAppendOnlyRelOptions(bool ao,
 		(pg_strcasecmp(comptype, "quicklz") == 0 ||
 		 pg_strcasecmp(comptype, "lz4") == 0 ||
 		 pg_strcasecmp(comptype, "zstd") == 0 ||
+		 pg_strcasecmp(comptype, "zstd_dict") == 0 ||
 		 pg_strcasecmp(comptype, "zlib") == 0 ||
 		 pg_strcasecmp(comptype, "rle_type") == 0))
 	{
@@ -1544,10 +1546,14 @@ void validateAppendOnlyRelOptions(bool ao,
  */
 static int setDefaultCompressionLevel(char* compresstype)
 {
-	if(!compresstype || pg_strcasecmp(compresstype, "none") == 0) {
+	const CompressionCodec *codec;
+
+	if(!compresstype || pg_strcasecmp(compresstype, "none") == 0)
 		return 0;
-    } else if (pg_strcasecmp(compresstype, "zstd") == 0) {
-        return 5;
-    } else 
+
+	codec = GetCompressionCodec(compresstype);
+	if (codec != NULL)
+		return codec->default_level;
+	else
 		return 1;
 }
@@ -44,6 +44,7 @@
 #include "commands/copy.h"
 #include "commands/dbcommands.h"
 #include "libpq/libpq-be.h"
+#include "libpq/pqformat.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -63,6 +64,9 @@
 #include "cdb/cdbvars.h"
 
 static HeapTuple externalgettup(FileScanDesc scan, ScanDirection dir);
+static void spq_setup_conv(FormatterData *formatter, TupleDesc tupDesc, bool forwrite);
+static void spq_form_row(CopyState pstate, FormatterData *formatter, TupleDesc tupDesc,
+						 Datum *values, bool *nulls);
 static void InitParseState(CopyState pstate, Relation relation,
 						   Datum* values, bool* nulls, bool writable,
 						   List *fmtOpts, char fmtType,
@@ -284,8 +288,6 @@ external_beginscan(Relation relation, Index scanrelid, uint32 scancounter,
          *
          * Decide if the formatter is a deepgreen builtin.
          */
-#define EXX_FMT_SPQ_IN "vitesse_spq_formatter_in"
-#define EXX_FMT_SPQ_IN_ALLSEGS "vitesse_spq_formatter_in_allsegs"
         if (fmttype_is_spq(fmtType)) {
             scan->fs_formatter->fmt_user_tag = EXX_FMT_SPQ_ALLSEGS;
         } else if (fmtname) {
@@ -295,6 +297,10 @@ external_beginscan(Relation relation, Index scanrelid, uint32 scancounter,
                 scan->fs_formatter->fmt_user_tag = EXX_FMT_SPQ_ALLSEGS;
             }
         }
+
+		/* spq rows are decoded with the types' binary receive functions */
+		if (exx_is_spq_format(scan->fs_formatter->fmt_user_tag))
+			spq_setup_conv(scan->fs_formatter, tupDesc, false);
 	}
 
 	/* Set up callback to identify error line number */
@@ -327,6 +333,10 @@ external_rescan(FileScanDesc scan)
 												 * in first run */
 	scan->fs_pstate->line_done = true;
 	scan->fs_pstate->bytesread = 0;
+
+	/* drop any partial row left over from the previous scan */
+	if (scan->fs_formatter)
+		resetStringInfo(&scan->fs_formatter->fmt_databuf);
 }
 
 /* ----------------
@@ -601,18 +611,22 @@ external_insert_init(Relation rel)
 				   extentry->fmterrtbl,
 				   extentry->encoding);
 
-    /*
-     * EXX: EXX_IN_PG
-     *  Intercept xdrive write.  Regardless if it is CSV or SPQ protocol, we catch it here.
-     */
-    if (IS_XDRIVE_URI(extInsertDesc->ext_uri)) {
-		elog(ERROR, "Xdrive not supported.");
-	}
-
 	if(fmttype_is_custom(extentry->fmtcode))
 	{
 		extInsertDesc->ext_formatter_data = (FormatterData *) palloc0 (sizeof(FormatterData));
 		extInsertDesc->ext_formatter_data->fmt_perrow_ctx = extInsertDesc->ext_pstate->rowcontext;
+
+		/*
+		 * EXX: EXX_IN_PG.
+		 *  spq is built in: rows are encoded with the types' send functions
+		 *  instead of going through a formatter UDF.
+		 */
+		if (fmttype_is_spq(extentry->fmtcode))
+		{
+			extInsertDesc->ext_formatter_data->fmt_user_tag = EXX_FMT_SPQ;
+			spq_setup_conv(extInsertDesc->ext_formatter_data,
+						   extInsertDesc->ext_tupDesc, true);
+		}
 	}
 
 	return extInsertDesc;
@@ -648,18 +662,18 @@ external_insert(ExternalInsertDesc extInsertDesc, HeapTuple instup)
 	if(!extInsertDesc->ext_file && !extInsertDesc->ext_noop)
 		open_external_writable_source(extInsertDesc);
 
-    /*
-     * EXX: EXX_IN_PG.
-     *  Intercept xdrive/spq writes.
-     */
-    if (extInsertDesc->ext_formatter_data && extInsertDesc->ext_formatter_data->fmt_user_tag == EXX_FMT_SPQ) {
-		elog(ERROR, "XDrive/Spq not supported");
-	} 
-
 	/*
 	 * deconstruct the tuple and format it into text
 	 */
-	if(!customFormat)
+	if (extInsertDesc->ext_formatter_data &&
+		exx_is_spq_format(extInsertDesc->ext_formatter_data->fmt_user_tag))
+	{
+		/* EXX: spq binary row */
+		heap_deform_tuple(instup, tupDesc, values, nulls);
+		spq_form_row(pstate, extInsertDesc->ext_formatter_data, tupDesc,
+					 values, nulls);
+	}
+	else if(!customFormat)
 	{
 		/* TEXT or CSV */
 		heap_deform_tuple(instup, tupDesc, values, nulls);
@@ -731,15 +745,7 @@ external_insert(ExternalInsertDesc extInsertDesc, HeapTuple instup)
 void
 external_insert_finish(ExternalInsertDesc extInsertDesc)
 {
-    /*
-     * EXX IN PG:
-     *  Finish xdrive insert.
-     */
-    if (extInsertDesc->ext_formatter_data && extInsertDesc->ext_formatter_data->fmt_user_tag == EXX_FMT_SPQ) {
-		elog(ERROR, "XDrive/Spq not supported.");
-	}
-
-   	/*
+	/*
 	 * Close the external source
 	 */
 	if(extInsertDesc->ext_file)
@@ -1211,6 +1217,243 @@ externalgettup_custom(FileScanDesc scan)
 		return NULL;
 }
 
+/*
+ * EXX: EXX_IN_PG.
+ *
+ * spq is the binary row format used by xdrive.  Each row is an int16
+ * attribute count followed, for every attribute, by an int32 length (-1 for
+ * NULL) and the output of the type's send function.  Integers are in network
+ * byte order.  Dropped attributes are sent as NULL.
+ */
+
+/*
+ * Look up the binary receive (scan) or send (insert) function of every
+ * attribute and keep them in the formatter data.
+ */
+static void
+spq_setup_conv(FormatterData *formatter, TupleDesc tupDesc, bool forwrite)
+{
+	int			natts = tupDesc->natts;
+	int			i;
+
+	formatter->fmt_conv_funcs = (FmgrInfo *) palloc0(natts * sizeof(FmgrInfo));
+	formatter->fmt_typioparams = (Oid *) palloc0(natts * sizeof(Oid));
+
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = tupDesc->attrs[i];
+		Oid			func_oid;
+
+		if (attr->attisdropped)
+			continue;
+
+		if (forwrite)
+		{
+			bool		isvarlena;
+
+			getTypeBinaryOutputInfo(attr->atttypid, &func_oid, &isvarlena);
+		}
+		else
+			getTypeBinaryInputInfo(attr->atttypid, &func_oid,
+								   &formatter->fmt_typioparams[i]);
+
+		fmgr_info(func_oid, &formatter->fmt_conv_funcs[i]);
+	}
+}
+
+/*
+ * Append one spq row for values/nulls to pstate->fe_msgbuf.
+ */
+static void
+spq_form_row(CopyState pstate, FormatterData *formatter, TupleDesc tupDesc,
+			 Datum *values, bool *nulls)
+{
+	StringInfo	msgbuf = pstate->fe_msgbuf;
+	MemoryContext oldcontext;
+	uint16		n16;
+	uint32		n32;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(formatter->fmt_perrow_ctx);
+
+	n16 = htons((uint16) tupDesc->natts);
+	appendBinaryStringInfo(msgbuf, (char *) &n16, sizeof(n16));
+
+	for (i = 0; i < tupDesc->natts; i++)
+	{
+		bytea	   *outputbytes;
+		int32		len;
+
+		if (nulls[i] || tupDesc->attrs[i]->attisdropped)
+		{
+			n32 = htonl((uint32) -1);
+			appendBinaryStringInfo(msgbuf, (char *) &n32, sizeof(n32));
+			continue;
+		}
+
+		outputbytes = SendFunctionCall(&formatter->fmt_conv_funcs[i], values[i]);
+		len = VARSIZE(outputbytes) - VARHDRSZ;
+		n32 = htonl((uint32) len);
+		appendBinaryStringInfo(msgbuf, (char *) &n32, sizeof(n32));
+		appendBinaryStringInfo(msgbuf, VARDATA(outputbytes), len);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(formatter->fmt_perrow_ctx);
+}
+
+/*
+ * Is a whole spq row available in buf, starting at its cursor?
+ */
+static bool
+spq_row_complete(StringInfo buf)
+{
+	int			pos = buf->cursor;
+	int			natts;
+	uint16		n16;
+	uint32		n32;
+	int			i;
+
+	if (buf->len - pos < (int) sizeof(n16))
+		return false;
+	memcpy(&n16, buf->data + pos, sizeof(n16));
+	natts = (int16) ntohs(n16);
+	pos += sizeof(n16);
+
+	for (i = 0; i < natts; i++)
+	{
+		int32		len;
+
+		if (buf->len - pos < (int) sizeof(n32))
+			return false;
+		memcpy(&n32, buf->data + pos, sizeof(n32));
+		len = (int32) ntohl(n32);
+		pos += sizeof(n32);
+
+		if (len > 0)
+		{
+			if (buf->len - pos < len)
+				return false;
+			pos += len;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Decode the complete spq row at the cursor of the formatter data buffer.
+ */
+static HeapTuple
+spq_parse_row(FileScanDesc scan)
+{
+	CopyState	pstate = scan->fs_pstate;
+	FormatterData *formatter = scan->fs_formatter;
+	StringInfo	buf = &formatter->fmt_databuf;
+	TupleDesc	tupDesc = scan->fs_tupDesc;
+	Datum	   *values = scan->values;
+	bool	   *nulls = scan->nulls;
+	StringInfo	attbuf = &pstate->attribute_buf;
+	MemoryContext oldcontext;
+	HeapTuple	tuple;
+	int			natts;
+	int			i;
+
+	natts = (int16) pq_getmsgint(buf, 2);
+	if (natts != tupDesc->natts)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("spq row has %d attributes, expected %d",
+						natts, tupDesc->natts)));
+
+	oldcontext = MemoryContextSwitchTo(formatter->fmt_perrow_ctx);
+
+	for (i = 0; i < natts; i++)
+	{
+		int32		len = (int32) pq_getmsgint(buf, 4);
+
+		if (len == -1)
+		{
+			values[i] = (Datum) 0;
+			nulls[i] = true;
+			continue;
+		}
+
+		if (len < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid field size %d in spq row", len)));
+
+		if (tupDesc->attrs[i]->attisdropped)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("spq row has a value for dropped attribute %d", i + 1)));
+
+		/* receive functions want their own null terminated buffer */
+		resetStringInfo(attbuf);
+		appendBinaryStringInfo(attbuf, pq_getmsgbytes(buf, len), len);
+
+		values[i] = ReceiveFunctionCall(&formatter->fmt_conv_funcs[i], attbuf,
+										formatter->fmt_typioparams[i],
+										tupDesc->attrs[i]->atttypmod);
+		nulls[i] = false;
+
+		if (attbuf->cursor != attbuf->len)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					 errmsg("incorrect binary data format in spq attribute %d",
+							i + 1)));
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	tuple = heap_form_tuple(tupDesc, values, nulls);
+	MemoryContextReset(formatter->fmt_perrow_ctx);
+
+	return tuple;
+}
+
+static HeapTuple
+externalgettup_spq(FileScanDesc scan)
+{
+	CopyState	pstate = scan->fs_pstate;
+	FormatterData *formatter = scan->fs_formatter;
+	StringInfo	buf = &formatter->fmt_databuf;
+
+	Assert(formatter && formatter->fmt_conv_funcs);
+
+	for (;;)
+	{
+		int			bytesread;
+
+		if (spq_row_complete(buf))
+		{
+			HeapTuple	tuple = spq_parse_row(scan);
+
+			pstate->processed++;
+			return tuple;
+		}
+
+		if (pstate->fe_eof)
+			break;
+
+		/* keep the partial row and read more data after it */
+		justifyDatabuf(buf);
+		bytesread = external_getdata((URL_FILE *) scan->fs_file, pstate, RAW_BUF_SIZE);
+		if (bytesread > 0)
+			appendBinaryStringInfo(buf, pstate->raw_buf, bytesread);
+	}
+
+	if (buf->cursor < buf->len)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("unexpected end of data in spq row")));
+
+	scan->fs_inited = false;
+
+	return NULL;
+}
+
 /* ----------------
 *		externalgettup  form another tuple from the data file.
 *		This is the workhorse - make sure it's fast!
@@ -1245,6 +1488,8 @@ externalgettup(FileScanDesc scan,
 
 	if (!custom)
 		return externalgettup_defined(scan); /* text/csv */
+	else if (exx_is_spq_format(scan->fs_formatter->fmt_user_tag))
+		return externalgettup_spq(scan);     /* EXX: spq */
 	else
 		return externalgettup_custom(scan);  /* custom   */
 
@@ -0,0 +1,378 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "../xdrive.c"
+
+#include <sys/wait.h>
+#include "utils/memutils.h"
+
+/*
+ * Each test runs a fake xdrive daemon in a child process, connected to the
+ * client through a socket.  The child exits with a non-zero status if the
+ * client does not follow the protocol.
+ */
+#define DAEMON_CHECK(cond) \
+	do { if (!(cond)) _exit(1); } while (0)
+
+static void
+daemon_recv_all(int sock, void *buf, size_t len)
+{
+	char	   *p = buf;
+
+	while (len > 0)
+	{
+		ssize_t		n = recv(sock, p, len, 0);
+
+		DAEMON_CHECK(n > 0);
+		p += n;
+		len -= n;
+	}
+}
+
+static uint32
+daemon_recv_frame(int sock, char *buf, uint32 *len)
+{
+	uint32		hdr[2];
+
+	daemon_recv_all(sock, hdr, sizeof(hdr));
+	*len = ntohl(hdr[1]);
+	DAEMON_CHECK(*len <= XDRIVE_MAX_FRAME);
+	daemon_recv_all(sock, buf, *len);
+
+	return ntohl(hdr[0]);
+}
+
+static void
+daemon_send_frame(int sock, uint32 type, const void *payload, uint32 len)
+{
+	uint32		hdr[2];
+
+	hdr[0] = htonl(type);
+	hdr[1] = htonl(len);
+	DAEMON_CHECK(send(sock, hdr, sizeof(hdr), 0) == sizeof(hdr));
+	if (len > 0)
+		DAEMON_CHECK(send(sock, payload, len, 0) == len);
+}
+
+static void
+wait_for_daemon(pid_t pid)
+{
+	int			status;
+
+	assert_int_equal(waitpid(pid, &status, 0), pid);
+	assert_true(WIFEXITED(status));
+	assert_int_equal(WEXITSTATUS(status), 0);
+}
+
+/* A connection that has already been opened, on one end of a socketpair */
+static XdriveConn *
+make_conn(int sock, bool forwrite)
+{
+	XdriveConn *conn = calloc(1, sizeof(XdriveConn));
+
+	conn->sock = sock;
+	conn->forwrite = forwrite;
+	conn->url = "xdrive://localhost/test";
+	conn->inbuf = malloc(XDRIVE_MAX_FRAME);
+	conn->outbuf = forwrite ? malloc(XDRIVE_WRITE_FRAME) : NULL;
+
+	return conn;
+}
+
+static char
+pattern_byte(size_t off)
+{
+	return (char) (off % 251);
+}
+
+/* ==================== xdrive_read =================== */
+/*
+ * Tests that the client reassembles DATA frames into the stream and keeps
+ * granting credit, so that a stream larger than the window goes through.
+ */
+void
+test__xdrive_read__stream_and_credit(void **state)
+{
+	size_t		total = 3 * XDRIVE_WINDOW_SIZE / 2 + 1000;
+	int			sv[2];
+	pid_t		pid;
+	XdriveConn *conn;
+	char		buf[10000];
+	size_t		off = 0;
+	size_t		n;
+
+	assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+	pid = fork();
+	if (pid == 0)
+	{
+		char	   *frame = malloc(XDRIVE_MAX_FRAME);
+		uint64		credit = XDRIVE_WINDOW_SIZE;
+		size_t		sent = 0;
+
+		close(sv[0]);
+		while (sent < total)
+		{
+			uint32		len = Min(total - sent, 100000);
+			uint32		i;
+
+			while (credit < len)
+			{
+				uint32		clen;
+
+				DAEMON_CHECK(daemon_recv_frame(sv[1], frame, &clen) == XDRIVE_MSG_CREDIT);
+				DAEMON_CHECK(clen == sizeof(uint32));
+				credit += ntohl(*(uint32 *) frame);
+			}
+
+			for (i = 0; i < len; i++)
+				frame[i] = pattern_byte(sent + i);
+			daemon_send_frame(sv[1], XDRIVE_MSG_DATA, frame, len);
+			credit -= len;
+			sent += len;
+		}
+		daemon_send_frame(sv[1], XDRIVE_MSG_END, NULL, 0);
+		_exit(0);
+	}
+	close(sv[1]);
+
+	conn = make_conn(sv[0], false);
+
+	while ((n = xdrive_read(conn, buf, sizeof(buf))) > 0)
+	{
+		size_t		i;
+
+		for (i = 0; i < n; i++)
+			assert_int_equal(buf[i], pattern_byte(off + i));
+		off += n;
+	}
+	assert_int_equal(off, total);
+
+	/* end of stream is sticky */
+	assert_int_equal(xdrive_read(conn, buf, sizeof(buf)), 0);
+
+	xdrive_close(conn, true);
+	wait_for_daemon(pid);
+}
+
+/* ==================== xdrive_write =================== */
+/*
+ * Tests that a writer sends DATA only within its credit, and that close
+ * sends END and waits for the daemon to confirm.
+ */
+void
+test__xdrive_write__credit_and_end(void **state)
+{
+	size_t		total = 4 * XDRIVE_WRITE_FRAME + 100;
+	int			sv[2];
+	pid_t		pid;
+	XdriveConn *conn;
+	char		buf[7000];
+	size_t		off = 0;
+
+	assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+	pid = fork();
+	if (pid == 0)
+	{
+		char	   *frame = malloc(XDRIVE_MAX_FRAME);
+		uint32		credit = htonl(XDRIVE_WRITE_FRAME);
+		size_t		received = 0;
+		uint64		outstanding = XDRIVE_WRITE_FRAME;
+		uint32		type;
+		uint32		len;
+
+		close(sv[0]);
+		daemon_send_frame(sv[1], XDRIVE_MSG_CREDIT, &credit, sizeof(credit));
+
+		while ((type = daemon_recv_frame(sv[1], frame, &len)) == XDRIVE_MSG_DATA)
+		{
+			uint32		i;
+
+			DAEMON_CHECK(len <= outstanding);
+			outstanding -= len;
+			for (i = 0; i < len; i++)
+				DAEMON_CHECK(frame[i] == pattern_byte(received + i));
+			received += len;
+
+			/* hand back what was used */
+			credit = htonl(len);
+			outstanding += len;
+			daemon_send_frame(sv[1], XDRIVE_MSG_CREDIT, &credit, sizeof(credit));
+		}
+
+		DAEMON_CHECK(type == XDRIVE_MSG_END);
+		DAEMON_CHECK(received == total);
+		daemon_send_frame(sv[1], XDRIVE_MSG_OK, NULL, 0);
+		_exit(0);
+	}
+	close(sv[1]);
+
+	conn = make_conn(sv[0], true);
+
+	while (off < total)
+	{
+		size_t		n = Min(total - off, sizeof(buf));
+		size_t		i;
+
+		for (i = 0; i < n; i++)
+			buf[i] = pattern_byte(off + i);
+		xdrive_write(conn, buf, n);
+		off += n;
+	}
+
+	xdrive_close(conn, true);
+	wait_for_daemon(pid);
+}
+
+/* ==================== xdrive_connect =================== */
+
+static int
+listen_on_loopback(int *port)
+{
+	struct sockaddr_in addr;
+	socklen_t	addrlen = sizeof(addr);
+	int			sock = socket(AF_INET, SOCK_STREAM, 0);
+
+	MemSet(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	assert_int_equal(bind(sock, (struct sockaddr *) &addr, sizeof(addr)), 0);
+	assert_int_equal(listen(sock, 1), 0);
+	assert_int_equal(getsockname(sock, (struct sockaddr *) &addr, &addrlen), 0);
+	*port = ntohs(addr.sin_port);
+
+	return sock;
+}
+
+static bool
+payload_has(const char *payload, uint32 len, const char *kv)
+{
+	const char *p = payload;
+
+	while (p < payload + len)
+	{
+		if (strcmp(p, kv) == 0)
+			return true;
+		p += strlen(p) + 1;
+	}
+	return false;
+}
+
+/*
+ * Tests the OPEN handshake over TCP: the location, mode and parameters are
+ * sent, and a reader grants the initial window.
+ */
+void
+test__xdrive_connect__open_handshake(void **state)
+{
+	const char *params[] = {"fmt", "csv", "segid", "1", NULL};
+	Uri			uri;
+	int			lsock;
+	int			port;
+	pid_t		pid;
+	XdriveConn *conn;
+	char		buf[16];
+
+	lsock = listen_on_loopback(&port);
+
+	pid = fork();
+	if (pid == 0)
+	{
+		char	   *frame = malloc(XDRIVE_MAX_FRAME);
+		int			sock = accept(lsock, NULL, NULL);
+		uint32		len;
+
+		DAEMON_CHECK(sock >= 0);
+		DAEMON_CHECK(daemon_recv_frame(sock, frame, &len) == XDRIVE_MSG_OPEN);
+		DAEMON_CHECK(payload_has(frame, len, "mode=r"));
+		DAEMON_CHECK(payload_has(frame, len, "path=/data/t1"));
+		DAEMON_CHECK(payload_has(frame, len, "fmt=csv"));
+		DAEMON_CHECK(payload_has(frame, len, "segid=1"));
+		daemon_send_frame(sock, XDRIVE_MSG_OK, NULL, 0);
+
+		DAEMON_CHECK(daemon_recv_frame(sock, frame, &len) == XDRIVE_MSG_CREDIT);
+		DAEMON_CHECK(ntohl(*(uint32 *) frame) == XDRIVE_WINDOW_SIZE);
+		daemon_send_frame(sock, XDRIVE_MSG_END, NULL, 0);
+		_exit(0);
+	}
+	close(lsock);
+
+	uri.protocol = URI_XDRIVE;
+	uri.hostname = "127.0.0.1";
+	uri.port = port;
+	uri.path = "/data/t1";
+	uri.customprotocol = NULL;
+
+	expect_any(ParseExternalTableUri, uri);
+	will_return(ParseExternalTableUri, &uri);
+	expect_value(FreeExternalTableUri, uri, &uri);
+	will_be_called(FreeExternalTableUri);
+
+	conn = xdrive_connect("xdrive://127.0.0.1/data/t1", false, params);
+	assert_int_equal(xdrive_read(conn, buf, sizeof(buf)), 0);
+	xdrive_close(conn, true);
+
+	wait_for_daemon(pid);
+}
+
+/*
+ * Tests that a refused connection is reported as an error instead of
+ * waiting for the TCP timeout.
+ */
+void
+test__xdrive_connect__refused(void **state)
+{
+	const char *params[] = {NULL};
+	Uri			uri;
+	int			lsock;
+	int			port;
+	bool		failed = false;
+
+	/* a port that nobody listens on any more */
+	lsock = listen_on_loopback(&port);
+	close(lsock);
+
+	uri.protocol = URI_XDRIVE;
+	uri.hostname = "127.0.0.1";
+	uri.port = port;
+	uri.path = "/data/t1";
+	uri.customprotocol = NULL;
+
+	expect_any(ParseExternalTableUri, uri);
+	will_return(ParseExternalTableUri, &uri);
+
+	PG_TRY();
+	{
+		xdrive_connect("xdrive://127.0.0.1/data/t1", false, params);
+	}
+	PG_CATCH();
+	{
+		failed = true;
+		FlushErrorState();
+	}
+	PG_END_TRY();
+
+	assert_true(failed);
+}
+
+int
+main(int argc, char* argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const UnitTest tests[] = {
+		unit_test(test__xdrive_read__stream_and_credit),
+		unit_test(test__xdrive_write__credit_and_end),
+		unit_test(test__xdrive_connect__open_handshake),
+		unit_test(test__xdrive_connect__refused)
+	};
+
+	MemoryContextInit();
+
+	return run_tests(tests);
+}
@@ -9,9 +9,11 @@
 #include <sys/wait.h>
 
 #include "access/fileam.h"
+#include "access/formatter.h"
 #include "access/heapam.h"
 #include "access/valid.h"
 #include "catalog/pg_extprotocol.h"
+#include "catalog/pg_exttable.h"
 #include "catalog/namespace.h"
 #include "commands/copy.h"
 #include "commands/dbcommands.h"
@@ -51,6 +53,7 @@
 #include "cdb/cdbutil.h"
 #include "cdb/cdbvars.h"
 #include "access/url.h"
+#include "access/xdrive.h"
 
 #include "tcop/tcopprot.h"
 
@@ -1114,7 +1117,7 @@ url_fopen(char *url, bool forwrite, extvar_t *ev, CopyState pstate, int *respons
 	}
 
     if (IS_XDRIVE_URI(url)) {
-        return url_xdrive_fopen(url, forwrite, ev);
+        return url_xdrive_fopen(url, forwrite, ev, pstate);
     }
 
 	URL_FILE* file = alloc_url_file(url);
@@ -1880,7 +1883,7 @@ url_fclose(URL_FILE *file, bool failOnError, const char *relname)
 			break;
 
         case CFTYPE_XDRIVE:
-            url_xdrive_fclose(file);
+            url_xdrive_fclose(file, failOnError);
             break;
 			
 		default: /* unknown or supported type - oh dear */
@@ -2489,8 +2492,7 @@ url_fread(void *ptr, size_t size, size_t nmemb, URL_FILE *file, CopyState pstate
 
 
         case CFTYPE_XDRIVE:
-			ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
-						errmsg("XDrive external table not supported."))); 
+			want = xdrive_read((XdriveConn *) file->u.xdrive.conn, ptr, nmemb * size) / size;
             break;
 
 		case CFTYPE_CUSTOM:
@@ -2538,6 +2540,11 @@ url_fwrite(void *ptr, size_t size, size_t nmemb, URL_FILE *file, CopyState pstat
 						
 			want = (size_t) InvokeExtProtocol(ptr, nmemb * size, file, pstate, false);
 			break;
+
+		case CFTYPE_XDRIVE:
+			xdrive_write((XdriveConn *) file->u.xdrive.conn, ptr, nmemb * size);
+			want = nmemb;
+			break;
 			
 		default: /* unknown or unsupported type */
 			want = 0;
@@ -2573,6 +2580,10 @@ url_fflush(URL_FILE *file, CopyState pstate)
 			break;
 #endif
 
+		case CFTYPE_XDRIVE:
+			xdrive_flush((XdriveConn *) file->u.xdrive.conn);
+			break;
+
 		default: /* unknown or unsupported type */
 			break;
     }
@@ -3003,17 +3014,79 @@ InvokeExtProtocol(void 	   		*ptr,
 
 /*
  * xdrive:
- *  open url.
+ *  open url.  Each segment talks to the xdrive server over its own
+ *  connection, telling it which segment it is so that the server can
+ *  split the data between segments.  See access/xdrive.h.
  */
 URL_FILE*
-url_xdrive_fopen(char *url, bool forwrite, extvar_t *ev)
+url_xdrive_fopen(char *url, bool forwrite, extvar_t *ev, CopyState pstate)
 {
-	elog(ERROR, "Xdrive not suported."); 
-	return 0;
+	URL_FILE   *file;
+	const char *fmt;
+	const char *params[32];
+	int			n = 0;
+
+	/*
+	 * The daemon has to parse the stream to split it between segments, and
+	 * it only knows text, csv and spq.  Refuse any other custom formatter
+	 * rather than sending it data it cannot parse.
+	 */
+	if (pstate != NULL && pstate->custom &&
+		!fmttype_is_spq(pstate->exx_fmtcode) &&
+		!(pstate->custom_formatter_name != NULL &&
+		  exx_is_spq_formatter(pstate->custom_formatter_name)))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("xdrive protocol does not support custom formatter \"%s\"",
+						pstate->custom_formatter_name ? pstate->custom_formatter_name : ""),
+				 errhint("Use the text, csv or spq format with xdrive locations.")));
+
+	if (pstate != NULL && pstate->custom)
+		fmt = "spq";
+	else if (pstate != NULL && pstate->csv_mode)
+		fmt = "csv";
+	else
+		fmt = "text";
+
+	params[n++] = "fmt";		params[n++] = fmt;
+	params[n++] = "segid";		params[n++] = ev->GP_SEGMENT_ID;
+	params[n++] = "segcount";	params[n++] = ev->GP_SEGMENT_COUNT;
+	params[n++] = "session";	params[n++] = ev->GP_SESSION_ID;
+	params[n++] = "xid";		params[n++] = ev->GP_XID;
+	params[n++] = "cid";		params[n++] = ev->GP_CID;
+	params[n++] = "sn";			params[n++] = ev->GP_SN;
+	params[n++] = "database";	params[n++] = ev->GP_DATABASE;
+	params[n++] = "user";		params[n++] = ev->GP_USER;
+	params[n++] = NULL;
+	Assert(n <= lengthof(params));
+
+	file = alloc_url_file(url);
+	file->type = CFTYPE_XDRIVE;
+
+	PG_TRY();
+	{
+		file->u.xdrive.conn = xdrive_connect(url, forwrite, params);
+	}
+	PG_CATCH();
+	{
+		free(file);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	return file;
 }
 
-void url_xdrive_fclose(URL_FILE *file)
+/*
+ * Detach the connection before closing it, so that if closing fails the
+ * abort-time url_fclose() of the same file finds nothing left to close.
+ */
+void url_xdrive_fclose(URL_FILE *file, bool failOnError)
 {
-	elog(ERROR, "Xdrive not suported."); 
+	XdriveConn *conn = (XdriveConn *) file->u.xdrive.conn;
+
+	file->u.xdrive.conn = NULL;
+	if (conn != NULL)
+		xdrive_close(conn, failOnError);
 }
 
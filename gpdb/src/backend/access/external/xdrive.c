@@ -0,0 +1,528 @@
+/*-------------------------------------------------------------------------
+ *
+ * xdrive.c
+ *	  Client side of the xdrive:// external table protocol.
+ *
+ * See access/xdrive.h for the wire protocol.  The connection state lives in
+ * malloc'ed memory, like the URL_FILE that owns it, because it has to
+ * survive until url_fclose() runs from the abort handler.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "access/xdrive.h"
+#include "miscadmin.h"
+#include "utils/uri.h"
+
+struct XdriveConn
+{
+	int			sock;
+	bool		forwrite;
+	char	   *url;			/* for messages */
+
+	/* reading: payload of the current DATA frame */
+	char	   *inbuf;
+	size_t		inlen;
+	size_t		inpos;
+	size_t		unacked;		/* bytes consumed but not yet re-granted */
+	bool		eof;
+
+	/* writing: DATA frame being filled, and credit granted by the daemon */
+	char	   *outbuf;
+	size_t		outlen;
+	uint64		credit;
+	bool		ended;
+};
+
+static void xdrive_free(XdriveConn *conn);
+
+/*
+ * Report a protocol or I/O error.  The socket is closed, but conn itself
+ * stays around: it belongs to a URL_FILE that url_fclose() frees later.
+ */
+static void
+xdrive_fail(XdriveConn *conn, const char *msg)
+{
+	if (conn->sock >= 0)
+		close(conn->sock);
+	conn->sock = -1;
+
+	ereport(ERROR,
+			(errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
+			 errmsg("xdrive: %s", msg),
+			 errdetail("URL: %s", conn->url)));
+}
+
+/*
+ * Wait until the socket is ready for events, servicing interrupts while
+ * we wait.
+ */
+static void
+xdrive_wait(XdriveConn *conn, short events)
+{
+	struct pollfd pfd;
+
+	for (;;)
+	{
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		pfd.fd = conn->sock;
+		pfd.events = events;
+		pfd.revents = 0;
+
+		rc = poll(&pfd, 1, 1000);
+		if (rc > 0)
+			return;
+		if (rc < 0 && errno != EINTR)
+			xdrive_fail(conn, "poll failed");
+	}
+}
+
+static void
+xdrive_send_all(XdriveConn *conn, const char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t		n = send(conn->sock, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				xdrive_wait(conn, POLLOUT);
+				continue;
+			}
+			xdrive_fail(conn, "could not send to xdrive server");
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+static void
+xdrive_recv_all(XdriveConn *conn, char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t		n = recv(conn->sock, buf, len, MSG_DONTWAIT);
+
+		if (n == 0)
+			xdrive_fail(conn, "xdrive server closed the connection unexpectedly");
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				xdrive_wait(conn, POLLIN);
+				continue;
+			}
+			xdrive_fail(conn, "could not receive from xdrive server");
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+static void
+xdrive_send_frame(XdriveConn *conn, uint32 type, const char *payload, uint32 len)
+{
+	uint32		hdr[2];
+
+	hdr[0] = htonl(type);
+	hdr[1] = htonl(len);
+	xdrive_send_all(conn, (char *) hdr, sizeof(hdr));
+	if (len > 0)
+		xdrive_send_all(conn, payload, len);
+}
+
+static void
+xdrive_send_credit(XdriveConn *conn, uint32 credit)
+{
+	uint32		n = htonl(credit);
+
+	xdrive_send_frame(conn, XDRIVE_MSG_CREDIT, (char *) &n, sizeof(n));
+}
+
+/*
+ * Receive the next frame into conn->inbuf.  Returns its type and sets *len.
+ * An ERROR frame is turned into an ereport right here.
+ */
+static uint32
+xdrive_recv_frame(XdriveConn *conn, uint32 *len)
+{
+	uint32		hdr[2];
+	uint32		type;
+
+	xdrive_recv_all(conn, (char *) hdr, sizeof(hdr));
+	type = ntohl(hdr[0]);
+	*len = ntohl(hdr[1]);
+
+	if (*len > XDRIVE_MAX_FRAME)
+		xdrive_fail(conn, "xdrive server sent an oversized frame");
+
+	if (*len > 0)
+		xdrive_recv_all(conn, conn->inbuf, *len);
+
+	if (type == XDRIVE_MSG_ERROR)
+	{
+		char		msg[512];
+
+		snprintf(msg, sizeof(msg), "error from xdrive server: %.*s",
+				 (int) Min(*len, sizeof(msg) - 40), conn->inbuf);
+		xdrive_fail(conn, msg);
+	}
+
+	return type;
+}
+
+static void
+xdrive_free(XdriveConn *conn)
+{
+	if (conn->sock >= 0)
+		close(conn->sock);
+	conn->sock = -1;
+
+	if (conn->inbuf)
+		free(conn->inbuf);
+	if (conn->outbuf)
+		free(conn->outbuf);
+	free(conn);
+}
+
+/*
+ * Connect conn->sock to addr.  The connect is non-blocking, so that an
+ * unreachable host can be cancelled and gives up after
+ * XDRIVE_CONNECT_TIMEOUT seconds rather than the kernel's TCP timeout.
+ */
+static bool
+xdrive_connect_addr(XdriveConn *conn, const struct sockaddr *addr, socklen_t addrlen)
+{
+	int			flags;
+	int			err = 0;
+	socklen_t	errlen = sizeof(err);
+	time_t		deadline = time(NULL) + XDRIVE_CONNECT_TIMEOUT;
+
+	flags = fcntl(conn->sock, F_GETFL);
+	if (flags < 0 || fcntl(conn->sock, F_SETFL, flags | O_NONBLOCK) < 0)
+		return false;
+
+	if (connect(conn->sock, addr, addrlen) == 0)
+		return true;
+	if (errno != EINPROGRESS && errno != EINTR)
+		return false;
+
+	for (;;)
+	{
+		struct pollfd pfd;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (time(NULL) >= deadline)
+			return false;
+
+		pfd.fd = conn->sock;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+
+		rc = poll(&pfd, 1, 1000);
+		if (rc > 0)
+			break;
+		if (rc < 0 && errno != EINTR)
+			return false;
+	}
+
+	if (getsockopt(conn->sock, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0 || err != 0)
+		return false;
+
+	return true;
+}
+
+/*
+ * Connect to the daemon at one of the addresses of the URI's host.  The
+ * socket is kept in conn->sock while connecting, so that xdrive_free()
+ * closes it if we are cancelled.
+ */
+static bool
+xdrive_open_socket(XdriveConn *conn, Uri *uri)
+{
+	struct addrinfo hints;
+	struct addrinfo *addrs;
+	struct addrinfo *ai;
+	char		portstr[16];
+
+	snprintf(portstr, sizeof(portstr), "%d",
+			 uri->port > 0 ? uri->port : XDRIVE_DEFAULT_PORT);
+
+	MemSet(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(uri->hostname, portstr, &hints, &addrs) != 0)
+		return false;
+
+	PG_TRY();
+	{
+		for (ai = addrs; ai != NULL; ai = ai->ai_next)
+		{
+			int			on = 1;
+
+			conn->sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (conn->sock < 0)
+				continue;
+
+			if (xdrive_connect_addr(conn, ai->ai_addr, ai->ai_addrlen))
+			{
+				setsockopt(conn->sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+				break;
+			}
+
+			close(conn->sock);
+			conn->sock = -1;
+		}
+	}
+	PG_CATCH();
+	{
+		freeaddrinfo(addrs);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	freeaddrinfo(addrs);
+	return conn->sock >= 0;
+}
+
+XdriveConn *
+xdrive_connect(const char *url, bool forwrite, const char **params)
+{
+	XdriveConn *conn;
+	Uri		   *uri;
+	StringInfoData msg;
+	char		version[16];
+	uint32		len;
+	uint32		type;
+	int			i;
+
+	uri = ParseExternalTableUri(url);
+
+	conn = (XdriveConn *) calloc(1, sizeof(XdriveConn) + strlen(url) + 1);
+	if (conn == NULL)
+		elog(ERROR, "out of memory");
+	conn->url = ((char *) conn) + sizeof(XdriveConn);
+	strcpy(conn->url, url);
+	conn->forwrite = forwrite;
+	conn->inbuf = malloc(XDRIVE_MAX_FRAME);
+	conn->outbuf = forwrite ? malloc(XDRIVE_WRITE_FRAME) : NULL;
+	conn->sock = -1;
+
+	if (conn->inbuf == NULL || (forwrite && conn->outbuf == NULL))
+	{
+		xdrive_free(conn);
+		elog(ERROR, "out of memory");
+	}
+
+	/* Nobody owns conn until we return it, so free it on any error */
+	PG_TRY();
+	{
+		if (!xdrive_open_socket(conn, uri))
+		{
+			char		errmsg[256];
+
+			snprintf(errmsg, sizeof(errmsg), "could not connect to xdrive server on %s:%d",
+					 uri->hostname, uri->port > 0 ? uri->port : XDRIVE_DEFAULT_PORT);
+			xdrive_fail(conn, errmsg);
+		}
+
+		/* OPEN */
+		snprintf(version, sizeof(version), "%d", XDRIVE_PROTOCOL_VERSION);
+		initStringInfo(&msg);
+		appendStringInfo(&msg, "version=%s", version);
+		appendStringInfoChar(&msg, '\0');
+		appendStringInfo(&msg, "mode=%s", forwrite ? "w" : "r");
+		appendStringInfoChar(&msg, '\0');
+		appendStringInfo(&msg, "path=%s", uri->path ? uri->path : "/");
+		appendStringInfoChar(&msg, '\0');
+		for (i = 0; params[i] != NULL; i += 2)
+		{
+			appendStringInfo(&msg, "%s=%s", params[i], params[i + 1] ? params[i + 1] : "");
+			appendStringInfoChar(&msg, '\0');
+		}
+
+		xdrive_send_frame(conn, XDRIVE_MSG_OPEN, msg.data, msg.len);
+		pfree(msg.data);
+
+		type = xdrive_recv_frame(conn, &len);
+		if (type != XDRIVE_MSG_OK)
+			xdrive_fail(conn, "unexpected response to OPEN from xdrive server");
+
+		if (!forwrite)
+			xdrive_send_credit(conn, XDRIVE_WINDOW_SIZE);
+	}
+	PG_CATCH();
+	{
+		xdrive_free(conn);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	FreeExternalTableUri(uri);
+
+	return conn;
+}
+
+/*
+ * Read up to len bytes of the data stream.  Returns 0 at end of stream.
+ */
+size_t
+xdrive_read(XdriveConn *conn, void *buf, size_t len)
+{
+	size_t		n;
+
+	Assert(!conn->forwrite);
+
+	while (conn->inpos == conn->inlen)
+	{
+		uint32		flen;
+		uint32		type;
+
+		if (conn->eof)
+			return 0;
+
+		/* Hand consumed window back once half of it is used up */
+		if (conn->unacked >= XDRIVE_WINDOW_SIZE / 2)
+		{
+			xdrive_send_credit(conn, (uint32) conn->unacked);
+			conn->unacked = 0;
+		}
+
+		type = xdrive_recv_frame(conn, &flen);
+		switch (type)
+		{
+			case XDRIVE_MSG_DATA:
+				conn->inlen = flen;
+				conn->inpos = 0;
+				break;
+			case XDRIVE_MSG_END:
+				conn->eof = true;
+				conn->inlen = conn->inpos = 0;
+				break;
+			default:
+				xdrive_fail(conn, "unexpected message from xdrive server while reading");
+		}
+	}
+
+	n = Min(len, conn->inlen - conn->inpos);
+	memcpy(buf, conn->inbuf + conn->inpos, n);
+	conn->inpos += n;
+	conn->unacked += n;
+
+	return n;
+}
+
+/*
+ * Consume CREDIT frames until the daemon lets us send need more bytes.
+ */
+static void
+xdrive_wait_credit(XdriveConn *conn, size_t need)
+{
+	while (conn->credit < need)
+	{
+		uint32		len;
+		uint32		type = xdrive_recv_frame(conn, &len);
+
+		if (type != XDRIVE_MSG_CREDIT || len != sizeof(uint32))
+			xdrive_fail(conn, "unexpected message from xdrive server while writing");
+
+		conn->credit += ntohl(*(uint32 *) conn->inbuf);
+	}
+}
+
+void
+xdrive_flush(XdriveConn *conn)
+{
+	Assert(conn->forwrite);
+
+	if (conn->outlen == 0)
+		return;
+
+	xdrive_wait_credit(conn, conn->outlen);
+	xdrive_send_frame(conn, XDRIVE_MSG_DATA, conn->outbuf, conn->outlen);
+	conn->credit -= conn->outlen;
+	conn->outlen = 0;
+}
+
+void
+xdrive_write(XdriveConn *conn, const void *buf, size_t len)
+{
+	const char *p = buf;
+
+	Assert(conn->forwrite);
+
+	while (len > 0)
+	{
+		size_t		n = Min(len, XDRIVE_WRITE_FRAME - conn->outlen);
+
+		memcpy(conn->outbuf + conn->outlen, p, n);
+		conn->outlen += n;
+		p += n;
+		len -= n;
+
+		if (conn->outlen == XDRIVE_WRITE_FRAME)
+			xdrive_flush(conn);
+	}
+}
+
+/*
+ * Close the connection.  A writer sends END and waits for the daemon to
+ * confirm the data is written; failOnError is false when we are cleaning up
+ * after an error, in which case we just drop the connection and the daemon
+ * discards the partial stream.
+ */
+void
+xdrive_close(XdriveConn *conn, bool failOnError)
+{
+	if (conn->forwrite && failOnError && !conn->ended && conn->sock >= 0)
+	{
+		PG_TRY();
+		{
+			uint32		len;
+			uint32		type;
+
+			xdrive_flush(conn);
+			xdrive_send_frame(conn, XDRIVE_MSG_END, NULL, 0);
+			conn->ended = true;
+
+			do
+			{
+				type = xdrive_recv_frame(conn, &len);
+			} while (type == XDRIVE_MSG_CREDIT);
+
+			if (type != XDRIVE_MSG_OK)
+				xdrive_fail(conn, "unexpected response to END from xdrive server");
+		}
+		PG_CATCH();
+		{
+			xdrive_free(conn);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+	}
+
+	xdrive_free(conn);
+}
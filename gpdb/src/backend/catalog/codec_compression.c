@@ -0,0 +1,467 @@
+/*-------------------------------------------------------------------------
+ *
+ * codec_compression.c
+ *	  Built-in block compression codecs for append-only storage.
+ *
+ * Every codec here is described by a CompressionCodec entry in the registry
+ * below, and backs a pg_compression row whose functions are the generic
+ * gp_codec_* functions.  The constructor picks the registry entry by
+ * compresstype, so adding a codec means adding an entry here and a
+ * pg_compression row; no new SQL-callable functions are needed.
+ *
+ * Compression contexts are expensive to set up, so each backend creates
+ * them once and reuses them for every block it compresses or decompresses.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "lz4.h"
+#include "zstd.h"
+
+#include "catalog/pg_compression.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/pg_crc.h"
+
+static size_t lz4_codec_compress(const void *src, size_t src_sz,
+								 void *dst, size_t dst_sz, int level);
+static size_t lz4_codec_decompress(const void *src, size_t src_sz,
+								   void *dst, size_t dst_sz);
+static size_t zstd_codec_compress(const void *src, size_t src_sz,
+								  void *dst, size_t dst_sz, int level);
+static size_t zstd_codec_decompress(const void *src, size_t src_sz,
+									void *dst, size_t dst_sz);
+static size_t zstd_dict_codec_compress(const void *src, size_t src_sz,
+									   void *dst, size_t dst_sz, int level);
+static size_t zstd_dict_codec_decompress(const void *src, size_t src_sz,
+										 void *dst, size_t dst_sz);
+static size_t lz4_codec_decompress_r(void *dctx, const void *src,
+									 size_t src_sz, void *dst, size_t dst_sz,
+									 const char **error);
+static void *zstd_codec_create_dctx(void);
+static void zstd_codec_free_dctx(void *dctx);
+static size_t zstd_codec_decompress_r(void *dctx, const void *src,
+									  size_t src_sz, void *dst, size_t dst_sz,
+									  const char **error);
+
+/*
+ * The registry.  Levels are limited to 1..9 by the storage options; zstd
+ * defaults to 5, which is a good trade of speed for ratio on column data.
+ */
+static const CompressionCodec compression_codecs[] =
+{
+	{"lz4", 1, 1, lz4_codec_compress, lz4_codec_decompress,
+	 NULL, NULL, lz4_codec_decompress_r},
+	{"zstd", 5, 9, zstd_codec_compress, zstd_codec_decompress,
+	 zstd_codec_create_dctx, zstd_codec_free_dctx, zstd_codec_decompress_r},
+	{"zstd_dict", 5, 9, zstd_dict_codec_compress, zstd_dict_codec_decompress,
+	 NULL, NULL, NULL},
+};
+
+/* Per-backend contexts, created on first use */
+static void *lz4_state = NULL;
+static ZSTD_CCtx *zstd_cctx = NULL;
+static ZSTD_DCtx *zstd_dctx = NULL;
+
+/*
+ * The zstd dictionary named by gp_zstd_dictionary, digested per level.
+ *
+ * Every zstd_dict block starts with the CRC-32C of the dictionary it was
+ * compressed with, so that a block is never decompressed with another
+ * dictionary, even one that happens to carry the same zstd dictionary ID.
+ */
+#define ZSTD_DICT_HEADER_SIZE	((int) sizeof(pg_crc32))
+
+static bool zstd_dict_loaded = false;
+static char *zstd_dict_buf = NULL;
+static size_t zstd_dict_size = 0;
+static unsigned zstd_dict_id = 0;
+static pg_crc32 zstd_dict_crc = 0;
+static ZSTD_CDict *zstd_cdicts[10];
+static ZSTD_DDict *zstd_ddict = NULL;
+
+/*
+ * Look up a codec by compresstype.  Returns NULL if it is not one of ours.
+ */
+const CompressionCodec *
+GetCompressionCodec(const char *comptype)
+{
+	int			i;
+
+	if (comptype == NULL)
+		return NULL;
+
+	for (i = 0; i < lengthof(compression_codecs); i++)
+	{
+		if (pg_strcasecmp(compression_codecs[i].name, comptype) == 0)
+			return &compression_codecs[i];
+	}
+	return NULL;
+}
+
+static void *
+codec_context_check(void *ctx)
+{
+	if (ctx == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Could not create compression context.")));
+	return ctx;
+}
+
+static size_t
+lz4_codec_compress(const void *src, size_t src_sz, void *dst, size_t dst_sz,
+				   int level)
+{
+	if (lz4_state == NULL)
+		lz4_state = codec_context_check(malloc(LZ4_sizeofState()));
+
+	/* 0 means dst was too small */
+	return LZ4_compress_fast_extState(lz4_state, src, dst, src_sz, dst_sz, 1);
+}
+
+static size_t
+lz4_codec_decompress(const void *src, size_t src_sz, void *dst, size_t dst_sz)
+{
+	int			zb;
+
+	zb = LZ4_decompress_safe(src, dst, src_sz, dst_sz);
+	if (zb < 0)
+		elog(ERROR, "lz4 encountered data in an unexpected format");
+
+	return zb;
+}
+
+static size_t
+lz4_codec_decompress_r(void *dctx, const void *src, size_t src_sz, void *dst,
+					   size_t dst_sz, const char **error)
+{
+	int			zb;
+
+	zb = LZ4_decompress_safe(src, dst, src_sz, dst_sz);
+	if (zb < 0)
+	{
+		*error = "lz4 encountered data in an unexpected format";
+		return 0;
+	}
+
+	return zb;
+}
+
+static size_t
+zstd_codec_compress(const void *src, size_t src_sz, void *dst, size_t dst_sz,
+					int level)
+{
+	size_t		zb;
+
+	if (zstd_cctx == NULL)
+		zstd_cctx = codec_context_check(ZSTD_createCCtx());
+
+	zb = ZSTD_compressCCtx(zstd_cctx, dst, dst_sz, src, src_sz, level);
+
+	return ZSTD_isError(zb) ? 0 : zb;
+}
+
+static size_t
+zstd_codec_decompress(const void *src, size_t src_sz, void *dst, size_t dst_sz)
+{
+	size_t		zb;
+
+	if (zstd_dctx == NULL)
+		zstd_dctx = codec_context_check(ZSTD_createDCtx());
+
+	zb = ZSTD_decompressDCtx(zstd_dctx, dst, dst_sz, src, src_sz);
+	if (ZSTD_isError(zb))
+		elog(ERROR, "zstd decompression failed: %s", ZSTD_getErrorName(zb));
+
+	return zb;
+}
+
+static void *
+zstd_codec_create_dctx(void)
+{
+	return ZSTD_createDCtx();
+}
+
+static void
+zstd_codec_free_dctx(void *dctx)
+{
+	ZSTD_freeDCtx((ZSTD_DCtx *) dctx);
+}
+
+static size_t
+zstd_codec_decompress_r(void *dctx, const void *src, size_t src_sz, void *dst,
+						size_t dst_sz, const char **error)
+{
+	size_t		zb;
+
+	zb = ZSTD_decompressDCtx((ZSTD_DCtx *) dctx, dst, dst_sz, src, src_sz);
+	if (ZSTD_isError(zb))
+	{
+		/* ZSTD_getErrorName returns a static string */
+		*error = ZSTD_getErrorName(zb);
+		return 0;
+	}
+
+	return zb;
+}
+
+/*
+ * Read the dictionary file named by gp_zstd_dictionary.  A relative path is
+ * taken relative to the data directory.  The dictionary is trained offline
+ * (zstd --train) and must be the same file on every segment.
+ */
+static void
+zstd_dict_load(void)
+{
+	char		path[MAXPGPATH];
+	FILE	   *fp;
+	long		size;
+
+	if (zstd_dict_loaded)
+		return;
+
+	if (gp_zstd_dictionary == NULL || gp_zstd_dictionary[0] == '\0')
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("compresstype zstd_dict requires gp_zstd_dictionary to be set"),
+				 errhint("Tables with compresstype zstd_dict can only be read with the dictionary they were written with.")));
+
+	if (is_absolute_path(gp_zstd_dictionary))
+		strlcpy(path, gp_zstd_dictionary, sizeof(path));
+	else
+		snprintf(path, sizeof(path), "%s/%s", DataDir, gp_zstd_dictionary);
+
+	fp = AllocateFile(path, PG_BINARY_R);
+	if (fp == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open zstd dictionary \"%s\": %m", path),
+				 errhint("Tables with compresstype zstd_dict can only be read with the dictionary they were written with.")));
+
+	size = -1;
+	if (fseek(fp, 0, SEEK_END) == 0)
+		size = ftell(fp);
+	if (size <= 0 || fseek(fp, 0, SEEK_SET) != 0)
+	{
+		FreeFile(fp);
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read zstd dictionary \"%s\"", path)));
+	}
+
+	zstd_dict_buf = codec_context_check(malloc(size));
+	if (fread(zstd_dict_buf, 1, size, fp) != (size_t) size)
+	{
+		FreeFile(fp);
+		free(zstd_dict_buf);
+		zstd_dict_buf = NULL;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read zstd dictionary \"%s\": %m", path)));
+	}
+	FreeFile(fp);
+
+	zstd_dict_size = size;
+	zstd_dict_id = ZSTD_getDictID_fromDict(zstd_dict_buf, zstd_dict_size);
+	if (zstd_dict_id == 0)
+	{
+		free(zstd_dict_buf);
+		zstd_dict_buf = NULL;
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"%s\" is not a trained zstd dictionary", path)));
+	}
+
+	zstd_dict_crc = crc32cInit();
+	zstd_dict_crc = crc32c(zstd_dict_crc, zstd_dict_buf, zstd_dict_size);
+	zstd_dict_crc = crc32cFinish(zstd_dict_crc);
+
+	zstd_dict_loaded = true;
+}
+
+static size_t
+zstd_dict_codec_compress(const void *src, size_t src_sz, void *dst,
+						 size_t dst_sz, int level)
+{
+	size_t		zb;
+
+	Assert(level > 0 && level < lengthof(zstd_cdicts));
+
+	zstd_dict_load();
+
+	if (zstd_cctx == NULL)
+		zstd_cctx = codec_context_check(ZSTD_createCCtx());
+	if (zstd_cdicts[level] == NULL)
+		zstd_cdicts[level] = codec_context_check(ZSTD_createCDict(zstd_dict_buf,
+																  zstd_dict_size,
+																  level));
+
+	if (dst_sz <= ZSTD_DICT_HEADER_SIZE)
+		return 0;
+
+	memcpy(dst, &zstd_dict_crc, ZSTD_DICT_HEADER_SIZE);
+	zb = ZSTD_compress_usingCDict(zstd_cctx,
+								  (char *) dst + ZSTD_DICT_HEADER_SIZE,
+								  dst_sz - ZSTD_DICT_HEADER_SIZE,
+								  src, src_sz, zstd_cdicts[level]);
+
+	return ZSTD_isError(zb) ? 0 : zb + ZSTD_DICT_HEADER_SIZE;
+}
+
+static size_t
+zstd_dict_codec_decompress(const void *src, size_t src_sz, void *dst,
+						   size_t dst_sz)
+{
+	pg_crc32	block_crc;
+	unsigned	frame_dict_id;
+	size_t		zb;
+
+	zstd_dict_load();
+
+	if (src_sz <= ZSTD_DICT_HEADER_SIZE)
+		elog(ERROR, "zstd_dict block is too short (%d bytes)", (int) src_sz);
+
+	memcpy(&block_crc, src, ZSTD_DICT_HEADER_SIZE);
+	src = (const char *) src + ZSTD_DICT_HEADER_SIZE;
+	src_sz -= ZSTD_DICT_HEADER_SIZE;
+
+	frame_dict_id = ZSTD_getDictID_fromFrame(src, src_sz);
+	if (!EQ_CRC32(block_crc, zstd_dict_crc) || frame_dict_id != zstd_dict_id)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("block was compressed with a different zstd dictionary than \"%s\"",
+						gp_zstd_dictionary),
+				 errdetail("The block was compressed with dictionary ID %u and checksum %08X, "
+						   "the loaded dictionary has ID %u and checksum %08X.",
+						   frame_dict_id, block_crc, zstd_dict_id, zstd_dict_crc),
+				 errhint("Set gp_zstd_dictionary to the dictionary the table was written with.")));
+
+	if (zstd_dctx == NULL)
+		zstd_dctx = codec_context_check(ZSTD_createDCtx());
+	if (zstd_ddict == NULL)
+		zstd_ddict = codec_context_check(ZSTD_createDDict(zstd_dict_buf,
+														  zstd_dict_size));
+
+	zb = ZSTD_decompress_usingDDict(zstd_dctx, dst, dst_sz, src, src_sz,
+									zstd_ddict);
+	if (ZSTD_isError(zb))
+		elog(ERROR, "zstd decompression failed: %s", ZSTD_getErrorName(zb));
+
+	return zb;
+}
+
+/*
+ * Internal state of a gp_codec compression; the codec and its level.
+ */
+typedef struct codec_state
+{
+	const CompressionCodec *codec;
+	int			level;
+} codec_state;
+
+Datum
+codec_constructor(PG_FUNCTION_ARGS)
+{
+	/* PG_GETARG_POINTER(0) is TupleDesc that is currently unused.
+	 * It is passed as NULL */
+
+	StorageAttributes *sa = PG_GETARG_POINTER(1);
+	CompressionState *cs = palloc0(sizeof(CompressionState));
+	codec_state *state = palloc0(sizeof(codec_state));
+
+	Insist(PointerIsValid(sa->comptype));
+
+	state->codec = GetCompressionCodec(sa->comptype);
+	if (state->codec == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("unknown compress type \"%s\"", sa->comptype)));
+
+	if (sa->complevel == 0)
+		sa->complevel = state->codec->default_level;
+	state->level = Min(sa->complevel, state->codec->max_level);
+
+	cs->opaque = (void *) state;
+	cs->desired_sz = NULL;
+
+	PG_RETURN_POINTER(cs);
+}
+
+Datum
+codec_destructor(PG_FUNCTION_ARGS)
+{
+	CompressionState *cs = PG_GETARG_POINTER(0);
+
+	if (cs != NULL && cs->opaque != NULL)
+	{
+		pfree(cs->opaque);
+	}
+
+	PG_RETURN_VOID();
+}
+
+Datum
+codec_compress(PG_FUNCTION_ARGS)
+{
+	const void *src = PG_GETARG_POINTER(0);
+	int32		src_sz = PG_GETARG_INT32(1);
+	void	   *dst = PG_GETARG_POINTER(2);
+	int32		dst_sz = PG_GETARG_INT32(3);
+	int32	   *dst_used = PG_GETARG_POINTER(4);
+	CompressionState *cs = (CompressionState *) PG_GETARG_POINTER(5);
+	codec_state *state = (codec_state *) cs->opaque;
+	size_t		zb;
+
+	zb = state->codec->compress(src, src_sz, dst, dst_sz, state->level);
+
+	/*
+	 * The caller detects that compression did not pay off by dst_used not
+	 * being smaller than src_sz, which also covers a dst too small.
+	 */
+	*dst_used = (zb == 0) ? src_sz : (int32) zb;
+
+	PG_RETURN_VOID();
+}
+
+Datum
+codec_decompress(PG_FUNCTION_ARGS)
+{
+	const char *src = PG_GETARG_POINTER(0);
+	int32		src_sz = PG_GETARG_INT32(1);
+	void	   *dst = PG_GETARG_POINTER(2);
+	int32		dst_sz = PG_GETARG_INT32(3);
+	int32	   *dst_used = PG_GETARG_POINTER(4);
+	CompressionState *cs = (CompressionState *) PG_GETARG_POINTER(5);
+	codec_state *state = (codec_state *) cs->opaque;
+
+	Insist(src_sz > 0 && dst_sz > 0);
+
+	*dst_used = state->codec->decompress(src, src_sz, dst, dst_sz);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+codec_validator(PG_FUNCTION_ARGS)
+{
+	StorageAttributes *sa = PG_GETARG_POINTER(0);
+	const CompressionCodec *codec = GetCompressionCodec(sa->comptype);
+
+	if (codec == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("unknown compress type \"%s\"", sa->comptype)));
+
+	if (sa->complevel < 0 || sa->complevel > codec->max_level)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("compresslevel=%d is out of range for %s (should be between 1 and %d)",
+						sa->complevel, codec->name, codec->max_level)));
+
+	PG_RETURN_VOID();
+}
@@ -111,31 +111,23 @@ GetCompressionImplementation(char *comptype)
                 NameGetDatum(&compname)));
 
     if (!HeapTupleIsValid(tuple)) {
-        if (pg_strcasecmp("zstd", comptype) == 0) {
-            /*
-             * EXX: Really messed up.
-             *  Greepnlum has an entry quicklz, so in case of zstd, lz4, we will fall
-             *  to lookup method of quicklz, then hijack the quicklz methods during
-             *  execution.
-             *
-             *  Because of a mistake, ftian messed up catalog -- so, if customer did 
-             *  a initdb, we will have an entry of lz4, but no quicklz -- this is fine
-             *  for lz4.  but now, zstd comes, it will have a big trouble deciding
-             *  what to lookup "quicklz" if the initdb is done using greenplum, but
-             *  "lz4" if the initdb is done using deepgreen.   
-             *
-             *  WTH.  Lookup lz4, regardless of the cases, it will be OK. 
-             */
-            return GetCompressionImplementation("lz4"); 
-        } else if (pg_strcasecmp("lz4", comptype) == 0) { 
-            return GetCompressionImplementation("quicklz");
-        } else {
-            ereport(ERROR,
-				(errcode(ERRCODE_UNDEFINED_OBJECT),
-				 errmsg("unknown compress type \"%s\"",
-						comptype)));
-        }
-    }
+		/*
+		 * EXX: Catalogs initialized before the codec registry have no rows
+		 * for zstd and friends, and their lz4 row may be called quicklz.
+		 * The quicklz functions behind those rows dispatch on comptype, so
+		 * any registered codec can borrow them.
+		 */
+		if (GetCompressionCodec(comptype) != NULL &&
+			pg_strcasecmp("lz4", comptype) != 0)
+			return GetCompressionImplementation("lz4");
+		else if (pg_strcasecmp("lz4", comptype) == 0)
+			return GetCompressionImplementation("quicklz");
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("unknown compress type \"%s\"",
+							comptype)));
+	}
 
 	funcs = palloc0(sizeof(PGFunction) * NUM_COMPRESS_FUNCS);
 
@@ -459,7 +451,7 @@ compresstype_is_valid(char *comptype)
 	 * must change!
 	 */
 	static const char *const valid_comptypes[] =
-			{"quicklz", "lz4", "zlib", "zstd", "rle_type", "none"};
+			{"quicklz", "lz4", "zlib", "zstd", "zstd_dict", "rle_type", "none"};
 
     if (pg_strcasecmp("quicklz", comptype) == 0) {
 		elog(ERROR, "quicklz not supported.  Please use lz4."); 
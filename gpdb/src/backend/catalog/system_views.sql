@@ -375,6 +375,9 @@ CREATE VIEW pg_stat_replication AS
     WHERE S.usesysid = U.oid AND
             S.procpid = W.pid;
 
+CREATE VIEW gp_session_gang_pool AS
+    SELECT * FROM gp_gang_pool_stats();
+
 CREATE VIEW pg_stat_database AS 
     SELECT 
             D.oid AS datid, 
@@ -0,0 +1,249 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "postgres.h"
+#include "storage/fd.h"
+
+/* fd.c is mocked; read the dictionary with plain stdio */
+#define AllocateFile(name, mode)	fopen(name, mode)
+#define FreeFile(file)				fclose(file)
+
+#include "../codec_compression.c"
+
+#include "zdict.h"
+
+#define SAMPLE_COUNT	2000
+#define BLOCK_SIZE		(32 * 1024)
+
+static char dict_a_path[] = "/tmp/codec_dict_a_XXXXXX";
+static char dict_b_path[] = "/tmp/codec_dict_b_XXXXXX";
+
+/*
+ * Rows of a made-up table, as text.  The field name differs between the
+ * two dictionaries, so that they are trained on different content.
+ */
+static int
+make_row(char *buf, size_t len, const char *field, int i)
+{
+	static const char *cities[] = {"Oslo", "Lima", "Pune", "Kyiv", "Perth",
+								   "Quito", "Turin"};
+
+	return snprintf(buf, len,
+					"{\"id\": %d, \"%s\": \"%s-%d\", \"city\": \"%s\", \"qty\": %d}",
+					i, field, field, i % 97, cities[i % 7], (i * 31) % 1000);
+}
+
+/*
+ * Train a zstd dictionary on SAMPLE_COUNT rows and write it to a fresh
+ * temporary file, whose name replaces the XXXXXX of path.
+ */
+static void
+train_dictionary(char *path, const char *field)
+{
+	char	   *samples = malloc(SAMPLE_COUNT * 128);
+	size_t		sizes[SAMPLE_COUNT];
+	char		dict[8192];
+	size_t		off = 0;
+	size_t		dict_sz;
+	int			fd;
+	int			i;
+
+	for (i = 0; i < SAMPLE_COUNT; i++)
+	{
+		sizes[i] = make_row(samples + off, 128, field, i);
+		off += sizes[i];
+	}
+
+	dict_sz = ZDICT_trainFromBuffer(dict, sizeof(dict), samples, sizes,
+									SAMPLE_COUNT);
+	assert_false(ZDICT_isError(dict_sz));
+
+	fd = mkstemp(path);
+	assert_true(fd >= 0);
+	assert_int_equal(write(fd, dict, dict_sz), dict_sz);
+	close(fd);
+
+	free(samples);
+}
+
+/*
+ * Point gp_zstd_dictionary at path, dropping whatever dictionary was loaded
+ * before, as a new backend would.
+ */
+static void
+use_dictionary(char *path)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(zstd_cdicts); i++)
+	{
+		ZSTD_freeCDict(zstd_cdicts[i]);
+		zstd_cdicts[i] = NULL;
+	}
+	ZSTD_freeDDict(zstd_ddict);
+	zstd_ddict = NULL;
+	free(zstd_dict_buf);
+	zstd_dict_buf = NULL;
+	zstd_dict_loaded = false;
+
+	gp_zstd_dictionary = path;
+}
+
+static size_t
+fill_block(char *buf)
+{
+	size_t		off = 0;
+	int			i = 100000;
+
+	while (off < BLOCK_SIZE - 128)
+		off += make_row(buf + off, 128, "name", i++);
+
+	return off;
+}
+
+/*
+ * The CRC-32C of a dictionary file, computed here independently of the
+ * codec.
+ */
+static pg_crc32
+file_crc(const char *path)
+{
+	char		buf[8192];
+	FILE	   *fp = fopen(path, "r");
+	size_t		n;
+
+	assert_true(fp != NULL);
+	n = fread(buf, 1, sizeof(buf), fp);
+	fclose(fp);
+
+	return crc32cFinish(crc32c(crc32cInit(), buf, n));
+}
+
+/*
+ * Decompress src with the loaded dictionary; it must fail as corrupted.
+ */
+static void
+expect_corrupted(const char *src, size_t src_sz)
+{
+	char	   *back = malloc(BLOCK_SIZE);
+	bool		failed = false;
+
+	PG_TRY();
+	{
+		zstd_dict_codec_decompress(src, src_sz, back, BLOCK_SIZE);
+	}
+	PG_CATCH();
+	{
+		CurrentMemoryContext = (MemoryContext) 1;
+		ErrorData  *edata = CopyErrorData();
+
+		assert_true(edata->elevel == ERROR);
+		assert_true(edata->sqlerrcode == ERRCODE_DATA_CORRUPTED);
+		failed = true;
+	}
+	PG_END_TRY();
+
+	assert_true(failed);
+	free(back);
+}
+
+/* ==================== zstd_dict round trip =================== */
+/*
+ * Tests that blocks compressed with a dictionary read back the same at
+ * every level, and that each starts with the finished CRC-32C of the
+ * dictionary.
+ */
+void
+test__zstd_dict_roundtrip(void **state)
+{
+	char	   *data = malloc(BLOCK_SIZE);
+	char	   *comp = malloc(2 * BLOCK_SIZE);
+	char	   *back = malloc(BLOCK_SIZE);
+	size_t		data_sz = fill_block(data);
+	pg_crc32	expected_crc = file_crc(dict_a_path);
+	pg_crc32	block_crc;
+	int			level;
+
+	use_dictionary(dict_a_path);
+
+	for (level = 1; level <= 9; level++)
+	{
+		size_t		comp_sz;
+		size_t		back_sz;
+
+		comp_sz = zstd_dict_codec_compress(data, data_sz, comp,
+										   2 * BLOCK_SIZE, level);
+		assert_true(comp_sz > ZSTD_DICT_HEADER_SIZE);
+		assert_true(comp_sz < data_sz / 2);
+
+		memcpy(&block_crc, comp, ZSTD_DICT_HEADER_SIZE);
+		assert_true(EQ_CRC32(block_crc, expected_crc));
+
+		back_sz = zstd_dict_codec_decompress(comp, comp_sz, back, BLOCK_SIZE);
+		assert_int_equal(back_sz, data_sz);
+		assert_memory_equal(back, data, data_sz);
+	}
+
+	/* A destination too small for the header is reported as no room */
+	assert_int_equal(zstd_dict_codec_compress(data, data_sz, comp,
+											  ZSTD_DICT_HEADER_SIZE, 1), 0);
+
+	free(data);
+	free(comp);
+	free(back);
+}
+
+/* ==================== zstd_dict mismatch =================== */
+/*
+ * Tests that a block written with one dictionary is not decompressed with
+ * another, nor when its checksum does not match the loaded dictionary.
+ */
+void
+test__zstd_dict_mismatch(void **state)
+{
+	char	   *data = malloc(BLOCK_SIZE);
+	char	   *comp = malloc(2 * BLOCK_SIZE);
+	size_t		data_sz = fill_block(data);
+	size_t		comp_sz;
+
+	use_dictionary(dict_a_path);
+	comp_sz = zstd_dict_codec_compress(data, data_sz, comp, 2 * BLOCK_SIZE, 5);
+	assert_true(comp_sz > ZSTD_DICT_HEADER_SIZE);
+
+	/* the other dictionary has another ID and checksum */
+	use_dictionary(dict_b_path);
+	expect_corrupted(comp, comp_sz);
+
+	/* the right dictionary, but a damaged checksum */
+	use_dictionary(dict_a_path);
+	comp[0] ^= 0x5a;
+	expect_corrupted(comp, comp_sz);
+
+	free(data);
+	free(comp);
+}
+
+int
+main(int argc, char* argv[])
+{
+	int			result;
+
+	cmockery_parse_arguments(argc, argv);
+
+	train_dictionary(dict_a_path, "name");
+	train_dictionary(dict_b_path, "label");
+
+	const UnitTest tests[] = {
+		unit_test(test__zstd_dict_roundtrip),
+		unit_test(test__zstd_dict_mismatch)
+	};
+
+	result = run_tests(tests);
+
+	unlink(dict_a_path);
+	unlink(dict_b_path);
+
+	return result;
+}
@@ -0,0 +1,478 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbappendonlydecompress.c
+ *	  A pool of threads that decompress Append-Only Storage blocks ahead
+ *	  of the scan that reads them.
+ *
+ * (See .h file for usage comments)
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <pthread.h>
+
+#include "access/xact.h"
+#include "cdb/cdbappendonlydecompress.h"
+#include "cdb/cdbgang.h"
+#include "utils/memutils.h"
+
+typedef enum AppendOnlyDecompressJobState
+{
+	AODecompressJob_Idle = 0,
+	AODecompressJob_Queued,
+	AODecompressJob_Running,
+	AODecompressJob_Done
+} AppendOnlyDecompressJobState;
+
+struct AppendOnlyDecompressJob
+{
+	AppendOnlyDecompressPool *pool;
+	const CompressionCodec *codec;
+
+	uint8	   *compressed;
+	uint8	   *uncompressed;
+	int32		bufferLen;
+
+	int32		compressedLen;
+	int32		uncompressedLen;
+
+	/* The following are protected by the pool's mutex */
+	AppendOnlyDecompressJobState state;
+	size_t		resultLen;		/* 0 on failure */
+	const char *error;			/* static message on failure */
+
+	struct AppendOnlyDecompressJob *next;	/* in the pool's queue */
+};
+
+/* The codecs a worker has made a decompression context for */
+#define MAX_WORKER_CODECS 4
+
+typedef struct AppendOnlyDecompressWorkerCodec
+{
+	const CompressionCodec *codec;
+	void	   *dctx;
+} AppendOnlyDecompressWorkerCodec;
+
+struct AppendOnlyDecompressPool
+{
+	MemoryContext memoryContext;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t workCond;	/* a job was queued, or shutdown */
+	pthread_cond_t doneCond;	/* a job was done */
+
+	/* Queued jobs, oldest first; protected by mutex */
+	AppendOnlyDecompressJob *queueHead;
+	AppendOnlyDecompressJob *queueTail;
+	bool		shutdown;
+
+	int			numWorkers;
+	pthread_t  *workers;
+};
+
+static void AppendOnlyDecompressPool_XactCallback(XactEvent event, void *arg);
+
+/*
+ * Decompress the block of the job with the given codec context.
+ */
+static void
+AppendOnlyDecompressJob_Run(AppendOnlyDecompressJob *job, void *dctx)
+{
+	const char *error = NULL;
+	size_t		resultLen;
+
+	resultLen = job->codec->decompress_r(dctx,
+										 job->compressed, job->compressedLen,
+										 job->uncompressed, job->uncompressedLen,
+										 &error);
+	if (resultLen == 0 && error == NULL)
+		error = "no content";
+
+	job->resultLen = resultLen;
+	job->error = error;
+}
+
+/*
+ * Find or make the worker's context for codec.  Returns false if the codec
+ * wants a context and none could be made.
+ */
+static bool
+AppendOnlyDecompressWorker_GetContext(AppendOnlyDecompressWorkerCodec *codecs,
+									  const CompressionCodec *codec,
+									  void **dctx)
+{
+	int			i;
+
+	for (i = 0; i < MAX_WORKER_CODECS; i++)
+	{
+		if (codecs[i].codec == codec)
+		{
+			*dctx = codecs[i].dctx;
+			return true;
+		}
+		if (codecs[i].codec == NULL)
+			break;
+	}
+
+	*dctx = NULL;
+	if (codec->create_dctx != NULL)
+	{
+		*dctx = codec->create_dctx();
+		if (*dctx == NULL)
+			return false;
+	}
+
+	if (i < MAX_WORKER_CODECS)
+	{
+		codecs[i].codec = codec;
+		codecs[i].dctx = *dctx;
+	}
+	else if (*dctx != NULL)
+	{
+		/* No room to keep it; cannot happen with the codecs we have */
+		codec->free_dctx(*dctx);
+		return false;
+	}
+
+	return true;
+}
+
+static void *
+AppendOnlyDecompressWorker_Main(void *arg)
+{
+	AppendOnlyDecompressPool *pool = (AppendOnlyDecompressPool *) arg;
+	AppendOnlyDecompressWorkerCodec codecs[MAX_WORKER_CODECS];
+	int			i;
+
+	gp_set_thread_sigmasks();
+
+	memset(codecs, 0, sizeof(codecs));
+
+	pthread_mutex_lock(&pool->mutex);
+	while (true)
+	{
+		AppendOnlyDecompressJob *job;
+		void	   *dctx;
+
+		while (!pool->shutdown && pool->queueHead == NULL)
+			pthread_cond_wait(&pool->workCond, &pool->mutex);
+		if (pool->shutdown)
+			break;
+
+		job = pool->queueHead;
+		pool->queueHead = job->next;
+		if (pool->queueHead == NULL)
+			pool->queueTail = NULL;
+		job->next = NULL;
+		job->state = AODecompressJob_Running;
+		pthread_mutex_unlock(&pool->mutex);
+
+		if (AppendOnlyDecompressWorker_GetContext(codecs, job->codec, &dctx))
+			AppendOnlyDecompressJob_Run(job, dctx);
+		else
+		{
+			job->resultLen = 0;
+			job->error = "could not create decompression context";
+		}
+
+		pthread_mutex_lock(&pool->mutex);
+		job->state = AODecompressJob_Done;
+		pthread_cond_broadcast(&pool->doneCond);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < MAX_WORKER_CODECS && codecs[i].codec != NULL; i++)
+	{
+		if (codecs[i].dctx != NULL)
+			codecs[i].codec->free_dctx(codecs[i].dctx);
+	}
+
+	return NULL;
+}
+
+/*
+ * Start a pool of numWorkers threads.  Returns NULL if no thread could be
+ * started.
+ */
+AppendOnlyDecompressPool *
+AppendOnlyDecompressPool_Create(int numWorkers)
+{
+	MemoryContext memoryContext;
+	AppendOnlyDecompressPool *pool;
+	int			i;
+
+	Assert(numWorkers > 0);
+
+	/*
+	 * Not a child of the caller's context: the pool must outlive an error
+	 * that resets it, until the workers are stopped.
+	 */
+	memoryContext = AllocSetContextCreate(TopMemoryContext,
+										  "AppendOnlyDecompressPool",
+										  ALLOCSET_DEFAULT_MINSIZE,
+										  ALLOCSET_DEFAULT_INITSIZE,
+										  ALLOCSET_DEFAULT_MAXSIZE);
+
+	pool = MemoryContextAllocZero(memoryContext,
+								  sizeof(AppendOnlyDecompressPool));
+	pool->memoryContext = memoryContext;
+	pool->workers = MemoryContextAlloc(memoryContext,
+									   sizeof(pthread_t) * numWorkers);
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->workCond, NULL);
+	pthread_cond_init(&pool->doneCond, NULL);
+
+	for (i = 0; i < numWorkers; i++)
+	{
+		if (gp_pthread_create(&pool->workers[i],
+							  AppendOnlyDecompressWorker_Main, pool,
+							  "AppendOnlyDecompressPool_Create") != 0)
+			break;
+		pool->numWorkers++;
+	}
+
+	if (pool->numWorkers == 0)
+	{
+		elog(LOG, "could not start any append-only decompression thread");
+		pthread_mutex_destroy(&pool->mutex);
+		pthread_cond_destroy(&pool->workCond);
+		pthread_cond_destroy(&pool->doneCond);
+		MemoryContextDelete(memoryContext);
+		return NULL;
+	}
+
+	RegisterXactCallbackOnce(AppendOnlyDecompressPool_XactCallback, pool);
+
+	return pool;
+}
+
+static void
+AppendOnlyDecompressPool_Shutdown(AppendOnlyDecompressPool *pool)
+{
+	int			i;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->shutdown = true;
+	pthread_cond_broadcast(&pool->workCond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	/* A worker finishes the block at hand, then exits */
+	for (i = 0; i < pool->numWorkers; i++)
+		pthread_join(pool->workers[i], NULL);
+
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->workCond);
+	pthread_cond_destroy(&pool->doneCond);
+
+	MemoryContextDelete(pool->memoryContext);
+}
+
+/*
+ * Clean up pools of scans that did not end, e.g. because of an error.
+ */
+static void
+AppendOnlyDecompressPool_XactCallback(XactEvent event, void *arg)
+{
+	AppendOnlyDecompressPool_Shutdown((AppendOnlyDecompressPool *) arg);
+}
+
+/*
+ * Stop the workers and free the pool and all its jobs.
+ */
+void
+AppendOnlyDecompressPool_Destroy(AppendOnlyDecompressPool *pool)
+{
+	Assert(pool != NULL);
+
+	UnregisterXactCallbackOnce(AppendOnlyDecompressPool_XactCallback, pool);
+	AppendOnlyDecompressPool_Shutdown(pool);
+}
+
+/*
+ * Allocate a job for blocks of the given codec with buffers of bufferLen
+ * bytes.
+ */
+AppendOnlyDecompressJob *
+AppendOnlyDecompressPool_AllocJob(AppendOnlyDecompressPool *pool,
+								  const CompressionCodec *codec,
+								  int32 bufferLen)
+{
+	AppendOnlyDecompressJob *job;
+
+	Assert(pool != NULL);
+	Assert(codec != NULL && codec->decompress_r != NULL);
+	Assert(bufferLen > 0);
+
+	job = MemoryContextAllocZero(pool->memoryContext,
+								 sizeof(AppendOnlyDecompressJob));
+	job->pool = pool;
+	job->codec = codec;
+	job->bufferLen = bufferLen;
+	job->compressed = MemoryContextAlloc(pool->memoryContext, bufferLen);
+	job->uncompressed = MemoryContextAlloc(pool->memoryContext, bufferLen);
+	job->state = AODecompressJob_Idle;
+
+	return job;
+}
+
+/*
+ * Return the buffer to copy the compressed block into before submitting.
+ */
+uint8 *
+AppendOnlyDecompressJob_CompressedBuffer(AppendOnlyDecompressJob *job)
+{
+	Assert(job->state == AODecompressJob_Idle);
+
+	return job->compressed;
+}
+
+/*
+ * Queue the job to decompress compressedLen bytes into uncompressedLen.
+ */
+void
+AppendOnlyDecompressJob_Submit(AppendOnlyDecompressJob *job,
+							   int32 compressedLen,
+							   int32 uncompressedLen)
+{
+	AppendOnlyDecompressPool *pool = job->pool;
+
+	Assert(job->state == AODecompressJob_Idle);
+	Assert(compressedLen > 0 && compressedLen <= job->bufferLen);
+	Assert(uncompressedLen > 0 && uncompressedLen <= job->bufferLen);
+
+	job->compressedLen = compressedLen;
+	job->uncompressedLen = uncompressedLen;
+	job->resultLen = 0;
+	job->error = NULL;
+	job->next = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+	job->state = AODecompressJob_Queued;
+	if (pool->queueTail == NULL)
+		pool->queueHead = job;
+	else
+		pool->queueTail->next = job;
+	pool->queueTail = job;
+	pthread_cond_signal(&pool->workCond);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/*
+ * Take a queued job off the queue.  Called with the mutex held.
+ */
+static void
+AppendOnlyDecompressPool_Unqueue(AppendOnlyDecompressPool *pool,
+								 AppendOnlyDecompressJob *job)
+{
+	AppendOnlyDecompressJob *prev = NULL;
+	AppendOnlyDecompressJob *cur;
+
+	for (cur = pool->queueHead; cur != NULL; prev = cur, cur = cur->next)
+	{
+		if (cur == job)
+			break;
+	}
+	Assert(cur == job);
+
+	if (prev == NULL)
+		pool->queueHead = job->next;
+	else
+		prev->next = job->next;
+	if (pool->queueTail == job)
+		pool->queueTail = prev;
+	job->next = NULL;
+}
+
+/*
+ * Wait for the job to finish and return the decompressed content.
+ *
+ * A job no worker has started yet is decompressed here, rather than waiting
+ * for a worker to get to it.
+ */
+uint8 *
+AppendOnlyDecompressJob_Wait(AppendOnlyDecompressJob *job)
+{
+	AppendOnlyDecompressPool *pool = job->pool;
+	bool		runHere = false;
+
+	Assert(job->state != AODecompressJob_Idle);
+
+	pthread_mutex_lock(&pool->mutex);
+	if (job->state == AODecompressJob_Queued)
+	{
+		/* No worker will see it any more */
+		AppendOnlyDecompressPool_Unqueue(pool, job);
+		job->state = AODecompressJob_Idle;
+		runHere = true;
+	}
+	else
+	{
+		while (job->state != AODecompressJob_Done)
+			pthread_cond_wait(&pool->doneCond, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (runHere)
+	{
+		/* The backend's own context; this may raise errors itself */
+		job->resultLen = job->codec->decompress(job->compressed,
+												job->compressedLen,
+												job->uncompressed,
+												job->uncompressedLen);
+		job->error = NULL;
+	}
+
+	job->state = AODecompressJob_Idle;
+
+	if (job->resultLen == 0 && job->error != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("%s decompression failed: %s",
+						job->codec->name, job->error)));
+
+	if (job->resultLen != (size_t) job->uncompressedLen)
+		elog(ERROR,
+			 "Uncompress returned length " INT64_FORMAT " which is different than the "
+			 "expected length %d",
+			 (int64) job->resultLen,
+			 job->uncompressedLen);
+
+	return job->uncompressed;
+}
+
+/*
+ * Forget a submitted job, waiting for it if a worker is running it.
+ */
+void
+AppendOnlyDecompressJob_Cancel(AppendOnlyDecompressJob *job)
+{
+	AppendOnlyDecompressPool *pool = job->pool;
+
+	if (job->state == AODecompressJob_Idle)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (job->state == AODecompressJob_Queued)
+		AppendOnlyDecompressPool_Unqueue(pool, job);
+	else
+	{
+		while (job->state != AODecompressJob_Done)
+			pthread_cond_wait(&pool->doneCond, &pool->mutex);
+	}
+	job->state = AODecompressJob_Idle;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/*
+ * Free a job, cancelling it first if need be.
+ */
+void
+AppendOnlyDecompressJob_Free(AppendOnlyDecompressJob *job)
+{
+	AppendOnlyDecompressJob_Cancel(job);
+
+	pfree(job->compressed);
+	pfree(job->uncompressed);
+	pfree(job);
+}
@@ -22,6 +22,13 @@
 #include "cdb/cdbappendonlystorageread.h"
 #include "utils/guc.h"
 
+static void AppendOnlyStorageRead_AheadReset(
+	AppendOnlyStorageRead			*storageRead);
+static void AppendOnlyStorageRead_InternalGetBuffer(
+	AppendOnlyStorageRead			*storageRead,
+	uint8							**header,
+	uint8							**content);
+
 
 // -----------------------------------------------------------------------------
 // Initialization
@@ -130,6 +137,8 @@ void AppendOnlyStorageRead_Init(
 					 storageRead->maxBufferLen,
 					 storageRead->largeReadLen,
 					 relationName);
+	BufferedReadSetPrefetchDepth(&storageRead->bufferedRead,
+								 gp_appendonly_prefetch_depth);
 
 	elogif(Debug_appendonly_print_scan || Debug_appendonly_print_read_block, LOG,
 		"Append-Only Storage Read initialize for table '%s' "
@@ -172,6 +181,69 @@ char *AppendOnlyStorageRead_SegmentFileName(
 	return storageRead->segmentFileName;
 }
 
+/*
+ * Set how many large reads ahead to prefetch.
+ */
+void AppendOnlyStorageRead_SetPrefetchDepth(
+	AppendOnlyStorageRead			*storageRead,
+	int32							prefetchDepth)
+{
+	Assert(storageRead != NULL);
+	Assert(storageRead->isActive);
+
+	BufferedReadSetPrefetchDepth(&storageRead->bufferedRead, prefetchDepth);
+}
+
+/*
+ * Decompress up to depth - 1 blocks ahead of the caller with the workers
+ * of pool.
+ *
+ * The blocks are still read, and their checksums verified, by this backend
+ * in file order; only the decompression of a copy of each compressed block
+ * is handed to the workers.  A block that cannot be handed over (large
+ * content, not compressed, or too long) stops the read-ahead until the
+ * caller has moved past it.
+ */
+bool AppendOnlyStorageRead_SetDecompressAhead(
+	AppendOnlyStorageRead			*storageRead,
+	AppendOnlyDecompressPool		*pool,
+	int								depth)
+{
+	const CompressionCodec *codec;
+	MemoryContext	oldMemoryContext;
+	int				i;
+
+	Assert(storageRead != NULL);
+	Assert(storageRead->isActive);
+	Assert(storageRead->file == -1);
+	Assert(storageRead->ahead == NULL);
+
+	if (pool == NULL || depth < 2 ||
+		!storageRead->storageAttributes.compress ||
+		storageRead->storageAttributes.compressType == NULL)
+		return false;
+
+	codec = GetCompressionCodec(storageRead->storageAttributes.compressType);
+	if (codec == NULL || codec->decompress_r == NULL)
+		return false;
+
+	oldMemoryContext = MemoryContextSwitchTo(storageRead->memoryContext);
+
+	storageRead->ahead = (AppendOnlyStorageReadAhead *)
+		palloc0(depth * sizeof(AppendOnlyStorageReadAhead));
+	for (i = 0; i < depth; i++)
+		storageRead->ahead[i].job =
+			AppendOnlyDecompressPool_AllocJob(pool, codec,
+											  storageRead->maxBufferLen);
+
+	MemoryContextSwitchTo(oldMemoryContext);
+
+	storageRead->aheadDepth = depth;
+	AppendOnlyStorageRead_AheadReset(storageRead);
+
+	return true;
+}
+
 /*
  * Finish using the AppendOnlyStorageRead session created with ~Init.
  */
@@ -189,6 +261,17 @@ void AppendOnlyStorageRead_FinishSession(
 	// UNDONE: This expects the MemoryContext to be what was used for the 'memory' in ~Init
 	BufferedReadFinish(&storageRead->bufferedRead);
 
+	if (storageRead->ahead != NULL)
+	{
+		int		i;
+
+		for (i = 0; i < storageRead->aheadDepth; i++)
+			AppendOnlyDecompressJob_Free(storageRead->ahead[i].job);
+		pfree(storageRead->ahead);
+		storageRead->ahead = NULL;
+		storageRead->aheadDepth = 0;
+	}
+
 	if (storageRead->relationName != NULL)
 	{
 		pfree(storageRead->relationName);
@@ -321,6 +404,8 @@ static void AppendOnlyStorageRead_FinishOpenFile(
 
 	storageRead->logicalEof = logicalEof;
 
+	AppendOnlyStorageRead_AheadReset(storageRead);
+
 	BufferedReadSetFile(
 				&storageRead->bufferedRead,
 				storageRead->file,
@@ -450,6 +535,8 @@ void AppendOnlyStorageRead_SetTemporaryRange(
 	Assert(afterFileOffset >= 0);
 	Assert(afterFileOffset <= storageRead->logicalEof);
 
+	AppendOnlyStorageRead_AheadReset(storageRead);
+
 	BufferedReadSetTemporaryRange(&storageRead->bufferedRead,
 								  beginFileOffset,
 								  afterFileOffset);
@@ -469,6 +556,8 @@ void AppendOnlyStorageRead_CloseFile(
 	if (storageRead->file == -1)
 		return;
 
+	AppendOnlyStorageRead_AheadReset(storageRead);
+
 	FileClose(storageRead->file);
 
 	storageRead->file = -1;
@@ -1034,6 +1123,148 @@ bool AppendOnlyStorageRead_ReadNextBlock(
 	return true;
 }
 
+// -----------------------------------------------------------------------------
+// Decompressing Ahead
+// -----------------------------------------------------------------------------
+
+/*
+ * Forget the blocks read ahead, e.g. because the read position moves.
+ */
+static void AppendOnlyStorageRead_AheadReset(
+	AppendOnlyStorageRead			*storageRead)
+{
+	int		i;
+
+	if (storageRead->ahead == NULL)
+		return;
+
+	for (i = 0; i < storageRead->aheadDepth; i++)
+		AppendOnlyDecompressJob_Cancel(storageRead->ahead[i].job);
+
+	storageRead->aheadFirst = 0;
+	storageRead->aheadCount = 0;
+	storageRead->aheadAtLive = false;
+	storageRead->aheadAtEof = false;
+	storageRead->aheadCurrent = NULL;
+}
+
+/*
+ * Can the block just read by ~_ReadNextBlock be decompressed by a worker?
+ */
+static bool AppendOnlyStorageRead_AheadEligible(
+	AppendOnlyStorageRead			*storageRead)
+{
+	AppendOnlyStorageReadCurrent *current = &storageRead->current;
+
+	return (!current->isLarge &&
+			current->isCompressed &&
+			(current->headerKind == AoHeaderKind_SmallContent ||
+			 current->headerKind == AoHeaderKind_BulkDenseContent) &&
+			current->compressedLen <= storageRead->maxBufferLen &&
+			current->uncompressedLen <= storageRead->maxBufferLen);
+}
+
+/*
+ * Read blocks into the ring until it is full, the file ends or a block
+ * that must stay in the BufferedRead buffer is found.
+ */
+static void AppendOnlyStorageRead_AheadFill(
+	AppendOnlyStorageRead			*storageRead)
+{
+	while (!storageRead->aheadAtLive &&
+		   !storageRead->aheadAtEof &&
+		   storageRead->aheadCount < storageRead->aheadDepth)
+	{
+		AppendOnlyStorageReadAhead *slot;
+		uint8	   *header;
+		uint8	   *content;
+
+		if (!AppendOnlyStorageRead_ReadNextBlock(storageRead))
+		{
+			storageRead->aheadAtEof = true;
+			break;
+		}
+
+		slot = &storageRead->ahead[(storageRead->aheadFirst + storageRead->aheadCount) %
+								   storageRead->aheadDepth];
+		storageRead->aheadCount++;
+
+		memcpy(&slot->current, &storageRead->current,
+			   sizeof(AppendOnlyStorageReadCurrent));
+
+		if (!AppendOnlyStorageRead_AheadEligible(storageRead))
+		{
+			slot->isLive = true;
+			storageRead->aheadAtLive = true;
+			break;
+		}
+
+		slot->isLive = false;
+
+		AppendOnlyStorageRead_InternalGetBuffer(
+										storageRead,
+										&header,
+										&content);
+
+		memcpy(AppendOnlyDecompressJob_CompressedBuffer(slot->job),
+			   content,
+			   storageRead->current.compressedLen);
+		AppendOnlyDecompressJob_Submit(slot->job,
+									   storageRead->current.compressedLen,
+									   storageRead->current.uncompressedLen);
+	}
+}
+
+/*
+ * The ~_ReadNextBlock of a session that decompresses ahead: make the next
+ * block from the ring the current one.
+ */
+static bool AppendOnlyStorageRead_AheadNextBlock(
+	AppendOnlyStorageRead			*storageRead)
+{
+	AppendOnlyStorageReadAhead *slot;
+
+	if (storageRead->aheadCurrent != NULL)
+	{
+		/* The caller skipped or got the previous block; forget it */
+		AppendOnlyDecompressJob_Cancel(storageRead->aheadCurrent->job);
+		storageRead->aheadCurrent = NULL;
+	}
+
+	AppendOnlyStorageRead_AheadFill(storageRead);
+
+	if (storageRead->aheadCount == 0)
+	{
+		/* Done reading the file; reset current* as ~_ReadNextBlock does */
+		memset(&storageRead->current, 0, sizeof(AppendOnlyStorageReadCurrent));
+		storageRead->current.headerKind = AoHeaderKind_None;
+		storageRead->current.firstRowNum = INT64CONST(-1);
+		storageRead->aheadAtEof = false;
+		return false;
+	}
+
+	slot = &storageRead->ahead[storageRead->aheadFirst];
+	storageRead->aheadFirst = (storageRead->aheadFirst + 1) % storageRead->aheadDepth;
+	storageRead->aheadCount--;
+
+	memcpy(&storageRead->current, &slot->current,
+		   sizeof(AppendOnlyStorageReadCurrent));
+
+	if (slot->isLive)
+	{
+		/*
+		 * Still the block in the BufferedRead buffer; the caller reads it
+		 * the regular way and the read-ahead resumes after it.
+		 */
+		Assert(storageRead->aheadCount == 0);
+		storageRead->aheadAtLive = false;
+	}
+	else
+		storageRead->aheadCurrent = slot;
+
+	return true;
+}
+
 /*
  * Get information on the next Append-Only Storage Block.
  *
@@ -1080,7 +1311,10 @@ bool AppendOnlyStorageRead_GetBlockInfo(
 	Assert(storageRead != NULL);
 	Assert(storageRead->isActive);
 
-	isNext = AppendOnlyStorageRead_ReadNextBlock(storageRead);
+	if (storageRead->ahead != NULL)
+		isNext = AppendOnlyStorageRead_AheadNextBlock(storageRead);
+	else
+		isNext = AppendOnlyStorageRead_ReadNextBlock(storageRead);
 
 	/*
 	 * The current* variables have good values even when there is no next block.
@@ -1237,6 +1471,7 @@ uint8 *AppendOnlyStorageRead_GetBuffer(
 		   storageRead->current.headerKind == AoHeaderKind_BulkDenseContent);
 	Assert(!storageRead->current.isLarge);
 	Assert(!storageRead->current.isCompressed);
+	Assert(storageRead->aheadCurrent == NULL);
 
 	/*
 	 * Fetch pointers to content.
@@ -1270,6 +1505,32 @@ void AppendOnlyStorageRead_Content(
 	Assert(storageRead->isActive);
 	Assert(contentOutLen == storageRead->current.uncompressedLen);
 
+	if (storageRead->aheadCurrent != NULL)
+	{
+		AppendOnlyStorageReadAhead *slot = storageRead->aheadCurrent;
+
+		/*
+		 * Decompressed ahead by a worker (or, if none got to it yet, right
+		 * here).
+		 */
+		memcpy(contentOut,
+			   AppendOnlyDecompressJob_Wait(slot->job),
+			   storageRead->current.uncompressedLen);
+		storageRead->aheadCurrent = NULL;
+
+		if (Debug_appendonly_print_scan)
+			elog(LOG,
+				 "Append-only Storage Read decompressed ahead block for table '%s' "
+				 "(compressed length %d, uncompressed length = %d, segment file '%s', "
+				 "header offset in file = " INT64_FORMAT ")",
+				 storageRead->relationName,
+				 storageRead->current.compressedLen,
+				 storageRead->current.uncompressedLen,
+				 storageRead->segmentFileName,
+				 storageRead->current.headerOffsetInFile);
+		return;
+	}
+
 	if (storageRead->current.isLarge)
 	{
 		int64		largeContentPosition;
@@ -1484,6 +1745,14 @@ void AppendOnlyStorageRead_SkipCurrentBlock(
 	Assert(storageRead != NULL);
 	Assert(storageRead->isActive);
 
+	if (storageRead->aheadCurrent != NULL)
+	{
+		/* Already read; just drop the decompression */
+		AppendOnlyDecompressJob_Cancel(storageRead->aheadCurrent->job);
+		storageRead->aheadCurrent = NULL;
+		return;
+	}
+
 	if (storageRead->current.isLarge)
 	{
 		int64		largeContentPosition;
@@ -16,6 +16,8 @@
 
 static void BufferedReadIo(
     BufferedRead        *bufferedRead);
+static void BufferedReadPrefetch(
+    BufferedRead        *bufferedRead);
 static uint8 *BufferedReadUseBeforeBuffer(
     BufferedRead       *bufferedRead,
     int32              maxReadAheadLen,
@@ -102,6 +104,25 @@ void BufferedReadInit(
 	 */
 	bufferedRead->haveTemporaryLimitInEffect = false;
 	bufferedRead->temporaryLimitFileLen = 0;
+
+	/*
+	 * Prefetch support.
+	 */
+	bufferedRead->prefetchDepth = 0;
+	bufferedRead->prefetchPosition = 0;
+}
+
+/*
+ * Set how many large reads ahead of the current one to prefetch.
+ */
+void BufferedReadSetPrefetchDepth(
+    BufferedRead         *bufferedRead,
+    int32                prefetchDepth)
+{
+	Assert(bufferedRead != NULL);
+	Assert(prefetchDepth >= 0);
+
+	bufferedRead->prefetchDepth = prefetchDepth;
 }
 
 /*
@@ -134,6 +155,8 @@ void BufferedReadSetFile(
 	bufferedRead->haveTemporaryLimitInEffect = false;
 	bufferedRead->temporaryLimitFileLen = 0;
 
+	bufferedRead->prefetchPosition = 0;
+
 	if (fileLen > 0)
 	{
 		/*
@@ -235,6 +258,69 @@ static void BufferedReadIo(
 
 	if (VacuumCostActive)
 		VacuumCostBalance += VacuumCostPageMiss;
+
+	BufferedReadPrefetch(bufferedRead);
+}
+
+/*
+ * Ask the kernel to read ahead the prefetchDepth large reads that follow
+ * the current one, so they are (being) read in while the caller works on
+ * the current one.  With many files read in an interleaved fashion, e.g.
+ * the columns of a column-oriented table, this keeps several reads in
+ * flight instead of waiting for each one in turn.
+ *
+ * The request is renewed a large read at a time, not for every read.
+ */
+static void BufferedReadPrefetch(
+    BufferedRead        *bufferedRead)
+{
+	int64 inEffectFileLen;
+	int64 largeReadAfterPos;
+	int64 prefetchAfterPos;
+
+	if (bufferedRead->prefetchDepth <= 0)
+		return;
+
+	if (bufferedRead->haveTemporaryLimitInEffect)
+		inEffectFileLen = bufferedRead->temporaryLimitFileLen;
+	else
+		inEffectFileLen = bufferedRead->fileLen;
+
+	largeReadAfterPos = bufferedRead->largeReadPosition +
+						bufferedRead->largeReadLen;
+	if (bufferedRead->prefetchPosition < largeReadAfterPos)
+		bufferedRead->prefetchPosition = largeReadAfterPos;
+
+	prefetchAfterPos = largeReadAfterPos +
+					   (int64) bufferedRead->prefetchDepth *
+					   bufferedRead->maxLargeReadLen;
+	if (prefetchAfterPos > inEffectFileLen)
+		prefetchAfterPos = inEffectFileLen;
+
+	if (prefetchAfterPos <= bufferedRead->prefetchPosition)
+		return;
+	if (prefetchAfterPos - bufferedRead->prefetchPosition <
+									bufferedRead->maxLargeReadLen &&
+		prefetchAfterPos < inEffectFileLen)
+		return;
+
+	/*
+	 * The advice is only a hint, so failures are not reported beyond the
+	 * debug log.
+	 */
+	if (FilePrefetch(bufferedRead->file,
+					 bufferedRead->prefetchPosition,
+					 (int) (prefetchAfterPos -
+							bufferedRead->prefetchPosition)) < 0)
+		elogif(Debug_appendonly_print_read_block, LOG,
+			   "Append-Only storage prefetch failed: table '%s', segment file '%s', "
+			   "position " INT64_FORMAT ", length " INT64_FORMAT ": %m",
+			   bufferedRead->relationName,
+			   bufferedRead->filePathName,
+			   bufferedRead->prefetchPosition,
+			   prefetchAfterPos - bufferedRead->prefetchPosition);
+
+	bufferedRead->prefetchPosition = prefetchAfterPos;
 }
 
 static uint8 *BufferedReadUseBeforeBuffer(
@@ -404,6 +490,12 @@ void BufferedReadSetTemporaryRange(
 		}
 	}
 
+	/*
+	 * Set the limit before reading, so prefetching stays within it.
+	 */
+	bufferedRead->haveTemporaryLimitInEffect = true;
+	bufferedRead->temporaryLimitFileLen = afterFileOffset;
+
 	if (newReadNeeded)
 	{
 		int64	remainingFileLen;
@@ -433,14 +525,11 @@ void BufferedReadSetTemporaryRange(
 			bufferedRead->largeReadLen = (int32)remainingFileLen;
 
 		bufferedRead->largeReadPosition = beginFileOffset;
+		bufferedRead->prefetchPosition = 0;
 
 		if (bufferedRead->largeReadLen > 0)
 			BufferedReadIo(bufferedRead);
 	}
-
-	bufferedRead->haveTemporaryLimitInEffect = true;
-	bufferedRead->temporaryLimitFileLen = afterFileOffset;
-	
 }
 
 /*
@@ -685,6 +774,8 @@ void BufferedReadCompleteFile(
 
 	bufferedRead->largeReadPosition = 0;
 	bufferedRead->largeReadLen = 0;
+
+	bufferedRead->prefetchPosition = 0;
 }
 
 
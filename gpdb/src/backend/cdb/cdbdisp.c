@@ -72,6 +72,16 @@
 #include "utils/portal.h"
 
 #define DISPATCH_WAIT_TIMEOUT_SEC 2
+
+/*
+ * Event-driven dispatch waits on all QE connections from the main thread;
+ * see cdbdisp_waitEvents().
+ */
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define USE_DISPATCH_EPOLL
+#define DISPATCH_MAX_EVENTS 64
+#endif
 extern bool Test_print_direct_dispatch_info;
 
 extern pthread_t main_tid;
@@ -94,6 +104,12 @@ static void *thread_DispatchCommand(void *arg);
 static bool thread_DispatchOut(DispatchCommandParms		*pParms);
 static void thread_DispatchWait(DispatchCommandParms	*pParms);
 static void thread_DispatchWaitSingle(DispatchCommandParms		*pParms);
+static bool cdbdisp_useEventDriven(void);
+#ifdef USE_DISPATCH_EPOLL
+static void cdbdisp_watchEvents(CdbDispatchCmdThreads *dThreads, DispatchCommandParms *pParms);
+static void cdbdisp_signalEvents(CdbDispatchCmdThreads *dThreads);
+static void cdbdisp_waitEvents(CdbDispatcherState *ds, bool block);
+#endif
 
 static void CdbCheckDispatchResultInt(struct CdbDispatcherState *ds,
 						  struct SegmentDatabaseDescriptor ***failedSegDB,
@@ -140,7 +156,8 @@ addSegDBToDispatchThreadPool(DispatchCommandParms  *ParmsAr,
 							 GpDispatchCommandType	mppDispatchCommandType,
 							 void				   *commandTypeParms,
 							 int					sliceId,
-							 CdbDispatchResult     *dispatchResult);
+							 CdbDispatchResult     *dispatchResult,
+							 int					connsPerThread);
 
 static void
 cdbdisp_dispatchCommandToAllGangs(const char	*strCommand,
@@ -233,7 +250,9 @@ static volatile int32 RunningThreadCount = 0;
  * on other qExecs. Normally this would be true.  The commands are sent over the libpq
  * connections that were established during cdblink_setup.	They are run inside of threads.
  * The number of segdbs handled by any one thread is determined by the
- * guc variable gp_connections_per_thread.
+ * guc variable gp_connections_per_thread.  With gp_dispatch_event_driven,
+ * the command is sent from the calling thread and the QEs are watched
+ * through the dispatcher's epoll set instead; no threads are started.
  *
  * The caller must provide a CdbDispatchResults object having available
  * resultArray slots sufficient for the number of QEs to be dispatched:
@@ -281,6 +300,8 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 		x,
 		newThreads = 0;	
 	int db_descriptors_size;
+	bool eventDriven;
+	int connsPerThread;
 	SegmentDatabaseDescriptor *db_descriptors;
 
 	MemoryContext oldContext;
@@ -369,10 +390,21 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 	
 	Assert(db_descriptors_size <= largestGangsize());
 
-	if (gp_connections_per_thread == 0)
+	/*
+	 * An event-driven dispatch puts the whole gang in one parameter block,
+	 * like gp_connections_per_thread = 0.  Stick to the mode the statement
+	 * started with even if the GUC changes under us.
+	 */
+	if (ds->dispatchThreads != NULL)
+		eventDriven = (ds->dispatchThreads->epollfd >= 0);
+	else
+		eventDriven = cdbdisp_useEventDriven();
+	connsPerThread = (eventDriven ? 0 : gp_connections_per_thread);
+
+	if (connsPerThread == 0)
 		max_threads = 1;	/* one, not zero, because we need to allocate one param block */
 	else
-		max_threads = 1 + (largestGangsize() - 1) / gp_connections_per_thread;
+		max_threads = 1 + (largestGangsize() - 1) / connsPerThread;
 	
 	if (DispatchContext == NULL)
 	{
@@ -399,6 +431,7 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 		elog(DEBUG4, "dispatcher: allocating command array with maxslices %d paramCount %d", maxSlices, paramCount);
 			
 		ds->dispatchThreads = cdbdisp_makeDispatchThreads(paramCount);
+		Assert((ds->dispatchThreads->epollfd >= 0) == eventDriven);
 	}
 	else
 	{
@@ -462,7 +495,8 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 					   				 mppDispatchCommandType,
 					   				 commandTypeParms,
 									 sliceIndex,
-                                     qeResult);
+                                     qeResult,
+                                     connsPerThread);
 
 		/*
 		 * This CdbDispatchResult/SegmentDatabaseDescriptor pair will be
@@ -479,16 +513,15 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 
 	/*
 	 * Compute the thread count based on how many segdbs were added into the
-	 * thread pool, knowing that each thread handles gp_connections_per_thread
-	 * segdbs.
+	 * thread pool, knowing that each thread handles connsPerThread segdbs.
 	 */
 	if (segdbs_in_thread_pool == 0)
 		newThreads += 0;
 	else
-		if (gp_connections_per_thread == 0)
+		if (connsPerThread == 0)
 			newThreads += 1;
 		else
-			newThreads += 1 + (segdbs_in_thread_pool - 1) / gp_connections_per_thread;
+			newThreads += 1 + (segdbs_in_thread_pool - 1) / connsPerThread;
 
 	oldContext = MemoryContextSwitchTo(DispatchContext);
 	for (i = 0; i < newThreads; i++)
@@ -509,10 +542,14 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 		
 		Assert(pParms != NULL);
 		
-	    if (gp_connections_per_thread==0)
+	    if (connsPerThread == 0)
 	    {
 	    	Assert(newThreads <= 1);
 	    	thread_DispatchOut(pParms);
+#ifdef USE_DISPATCH_EPOLL
+			if (eventDriven)
+				cdbdisp_watchEvents(ds->dispatchThreads, pParms);
+#endif
 	    }
 	    else
 	    {
@@ -562,8 +599,8 @@ cdbdisp_dispatchToGang(struct CdbDispatcherState *ds,
 /*
  * addSegDBToDispatchThreadPool
  * Helper function used to add a segdb's segdbDesc to the thread pool to have commands dispatched to.
- * It figures out which thread will handle it, based on the setting of
- * gp_connections_per_thread.
+ * It figures out which thread will handle it, based on connsPerThread:
+ * gp_connections_per_thread, or 0 to put the whole gang in one block.
  */
 static void
 addSegDBToDispatchThreadPool(DispatchCommandParms  *ParmsAr,
@@ -571,7 +608,8 @@ addSegDBToDispatchThreadPool(DispatchCommandParms  *ParmsAr,
 						     GpDispatchCommandType	mppDispatchCommandType,
 						     void				   *commandTypeParms,
                              int					sliceId,
-                             CdbDispatchResult     *dispatchResult)
+                             CdbDispatchResult     *dispatchResult,
+                             int					connsPerThread)
 {
 	DispatchCommandParms *pParms;
 	int			ParmsIndex;
@@ -579,25 +617,25 @@ addSegDBToDispatchThreadPool(DispatchCommandParms  *ParmsAr,
 
 	/*
 	 * The proper index into the DispatchCommandParms array is computed, based on
-	 * having gp_connections_per_thread segdbDesc's in each thread.
+	 * having connsPerThread segdbDesc's in each thread.
 	 * If it's the first access to an array location, determined
-	 * by (*segdbCount) % gp_connections_per_thread == 0,
+	 * by (*segdbCount) % connsPerThread == 0,
 	 * then we initialize the struct members for that array location first.
 	 */
-	if (gp_connections_per_thread == 0)
+	if (connsPerThread == 0)
 		ParmsIndex = 0;
 	else
-		ParmsIndex = segdbs_in_thread_pool / gp_connections_per_thread;
+		ParmsIndex = segdbs_in_thread_pool / connsPerThread;
 	pParms = &ParmsAr[ParmsIndex];
 
 	/* 
 	 * First time through?
 	 */
 
-	if (gp_connections_per_thread==0)
+	if (connsPerThread == 0)
 		firsttime = segdbs_in_thread_pool == 0;
 	else
-		firsttime = segdbs_in_thread_pool % gp_connections_per_thread == 0;
+		firsttime = segdbs_in_thread_pool % connsPerThread == 0;
 	if (firsttime)
 	{
 		pParms->mppDispatchCommandType = mppDispatchCommandType;
@@ -727,7 +765,7 @@ addSegDBToDispatchThreadPool(DispatchCommandParms  *ParmsAr,
 		pParms->localSlice = sliceId;
 		Assert(DispatchContext != NULL);
 		pParms->dispatchResultPtrArray =
-			(CdbDispatchResult **) palloc0((gp_connections_per_thread == 0 ? largestGangsize() : gp_connections_per_thread)*
+			(CdbDispatchResult **) palloc0((connsPerThread == 0 ? largestGangsize() : connsPerThread)*
 										   sizeof(CdbDispatchResult *));
 		MemSet(&pParms->thread, 0, sizeof(pthread_t));
 		pParms->db_count = 0;
@@ -811,6 +849,23 @@ CdbCheckDispatchResultInt(struct CdbDispatcherState *ds,
 		return;
 	}
 
+#ifdef USE_DISPATCH_EPOLL
+	/*
+	 * Event-driven: there are no threads, wait for the QEs of all the gangs
+	 * at once.
+	 */
+	if (ds->dispatchThreads->epollfd >= 0)
+	{
+		if (waitMode == DISPATCH_WAIT_CANCEL || waitMode == DISPATCH_WAIT_FINISH)
+		{
+			for (i = 0; i < ds->dispatchThreads->threadCount; i++)
+				ds->dispatchThreads->dispatchCommandParmsAr[i].waitMode = waitMode;
+		}
+
+		cdbdisp_waitEvents(ds, true);
+	}
+#endif
+
 	/*
 	 * Wait for threads to finish.
 	 */
@@ -831,7 +886,11 @@ CdbCheckDispatchResultInt(struct CdbDispatcherState *ds,
 			break;
 		}
 
-		if (gp_connections_per_thread==0)
+		if (ds->dispatchThreads->epollfd >= 0)
+		{
+			/* Event-driven: cdbdisp_waitEvents() above did the waiting. */
+		}
+		else if (gp_connections_per_thread==0)
 		{
 			thread_DispatchWait(pParms);
 		}
@@ -1441,6 +1500,18 @@ cdbdisp_check_estate_for_cancel(struct EState *estate)
 
 	Assert(meleeResults);
 
+#ifdef USE_DISPATCH_EPOLL
+	/*
+	 * Nobody else is reading the QE connections during an event-driven
+	 * dispatch: pick up whatever they have sent so far, so that their
+	 * errors are noticed while the executor is still running.
+	 */
+	if (estate->dispatcherState->dispatchThreads &&
+		estate->dispatcherState->dispatchThreads->epollfd >= 0 &&
+		estate->dispatcherState->dispatchThreads->threadCount > 0)
+		cdbdisp_waitEvents(estate->dispatcherState, false);
+#endif
+
 //	if (pleaseCancel || meleeResults->errcode)
 	if (meleeResults->errcode)
 	{
@@ -2087,6 +2158,234 @@ thread_DispatchWaitSingle(DispatchCommandParms		*pParms)
 	}
 }
 
+/*
+ * Should a new dispatch wait for its QEs from the main thread rather than
+ * start dispatch threads?
+ *
+ * The event loop drains QE connections only from CdbCheckDispatchResult()
+ * and from the UDP interconnect's cancel check.  The TCP interconnect never
+ * calls back into the dispatcher while a query runs, so a QE that fills its
+ * output buffer would stall until the end; use threads there.
+ */
+static bool
+cdbdisp_useEventDriven(void)
+{
+#ifdef USE_DISPATCH_EPOLL
+	return gp_dispatch_event_driven &&
+		Gp_interconnect_type != INTERCONNECT_TYPE_TCP;
+#else
+	return false;
+#endif
+}
+
+#ifdef USE_DISPATCH_EPOLL
+/*
+ * Add the QEs of a freshly dispatched gang to the event set.  Each event
+ * carries the QE's CdbDispatchResult.
+ */
+static void
+cdbdisp_watchEvents(CdbDispatchCmdThreads *dThreads, DispatchCommandParms *pParms)
+{
+	int			i;
+
+	for (i = 0; i < pParms->db_count; i++)
+	{
+		CdbDispatchResult *dispatchResult = pParms->dispatchResultPtrArray[i];
+		struct epoll_event ev;
+		int			sock;
+
+		if (!dispatchResult->stillRunning)
+			continue;
+
+		sock = PQsocket(dispatchResult->segdbDesc->conn);
+		if (sock < 0)
+			continue;			/* cdbdisp_waitEvents() notes the loss */
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = dispatchResult;
+		if (epoll_ctl(dThreads->epollfd, EPOLL_CTL_ADD, sock, &ev) < 0 &&
+			(errno != EEXIST ||
+			 epoll_ctl(dThreads->epollfd, EPOLL_CTL_MOD, sock, &ev) < 0))
+			write_log("could not watch connection to %s; errno=%d",
+					  dispatchResult->segdbDesc->whoami, errno);
+	}
+}
+
+/*
+ * Send the still-running QEs of every gang the cancel or finish signal that
+ * is due, without waiting for a poll timeout and without probing FTS.
+ */
+static void
+cdbdisp_signalEvents(CdbDispatchCmdThreads *dThreads)
+{
+	int			i;
+
+	for (i = 0; i < dThreads->threadCount; i++)
+	{
+		DispatchCommandParms *pParms = &dThreads->dispatchCommandParmsAr[i];
+		int			noProbe = 0;
+
+		handlePollTimeout(pParms, pParms->db_count, &noProbe, false);
+	}
+}
+
+/*
+ * Event-driven counterpart of thread_DispatchWait(), run by the main thread
+ * for the QEs of every gang of the statement at once.
+ *
+ * With block = true, wait until all QEs are done, sending them cancel or
+ * finish according to their waitMode as the threads would.  Otherwise just
+ * consume the input that is already there, and ask the other QEs to cancel
+ * if that turned up an error.
+ */
+static void
+cdbdisp_waitEvents(CdbDispatcherState *ds, bool block)
+{
+	CdbDispatchCmdThreads *dThreads = ds->dispatchThreads;
+	struct epoll_event events[DISPATCH_MAX_EVENTS];
+	int			timeoutCounter = 0;
+	bool		signalNow = block;
+	int			i;
+	int			j;
+
+	for (;;)
+	{
+		int			nrunning = 0;
+		int			n;
+
+		/*
+		 * Which QEs are still running and could send results to us?
+		 */
+		for (i = 0; i < dThreads->threadCount; i++)
+		{
+			DispatchCommandParms *pParms = &dThreads->dispatchCommandParmsAr[i];
+
+			for (j = 0; j < pParms->db_count; j++)
+			{
+				CdbDispatchResult *dispatchResult = pParms->dispatchResultPtrArray[j];
+				SegmentDatabaseDescriptor *segdbDesc = dispatchResult->segdbDesc;
+
+				if (!dispatchResult->stillRunning)
+					continue;
+
+				if (PQsocket(segdbDesc->conn) >= 0 &&
+					PQstatus(segdbDesc->conn) != CONNECTION_BAD)
+					nrunning++;
+
+				/* Lost the connection. */
+				else
+				{
+					char	   *msg = PQerrorMessage(segdbDesc->conn);
+
+					cdbdisp_appendMessage(dispatchResult, DEBUG1,
+										  ERRCODE_GP_INTERCONNECTION_ERROR,
+										  "Lost connection to %s.  %s",
+										  segdbDesc->whoami,
+										  msg ? msg : "");
+
+					PQfinish(segdbDesc->conn);
+					segdbDesc->conn = NULL;
+					dispatchResult->stillRunning = false;
+				}
+			}
+		}
+
+		if (nrunning == 0 || proc_exit_inprogress)
+			break;
+
+		/*
+		 * Send cancel or finish at once rather than on the next timeout,
+		 * when we are told to or a QE has failed.
+		 */
+		if (signalNow)
+		{
+			cdbdisp_signalEvents(dThreads);
+			signalNow = false;
+		}
+
+		n = epoll_wait(dThreads->epollfd, events, DISPATCH_MAX_EVENTS,
+					   block ? DISPATCH_WAIT_TIMEOUT_SEC * 1000 : 0);
+
+		if (n < 0)
+		{
+			int			sock_errno = SOCK_ERRNO;
+
+			if (sock_errno == EINTR)
+				continue;
+
+			for (i = 0; i < dThreads->threadCount; i++)
+			{
+				DispatchCommandParms *pParms = &dThreads->dispatchCommandParmsAr[i];
+
+				handlePollError(pParms, pParms->db_count, sock_errno);
+			}
+			if (!block)
+				break;
+			continue;
+		}
+
+		if (n == 0)
+		{
+			int			counter = timeoutCounter;
+
+			if (!block)
+				break;
+
+			/* One timeout for all the gangs, not one per gang. */
+			for (i = 0; i < dThreads->threadCount; i++)
+			{
+				DispatchCommandParms *pParms = &dThreads->dispatchCommandParmsAr[i];
+
+				counter = timeoutCounter;
+				handlePollTimeout(pParms, pParms->db_count, &counter, true);
+			}
+			timeoutCounter = counter;
+			continue;
+		}
+
+		/*
+		 * We have data waiting on one or more of the connections.
+		 */
+		for (i = 0; i < n; i++)
+		{
+			CdbDispatchResult *dispatchResult = (CdbDispatchResult *) events[i].data.ptr;
+			SegmentDatabaseDescriptor *segdbDesc = dispatchResult->segdbDesc;
+			bool		hadError = (dispatchResult->meleeResults->errcode != 0);
+
+			if (!dispatchResult->stillRunning)
+				continue;
+
+			if (processResults(dispatchResult))
+			{
+				if (DEBUG4 >= log_min_messages)
+					write_log("processResults says we are finished with %s",
+							  segdbDesc->whoami);
+
+				if (segdbDesc->conn && PQsocket(segdbDesc->conn) >= 0)
+					epoll_ctl(dThreads->epollfd, EPOLL_CTL_DEL,
+							  PQsocket(segdbDesc->conn), NULL);
+				dispatchResult->stillRunning = false;
+
+				if (PQisBusy(segdbDesc->conn))
+					write_log("We thought we were done, because finished==true, but libpq says we are still busy");
+			}
+
+			if (!hadError && dispatchResult->meleeResults->errcode != 0 &&
+				dispatchResult->meleeResults->cancelOnError)
+				signalNow = true;
+		}
+
+		if (!block)
+		{
+			/* Cancel the others right away if we have just seen an error. */
+			if (signalNow)
+				cdbdisp_signalEvents(dThreads);
+			break;
+		}
+	}
+}
+#endif   /* USE_DISPATCH_EPOLL */
+
 /*
  * Cleanup routine for the dispatching thread.  This will indicate the thread
  * is not running any longer.
@@ -4352,6 +4651,18 @@ cdbdisp_makeDispatchThreads(int paramCount)
 
     dThreads->threadCount = 0;
 
+	dThreads->epollfd = -1;
+#ifdef USE_DISPATCH_EPOLL
+	if (cdbdisp_useEventDriven())
+	{
+		dThreads->epollfd = epoll_create1(EPOLL_CLOEXEC);
+		if (dThreads->epollfd < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("could not create dispatcher event set: %m")));
+	}
+#endif
+
     return dThreads;
 }                               /* cdbdisp_makeDispatchThreads */
 
@@ -4463,6 +4774,12 @@ cdbdisp_destroyDispatchThreads(CdbDispatchCmdThreads *dThreads)
 	pfree(dThreads->dispatchCommandParmsAr);	
 	dThreads->dispatchCommandParmsAr = NULL;
 
+	if (dThreads->epollfd >= 0)
+	{
+		close(dThreads->epollfd);
+		dThreads->epollfd = -1;
+	}
+
     dThreads->dispatchCommandParmsArSize = 0;
     dThreads->threadCount = 0;
 		
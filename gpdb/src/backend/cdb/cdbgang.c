@@ -45,6 +45,10 @@ extern char *default_tablespace;
 #include "libpq/ip.h"
 
 #include "utils/guc_tables.h"
+#include "access/xact.h"
+#include "funcapi.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
 
 
 #define MAX_CACHED_1_GANGS 1
@@ -1303,6 +1307,18 @@ static List *allocatedReaderGangs1 = NIL;
 static List *availableReaderGangs1 = NIL;
 static Gang *primaryWriterGang = NULL;
 
+/*
+ * Session-local gang pool counters, reported by gp_gang_pool_stats().
+ * "Created" gangs are the ones a query had to wait for; "preforked" gangs
+ * were built while the session was idle and "reused" counts every reader
+ * N-gang allocation served from the cache, pre-forked or not.
+ */
+static int64 gangPoolPreforked = 0;
+static int64 gangPoolPreforkFailures = 0;
+static int64 gangPoolReused = 0;
+static int64 gangPoolCreated = 0;
+static double gangPoolCreateMs = 0;
+
 List *
 getAllReaderGangs()
 {
@@ -1423,15 +1439,21 @@ allocateGang(GangType type, int size, int content, char *portal_name)
 					availableReaderGangsN =
 						list_delete_first(availableReaderGangsN);
 
+					gangPoolReused++;
 				}
 				else
 					/*
 					 * no pre-created gang exists
 					 */
 				{
+					instr_time	starttime;
+					instr_time	elapsed;
+
 					if (gp_log_gang >= GPVARS_VERBOSITY_DEBUG)
 						elog(LOG, "Creating a new reader N-gang for %s", (portal_name ? portal_name : "unnamed portal"));
 
+					INSTR_TIME_SET_CURRENT(starttime);
+
 					for (int attempts = 0; (attempts < gp_gang_creation_retry_count && gp == NULL); attempts++)
 					{
 						gp = createGang(type, gang_id_counter++, size, content, portal_name);
@@ -1441,6 +1463,12 @@ allocateGang(GangType type, int size, int content, char *portal_name)
 							elog(LOG, "Could not create reader gang. Retry count = %d", (attempts + 1));
 						}
 					}
+
+					INSTR_TIME_SET_CURRENT(elapsed);
+					INSTR_TIME_SUBTRACT(elapsed, starttime);
+					gangPoolCreateMs += INSTR_TIME_GET_MILLISEC(elapsed);
+					if (gp)
+						gangPoolCreated++;
 				}
 
 				if (!gp)
@@ -1636,6 +1664,138 @@ allocateWriterGang()
 	return writer_gang;
 }
 
+/*
+ * Does the session's pool of idle reader N-gangs need topping up?
+ *
+ * Only on the QD with gp_gang_pool_size set.  We give up for the rest of
+ * the session after a failed attempt rather than retry on every idle loop.
+ */
+bool
+gangPoolNeedsPrefork(void)
+{
+	if (Gp_role != GP_ROLE_DISPATCH || gp_gang_pool_size <= 0)
+		return false;
+
+	if (gangPoolPreforkFailures > 0)
+		return false;
+
+	return list_length(availableReaderGangsN) < gp_gang_pool_size;
+}
+
+/*
+ * Pre-fork reader N-gangs into the available list until it holds
+ * gp_gang_pool_size gangs, so that allocateGang() finds them warm.
+ *
+ * Reader QEs look up the writer's shared snapshot when they start, so the
+ * writer gang is created first.
+ */
+static void
+preforkReaderGangs(void)
+{
+	MemoryContext oldContext;
+	int			nsegdb;
+
+	allocateWriterGang();
+
+	oldContext = MemoryContextSwitchTo(GangContext);
+
+	nsegdb = getgpsegmentCount();
+
+	while (list_length(availableReaderGangsN) < gp_gang_pool_size)
+	{
+		Gang	   *gp = NULL;
+
+		for (int attempts = 0; (attempts < gp_gang_creation_retry_count && gp == NULL); attempts++)
+			gp = createGang(GANGTYPE_PRIMARY_READER, gang_id_counter++, nsegdb, -1, NULL);
+
+		if (gp == NULL || !gangOK(gp))
+			ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+							errmsg("segworker group pre-fork failed"),
+							errhint("server log may have more detailed error message")));
+
+		availableReaderGangsN = lappend(availableReaderGangsN, gp);
+		gangPoolPreforked++;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (gp_log_gang >= GPVARS_VERBOSITY_DEBUG)
+		elog(LOG, "preforkReaderGangs: availableReaderGangsN %d",
+			 list_length(availableReaderGangsN));
+}
+
+/*
+ * Top up the session's gang pool in a transaction of its own.  createGang()
+ * needs a resource owner, so this can't be done bare.  A failure is logged,
+ * not reported to the client, and the next query creates its gangs the
+ * usual way.
+ *
+ * Call this procedure outside of a transaction.
+ */
+void
+preforkGangPool(void)
+{
+	MemoryContext oldContext = CurrentMemoryContext;
+
+	Assert(Gp_role == GP_ROLE_DISPATCH);
+	Assert(!IsTransactionOrTransactionBlock());
+
+	StartTransactionCommand();
+
+	PG_TRY();
+	{
+		preforkReaderGangs();
+		CommitTransactionCommand();
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(oldContext);
+
+		gangPoolPreforkFailures++;
+
+		if (!elog_demote(LOG))
+		{
+			elog(LOG, "unable to demote error");
+			PG_RE_THROW();
+		}
+
+		EmitErrorReport();
+		FlushErrorState();
+
+		AbortCurrentTransaction();
+	}
+	PG_END_TRY();
+}
+
+/*
+ * gp_gang_pool_stats
+ *		Report the current session's gang pool counters as a single row.
+ */
+Datum
+gp_gang_pool_stats(PG_FUNCTION_ARGS)
+{
+#define GP_GANG_POOL_STATS_COLS	8
+	TupleDesc	tupdesc;
+	Datum		values[GP_GANG_POOL_STATS_COLS];
+	bool		nulls[GP_GANG_POOL_STATS_COLS];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int32GetDatum(gp_gang_pool_size);
+	values[1] = Int32GetDatum(list_length(availableReaderGangsN));
+	values[2] = Int32GetDatum(list_length(allocatedReaderGangsN));
+	values[3] = Int64GetDatum(gangPoolPreforked);
+	values[4] = Int64GetDatum(gangPoolReused);
+	values[5] = Int64GetDatum(gangPoolCreated);
+	values[6] = Float8GetDatum(gangPoolCreateMs);
+	values[7] = Int64GetDatum(gangPoolPreforkFailures);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc),
+													  values, nulls)));
+}
+
 /*
  * When we are the dispatch agent, we get told which gang to use by its "gang_id"
  * We need to find the gang in our lists.
@@ -2261,7 +2421,8 @@ cleanupPortalGangs(Portal portal)
 	else
 		oldContext = MemoryContextSwitchTo(TopMemoryContext);
 
-	availableReaderGangsN = cleanupPortalGangList(availableReaderGangsN, gp_cached_gang_threshold);
+	availableReaderGangsN = cleanupPortalGangList(availableReaderGangsN,
+												  Max(gp_cached_gang_threshold, gp_gang_pool_size));
 	availableReaderGangs1 = cleanupPortalGangList(availableReaderGangs1, MAX_CACHED_1_GANGS);
 
 	if (gp_log_gang >= GPVARS_VERBOSITY_DEBUG)
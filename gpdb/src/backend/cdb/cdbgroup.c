@@ -6404,6 +6404,88 @@ if (true)
 	return result_plan;
 }
 
+/*
+ * approx_count_distinct_safe_type - can approx_count_distinct() take the
+ * given type?
+ *
+ * The sketch hashes its input with the hash function of the type's equality
+ * operator, the same way hll_add_trans() looks it up.
+ */
+static bool
+approx_count_distinct_safe_type(Oid type)
+{
+	Operator	optup;
+	Oid			hashfn;
+
+	optup = equality_oper(getBaseType(type), true);
+	if (!optup)
+		return false;
+	hashfn = get_op_hash_function(oprid(optup));
+	ReleaseOperator(optup);
+
+	return OidIsValid(hashfn);
+}
+
+/*
+ * approximate_count_distinct
+ *
+ * Replace COUNT(DISTINCT x) aggregates of the query with approx_count_distinct(x)
+ * when the query has DISTINCT-qualified aggregates on more than one argument.
+ *
+ * Such queries are planned with one 3-phase aggregation per distinct argument
+ * and a join of the results.  approx_count_distinct() keeps a HyperLogLog
+ * sketch as its transition value, whose preliminary function merges sketches,
+ * so the replaced aggregates are computed in an ordinary 2-phase aggregation.
+ * Arguments whose type has no hash function are left alone.  The Aggref nodes are modified in place; call this before counting the
+ * aggregates of the query.
+ *
+ * Returns true if any aggregate was replaced.
+ */
+bool
+approximate_count_distinct(Node *tlist, Node *havingQual)
+{
+	List	   *aggrefs;
+	List	   *dqaArgs = NIL;
+	ListCell   *lc;
+	bool		replaced = false;
+
+	aggrefs = list_concat(extract_nodes(NULL, tlist, T_Aggref),
+						  extract_nodes(NULL, havingQual, T_Aggref));
+
+	foreach(lc, aggrefs)
+	{
+		Aggref	   *aggref = (Aggref *) lfirst(lc);
+
+		if (aggref->aggdistinct && aggref->agglevelsup == 0)
+			dqaArgs = list_append_unique(dqaArgs, aggref->args);
+	}
+
+	if (list_length(dqaArgs) > 1)
+	{
+		foreach(lc, aggrefs)
+		{
+			Aggref	   *aggref = (Aggref *) lfirst(lc);
+
+			if (aggref->aggdistinct &&
+				aggref->agglevelsup == 0 &&
+				aggref->aggfnoid == AGGFNOID_COUNT_ANY &&
+				aggref->aggorder == NULL &&
+				list_length(aggref->args) == 1 &&
+				approx_count_distinct_safe_type(exprType(linitial(aggref->args))))
+			{
+				aggref->aggfnoid = AGGFNOID_APPROX_COUNT_DISTINCT;
+				aggref->aggdistinct = false;
+				replaced = true;
+			}
+		}
+	}
+
+	list_free(dqaArgs);
+	list_free(aggrefs);
+
+	return replaced;
+}
+
 /*
  * within_agg_planner
  *
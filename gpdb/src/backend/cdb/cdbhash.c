@@ -35,6 +35,7 @@
 #include "cdb/cdbhash.h"
 #include "cdb/cdbhash_int.h"
 #include "cdb/cdbutil.h"
+#include "exx_oss.h"
 
 /* Fast mod using a bit mask, assuming that y is a power of 2 */
 #define FASTMOD(x,y)		((x) & ((y)-1))
@@ -87,6 +88,7 @@ makeCdbHash(int numsegs)
 	 * else use lazy mod (h mod n)
 	 */
 	h->mask = ispowof2(numsegs) ? numsegs - 1 : 0;
+	h->modinv = UINT64CONST(0xFFFFFFFFFFFFFFFF) / numsegs + 1;
 
 	/*
 	 * if we distribute into a relation with an empty partitioning policy, 
@@ -132,6 +134,15 @@ cdbhash(CdbHash *h, Datum datum, Oid type, FmgrInfo *hfn)
 	hashDatum(datum, type, hfn, h);
 }
 
+/*
+ * The functions of exx_datumhash.c hash each type exactly like hashDatum().
+ */
+CdbHashKeyFunction
+cdbhash_get_keyfunction(Oid typid)
+{
+	return exx_get_datum_hashfn(typid);
+}
+
 /*
  * Add an attribute to the hash calculation.
  * **IMPORTANT: any new hard coded support for a data type in here
@@ -3,6 +3,9 @@
  * cdbsrlz.c
  *	  Serialize a PostgreSQL sequential plan tree.
  *
+ * Serialized nodes are compressed with the codec named by
+ * gp_dispatch_compression.
+ *
  * Copyright (c) 2004-2008, Greenplum inc
  *
  * NOTES
@@ -19,12 +22,30 @@
 #include "cdb/cdbsrlz.h"
 #include "utils/memaccounting.h"
 #include "nodes/print.h"
+#include "catalog/pg_compression.h"
+#include "cdb/cdbvars.h"
 #include <math.h>
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif
 
 
+/*
+ * Serialized nodes start with this header, followed by the node string as
+ * compressed by the codec named here.  The QE learns the codec from the
+ * header, so gp_dispatch_compression need only be set on the QD.
+ */
+typedef struct SerializedNodeHeader
+{
+	int32		uncompressed_len;
+	int32		codec;			/* DISPATCH_COMPRESS_xxx */
+} SerializedNodeHeader;
+
+static const char *const dispatch_compression_names[] =
+{
+	"none", "zlib", "lz4", "zstd"
+};
+
 static char *compress_string(const char *src, int uncompressed_size, int *size);
 static char *uncompress_string(const char *src, int size, int * uncompressed_len);
 
@@ -38,6 +59,22 @@ gp_compressBound(unsigned long sourceLen)
   return sourceLen + (sourceLen >> 12) + (sourceLen >> 14) + 11;
 }
 
+/*
+ * Map a gp_dispatch_compression setting to DISPATCH_COMPRESS_xxx, or -1.
+ */
+int
+dispatch_compression_from_string(const char *name)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(dispatch_compression_names); i++)
+	{
+		if (pg_strcasecmp(name, dispatch_compression_names[i]) == 0)
+			return i;
+	}
+	return -1;
+}
+
 /*
  * serializeNode -
  * This is used on the query dispatcher to serialize Plan and Query Trees for
@@ -125,18 +162,17 @@ deserializeNode(const char *strNode, int size)
 }
 
 /*
- * Compress a (binary) string using zlib.
+ * Compress a (binary) string with the codec chosen by gp_dispatch_compression.
  * 
  * returns the compressed data and the size of the compressed data.
  */
 static char *
 compress_string(const char *src, int uncompressed_size, int *size)
 {
-	int level = 3;
-	unsigned long compressed_size;
-	int status;
-
-	Bytef * result;
+	int32		codec = gp_dispatch_compress_algorithm;
+	SerializedNodeHeader hdr;
+	Size		compressed_size = 0;
+	char	   *result;
 
 	Assert(size!=NULL);
 	
@@ -145,21 +181,63 @@ compress_string(const char *src, int uncompressed_size, int *size)
 		*size = 0;
 		return NULL;
 	}
-	
-	compressed_size = gp_compressBound(uncompressed_size);  /* worst case */
-	
-	result = palloc(compressed_size + sizeof(int));
-	memcpy(result, &uncompressed_size, sizeof(int)); 		/* save the original length */
-	
-	status = compress2(result+sizeof(int), &compressed_size, (Bytef *)src, uncompressed_size, level);
-	if (status != Z_OK)
-		elog(ERROR,"Compression failed: %s (errno=%d) uncompressed len %d, compressed %d",
-			 zError(status), status, uncompressed_size, (int)compressed_size);
-		
-	*size = compressed_size + sizeof(int);
+
+	switch (codec)
+	{
+		case DISPATCH_COMPRESS_ZLIB:
+			{
+				int			level = 3;
+				unsigned long zsize = gp_compressBound(uncompressed_size);	/* worst case */
+				int			status;
+
+				result = palloc(sizeof(hdr) + zsize);
+				status = compress2((Bytef *) result + sizeof(hdr), &zsize,
+								   (Bytef *) src, uncompressed_size, level);
+				if (status != Z_OK)
+					elog(ERROR,"Compression failed: %s (errno=%d) uncompressed len %d, compressed %d",
+						 zError(status), status, uncompressed_size, (int) zsize);
+				compressed_size = zsize;
+			}
+			break;
+
+		case DISPATCH_COMPRESS_LZ4:
+		case DISPATCH_COMPRESS_ZSTD:
+			{
+				const CompressionCodec *cc;
+
+				cc = GetCompressionCodec(dispatch_compression_names[codec]);
+				Assert(cc != NULL);
+
+				/* No room for growth: 0 means it didn't pay to compress. */
+				result = palloc(sizeof(hdr) + uncompressed_size);
+				compressed_size = cc->compress(src, uncompressed_size,
+											   result + sizeof(hdr),
+											   uncompressed_size, 1);
+				if (compressed_size == 0)
+					codec = DISPATCH_COMPRESS_NONE;
+			}
+			break;
+
+		default:
+			codec = DISPATCH_COMPRESS_NONE;
+			result = palloc(sizeof(hdr) + uncompressed_size);
+			break;
+	}
+
+	if (codec == DISPATCH_COMPRESS_NONE)
+	{
+		memcpy(result + sizeof(hdr), src, uncompressed_size);
+		compressed_size = uncompressed_size;
+	}
+
+	hdr.uncompressed_len = uncompressed_size;	/* save the original length */
+	hdr.codec = codec;
+	memcpy(result, &hdr, sizeof(hdr));
+
+	*size = compressed_size + sizeof(hdr);
 	elog(DEBUG2,"Compressed from %d to %d ", uncompressed_size, *size);
 
-	return (char *)result;
+	return result;
 }
 
 /*
@@ -168,25 +246,68 @@ compress_string(const char *src, int uncompressed_size, int *size)
 static char *
 uncompress_string(const char *src, int size, int *uncompressed_len)
 {
-	Bytef * result;
-	unsigned long resultlen;
-	int status;
+	SerializedNodeHeader hdr;
+	const char *body;
+	int			bodylen;
+	char	   *result;
+
 	*uncompressed_len = 0;
 	
 	if (src==NULL)
 		return NULL;
 		
-	Assert(size >= sizeof(int));
-		
-	memcpy(uncompressed_len,src, sizeof(int));
-	
-	resultlen = *uncompressed_len;
-	result = palloc(resultlen);
-		
-	status = uncompress(result, &resultlen, (Bytef *)(src+sizeof(int)), size-sizeof(int));
-	if (status != Z_OK)
-		elog(ERROR,"Uncompress failed: %s (errno=%d compressed len %d, uncompressed %d)",
-			 zError(status), status, size, *uncompressed_len);
+	Assert(size >= sizeof(hdr));
 		
-	return (char *)result;
+	memcpy(&hdr, src, sizeof(hdr));
+	*uncompressed_len = hdr.uncompressed_len;
+	body = src + sizeof(hdr);
+	bodylen = size - sizeof(hdr);
+
+	result = palloc(hdr.uncompressed_len);
+
+	if (hdr.codec == DISPATCH_COMPRESS_NONE)
+	{
+		if (bodylen != hdr.uncompressed_len)
+			elog(ERROR, "serialized node has %d bytes, expected %d",
+				 bodylen, hdr.uncompressed_len);
+		memcpy(result, body, bodylen);
+		return result;
+	}
+
+	switch (hdr.codec)
+	{
+		case DISPATCH_COMPRESS_ZLIB:
+			{
+				unsigned long resultlen = hdr.uncompressed_len;
+				int			status;
+
+				status = uncompress((Bytef *) result, &resultlen, (Bytef *) body, bodylen);
+				if (status != Z_OK)
+					elog(ERROR,"Uncompress failed: %s (errno=%d compressed len %d, uncompressed %d)",
+						 zError(status), status, size, *uncompressed_len);
+			}
+			break;
+
+		case DISPATCH_COMPRESS_LZ4:
+		case DISPATCH_COMPRESS_ZSTD:
+			{
+				const CompressionCodec *cc;
+				size_t		resultlen;
+
+				cc = GetCompressionCodec(dispatch_compression_names[hdr.codec]);
+				Assert(cc != NULL);
+
+				resultlen = cc->decompress(body, bodylen, result, hdr.uncompressed_len);
+				if (resultlen != hdr.uncompressed_len)
+					elog(ERROR, "Uncompress failed: %s produced %d bytes, expected %d",
+						 dispatch_compression_names[hdr.codec], (int) resultlen,
+						 hdr.uncompressed_len);
+			}
+			break;
+
+		default:
+			elog(ERROR, "unrecognized compression %d in serialized node", hdr.codec);
+	}
+
+	return result;
 }
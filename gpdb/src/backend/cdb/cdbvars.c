@@ -18,6 +18,7 @@
 #include "utils/guc.h"
 #include "catalog/gp_segment_config.h"
 #include "cdb/cdbvars.h"
+#include "cdb/cdbsrlz.h"
 #include "cdb/cdbfts.h"
 #include "cdb/cdbutil.h"
 #include "lib/stringinfo.h"
@@ -87,8 +88,14 @@ int			gp_safefswritesize;  /* set for safe AO writes in non-mature fs */
 int			gp_connections_per_thread; /* How many libpq connections are
 										 * handled in each thread */
 
+bool		gp_dispatch_event_driven = false; /* wait for QEs with epoll() from
+											 * the main thread */
+
 int			gp_cached_gang_threshold; /*How many gangs to keep around from stmt to stmt.*/
 
+int			gp_gang_pool_size;	/* How many reader N-gangs to pre-fork while
+								 * the session is idle. */
+
 int			Gp_segment = UNDEF_SEGMENT;		/* What content this QE is
 												 * handling. */
 
@@ -223,6 +230,8 @@ bool		gp_interconnect_aggressive_retry=true; /* fast-track app-level retry */
 
 bool gp_interconnect_full_crc=false; /* sanity check UDP data. */
 
+bool gp_interconnect_batch_io=true; /* sendmmsg()/recvmmsg() where available */
+
 bool gp_interconnect_elide_setup=true; /* under some conditions we can eliminate the setup */
 
 bool gp_interconnect_log_stats=false; /* emit stats at log-level */
@@ -292,6 +301,22 @@ int 		gp_hashagg_spillbatch_max = 0;
 /* hash join to use bloom filter: default to 0, means not used */
 int 	 	gp_hashjoin_bloomfilter = 0;
 
+/* hash join to cluster its hash table by bucket and probe it in batches */
+bool		gp_hashjoin_radix_cluster = false;
+
+/* hash join to filter the scans on its probe side with its inner keys */
+bool		gp_hashjoin_runtime_filter = false;
+
+/* AOCS scan to read and filter a batch of rows at a time */
+bool		gp_enable_aocs_batch_scan = false;
+
+/* Maintain and use per-block min/max zone maps for append-only tables */
+bool		gp_appendonly_zonemaps = false;
+
+/* Motion to send redistributed and broadcast rows in column-major batches */
+bool		gp_enable_motion_batch = false;
+bool		gp_motion_batch_compress = false;
+
 /* Analyzing aid */
 int 		gp_motion_slice_noop = 0;
 #ifdef ENABLE_LTRACE
@@ -312,10 +337,13 @@ bool		gp_enable_motion_deadlock_sanity = FALSE; /* planning time sanity check */
 #ifdef USE_ASSERT_CHECKING
 bool		gp_mk_sort_check = false;
 #endif
+bool		gp_enable_mk_radix_sort = true;
+int			gp_mk_sort_readahead_blocks = 8;
 bool 		trace_sort = false;
 int			gp_sort_flags = 0;
 int			gp_dbg_flags = 0;
 int 		gp_sort_max_distinct = 20000;
+bool		gp_enable_sliding_window_agg = true;
 
 bool		gp_enable_hash_partitioned_tables = FALSE;
 bool		gp_foreign_data_access = FALSE;
@@ -335,6 +363,8 @@ int gp_segworker_relative_priority = PRIO_MAX;
 /* Max size of dispatched plans; 0 if no limit */
 int			gp_max_plan_size = 0;
 
+int			gp_dispatch_compress_algorithm = DISPATCH_COMPRESS_LZ4;
+
 /* Disable setting of tuple hints while reading */
 bool		gp_disable_tuple_hints = false;
 int		gp_hashagg_compress_spill_files = 0;
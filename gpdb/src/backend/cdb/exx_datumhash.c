@@ -290,7 +290,7 @@ static uint32_t hfn_BITOID(Datum datum, uint32_t hval)
      */
     VarBit* p  = DatumGetVarBitP(datum);
     int len = VARBITBYTES(p);
-    return fnv1_32_buf(p, len, hval);
+    return fnv1_32_buf(VARBITS(p), len, hval);
 }    
 
 static hfn_t* hfn_VARBITOID = hfn_BITOID;
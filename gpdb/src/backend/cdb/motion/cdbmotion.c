@@ -20,6 +20,7 @@
 #include "cdb/htupfifo.h"
 #include "cdb/ml_ipc.h"
 #include "cdb/tupser.h"
+#include "executor/tuptable.h"
 #include "libpq/pqformat.h"
 #include "utils/hsearch.h"
 #include "utils/memutils.h"
@@ -61,9 +62,16 @@ static void processIncomingChunks(MotionLayerState *mlStates,
 								  int16 srcRoute);
 
 static inline void reconstructTuple(MotionNodeEntry * pMNEntry, ChunkSorterEntry * pCSEntry);
+static void reconstructBatch(MotionNodeEntry * pMNEntry, ChunkSorterEntry * pCSEntry);
+static SendReturnCode sendTupleBatch(MotionLayerState *mlStates,
+									 ChunkTransportState *transportStates,
+									 MotionNodeEntry * pMNEntry,
+									 int16 motNodeID,
+									 int16 targetRoute);
+static bool getReadyRow(MotionNodeEntry * pMNEntry, TupleTableSlot *slot);
 
 /* Stats-function declarations. */
-static void statSendTuple(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry, TupleChunkList tcList);
+static void statSendTuple(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry, TupleChunkList tcList, int ntuples);
 static void statSendEOS(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry);
 static void statChunksProcessed(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry, int chunksProcessed, int chunkBytes, int tupleBytes);
 static void statNewTupleArrived(MotionNodeEntry * pMNEntry, ChunkSorterEntry * pCSEntry);
@@ -82,6 +90,14 @@ static inline void
 reconstructTuple(MotionNodeEntry * pMNEntry, ChunkSorterEntry * pCSEntry)
 {
 	HeapTuple	htup;
+	TupleChunkType tcType;
+
+	GetChunkType(pCSEntry->chunk_list.p_first, &tcType);
+	if (tcType == TC_BATCH || tcType == TC_BATCH_START)
+	{
+		reconstructBatch(pMNEntry, pCSEntry);
+		return;
+	}
 
 	/*
 	 * Convert the list of chunks into a tuple, then stow it away. This frees
@@ -95,6 +111,34 @@ reconstructTuple(MotionNodeEntry * pMNEntry, ChunkSorterEntry * pCSEntry)
 	statNewTupleArrived(pMNEntry, pCSEntry);
 }
 
+/*
+ * Like reconstructTuple(), for a list of chunks holding a batch of rows.
+ * The batch is queued as it is, its rows are taken out by getReadyRow().
+ */
+static void
+reconstructBatch(MotionNodeEntry * pMNEntry, ChunkSorterEntry * pCSEntry)
+{
+	SerTupBatch *batch;
+	int			i;
+
+	if (pMNEntry->preserve_order)
+		ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+						errmsg("Received a batch of rows on order-preserving"
+							   " motion node %d.", pMNEntry->motion_node_id)));
+
+	batch = CvtChunksToTupleBatch(&pCSEntry->chunk_list, &pMNEntry->ser_tup_info);
+
+	if (pMNEntry->ready_batches_tail != NULL)
+		pMNEntry->ready_batches_tail->next = batch;
+	else
+		pMNEntry->ready_batches_head = batch;
+	pMNEntry->ready_batches_tail = batch;
+
+	/* Stats */
+	for (i = 0; i < batch->nrows; i++)
+		statNewTupleArrived(pMNEntry, pCSEntry);
+}
+
 /*
  * FUNCTION DEFINITIONS
  */
@@ -340,6 +384,11 @@ UpdateMotionLayerNode(MotionLayerState *mlStates, int16 motNodeID, bool preserve
 	else
 		pEntry->ready_tuples = NULL;
 
+	pEntry->ready_batches_head = NULL;
+	pEntry->ready_batches_tail = NULL;
+	pEntry->cur_batch = NULL;
+	pEntry->send_batches = NULL;
+	pEntry->num_send_batches = 0;
 
 	pEntry->num_stream_ends_recvd = 0;
 
@@ -440,7 +489,7 @@ SendTuple(MotionLayerState *mlStates,
 				tcList.serialized_data_length = sent;
 			
 				/* update stats */
-				statSendTuple(mlStates, pMNEntry, &tcList);
+				statSendTuple(mlStates, pMNEntry, &tcList, 1);
 
 				return SEND_COMPLETE;
 			}
@@ -474,7 +523,7 @@ SendTuple(MotionLayerState *mlStates,
 	else
 	{
 		/* update stats */
-		statSendTuple(mlStates, pMNEntry, &tcList);
+		statSendTuple(mlStates, pMNEntry, &tcList, 1);
 
 		rc = SEND_COMPLETE;
 	}
@@ -485,6 +534,103 @@ SendTuple(MotionLayerState *mlStates,
 	return rc;
 }
 
+/*
+ * Function:  SendTupleSlot - Adds the row in a slot to the batch for its
+ * route, and sends the batch once it is full.
+ *
+ * The rows of a batch are only sent when it fills up or at end-of-stream,
+ * so the caller must use SendEndOfStream() to finish.
+ */
+SendReturnCode
+SendTupleSlot(MotionLayerState *mlStates,
+			  ChunkTransportState *transportStates,
+			  int16 motNodeID,
+			  TupleTableSlot *slot,
+			  int16 targetRoute)
+{
+	MotionNodeEntry *pMNEntry;
+	SerTupBatchBuilder *builder;
+	int			idx;
+
+	AssertArg(!TupIsNull(slot));
+
+	/* Analyze tools.  Do not send any thing if this slice is in the bit mask */
+	if (gp_motion_slice_noop != 0 && (gp_motion_slice_noop & (1 << currentSliceId)) != 0)
+		return SEND_COMPLETE;
+
+	pMNEntry = getMotionNodeEntry(mlStates, motNodeID, "SendTupleSlot");
+
+	if (pMNEntry->send_batches == NULL)
+	{
+		pMNEntry->num_send_batches = GpIdentity.numsegments + 1;
+		pMNEntry->send_batches = (SerTupBatchBuilder **)
+			MemoryContextAllocZero(mlStates->motion_layer_mctx,
+								   pMNEntry->num_send_batches * sizeof(SerTupBatchBuilder *));
+	}
+
+	idx = (targetRoute == BROADCAST_SEGIDX) ? pMNEntry->num_send_batches - 1 : targetRoute;
+	Assert(idx >= 0 && idx < pMNEntry->num_send_batches);
+
+	builder = pMNEntry->send_batches[idx];
+	if (builder == NULL)
+	{
+		MemoryContext oldCtxt = MemoryContextSwitchTo(mlStates->motion_layer_mctx);
+
+		builder = CreateSerTupBatchBuilder(&pMNEntry->ser_tup_info);
+		pMNEntry->send_batches[idx] = builder;
+
+		MemoryContextSwitchTo(oldCtxt);
+	}
+
+	slot_getallattrs(slot);
+	if (SerTupBatchAddRow(builder, &pMNEntry->ser_tup_info,
+						  slot_get_values(slot), slot_get_isnull(slot)))
+		return sendTupleBatch(mlStates, transportStates, pMNEntry, motNodeID, targetRoute);
+
+	return SEND_COMPLETE;
+}
+
+/* Serialize and send the rows collected for a route. */
+static SendReturnCode
+sendTupleBatch(MotionLayerState *mlStates,
+			   ChunkTransportState *transportStates,
+			   MotionNodeEntry * pMNEntry,
+			   int16 motNodeID,
+			   int16 targetRoute)
+{
+	SerTupBatchBuilder *builder;
+	TupleChunkListData tcList;
+	MemoryContext oldCtxt;
+	SendReturnCode rc;
+	int			nrows;
+
+	builder = pMNEntry->send_batches[targetRoute == BROADCAST_SEGIDX ?
+									 pMNEntry->num_send_batches - 1 : targetRoute];
+	nrows = SerTupBatchNumRows(builder);
+
+	oldCtxt = MemoryContextSwitchTo(mlStates->motion_layer_mctx);
+
+	SerializeTupleBatchIntoChunks(builder, &pMNEntry->ser_tup_info, &tcList,
+								  gp_motion_batch_compress);
+
+	MemoryContextSwitchTo(oldCtxt);
+
+	if (!SendTupleChunkToAMS(mlStates, transportStates, motNodeID, targetRoute, tcList.p_first))
+	{
+		pMNEntry->stopped = true;
+		rc = STOP_SENDING;
+	}
+	else
+	{
+		statSendTuple(mlStates, pMNEntry, &tcList, nrows);
+		rc = SEND_COMPLETE;
+	}
+
+	clearTCList(&pMNEntry->ser_tup_info.chunkCache, &tcList);
+
+	return rc;
+}
+
 TupleChunkListItem
 get_eos_tuplechunklist(void)
 {
@@ -509,6 +655,24 @@ SendEndOfStream(MotionLayerState       *mlStates,
 	 */
 	pMNEntry = getMotionNodeEntry(mlStates, motNodeID, "SendEndOfStream");
 
+	/* Send out the rows still waiting in batches. */
+	if (pMNEntry->send_batches != NULL && !pMNEntry->stopped)
+	{
+		int			i;
+
+		for (i = 0; i < pMNEntry->num_send_batches; i++)
+		{
+			SerTupBatchBuilder *builder = pMNEntry->send_batches[i];
+			int16		route = (i == pMNEntry->num_send_batches - 1) ? BROADCAST_SEGIDX : i;
+
+			if (builder == NULL || SerTupBatchNumRows(builder) == 0)
+				continue;
+
+			if (sendTupleBatch(mlStates, transportStates, pMNEntry, motNodeID, route) == STOP_SENDING)
+				break;
+		}
+	}
+
 	transportStates->SendEos(mlStates, transportStates, motNodeID, s_eos_chunk_data);
 
 	/*
@@ -630,6 +794,89 @@ RecvTupleFrom(MotionLayerState *mlStates,
 	return recvRC;
 }
 
+/*
+ * Unordered receive into a slot.  Works like RecvTupleFrom() with
+ * ANY_ROUTE, and also takes the rows of batches: those are returned as
+ * virtual tuples pointing into the batch, valid until the next call.
+ */
+ReceiveReturnCode
+RecvTupleSlotFrom(MotionLayerState *mlStates,
+				  ChunkTransportState *transportStates,
+				  int16 motNodeID,
+				  TupleTableSlot *slot)
+{
+	MotionNodeEntry *pMNEntry;
+	ReceiveReturnCode recvRC;
+
+	pMNEntry = getMotionNodeEntry(mlStates, motNodeID, "RecvTupleSlotFrom");
+	Assert(pMNEntry->preserve_order == 0);
+
+	for (;;)
+	{
+		if (getReadyRow(pMNEntry, slot))
+		{
+			recvRC = GOT_TUPLE;
+			break;
+		}
+
+		if (!pMNEntry->moreNetWork)
+		{
+			recvRC = END_OF_STREAM;
+			break;
+		}
+
+		processIncomingChunks(mlStates, transportStates, pMNEntry, motNodeID, ANY_ROUTE);
+	}
+
+	/* Stats */
+	statRecvTuple(pMNEntry, NULL, recvRC);
+
+	return recvRC;
+}
+
+/*
+ * Store the next row already received into slot: the next of the current
+ * batch, else a single tuple, else the first of the next batch.
+ */
+static bool
+getReadyRow(MotionNodeEntry * pMNEntry, TupleTableSlot *slot)
+{
+	HeapTuple	htup;
+
+	for (;;)
+	{
+		SerTupBatch *batch = pMNEntry->cur_batch;
+
+		if (batch != NULL)
+		{
+			ExecClearTuple(slot);
+			if (SerTupBatchNextRow(batch, slot_get_values(slot), slot_get_isnull(slot)))
+			{
+				ExecStoreVirtualTuple(slot);
+				return true;
+			}
+
+			pMNEntry->cur_batch = NULL;
+			FreeSerTupBatch(batch);
+		}
+
+		htup = htfifo_gettuple(pMNEntry->ready_tuples);
+		if (htup != NULL)
+		{
+			ExecStoreGenericTuple(htup, slot, true);
+			return true;
+		}
+
+		if (pMNEntry->ready_batches_head == NULL)
+			return false;
+
+		pMNEntry->cur_batch = pMNEntry->ready_batches_head;
+		pMNEntry->ready_batches_head = pMNEntry->cur_batch->next;
+		if (pMNEntry->ready_batches_head == NULL)
+			pMNEntry->ready_batches_tail = NULL;
+	}
+}
+
 
 /*
  * This helper function is the receive-tuple workhorse.  It pulls
@@ -831,6 +1078,22 @@ EndMotionLayerNode(MotionLayerState *mlStates, int16 motNodeID, bool flushCommLa
 	if (!pMNEntry->preserve_order)
 		htfifo_destroy(pMNEntry->ready_tuples);
 
+	while (pMNEntry->ready_batches_head != NULL)
+	{
+		SerTupBatch *batch = pMNEntry->ready_batches_head;
+
+		pMNEntry->ready_batches_head = batch->next;
+		FreeSerTupBatch(batch);
+	}
+	pMNEntry->ready_batches_tail = NULL;
+	if (pMNEntry->cur_batch != NULL)
+	{
+		FreeSerTupBatch(pMNEntry->cur_batch);
+		pMNEntry->cur_batch = NULL;
+	}
+	pMNEntry->send_batches = NULL;
+	pMNEntry->num_send_batches = 0;
+
 	pMNEntry->valid = false;
 }
 
@@ -1012,6 +1275,7 @@ addChunkToSorter(MotionLayerState *mlStates,
 	{
 		case TC_WHOLE:
 		case TC_EMPTY:
+		case TC_BATCH:
 			/* There shouldn't be any partial tuple data in the list! */
 			if (chunkSorterEntry->chunk_list.num_chunks != 0)
 			{
@@ -1028,6 +1292,7 @@ addChunkToSorter(MotionLayerState *mlStates,
 			break;
 
 		case TC_PARTIAL_START:
+		case TC_BATCH_START:
 
 			/* There shouldn't be any partial tuple data in the list! */
 			if (chunkSorterEntry->chunk_list.num_chunks != 0)
@@ -1145,7 +1410,7 @@ addChunkToSorter(MotionLayerState *mlStates,
  * SerializeTupleDirect() only fills those fields out.
  */
 static void
-statSendTuple(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry, TupleChunkList tcList)
+statSendTuple(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry, TupleChunkList tcList, int ntuples)
 {
 	int			headerOverhead;
 
@@ -1154,7 +1419,7 @@ statSendTuple(MotionLayerState *mlStates, MotionNodeEntry * pMNEntry, TupleChunk
 	headerOverhead = TUPLE_CHUNK_HEADER_SIZE * tcList->num_chunks;
 
 	/* per motion-node stats. */
-	pMNEntry->stat_total_sends++;
+	pMNEntry->stat_total_sends += ntuples;
 	pMNEntry->stat_total_chunks_sent += tcList->num_chunks;
 	pMNEntry->stat_total_bytes_sent += tcList->serialized_data_length + headerOverhead;
 	pMNEntry->stat_tuple_bytes_sent += tcList->serialized_data_length;
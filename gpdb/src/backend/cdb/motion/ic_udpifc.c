@@ -131,6 +131,28 @@ timeoutArray[] =
 /* 1/4 sec in msec */
 #define RX_THREAD_POLL_TIMEOUT (250)
 
+/*
+ * Batched socket IO.
+ *
+ * Where sendmmsg() and recvmmsg() are available, the packets that
+ * sendBuffers() sends to a connection in one go are handed to the kernel
+ * with a single system call, and the rx thread picks up to UDPIC_RX_BATCH
+ * packets per call.
+ */
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define UDPIC_USE_MMSG
+#endif
+
+#define UDPIC_XMIT_BATCH (32)
+
+#ifdef UDPIC_USE_MMSG
+#define UDPIC_RX_BATCH (16)
+#define UDPIC_BATCH_IO() (gp_interconnect_batch_io)
+#else
+#define UDPIC_RX_BATCH (1)
+#define UDPIC_BATCH_IO() (false)
+#endif
+
 /*
  * Flags definitions for flag-field of UDP-messages
  *
@@ -320,10 +342,10 @@ struct RxBufferPool
 /*
  * The buffer pool used for keeping data packets.
  *
- * maxCount is set to 1 to make sure there is always a buffer
- * for picking packets from OS buffer.
+ * maxCount is set to UDPIC_RX_BATCH to make sure there are always
+ * buffers for picking packets from OS buffer.
  */
-static RxBufferPool rx_buffer_pool = {1, 0, NULL};
+static RxBufferPool rx_buffer_pool = {UDPIC_RX_BATCH, 0, NULL};
 
 /*
  * SendBufferPool
@@ -760,6 +782,7 @@ static void checkQDConnectionAlive(void);
 
 
 static void *rxThreadFunc(void *arg);
+static bool handleRxPacket(icpkthdr *pkt, int read_count, struct sockaddr_storage *peer, socklen_t peerlen);
 
 static bool handleMismatch(icpkthdr *pkt, struct sockaddr_storage *peer, int peer_len);
 static void inline handleAckedPacket(MotionConn *ackConn, ICBuffer *buf, uint64 now);
@@ -775,6 +798,9 @@ static inline void addCRC(icpkthdr *pkt);
 static inline bool checkCRC(icpkthdr *pkt);
 static void sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn);
 static void sendOnce(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, ICBuffer *buf, MotionConn * conn);
+#ifdef UDPIC_USE_MMSG
+static void sendBatch(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn, ICBuffer **bufs, int nbufs);
+#endif
 static inline uint64 computeExpirationPeriod(MotionConn *conn, uint32 retry);
 
 static ICBuffer *getSndBuffer(MotionConn *conn);
@@ -2044,7 +2070,7 @@ static void
 initRxBufferPool(RxBufferPool *p)
 {
 	p->count = 0;
-	p->maxCount = 1;
+	p->maxCount = UDPIC_RX_BATCH;
 	p->freeList = NULL;
 }
 
@@ -4795,6 +4821,103 @@ xmit_retry:
 	return;
 }
 
+#ifdef UDPIC_USE_MMSG
+/*
+ * sendBatch
+ * 		Send packets of a connection with as few sendmmsg() calls as we can.
+ *
+ * Errors are handled like sendOnce() does: a full socket buffer drops the
+ * packets not sent yet, they will be retransmitted.
+ */
+static void
+sendBatch(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn, ICBuffer **bufs, int nbufs)
+{
+	struct mmsghdr	msgs[UDPIC_XMIT_BATCH];
+	struct iovec	iov[UDPIC_XMIT_BATCH];
+	int				sent = 0;
+	int				i;
+
+	Assert(nbufs > 0 && nbufs <= UDPIC_XMIT_BATCH);
+
+#ifdef USE_ASSERT_CHECKING
+	/* Drop packets as sendOnce() does; they stay queued for retransmit */
+	if (udp_testmode)
+	{
+		int		n = 0;
+
+		for (i = 0; i < nbufs; i++)
+		{
+			if (testmode_inject_fault(gp_udpic_dropxmit_percent))
+			{
+			#ifdef AMS_VERBOSE_LOGGING
+				write_log("THROW PKT with seq %d srcpid %d despid %d", bufs[i]->pkt->seq, bufs[i]->pkt->srcPid, bufs[i]->pkt->dstPid);
+			#endif
+				continue;
+			}
+			bufs[n++] = bufs[i];
+		}
+		nbufs = n;
+	}
+#endif
+
+	memset(msgs, 0, nbufs * sizeof(struct mmsghdr));
+	for (i = 0; i < nbufs; i++)
+	{
+		iov[i].iov_base = bufs[i]->pkt;
+		iov[i].iov_len = bufs[i]->pkt->len;
+		msgs[i].msg_hdr.msg_name = &conn->peer;
+		msgs[i].msg_hdr.msg_namelen = conn->peer_len;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < nbufs)
+	{
+		int		n;
+
+		n = sendmmsg(pEntry->txfd, msgs + sent, nbufs - sent, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN) /* no space ? not an error. */
+				return;
+
+			if (errno == EPERM)
+			{
+				ereport(LOG,
+						(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+						 errmsg("Interconnect error writing an outgoing packet: %m"),
+						 errdetail("error during sendmmsg() for Remote Connection: contentId=%d at %s",
+								   conn->remoteContentId, conn->remoteHostAndPort)));
+				/* skip the packet that failed, as sendOnce() would */
+				sent++;
+				continue;
+			}
+
+			ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+							errmsg("Interconnect error writing an outgoing packet: %m"),
+							errdetail("error during sendmmsg() call (error:%d).\n"
+									  "For Remote Connection: contentId=%d at %s",
+									  errno, conn->remoteContentId,
+									  conn->remoteHostAndPort)));
+			/* not reached */
+		}
+
+		for (i = sent; i < sent + n; i++)
+		{
+			if (msgs[i].msg_len != iov[i].iov_len && DEBUG1 >= log_min_messages)
+				write_log("Interconnect error writing an outgoing packet [seq %d]: short transmit (given %d sent %d) during sendmmsg() call."
+						  "For Remote Connection: contentId=%d at %s", bufs[i]->pkt->seq, bufs[i]->pkt->len, (int) msgs[i].msg_len,
+						  conn->remoteContentId,
+						  conn->remoteHostAndPort);
+		}
+		sent += n;
+	}
+}
+#endif
+
 
 /*
  * handleStopMsgs
@@ -4904,6 +5027,11 @@ handleStopMsgs(ChunkTransportState *transportStates, ChunkTransportStateEntry *p
 static void
 sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn)
 {
+#ifdef UDPIC_USE_MMSG
+	ICBuffer   *batch[UDPIC_XMIT_BATCH];
+	int			nbatch = 0;
+#endif
+
 	while (conn->capacity > 0 && icBufferListLength(&conn->sndQueue) > 0)
 	{
 		ICBuffer *buf = NULL;
@@ -4949,7 +5077,19 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 		updateStats(TPE_DATA_PKT_SEND, conn, buf->pkt);
 #endif
 
-		sendOnce(transportStates, pEntry, buf, conn);
+#ifdef UDPIC_USE_MMSG
+		if (UDPIC_BATCH_IO())
+		{
+			batch[nbatch++] = buf;
+			if (nbatch == UDPIC_XMIT_BATCH)
+			{
+				sendBatch(transportStates, pEntry, conn, batch, nbatch);
+				nbatch = 0;
+			}
+		}
+		else
+#endif
+			sendOnce(transportStates, pEntry, buf, conn);
 		ic_statistics.sndPktNum++;
 
 #ifdef AMS_VERBOSE_LOGGING
@@ -4958,6 +5098,11 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 
 		buf->conn->sentSeq = buf->pkt->seq;
 	}
+
+#ifdef UDPIC_USE_MMSG
+	if (nbatch > 0)
+		sendBatch(transportStates, pEntry, conn, batch, nbatch);
+#endif
 }
 
 /*
@@ -6260,10 +6405,122 @@ handleDataPacket(MotionConn *conn, icpkthdr *pkt, struct sockaddr_storage *peer,
 	return true;
 }
 
+/*
+ * handleRxPacket
+ * 		Handle a packet picked up by the receive thread.
+ *
+ * Returns true if the packet buffer was taken over, in which case the
+ * caller must not touch it anymore.
+ *
+ * NOTE: This function MUST NOT contain elog or ereport statements.
+ * elog is NOT thread-safe.  Developers should instead use something like:
+ *
+ *	if (DEBUG3 >= log_min_messages)
+ *		write_log("my brilliant log statement here.");
+ *
+ * NOTE: In threads, we cannot use palloc/pfree, because it's not thread safe.
+ */
+static bool
+handleRxPacket(icpkthdr *pkt, int read_count, struct sockaddr_storage *peer, socklen_t peerlen)
+{
+	MotionConn *conn = NULL;
+	AckSendParam param;
+	bool		consumed = false;
+
+	/* length must be >= 0 */
+	if (pkt->len < 0)
+	{
+		if (DEBUG3 >= log_min_messages)
+			write_log("received inbound with negative length");
+		return false;
+	}
+
+	if (pkt->len != read_count)
+	{
+		if (DEBUG3 >= log_min_messages)
+			write_log("received inbound packet [%d], short: read %d bytes, pkt->len %d", pkt->seq, read_count, pkt->len);
+		return false;
+	}
+
+	/*
+	 * check the CRC of the payload.
+	 */
+	if (gp_interconnect_full_crc)
+	{
+		if (!checkCRC(pkt))
+		{
+			gp_atomic_add_32(&ic_statistics.crcErrors, 1);
+			if (DEBUG2 >= log_min_messages)
+				write_log("received network data error, dropping bad packet, user data unaffected.");
+			return false;
+		}
+	}
+
+	#ifdef AMS_VERBOSE_LOGGING
+		logPkt("GOT MESSAGE", pkt);
+	#endif
+
+	memset(&param, 0, sizeof(AckSendParam));
+
+	/*
+	 * Get the connection for the pkt.
+	 *
+	 * 	The connection hash table should be locked until
+	 * 	finishing the processing of the packet to avoid
+	 *  the connection addition/removal from the hash table
+	 *  during the mean time.
+	 */
+
+	pthread_mutex_lock(&ic_control_info.lock);
+	conn = findConnByHeader(&ic_control_info.connHtab, pkt);
+
+	if (conn != NULL)
+	{
+		/* Handling a regular packet */
+		if (handleDataPacket(conn, pkt, peer, &peerlen, &param))
+			consumed = true;
+		ic_statistics.recvPktNum++;
+	}
+	else
+	{
+		/*
+		 * There may have two kinds of Mismatched packets:
+		 *    a) Past packets from previous command after I was torn down
+		 *    b) Future packets from current command before my connections are built.
+		 *
+		 * The handling logic is to "Ack the past and Nak the future".
+		 */
+		if ((pkt->flags & UDPIC_FLAGS_RECEIVER_TO_SENDER) == 0)
+		{
+			if (DEBUG1 >= log_min_messages)
+				write_log("mismatched packet received, seq %d, srcpid %d, dstpid %d, icid %d, sid %d", pkt->seq, pkt->srcPid, pkt->dstPid, pkt->icId, pkt->sessionId);
+
+		#ifdef AMS_VERBOSE_LOGGING
+			logPkt("Got a Mismatched Packet", pkt);
+		#endif
+
+			if (handleMismatch(pkt, peer, peerlen))
+				consumed = true;
+			ic_statistics.mismatchNum++;
+		}
+	}
+	pthread_mutex_unlock(&ic_control_info.lock);
+
+	/* real ack sending is after lock release to decrease the lock holding time. */
+	if (param.msg.len != 0)
+		sendAckWithParam(&param);
+
+	return consumed;
+}
+
 /*
  * rxThreadFunc
  * 		Main function of the receive background thread.
  *
+ * The thread keeps up to UDPIC_RX_BATCH buffers at hand, so that with
+ * batched IO one recvmmsg() call can fill them all; the buffer pool leaves
+ * room for that.
+ *
  * NOTE: This function MUST NOT contain elog or ereport statements.
  * elog is NOT thread-safe.  Developers should instead use something like:
  *
@@ -6275,8 +6532,10 @@ handleDataPacket(MotionConn *conn, icpkthdr *pkt, struct sockaddr_storage *peer,
 static void *
 rxThreadFunc(void *arg)
 {
-	icpkthdr *pkt=NULL;
+	icpkthdr *pkts[UDPIC_RX_BATCH];
+	int		npkts = 0;
 	bool	skip_poll=false;
+	int		i;
 
 	gp_set_thread_sigmasks();
 
@@ -6284,6 +6543,7 @@ rxThreadFunc(void *arg)
 	{
 		struct pollfd nfd;
 		int		n;
+		int		want;
 
 		/* check shutdown condition*/
 
@@ -6296,14 +6556,22 @@ rxThreadFunc(void *arg)
 			break;
 		}
 
-		/* Try to get a buffer */
-		if (pkt == NULL)
+		/* Try to get the buffers */
+		want = UDPIC_BATCH_IO() ? UDPIC_RX_BATCH : 1;
+		if (npkts < want)
 		{
 			pthread_mutex_lock(&ic_control_info.lock);
-			pkt = getRxBuffer(&rx_buffer_pool);
+			while (npkts < want)
+			{
+				icpkthdr *pkt = getRxBuffer(&rx_buffer_pool);
+
+				if (pkt == NULL)
+					break;
+				pkts[npkts++] = pkt;
+			}
 			pthread_mutex_unlock(&ic_control_info.lock);
 
-			if (pkt == NULL)
+			if (npkts == 0)
 			{
 				setRxThreadError(ENOMEM);
 				continue;
@@ -6352,15 +6620,44 @@ rxThreadFunc(void *arg)
 			/* we've got something interesting to read */
 			/* handle incoming */
 			/* ready to read on our socket */
-			MotionConn *conn = NULL;
-			int read_count = 0;
+			int		nrecv;
+			int		read_counts[UDPIC_RX_BATCH];
+			struct sockaddr_storage peers[UDPIC_RX_BATCH];
+			socklen_t peerlens[UDPIC_RX_BATCH];
+
+#ifdef UDPIC_USE_MMSG
+			if (UDPIC_BATCH_IO() && npkts > 1)
+			{
+				struct mmsghdr msgs[UDPIC_RX_BATCH];
+				struct iovec iov[UDPIC_RX_BATCH];
 
-			struct sockaddr_storage peer;
-			socklen_t peerlen;
+				memset(msgs, 0, npkts * sizeof(struct mmsghdr));
+				for (i = 0; i < npkts; i++)
+				{
+					iov[i].iov_base = pkts[i];
+					iov[i].iov_len = Gp_max_packet_size;
+					msgs[i].msg_hdr.msg_name = &peers[i];
+					msgs[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+					msgs[i].msg_hdr.msg_iov = &iov[i];
+					msgs[i].msg_hdr.msg_iovlen = 1;
+				}
 
-			peerlen = sizeof(peer);
-			read_count = recvfrom(UDP_listenerFd, (char *)pkt, Gp_max_packet_size, 0,
-								  (struct sockaddr *)&peer, &peerlen);
+				nrecv = recvmmsg(UDP_listenerFd, msgs, npkts, MSG_DONTWAIT, NULL);
+
+				for (i = 0; i < nrecv; i++)
+				{
+					read_counts[i] = msgs[i].msg_len;
+					peerlens[i] = msgs[i].msg_hdr.msg_namelen;
+				}
+			}
+			else
+#endif
+			{
+				peerlens[0] = sizeof(peers[0]);
+				read_counts[0] = recvfrom(UDP_listenerFd, (char *)pkts[0], Gp_max_packet_size, 0,
+										  (struct sockaddr *)&peers[0], &peerlens[0]);
+				nrecv = (read_counts[0] < 0 ? -1 : 1);
+			}
 
 			if (compare_and_swap_32(&ic_control_info.shutdown, 1, 0))
 			{
@@ -6371,10 +6668,7 @@ rxThreadFunc(void *arg)
 				break;
 			}
 
-			if (DEBUG5 >= log_min_messages)
-				write_log("received inbound len %d", read_count);
-
-			if (read_count < 0)
+			if (nrecv < 0)
 			{
 				skip_poll = false;
 
@@ -6393,110 +6687,45 @@ rxThreadFunc(void *arg)
 				continue;
 			}
 
-			if (read_count < sizeof(icpkthdr))
+			for (i = 0; i < nrecv; i++)
 			{
-				if (DEBUG1 >= log_min_messages)
-					write_log("Interconnect error: short conn receive (%d)", read_count);
-				continue;
-			}
-
-			/* when we get a "good" recvfrom() result, we can skip poll() until we get a bad one. */
-			skip_poll = true;
+				if (DEBUG5 >= log_min_messages)
+					write_log("received inbound len %d", read_counts[i]);
 
-			/* length must be >= 0 */
-			if (pkt->len < 0)
-			{
-				if (DEBUG3 >= log_min_messages)
-					write_log("received inbound with negative length");
-				continue;
-			}
-
-			if (pkt->len != read_count)
-			{
-				if (DEBUG3 >= log_min_messages)
-					write_log("received inbound packet [%d], short: read %d bytes, pkt->len %d", pkt->seq, read_count, pkt->len);
-				continue;
-			}
-
-			/*
-			 * check the CRC of the payload.
-			 */
-			if (gp_interconnect_full_crc)
-			{
-				if (!checkCRC(pkt))
+				if (read_counts[i] < sizeof(icpkthdr))
 				{
-					gp_atomic_add_32(&ic_statistics.crcErrors, 1);
-					if (DEBUG2 >= log_min_messages)
-						write_log("received network data error, dropping bad packet, user data unaffected.");
+					if (DEBUG1 >= log_min_messages)
+						write_log("Interconnect error: short conn receive (%d)", read_counts[i]);
 					continue;
 				}
-			}
 
-			#ifdef AMS_VERBOSE_LOGGING
-				logPkt("GOT MESSAGE", pkt);
-			#endif
-
-			AckSendParam param;
-			memset(&param, 0, sizeof(AckSendParam));
-
-			/*
-			 * Get the connection for the pkt.
-			 *
-			 * 	The connection hash table should be locked until
-			 * 	finishing the processing of the packet to avoid
-			 *  the connection addition/removal from the hash table
-			 *  during the mean time.
-			 */
+				/* when we get a "good" recvfrom() result, we can skip poll() until we get a bad one. */
+				skip_poll = true;
 
-			pthread_mutex_lock(&ic_control_info.lock);
-			conn = findConnByHeader(&ic_control_info.connHtab, pkt);
-
-			if (conn != NULL)
-			{
-				/* Handling a regular packet */
-				if (handleDataPacket(conn, pkt, &peer, &peerlen, &param))
-					pkt = NULL;
-				ic_statistics.recvPktNum++;
+				if (handleRxPacket(pkts[i], read_counts[i], &peers[i], peerlens[i]))
+					pkts[i] = NULL;
 			}
-			else
-			{
-				/*
-				 * There may have two kinds of Mismatched packets:
-				 *    a) Past packets from previous command after I was torn down
-				 *    b) Future packets from current command before my connections are built.
-				 *
-				 * The handling logic is to "Ack the past and Nak the future".
-				 */
-				if ((pkt->flags & UDPIC_FLAGS_RECEIVER_TO_SENDER) == 0)
-				{
-					if (DEBUG1 >= log_min_messages)
-						write_log("mismatched packet received, seq %d, srcpid %d, dstpid %d, icid %d, sid %d", pkt->seq, pkt->srcPid, pkt->dstPid, pkt->icId, pkt->sessionId);
-
-				#ifdef AMS_VERBOSE_LOGGING
-					logPkt("Got a Mismatched Packet", pkt);
-				#endif
 
-					if (handleMismatch(pkt, &peer, peerlen))
-						pkt = NULL;
-					ic_statistics.mismatchNum++;
-				}
+			/* Keep the buffers that were not taken over for the next round. */
+			n = 0;
+			for (i = 0; i < npkts; i++)
+			{
+				if (pkts[i] != NULL)
+					pkts[n++] = pkts[i];
 			}
-			pthread_mutex_unlock(&ic_control_info.lock);
-
-			/* real ack sending is after lock release to decrease the lock holding time. */
-			if (param.msg.len != 0)
-				sendAckWithParam(&param);
+			npkts = n;
 		}
 
 		/* pthread_yield(); */
 	}
 
-	/* Before retrun, we release the packet. */
-	if (pkt)
+	/* Before retrun, we release the packets. */
+	if (npkts > 0)
 	{
 		pthread_mutex_lock(&ic_control_info.lock);
-		freeRxBuffer(&rx_buffer_pool, pkt);
-		pkt = NULL;
+		for (i = 0; i < npkts; i++)
+			freeRxBuffer(&rx_buffer_pool, pkts[i]);
+		npkts = 0;
 		pthread_mutex_unlock(&ic_control_info.lock);
 	}
 
@@ -27,6 +27,10 @@
 #include "utils/syscache.h"
 
 #include "access/memtup.h"
+#include "access/tupmacs.h"
+#include "access/tuptoaster.h"
+
+#include "lz4.h"
 
 /* A MemoryContext used within the tuple serialize code, so that freeing of
  * space is SUPAFAST.  It is initialized in the first call to InitSerTupInfo()
@@ -1232,3 +1236,475 @@ CvtChunksToHeapTup(TupleChunkList tcList, SerTupInfo * pSerInfo)
 
 	return htup;
 }
+
+/*
+ * Batches of rows.
+ *
+ * A serialized batch is a SerTupBatchHeader followed by the columns, each
+ * a SerTupBatchColumnHeader, the column's null bitmap if it has any NULLs
+ * and its values, the bitmap and the values each padded to MAXALIGN.  If
+ * SERTUPBATCH_LZ4 is set, everything after the header is compressed.
+ *
+ * Values are stored as in a heap tuple, except that varlenas always get a
+ * 4-byte header and are never toasted, so the receiver can hand out Datums
+ * pointing straight into the batch.
+ */
+typedef struct SerTupBatchHeader
+{
+	uint32		nrows;
+	uint16		natts;
+	uint16		flags;
+	uint32		rawlen;			/* length of the columns */
+	uint32		sentlen;		/* length of the columns as sent */
+} SerTupBatchHeader;
+
+#define SERTUPBATCH_LZ4		0x0001
+
+typedef struct SerTupBatchColumnHeader
+{
+	uint32		nullslen;		/* 0 if the column has no NULLs */
+	uint32		datalen;
+} SerTupBatchColumnHeader;
+
+typedef struct SerTupBatchColumn
+{
+	StringInfoData nulls;		/* a bit set for each non-NULL value */
+	StringInfoData data;		/* the non-NULL values */
+	bool		hasnulls;
+} SerTupBatchColumn;
+
+struct SerTupBatchBuilder
+{
+	int			natts;
+	int			nrows;
+	Size		size;			/* bytes of values collected */
+	SerTupBatchColumn *cols;
+};
+
+static const char s_zeros[MAXIMUM_ALIGNOF] = {0};
+
+static inline void
+appendZeros(StringInfo str, int len)
+{
+	enlargeStringInfo(str, len);
+	memset(str->data + str->len, 0, len);
+	str->len += len;
+}
+
+bool
+SerTupInfoCanBatch(SerTupInfo *pSerInfo)
+{
+	TupleDesc	tupdesc = pSerInfo->tupdesc;
+
+	return tupdesc->natts > 0 && !tupdesc->tdhasoid;
+}
+
+SerTupBatchBuilder *
+CreateSerTupBatchBuilder(SerTupInfo *pSerInfo)
+{
+	SerTupBatchBuilder *builder;
+	int			i;
+
+	builder = palloc(sizeof(SerTupBatchBuilder));
+	builder->natts = pSerInfo->tupdesc->natts;
+	builder->nrows = 0;
+	builder->size = 0;
+	builder->cols = palloc(builder->natts * sizeof(SerTupBatchColumn));
+
+	/* Start small, there may be one builder per destination. */
+	for (i = 0; i < builder->natts; i++)
+	{
+		initStringInfoOfSize(&builder->cols[i].nulls, 16);
+		initStringInfoOfSize(&builder->cols[i].data, 256);
+		builder->cols[i].hasnulls = false;
+	}
+
+	return builder;
+}
+
+int
+SerTupBatchNumRows(SerTupBatchBuilder *builder)
+{
+	return builder->nrows;
+}
+
+bool
+SerTupBatchAddRow(SerTupBatchBuilder *builder, SerTupInfo *pSerInfo,
+				  Datum *values, bool *isnull)
+{
+	TupleDesc	tupdesc = pSerInfo->tupdesc;
+	int			row = builder->nrows;
+	int			i;
+
+	for (i = 0; i < builder->natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		SerTupBatchColumn *col = &builder->cols[i];
+		StringInfo	data = &col->data;
+		int			oldlen = data->len;
+
+		if ((row & 7) == 0)
+			appendStringInfoCharMacro(&col->nulls, 0);
+
+		if (isnull[i])
+		{
+			col->hasnulls = true;
+			continue;
+		}
+		col->nulls.data[row >> 3] |= (1 << (row & 7));
+
+		appendZeros(data, att_align_nominal(data->len, attr->attalign) - data->len);
+
+		if (attr->attbyval)
+		{
+			enlargeStringInfo(data, attr->attlen);
+			store_att_byval(data->data + data->len, values[i], attr->attlen);
+			data->len += attr->attlen;
+		}
+		else if (attr->attlen > 0)
+			appendBinaryStringInfo(data, DatumGetPointer(values[i]), attr->attlen);
+		else if (attr->attlen == -1)
+		{
+			struct varlena *val = (struct varlena *) DatumGetPointer(values[i]);
+			struct varlena *plain = val;
+			char	   *dst;
+			int			len;
+
+			if (VARATT_IS_EXTERNAL(val) || VARATT_IS_COMPRESSED(val))
+				plain = heap_tuple_untoast_attr(val);
+
+			len = VARSIZE_ANY_EXHDR(plain);
+			enlargeStringInfo(data, VARHDRSZ + len);
+			dst = data->data + data->len;
+			SET_VARSIZE(dst, VARHDRSZ + len);
+			memcpy(VARDATA(dst), VARDATA_ANY(plain), len);
+			data->len += VARHDRSZ + len;
+			data->data[data->len] = '\0';
+
+			if (plain != val)
+				pfree(plain);
+		}
+		else
+		{
+			char	   *str = DatumGetCString(values[i]);
+
+			appendBinaryStringInfo(data, str, strlen(str) + 1);
+		}
+
+		builder->size += data->len - oldlen;
+	}
+
+	builder->nrows++;
+
+	return builder->nrows >= TUPSER_BATCH_MAX_ROWS ||
+		builder->size >= TUPSER_BATCH_MAX_BYTES;
+}
+
+/* Copy the columns of a batch into one flat buffer of hdr->rawlen bytes. */
+static void
+flattenBatchColumns(SerTupBatchBuilder *builder, char *pos)
+{
+	int			i;
+
+	for (i = 0; i < builder->natts; i++)
+	{
+		SerTupBatchColumn *col = &builder->cols[i];
+		SerTupBatchColumnHeader colhdr;
+
+		colhdr.nullslen = col->hasnulls ? col->nulls.len : 0;
+		colhdr.datalen = col->data.len;
+
+		memcpy(pos, &colhdr, sizeof(colhdr));
+		pos += sizeof(colhdr);
+
+		memcpy(pos, col->nulls.data, colhdr.nullslen);
+		memset(pos + colhdr.nullslen, 0, MAXALIGN(colhdr.nullslen) - colhdr.nullslen);
+		pos += MAXALIGN(colhdr.nullslen);
+
+		memcpy(pos, col->data.data, colhdr.datalen);
+		memset(pos + colhdr.datalen, 0, MAXALIGN(colhdr.datalen) - colhdr.datalen);
+		pos += MAXALIGN(colhdr.datalen);
+	}
+}
+
+/*
+ * Convert the rows collected in a batch into a chunk list for transmission,
+ * compressing them first if asked to and if it pays off.  The builder is
+ * emptied for the next batch.
+ */
+void
+SerializeTupleBatchIntoChunks(SerTupBatchBuilder *builder, SerTupInfo *pSerInfo,
+							  TupleChunkList tcList, bool compress)
+{
+	TupleChunkListItem tcItem;
+	TupleChunkListCache *cache = &pSerInfo->chunkCache;
+	SerTupBatchHeader hdr;
+	char	   *comp = NULL;
+	int			i;
+
+	AssertArg(builder != NULL);
+	AssertArg(builder->nrows > 0);
+	AssertArg(tcList != NULL);
+
+	/* get ready to go */
+	tcList->p_first = NULL;
+	tcList->p_last = NULL;
+	tcList->num_chunks = 0;
+	tcList->serialized_data_length = 0;
+	tcList->max_chunk_length = Gp_max_tuple_chunk_size;
+
+	tcItem = getChunkFromCache(cache);
+	if (tcItem == NULL)
+	{
+		ereport(FATAL, (errcode(ERRCODE_OUT_OF_MEMORY),
+						errmsg("Could not allocate space for first chunk item in new chunk list.")));
+	}
+	SetChunkType(tcItem->chunk_data, TC_BATCH);
+	tcItem->chunk_length = TUPLE_CHUNK_HEADER_SIZE;
+	appendChunkToTCList(tcList, tcItem);
+
+	hdr.nrows = builder->nrows;
+	hdr.natts = builder->natts;
+	hdr.flags = 0;
+	hdr.rawlen = 0;
+	for (i = 0; i < builder->natts; i++)
+	{
+		SerTupBatchColumn *col = &builder->cols[i];
+
+		hdr.rawlen += sizeof(SerTupBatchColumnHeader) +
+			(col->hasnulls ? MAXALIGN(col->nulls.len) : 0) +
+			MAXALIGN(col->data.len);
+	}
+	hdr.sentlen = hdr.rawlen;
+
+	if (compress)
+	{
+		MemoryContext oldCtxt;
+		char	   *raw;
+		int			bound = LZ4_compressBound(hdr.rawlen);
+		int			complen;
+
+		AssertState(s_tupSerMemCtxt != NULL);
+		oldCtxt = MemoryContextSwitchTo(s_tupSerMemCtxt);
+
+		raw = palloc(hdr.rawlen);
+		flattenBatchColumns(builder, raw);
+		comp = palloc(bound);
+		complen = LZ4_compress_default(raw, comp, hdr.rawlen, bound);
+
+		MemoryContextSwitchTo(oldCtxt);
+
+		if (complen > 0 && complen < hdr.rawlen)
+		{
+			hdr.flags |= SERTUPBATCH_LZ4;
+			hdr.sentlen = complen;
+		}
+		else
+		{
+			/* incompressible, send the flattened columns as they are */
+			comp = raw;
+		}
+	}
+
+	addByteStringToChunkList(tcList, (char *) &hdr, sizeof(hdr), cache);
+
+	if (comp != NULL)
+	{
+		addByteStringToChunkList(tcList, comp, hdr.sentlen, cache);
+		addPadding(tcList, cache, hdr.sentlen);
+		MemoryContextReset(s_tupSerMemCtxt);
+	}
+	else
+	{
+		for (i = 0; i < builder->natts; i++)
+		{
+			SerTupBatchColumn *col = &builder->cols[i];
+			SerTupBatchColumnHeader colhdr;
+
+			colhdr.nullslen = col->hasnulls ? col->nulls.len : 0;
+			colhdr.datalen = col->data.len;
+
+			addByteStringToChunkList(tcList, (char *) &colhdr, sizeof(colhdr), cache);
+			if (colhdr.nullslen > 0)
+			{
+				addByteStringToChunkList(tcList, col->nulls.data, colhdr.nullslen, cache);
+				if (MAXALIGN(colhdr.nullslen) > colhdr.nullslen)
+					addByteStringToChunkList(tcList, (char *) s_zeros,
+											 MAXALIGN(colhdr.nullslen) - colhdr.nullslen, cache);
+			}
+			if (colhdr.datalen > 0)
+			{
+				addByteStringToChunkList(tcList, col->data.data, colhdr.datalen, cache);
+				if (MAXALIGN(colhdr.datalen) > colhdr.datalen)
+					addByteStringToChunkList(tcList, (char *) s_zeros,
+											 MAXALIGN(colhdr.datalen) - colhdr.datalen, cache);
+			}
+		}
+	}
+
+	/* the first chunk of several starts a batch, the rest are partial */
+	if (tcList->num_chunks > 1)
+	{
+		SetChunkType(tcList->p_first->chunk_data, TC_BATCH_START);
+		SetChunkType(tcList->p_last->chunk_data, TC_PARTIAL_END);
+	}
+
+	/* empty the builder for the next batch */
+	builder->nrows = 0;
+	builder->size = 0;
+	for (i = 0; i < builder->natts; i++)
+	{
+		resetStringInfo(&builder->cols[i].nulls);
+		resetStringInfo(&builder->cols[i].data);
+		builder->cols[i].hasnulls = false;
+	}
+}
+
+SerTupBatch *
+CvtChunksToTupleBatch(TupleChunkList tcList, SerTupInfo *pSerInfo)
+{
+	StringInfoData serData;
+	TupleChunkListItem tcItem;
+	TupleChunkType tcType;
+	TupleChunkType expected;
+	SerTupBatchHeader hdr;
+	SerTupBatch *batch;
+	int			natts = pSerInfo->tupdesc->natts;
+	char	   *pos;
+	char	   *end;
+	int			i;
+
+	AssertArg(tcList != NULL);
+	AssertArg(tcList->p_first != NULL);
+
+	initStringInfoOfSize(&serData, tcList->num_chunks * tcList->max_chunk_length);
+
+	for (tcItem = tcList->p_first; tcItem != NULL; tcItem = tcItem->p_next)
+	{
+		GetChunkType(tcItem, &tcType);
+		if (tcItem == tcList->p_first)
+			expected = (tcItem->p_next == NULL) ? TC_BATCH : TC_BATCH_START;
+		else
+			expected = (tcItem->p_next == NULL) ? TC_PARTIAL_END : TC_PARTIAL_MID;
+
+		if (tcType != expected)
+			ereport(ERROR, (errcode(ERRCODE_PROTOCOL_VIOLATION),
+							errmsg("Unexpected chunk type %d in a batch of rows, expected %d.",
+								   tcType, expected)));
+
+		appendBinaryStringInfo(&serData,
+							   (const char *) GetChunkDataPtr(tcItem) + TUPLE_CHUNK_HEADER_SIZE,
+							   tcItem->chunk_length - TUPLE_CHUNK_HEADER_SIZE);
+	}
+
+	/* we've finished with the TCList, free it now. */
+	clearTCList(NULL, tcList);
+
+	if (serData.len < sizeof(hdr))
+		ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+						errmsg("Interconnect error: cannot convert chunks to a batch of rows."),
+						errdetail("batch len %d < headersize (%d)",
+								  serData.len, (int) sizeof(hdr))));
+	memcpy(&hdr, serData.data, sizeof(hdr));
+
+	if (hdr.natts != natts || hdr.sentlen > serData.len - sizeof(hdr))
+		ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+						errmsg("Interconnect error: cannot convert chunks to a batch of rows."),
+						errdetail("batch has %d columns and %u bytes, expected %d columns and at most %d bytes",
+								  hdr.natts, hdr.sentlen, natts, serData.len - (int) sizeof(hdr))));
+
+	batch = palloc(sizeof(SerTupBatch));
+	batch->next = NULL;
+	batch->tupdesc = pSerInfo->tupdesc;
+	batch->nrows = hdr.nrows;
+	batch->currow = 0;
+	batch->colpos = palloc(natts * sizeof(char *));
+	batch->colnulls = palloc(natts * sizeof(bits8 *));
+
+	if (hdr.flags & SERTUPBATCH_LZ4)
+	{
+		batch->data = palloc(hdr.rawlen);
+		if (LZ4_decompress_safe(serData.data + sizeof(hdr), batch->data,
+								hdr.sentlen, hdr.rawlen) != hdr.rawlen)
+			ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+							errmsg("Interconnect error: cannot decompress a batch of rows.")));
+		pfree(serData.data);
+		pos = batch->data;
+	}
+	else
+	{
+		/* point into the received data, the header keeps MAXALIGN */
+		batch->data = serData.data;
+		pos = batch->data + sizeof(hdr);
+	}
+	end = pos + hdr.rawlen;
+
+	for (i = 0; i < natts; i++)
+	{
+		SerTupBatchColumnHeader colhdr;
+
+		if (pos + sizeof(colhdr) > end)
+			break;
+		memcpy(&colhdr, pos, sizeof(colhdr));
+		pos += sizeof(colhdr);
+
+		if (colhdr.nullslen != 0 && colhdr.nullslen < BITMAPLEN(hdr.nrows))
+			break;
+
+		batch->colnulls[i] = colhdr.nullslen ? (bits8 *) pos : NULL;
+		pos += MAXALIGN(colhdr.nullslen);
+		batch->colpos[i] = pos;
+		pos += MAXALIGN(colhdr.datalen);
+
+		if (pos > end)
+			break;
+	}
+	if (i < natts)
+		ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+						errmsg("Interconnect error: cannot convert chunks to a batch of rows."),
+						errdetail("column %d of %d overruns the batch", i + 1, natts)));
+
+	return batch;
+}
+
+bool
+SerTupBatchNextRow(SerTupBatch *batch, Datum *values, bool *isnull)
+{
+	TupleDesc	tupdesc = batch->tupdesc;
+	int			row = batch->currow;
+	int			i;
+
+	if (row >= batch->nrows)
+		return false;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		char	   *pos;
+
+		if (batch->colnulls[i] != NULL && att_isnull(row, batch->colnulls[i]))
+		{
+			values[i] = (Datum) 0;
+			isnull[i] = true;
+			continue;
+		}
+
+		pos = (char *) att_align_nominal(batch->colpos[i], attr->attalign);
+		values[i] = fetchatt(attr, pos);
+		isnull[i] = false;
+		batch->colpos[i] = (char *) att_addlength_pointer(pos, attr->attlen, pos);
+	}
+
+	batch->currow++;
+
+	return true;
+}
+
+void
+FreeSerTupBatch(SerTupBatch *batch)
+{
+	pfree(batch->data);
+	pfree(batch->colpos);
+	pfree(batch->colnulls);
+	pfree(batch);
+}
@@ -80,6 +80,57 @@ test__BufferedReadUseBeforeBuffer__IsNextReadLenZero(void **state)
 	PG_END_TRY();	
 }
 
+void
+test__BufferedReadPrefetch__StaysDepthAhead(void **state)
+{
+	BufferedRead *bufferedRead = palloc(sizeof(BufferedRead));
+	int32 memoryLen = 256; /* maxBufferLen + largeReadLen */
+	uint8 *memory = malloc(memoryLen);
+	char *relname = "test";
+
+	BufferedReadInit(bufferedRead, memory, memoryLen, 128, 128, relname);
+	BufferedReadSetPrefetchDepth(bufferedRead, 2);
+
+	bufferedRead->file = 3;
+	bufferedRead->fileLen = 600;
+	bufferedRead->largeReadPosition = 0;
+	bufferedRead->largeReadLen = 128;
+
+	/* The first read asks for the two large reads that follow it */
+	expect_value(FilePrefetch, file, 3);
+	expect_value(FilePrefetch, offset, 128);
+	expect_value(FilePrefetch, amount, 256);
+	will_return(FilePrefetch, 0);
+	BufferedReadPrefetch(bufferedRead);
+	assert_true(bufferedRead->prefetchPosition == 384);
+
+	/* Each following read extends the window by one large read */
+	bufferedRead->largeReadPosition = 128;
+	expect_value(FilePrefetch, file, 3);
+	expect_value(FilePrefetch, offset, 384);
+	expect_value(FilePrefetch, amount, 128);
+	will_return(FilePrefetch, 0);
+	BufferedReadPrefetch(bufferedRead);
+
+	/* The window ends at the end of the file */
+	bufferedRead->largeReadPosition = 256;
+	expect_value(FilePrefetch, file, 3);
+	expect_value(FilePrefetch, offset, 512);
+	expect_value(FilePrefetch, amount, 88);
+	will_return(FilePrefetch, 0);
+	BufferedReadPrefetch(bufferedRead);
+	assert_true(bufferedRead->prefetchPosition == 600);
+
+	/* Nothing is left to prefetch */
+	bufferedRead->largeReadPosition = 384;
+	BufferedReadPrefetch(bufferedRead);
+
+	/* Depth 0 never prefetches */
+	BufferedReadSetPrefetchDepth(bufferedRead, 0);
+	bufferedRead->prefetchPosition = 0;
+	BufferedReadPrefetch(bufferedRead);
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -87,7 +138,8 @@ main(int argc, char* argv[])
 
 	const UnitTest tests[] = {
 		unit_test(test__BufferedReadUseBeforeBuffer__IsNextReadLenZero),
-		unit_test(test__BufferedReadInit__IsConsistent)
+		unit_test(test__BufferedReadInit__IsConsistent),
+		unit_test(test__BufferedReadPrefetch__StaysDepthAhead)
 	};
 
 	return run_tests(tests);
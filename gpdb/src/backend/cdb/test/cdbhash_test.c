@@ -0,0 +1,101 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "../cdbhash.c"
+
+/* hash values at the edges of the 32-bit range and of the segment count */
+static uint32
+edge_hash(int i, int numsegs)
+{
+	static const uint32 edges[] = {0, 1, 2, 0x7FFFFFFF, 0x80000000,
+								   0x80000001, 0xFFFFFFFE, 0xFFFFFFFF};
+
+	if (i < lengthof(edges))
+		return edges[i];
+
+	i -= lengthof(edges);
+	switch (i % 4)
+	{
+		case 0:
+			return (uint32) numsegs * (i / 4);
+		case 1:
+			return (uint32) numsegs * (i / 4) - 1;
+		case 2:
+			return 0xFFFFFFFF - (uint32) numsegs * (i / 4);
+		default:
+			return 0xFFFFFFFF / numsegs * numsegs - (i / 4);
+	}
+}
+
+static void
+check_reduce(int numsegs)
+{
+	CdbHash    *h = makeCdbHash(numsegs);
+	uint32		x = 2463534242U;
+	int			i;
+
+	assert_int_equal(h->numsegs, numsegs);
+
+	for (i = 0; i < 400; i++)
+	{
+		h->hash = edge_hash(i, numsegs);
+		assert_int_equal(cdbhashreduce(h), h->hash % numsegs);
+	}
+
+	/* and a few hundred thousand others, from a xorshift generator */
+	for (i = 0; i < 200000; i++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		h->hash = x;
+		assert_int_equal(cdbhashreduce(h), h->hash % numsegs);
+	}
+
+	free(h);
+}
+
+/* ==================== cdbhashreduce =================== */
+/*
+ * Tests that reducing a hash to a segment gives h->hash % numsegs, for
+ * segment counts that are not powers of two.
+ */
+void
+test__cdbhashreduce_not_power_of_two(void **state)
+{
+	static const int numsegs[] = {3, 5, 6, 7, 10, 12, 24, 33, 96, 100, 127,
+								  999, 1000, 4095, 65535, 65537, 1000003,
+								  0x7FFFFFFF};
+	int			i;
+
+	for (i = 0; i < lengthof(numsegs); i++)
+		check_reduce(numsegs[i]);
+}
+
+/*
+ * Tests the same for powers of two, which are reduced with a mask, and for
+ * a single segment.
+ */
+void
+test__cdbhashreduce_power_of_two(void **state)
+{
+	int			shift;
+
+	for (shift = 0; shift <= 30; shift++)
+		check_reduce(1 << shift);
+}
+
+int
+main(int argc, char* argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const UnitTest tests[] = {
+		unit_test(test__cdbhashreduce_not_power_of_two),
+		unit_test(test__cdbhashreduce_power_of_two)
+	};
+
+	return run_tests(tests);
+}
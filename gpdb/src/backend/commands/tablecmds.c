@@ -730,6 +730,11 @@ DefineRelation_int(CreateStmt *stmt,
 		stmt->relKind = relkind;
 		stmt->relStorage = relstorage;
 
+		/* The zone maps of an append-only table live in its block directory */
+		if (gp_appendonly_zonemaps &&
+			(relstorage == RELSTORAGE_AOROWS || relstorage == RELSTORAGE_AOCOLS))
+			stmt->buildAoBlkdir = true;
+
 		if (!OidIsValid(stmt->ownerid))
 			stmt->ownerid = GetUserId();
 
@@ -7,15 +7,52 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/execVecQual.h"
 #include "nodes/execnodes.h"
 #include "cdb/cdbaocsam.h"
+#include "cdb/cdbvars.h"
+#include "utils/memutils.h"
+
+/*
+ * AOCSBatchScanData
+ *    State for reading an AOCS table a batch at a time.
+ *
+ * aocs_getnextbatch() fills up to EXX_AOCS_BATCH_NROW rows of the projected
+ * columns straight out of the datum stream blocks.  The simple conjuncts of
+ * the scan qual are then evaluated over the whole batch (see execVecQual.c),
+ * and only the rows that pass are handed up, one slot at a time.  Conjuncts
+ * we cannot vectorize stay in ps.qual and are checked by ExecScan as usual.
+ *
+ * A batch never spans a datum stream block, and no block is read until the
+ * next batch is requested, so pass-by-reference datums in the batch stay
+ * valid while its rows are returned.
+ */
+typedef struct AOCSBatchScanData
+{
+	ExxAocsBatchReaderCtxt ctxt;
+
+	int		   *colattrs;		/* attnos of the projected columns */
+	int			ncolattrs;
+	int		   *rowAvailable;
+	AOTupleId  *aotid;
+	int32	  **runs;			/* run ids of the columns, for the qual */
+
+	VecQual    *vecqual;		/* NULL if no conjunct could be vectorized */
+	List	   *savedQual;		/* ps.qual to restore at end of scan */
+
+	int		   *sel;			/* selection vector over the current batch */
+	int			nsel;
+	int			nextsel;
+
+	MemoryContext batchContext; /* reset for every batch */
+} AOCSBatchScanData;
 
 static void
 InitAOCSScanOpaque(ScanState *scanState)
 {
 	AOCSScanState *state = (AOCSScanState *)scanState;
 	Assert(state->opaque == NULL);
-	state->opaque = palloc(sizeof(AOCSScanOpaqueData));
+	state->opaque = palloc0(sizeof(AOCSScanOpaqueData));
 
 	/* Initialize AOCS projection info */
 	AOCSScanOpaqueData *opaque = (AOCSScanOpaqueData *)state->opaque;
@@ -54,11 +91,207 @@ FreeAOCSScanOpaque(ScanState *scanState)
 
 	AOCSScanOpaqueData *opaque = (AOCSScanOpaqueData *)state->opaque;
 	Assert(opaque->proj != NULL);
+	Assert(opaque->batch == NULL);
 	pfree(opaque->proj);
 	pfree(state->opaque);
 	state->opaque = NULL;
 }
 
+/*
+ * InitAOCSBatchScan
+ *    Set up batch reading for the scan, and move the conjuncts of the qual
+ *    that can be evaluated over a batch out of ps.qual.
+ */
+static void
+InitAOCSBatchScan(AOCSScanState *node)
+{
+	AOCSScanOpaqueData *opaque = node->opaque;
+	Plan	   *plan = node->ss.ps.plan;
+	Index		scanrelid = ((Scan *) plan)->scanrelid;
+	AOCSBatchScanData *batch;
+	int		   *attmap;
+	List	   *vecClauses = NIL;
+	List	   *restQual = NIL;
+	ListCell   *lc;
+	ListCell   *lcs;
+	Datum	   *values;
+	bool	   *nulls;
+	int			i;
+
+	batch = palloc0(sizeof(AOCSBatchScanData));
+
+	attmap = palloc(sizeof(int) * opaque->ncol);
+	batch->colattrs = palloc(sizeof(int) * opaque->ncol);
+	for (i = 0; i < opaque->ncol; i++)
+	{
+		attmap[i] = -1;
+		if (opaque->proj[i])
+		{
+			attmap[i] = batch->ncolattrs;
+			batch->colattrs[batch->ncolattrs++] = i + 1;
+		}
+	}
+
+	/*
+	 * ps.qual holds one ExprState per conjunct of plan->qual, in the same
+	 * order.  Split it into the part we vectorize and the part ExecScan
+	 * keeps evaluating.
+	 */
+	if (list_length(plan->qual) == list_length(node->ss.ps.qual))
+	{
+		forboth(lc, plan->qual, lcs, node->ss.ps.qual)
+		{
+			Expr	   *clause = (Expr *) lfirst(lc);
+
+			if (ExecVecQualSupported(clause, scanrelid, attmap, opaque->ncol))
+				vecClauses = lappend(vecClauses, clause);
+			else
+				restQual = lappend(restQual, lfirst(lcs));
+		}
+	}
+	else
+		restQual = node->ss.ps.qual;
+
+	batch->vecqual = ExecVecQualCompile(vecClauses, scanrelid, attmap,
+										opaque->ncol, EXX_AOCS_BATCH_NROW);
+	batch->savedQual = node->ss.ps.qual;
+	if (batch->vecqual != NULL)
+		node->ss.ps.qual = restQual;
+	list_free(vecClauses);
+	pfree(attmap);
+
+	/* Row-major batch buffers, as aocs_getnextbatch() expects */
+	values = palloc(sizeof(Datum) * EXX_AOCS_BATCH_NROW * batch->ncolattrs);
+	nulls = palloc(sizeof(bool) * EXX_AOCS_BATCH_NROW * batch->ncolattrs);
+	for (i = 0; i < EXX_AOCS_BATCH_NROW; i++)
+	{
+		batch->ctxt.datum[i] = values + i * batch->ncolattrs;
+		batch->ctxt.isnull[i] = nulls + i * batch->ncolattrs;
+	}
+
+	batch->rowAvailable = palloc0(sizeof(int) * batch->ncolattrs);
+	batch->aotid = palloc(sizeof(AOTupleId) * EXX_AOCS_BATCH_NROW);
+	batch->sel = palloc(sizeof(int) * EXX_AOCS_BATCH_NROW);
+	if (batch->vecqual != NULL)
+	{
+		batch->runs = palloc0(sizeof(int32 *) * batch->ncolattrs);
+		batch->ctxt.runs = batch->runs;
+		batch->ctxt.runbuf = palloc(sizeof(int32) * EXX_AOCS_BATCH_NROW *
+									batch->ncolattrs);
+	}
+
+	batch->ctxt.ncol = batch->ncolattrs;
+	batch->ctxt.colattrs = batch->colattrs;
+	batch->ctxt.maxrows = EXX_AOCS_BATCH_NROW;
+	batch->ctxt.aotid = batch->aotid;
+	batch->ctxt.row_available = batch->rowAvailable;
+
+	batch->batchContext = AllocSetContextCreate(CurrentMemoryContext,
+												"AOCSBatchScan",
+												ALLOCSET_DEFAULT_MINSIZE,
+												ALLOCSET_DEFAULT_INITSIZE,
+												ALLOCSET_DEFAULT_MAXSIZE);
+
+	opaque->batch = batch;
+}
+
+static void
+ResetAOCSBatchScan(AOCSBatchScanData *batch)
+{
+	/* SEG_NOT_OPEN, see aocs_getnextbatch() */
+	batch->ctxt.seg_status = 0;
+	batch->nsel = 0;
+	batch->nextsel = 0;
+	MemoryContextReset(batch->batchContext);
+}
+
+static void
+FreeAOCSBatchScan(AOCSScanState *node)
+{
+	AOCSBatchScanData *batch = node->opaque->batch;
+
+	node->ss.ps.qual = batch->savedQual;
+
+	MemoryContextDelete(batch->batchContext);
+	pfree(batch->ctxt.datum[0]);
+	pfree(batch->ctxt.isnull[0]);
+	pfree(batch->rowAvailable);
+	pfree(batch->aotid);
+	pfree(batch->sel);
+	if (batch->runs != NULL)
+	{
+		pfree(batch->runs);
+		pfree(batch->ctxt.runbuf);
+	}
+	pfree(batch->colattrs);
+	pfree(batch);
+
+	node->opaque->batch = NULL;
+}
+
+/*
+ * AOCSScanNextBatch
+ *    Return the next row of the current batch that passed the vectorized
+ *    qual, reading (and filtering) the next batch when this one is used up.
+ */
+static TupleTableSlot *
+AOCSScanNextBatch(AOCSScanState *node)
+{
+	AOCSBatchScanData *batch = node->opaque->batch;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	while (batch->nextsel >= batch->nsel)
+	{
+		MemoryContext oldcxt;
+		int			nrow;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		MemoryContextReset(batch->batchContext);
+
+		nrow = aocs_getnextbatch(node->opaque->scandesc, &batch->ctxt);
+		if (nrow == 0)
+		{
+			ExecClearTuple(slot);
+			return slot;
+		}
+
+		for (i = 0; i < nrow; i++)
+			batch->sel[i] = i;
+
+		oldcxt = MemoryContextSwitchTo(batch->batchContext);
+		batch->nsel = ExecVecQualEval(batch->vecqual, batch->ctxt.datum,
+									  batch->ctxt.isnull, batch->runs,
+									  batch->sel, nrow);
+		MemoryContextSwitchTo(oldcxt);
+
+		batch->nextsel = 0;
+	}
+
+	{
+		int			row = batch->sel[batch->nextsel++];
+		Datum	   *values = slot_get_values(slot);
+		bool	   *isnull = slot_get_isnull(slot);
+		Datum	   *bvalues = batch->ctxt.datum[row];
+		bool	   *bisnull = batch->ctxt.isnull[row];
+		int			i;
+
+		for (i = 0; i < batch->ncolattrs; i++)
+		{
+			int			attno = batch->colattrs[i];
+
+			values[attno - 1] = bvalues[i];
+			isnull[attno - 1] = bisnull[i];
+		}
+
+		TupSetVirtualTupleNValid(slot, slot->tts_tupleDescriptor->natts);
+		slot_set_ctid(slot, (ItemPointer) &batch->aotid[row]);
+	}
+
+	return slot;
+}
+
 TupleTableSlot *
 AOCSScanNext(ScanState *scanState)
 {
@@ -68,6 +301,9 @@ AOCSScanNext(ScanState *scanState)
 	Assert(node->opaque != NULL &&
 		   node->opaque->scandesc != NULL);
 
+	if (node->opaque->batch != NULL)
+		return AOCSScanNextBatch(node);
+
 	aocs_getnext(node->opaque->scandesc, node->ss.ps.state->es_direction, node->ss.ss_ScanTupleSlot);
 	return node->ss.ss_ScanTupleSlot;
 }
@@ -102,6 +338,19 @@ BeginScanAOCSRelation(ScanState *scanState)
 					   NULL /* relationTupleDesc */,
 					   node->opaque->proj);
 
+	node->opaque->scandesc->zoneMap =
+		AppendOnlyZoneMap_BeginScan(node->ss.ss_currentRelation,
+									node->opaque->scandesc->aoEntry,
+									appendOnlyMetaDataSnapshot,
+									node->ss.ps.plan->qual,
+									((Scan *) node->ss.ps.plan)->scanrelid);
+
+	if (gp_enable_aocs_batch_scan &&
+		ScanDirectionIsForward(node->ss.ps.state->es_direction))
+	{
+		InitAOCSBatchScan(node);
+	}
+
 	node->ss.scan_state = SCAN_SCAN;
 }
  
@@ -117,7 +366,10 @@ EndScanAOCSRelation(ScanState *scanState)
 		   node->opaque->scandesc != NULL);
 
 	aocs_endscan(node->opaque->scandesc);
-        
+
+	if (node->opaque->batch != NULL)
+		FreeAOCSBatchScan(node);
+
 	FreeAOCSScanOpaque(scanState);
 	
 	node->ss.scan_state = SCAN_INIT;
@@ -133,4 +385,7 @@ ReScanAOCSRelation(ScanState *scanState)
 		   node->opaque->scandesc != NULL);
 
 	aocs_rescan(node->opaque->scandesc); 
+
+	if (node->opaque->batch != NULL)
+		ResetAOCSBatchScan(node->opaque->batch);
 }
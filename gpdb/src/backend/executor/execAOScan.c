@@ -67,6 +67,14 @@ BeginScanAppendOnlyRelation(ScanState *scanState)
 			node->ss.ps.state->es_snapshot, 
 			appendOnlyMetaDataSnapshot,
 			0, NULL);
+
+	node->aos_ScanDesc->zoneMap = AppendOnlyZoneMap_BeginScan(
+			node->ss.ss_currentRelation,
+			node->aos_ScanDesc->aoEntry,
+			appendOnlyMetaDataSnapshot,
+			node->ss.ps.plan->qual,
+			((Scan *) node->ss.ps.plan)->scanrelid);
+
 	node->ss.scan_state = SCAN_SCAN;
 }
 
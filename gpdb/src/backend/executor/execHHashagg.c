@@ -94,6 +94,23 @@ typedef enum InputRecordType
 #define HAVE_FREESPACE(hashtable) \
    (GET_TOTAL_USED_SIZE(hashtable) < (hashtable)->max_mem)
 
+/* The hash table is grown when more than 3/4 of its buckets are used. */
+#define HHA_MAX_FILL(nbuckets) ((nbuckets) - ((nbuckets) >> 2))
+
+/*
+ * Records reloaded from a batch file are looked up HHA_PREFETCH_BATCH at
+ * a time, after prefetching all their buckets.  Scans over the buckets
+ * prefetch the entry HHA_PREFETCH_DISTANCE buckets ahead.
+ */
+#define HHA_PREFETCH_BATCH 16
+#define HHA_PREFETCH_DISTANCE 8
+
+#ifdef __GNUC__
+#define hha_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hha_prefetch(addr) ((void) (addr))
+#endif
+
 /* Methods that handle batch files */
 static SpillSet *createSpillSet(unsigned branching_factor, unsigned parent_hash_bit);
 static SpillSet *read_spill_set(AggState *aggstate);
@@ -106,7 +123,8 @@ static int32 writeHashEntry(AggState *aggstate,
 static void *readHashEntry(AggState *aggstate,
 						   BatchFileInfo *file_info,
 						   HashKey *p_hashkey,
-						   int32 *p_input_size);
+						   int32 *p_input_size,
+						   bool copy);
 
 /* Methods for hash table */
 static uint32 calc_hash_value(AggState* aggstate, TupleTableSlot *inputslot);
@@ -115,7 +133,7 @@ static void init_agg_hash_iter(HashAggTable* ht);
 static HashAggEntry *lookup_agg_hash_entry(AggState *aggstate, void *input_record,
 										   InputRecordType input_type, int32 input_size,
 										   uint32 hashkey, unsigned parent_hash_bit, bool *p_isnew);
-static void agg_hash_table_stat_upd(HashAggTable *ht);
+static void agg_hash_table_stat_upd(HashAggTable *ht, unsigned hash_bit);
 static void reset_agg_hash_table(AggState *aggstate);
 static bool agg_hash_reload(AggState *aggstate);
 static inline void *mpool_cxt_alloc(void *manager, Size len);
@@ -274,7 +292,6 @@ makeHashAggEntryForInput(AggState *aggstate, TupleTableSlot *inputslot, uint32 h
 	entry->tuple_and_aggs = NULL;
 	entry->hashvalue = hashvalue;
 	entry->is_primodial = !(hashtable->is_spilling);
-	entry->next = NULL;
 
 	/*
 	 * Copy memtuple into group_buf. Remember to always allocate
@@ -346,7 +363,6 @@ makeHashAggEntryForGroup(AggState *aggstate, void *tuple_and_aggs,
 	entry->hashvalue = hashvalue;
 	entry->is_primodial = !(hashtable->is_spilling);
 	entry->tuple_and_aggs = copy_tuple_and_aggs;
-	entry->next = NULL;
 
 	/* Initialize per group data */
 	adjustInputGroup(aggstate, entry->tuple_and_aggs, mt_bind);
@@ -376,6 +392,132 @@ setGroupAggs(HashAggTable *hashtable, MemTupleBinding *mt_bind, HashAggEntry *en
 	}
 }
 
+/*
+ * Function: agg_hash_entry_matches
+ *
+ * Returns true if the grouping key of the input record equals the grouping
+ * key of the given entry.  NULLs match each other.
+ */
+static inline bool
+agg_hash_entry_matches(AggState *aggstate, HashAggEntry *entry,
+					   void *input_record, InputRecordType input_type)
+{
+	MemTupleBinding *mt_bind = aggstate->hashslot->tts_mt_bind;
+	Agg *agg = (Agg*)aggstate->ss.ps.plan;
+	MemTuple mtup = (MemTuple) entry->tuple_and_aggs;
+	int i;
+
+	for (i = 0; i < agg->numCols; i++)
+	{
+		AttrNumber	att = agg->grpColIdx[i];
+		Datum input_datum = 0;
+		Datum entry_datum = 0;
+		bool input_isNull = false;
+		bool entry_isNull = false;
+
+		switch(input_type)
+		{
+			case INPUT_RECORD_TUPLE:
+				input_datum = slot_getattr((TupleTableSlot *)input_record, att, &input_isNull);
+				break;
+			case INPUT_RECORD_GROUP_AND_AGGS:
+				input_datum = memtuple_getattr((MemTuple)input_record, mt_bind, att, &input_isNull);
+				break;
+			default:
+				insist_log(false, "invalid record type %d", input_type);
+		}
+
+		entry_datum = memtuple_getattr(mtup, mt_bind, att, &entry_isNull);
+
+		if ( !input_isNull && !entry_isNull &&
+			 (DatumGetBool(FunctionCall2(&aggstate->eqfunctions[i],
+										 input_datum,
+										 entry_datum)) ) )
+			continue; /* Both non-NULL and equal. */
+
+		if (!(input_isNull && entry_isNull))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Function: grow_agg_hash_table
+ *
+ * Double the number of buckets of the hash table and move the entries
+ * over.  Returns false, leaving the table alone, if the larger bucket
+ * array does not fit in the memory left.
+ *
+ * hash_bit is the number of low bits of the hash values that select the
+ * batch of the current pass; they are shifted off before the hash value is
+ * used as a bucket number.
+ */
+static bool
+grow_agg_hash_table(AggState *aggstate, unsigned hash_bit)
+{
+	HashAggTable *hashtable = aggstate->hhashtable;
+	HashAggBucket *old_buckets = hashtable->buckets;
+	unsigned old_nbuckets = hashtable->nbuckets;
+	unsigned nbuckets = old_nbuckets * 2;
+	unsigned mask = nbuckets - 1;
+	HashAggBucket *buckets;
+	unsigned i;
+
+	if (nbuckets < old_nbuckets ||
+		(Size) nbuckets * sizeof(HashAggBucket) > MaxAllocSize)
+		return false;
+
+	if (GET_TOTAL_USED_SIZE(hashtable) + old_nbuckets * sizeof(HashAggBucket) >=
+		hashtable->max_mem)
+		return false;
+
+	buckets = (HashAggBucket *)
+		MemoryContextAllocZero(aggstate->aggcontext, nbuckets * sizeof(HashAggBucket));
+
+	/*
+	 * Reinsert in bucket order.  The new home bucket of an entry is its old
+	 * one, or that plus old_nbuckets, so the stores sweep both halves of the
+	 * new array front to back.
+	 */
+	for (i = 0; i < old_nbuckets; i++)
+	{
+		unsigned bucket_idx;
+
+		if (old_buckets[i].entry == NULL)
+			continue;
+
+		bucket_idx = (old_buckets[i].hashvalue >> hash_bit) & mask;
+		while (buckets[bucket_idx].entry != NULL)
+			bucket_idx = (bucket_idx + 1) & mask;
+		buckets[bucket_idx] = old_buckets[i];
+	}
+
+	pfree(old_buckets);
+	hashtable->buckets = buckets;
+	hashtable->nbuckets = nbuckets;
+	hashtable->mem_for_metadata += old_nbuckets * sizeof(HashAggBucket);
+	hashtable->total_buckets += old_nbuckets;
+
+	elog(HHA_MSG_LVL, "HashAgg: grew hash table to %u buckets for %u groups",
+		 nbuckets, hashtable->nbuckets_used);
+
+	return true;
+}
+
+/*
+ * Function: prefetch_agg_hash_bucket
+ *
+ * Start loading the home bucket of the given hash key into the cache, for
+ * a lookup_agg_hash_entry call that is coming soon.
+ */
+static inline void
+prefetch_agg_hash_bucket(HashAggTable *hashtable, uint32 hashkey, unsigned parent_hash_bit)
+{
+	hha_prefetch(&hashtable->buckets[(hashkey >> parent_hash_bit) &
+									 (hashtable->nbuckets - 1)]);
+}
+
 /*
  * Function: lookup_agg_hash_entry
  *
@@ -399,83 +541,67 @@ lookup_agg_hash_entry(AggState *aggstate,
 					  InputRecordType input_type, int32 input_size,
 					  uint32 hashkey, unsigned parent_hash_bit, bool *p_isnew)
 {
-	HashAggEntry *entry;
+	HashAggEntry *entry = NULL;
 	HashAggTable *hashtable = aggstate->hhashtable;
-	MemTupleBinding *mt_bind = aggstate->hashslot->tts_mt_bind;
 	ExprContext *tmpcontext = aggstate->tmpcontext; /* per input tuple context */
-	Agg *agg = (Agg*)aggstate->ss.ps.plan;
 	MemoryContext oldcxt;
+	HashAggBucket *bucket;
 	unsigned int bucket_idx;
-	uint64 bloomval;			/* bloom filter value */
+	unsigned int mask = hashtable->nbuckets - 1;
    
-	Assert(mt_bind != NULL);
+	Assert(aggstate->hashslot->tts_mt_bind != NULL);
+	Assert((hashtable->nbuckets & mask) == 0);
 
 	if (p_isnew != NULL)
 		*p_isnew = false;
 
 	oldcxt = MemoryContextSwitchTo(tmpcontext->ecxt_per_tuple_memory);
-	bucket_idx = (hashkey >> parent_hash_bit) % (hashtable->nbuckets);
-	bloomval = ((uint64)1) << ((hashkey >> 23) & 0x3f);
-	entry = (0 == (hashtable->bloom[bucket_idx] & bloomval) ? NULL :
-			 hashtable->buckets[bucket_idx]);
 
 	/*
-	 * Search entry chain for the bucket. If such an entry found in the
-	 * chain, move it to the front of the chain. Otherwise, if there
-	 * are any space left, create a new entry, and insert it in
-	 * the front of the chain.
+	 * Probe from the home bucket until we either find the group or hit an
+	 * empty bucket.  Only buckets holding the same hash value need a look
+	 * at the entry itself.
 	 */
-	while (entry != NULL)
+	bucket_idx = (hashkey >> parent_hash_bit) & mask;
+	for (;;)
 	{
-		MemTuple mtup = (MemTuple) entry->tuple_and_aggs;
-		int i;
-		bool match = true;
+		bucket = &hashtable->buckets[bucket_idx];
 
-		if (hashkey != entry->hashvalue)
+		if (bucket->entry == NULL)
+			break;
+
+		if (bucket->hashvalue == hashkey &&
+			agg_hash_entry_matches(aggstate, bucket->entry, input_record, input_type))
 		{
-			entry = entry->next;
-			continue;
+			entry = bucket->entry;
+			break;
 		}
-		
-		for (i = 0; match && i < agg->numCols; i++)
+
+		bucket_idx = (bucket_idx + 1) & mask;
+	}
+
+	if (entry == NULL)
+	{
+		/*
+		 * Keep the table at most 3/4 full, so that probes stay short and
+		 * there is always an empty bucket to stop them.  If it cannot grow,
+		 * report it full and let the caller spill.
+		 */
+		if (hashtable->nbuckets_used >= HHA_MAX_FILL(hashtable->nbuckets))
 		{
-			AttrNumber	att = agg->grpColIdx[i];
-			Datum input_datum = 0;
-			Datum entry_datum = 0;
-			bool input_isNull = false;
-			bool entry_isNull = false;
-				
-			switch(input_type)
+			if (!grow_agg_hash_table(aggstate, parent_hash_bit))
 			{
-				case INPUT_RECORD_TUPLE:
-					input_datum = slot_getattr((TupleTableSlot *)input_record, att, &input_isNull);
-					break;
-				case INPUT_RECORD_GROUP_AND_AGGS:
-					input_datum = memtuple_getattr((MemTuple)input_record, mt_bind, att, &input_isNull);
-					break;
-				default:
-					insist_log(false, "invalid record type %d", input_type);
+				(void) MemoryContextSwitchTo(oldcxt);
+				return NULL;
 			}
 
-			entry_datum = memtuple_getattr(mtup, mt_bind, att, &entry_isNull);
-
-			if ( !input_isNull && !entry_isNull &&
-				 (DatumGetBool(FunctionCall2(&aggstate->eqfunctions[i],
-											 input_datum,
-											 entry_datum)) ) )
-				continue; /* Both non-NULL and equal. */
-			match = (input_isNull && entry_isNull);/* NULLs match in group keys. */
+			mask = hashtable->nbuckets - 1;
+			bucket_idx = (hashkey >> parent_hash_bit) & mask;
+			while (hashtable->buckets[bucket_idx].entry != NULL)
+				bucket_idx = (bucket_idx + 1) & mask;
+			bucket = &hashtable->buckets[bucket_idx];
 		}
-		
-		/* Break if found an existing matching entry. */
-		if (match)
-			break;
-
-		entry = entry->next;
-	}
 
-	if (entry == NULL)
-	{
 		/* Create a new matching entry. */
 		switch(input_type)
 		{
@@ -491,9 +617,9 @@ lookup_agg_hash_entry(AggState *aggstate,
 			
 		if (entry != NULL)
 		{
-			entry->next = hashtable->buckets[bucket_idx];
-			hashtable->buckets[bucket_idx] = entry;
-			hashtable->bloom[bucket_idx] |= bloomval;
+			bucket->entry = entry;
+			bucket->hashvalue = hashkey;
+			hashtable->nbuckets_used++;
 			
 			hashtable->num_ht_groups++;
 
@@ -533,6 +659,7 @@ calcHashAggTableSizes(double memquota,	/* Memory quota in bytes. */
 		+ transpace;
 	
 	double nbuckets;
+	double pow2;
 
 	/* Hash Entries */
 	double nentries;
@@ -575,9 +702,6 @@ calcHashAggTableSizes(double memquota,	/* Memory quota in bytes. */
 
 	nbuckets = ceil(nentries/gp_hashagg_groups_per_bucket);
 
-	/* Set nbuckets to the power of 2. */
-	nbuckets = (((unsigned)1) << ((unsigned)ceil(log(nbuckets) / log(2))));
-
 	/*
 	 * Always set nbuckets greater than gp_hashagg_default_nbatches since
 	 * the spilling relies on this fact to choose which files to spill
@@ -586,6 +710,14 @@ calcHashAggTableSizes(double memquota,	/* Memory quota in bytes. */
 	if (nbuckets < gp_hashagg_default_nbatches)
 		nbuckets = gp_hashagg_default_nbatches;
 
+	/*
+	 * Set nbuckets to the power of 2.  This must come last: the table is
+	 * open-addressed and probes with nbuckets - 1 as the mask.
+	 */
+	for (pow2 = 1; pow2 < nbuckets; pow2 *= 2)
+		;
+	nbuckets = pow2;
+
 	if (nbatches > UINT_MAX || nentries > UINT_MAX || nbuckets > UINT_MAX)
 	{
 		if (force)
@@ -613,7 +745,7 @@ calcHashAggTableSizes(double memquota,	/* Memory quota in bytes. */
 	elog(HHA_MSG_LVL, "HashAgg: nbuckets = %d, nentries = %d, nbatches = %d",
 		 (int)nbuckets, (int)nentries, (int)nbatches);
 	elog(HHA_MSG_LVL, "HashAgg: expected memory footprint = %d",
-		(int)( nentries*entrywidth + nbuckets*sizeof(HashAggEntry*) + nbatches*batchfile_buffer_size));
+		(int)( nentries*entrywidth + nbuckets*sizeof(HashAggBucket) + nbatches*batchfile_buffer_size));
 	
 	return true;
 }
@@ -743,8 +875,11 @@ create_agg_hash_table(AggState *aggstate)
 	/* Initialize the hash buckets */
 	hashtable->nbuckets = hashtable->hats.nbuckets;
 	hashtable->total_buckets = hashtable->nbuckets;
-	hashtable->buckets = (HashAggEntry **)palloc0(hashtable->nbuckets * sizeof(HashAggEntry *));
-	hashtable->bloom = (uint64 *)palloc0(hashtable->nbuckets * sizeof(uint64));
+	if (hashtable->nbuckets == 0 ||
+		(hashtable->nbuckets & (hashtable->nbuckets - 1)) != 0)
+		elog(ERROR, "hash aggregate table size %u is not a power of 2",
+			 hashtable->nbuckets);
+	hashtable->buckets = (HashAggBucket *)palloc0(hashtable->nbuckets * sizeof(HashAggBucket));
 
 	MemoryContextSwitchTo(hashtable->entry_cxt);
 	
@@ -764,8 +899,7 @@ create_agg_hash_table(AggState *aggstate)
 
 	hashtable->max_mem = 1024.0 * operatorMemKB;
 	hashtable->mem_for_metadata = sizeof(HashAggTable)
-		+ hashtable->nbuckets * sizeof(HashAggEntry *)
-		+ hashtable->nbuckets * sizeof(uint64)
+		+ hashtable->nbuckets * sizeof(HashAggBucket)
 		+ sizeof(GroupKeysAndAggs);
 	hashtable->mem_wanted = hashtable->mem_for_metadata;
 	hashtable->mem_used = hashtable->mem_for_metadata;
@@ -924,7 +1058,7 @@ agg_hash_initial_pass(AggState *aggstate)
 
 			/* CDB: Report statistics for EXPLAIN ANALYZE. */
 			if (!hashtable->is_spilling && aggstate->ss.ps.instrument)
-				agg_hash_table_stat_upd(hashtable);
+				agg_hash_table_stat_upd(hashtable, 0);
 
 			spill_hash_table(aggstate);
 
@@ -986,7 +1120,7 @@ agg_hash_initial_pass(AggState *aggstate)
 
     /* CDB: Report statistics for EXPLAIN ANALYZE. */
     if (!hashtable->is_spilling && aggstate->ss.ps.instrument)
-        agg_hash_table_stat_upd(hashtable);
+        agg_hash_table_stat_upd(hashtable, 0);
 
 	AssertImply(tuple_remaining, streaming);
 	if(tuple_remaining) 
@@ -1367,11 +1501,11 @@ read_spill_set(AggState *aggstate)
 /* Spill all entries from the hash table to file in order to make room
  * for new hash entries.
  *
- * We want to maximize the sequential writes to each spill file. Since
- * the number of buckets and the number of batches (#batches) are the power of 2,
- * We simply write bucket 0, #batches, 2 * #batches, ... to the batch 0;
- * write bucket 1, (#batches + 1), (2 * #batches + 1), ... to the batch 1;
- * and etc.
+ * An entry goes to the batch picked by the hash bits just above those that
+ * selected the current batch, the same bits that pick its home bucket.
+ * Since an entry may sit in a bucket after its home bucket, the batch is
+ * taken from the hash value kept in the bucket rather than from the bucket
+ * number, and the buckets are written out in a single sweep.
  */
 static void
 spill_hash_table(AggState *aggstate)
@@ -1379,8 +1513,9 @@ spill_hash_table(AggState *aggstate)
 	HashAggTable *hashtable = aggstate->hhashtable;
 	SpillSet *spill_set;
 	SpillFile *spill_file;
-	int bucket_no;
+	unsigned bucket_no;
 	int file_no;
+	unsigned hash_bit;
 	MemoryContext oldcxt;
 	uint64 old_num_spill_groups = hashtable->num_spill_groups;
 
@@ -1403,10 +1538,8 @@ spill_hash_table(AggState *aggstate)
 	/* Book keeping. */
 	hashtable->is_spilling = true;
 
-	Assert(hashtable->nbuckets > spill_set->num_spill_files);
-
 	/*
-	 * Write each spill file. Write the last spill file first, since it will
+	 * Open each spill file. Open the last spill file first, since it will
 	 * be processed the last.
 	 */
 	for (file_no = spill_set->num_spill_files - 1; file_no >= 0; file_no--)
@@ -1428,43 +1561,43 @@ spill_hash_table(AggState *aggstate)
 			
 			CheckSendPlanStateGpmonPkt(&aggstate->ss.ps);
 		}
+	}
 
-		for (bucket_no = file_no; bucket_no < hashtable->nbuckets;
-			 bucket_no += spill_set->num_spill_files)
-		{
-			HashAggEntry *entry = hashtable->buckets[bucket_no];
-			
-			/* Ignore empty chains. */
-			if (entry == NULL) continue;
-			
-			/* Write all entries in the hash chain. */
-			while ( entry  != NULL )
-			{
-				HashAggEntry *spill_entry = entry;
-				entry = spill_entry->next;
+	hash_bit = spill_set->spill_files[0].batch_hash_bit;
 
-				if (spill_entry != NULL)
-				{
-					int32 written_bytes;
-					
-					written_bytes = writeHashEntry(aggstate, spill_file->file_info, spill_entry);
-					spill_file->file_info->ntuples++;
-					spill_file->file_info->total_bytes += written_bytes;
+	for (bucket_no = 0; bucket_no < hashtable->nbuckets; bucket_no++)
+	{
+		HashAggEntry *spill_entry = hashtable->buckets[bucket_no].entry;
+		int32 written_bytes;
+
+		/* Ignore empty buckets. */
+		if (spill_entry == NULL)
+			continue;
 
-					hashtable->num_spill_groups++;
+		if (bucket_no + HHA_PREFETCH_DISTANCE < hashtable->nbuckets &&
+			hashtable->buckets[bucket_no + HHA_PREFETCH_DISTANCE].entry != NULL)
+			hha_prefetch(hashtable->buckets[bucket_no + HHA_PREFETCH_DISTANCE].entry);
 
-					Gpmon_M_Incr(GpmonPktFromAggState(aggstate), GPMON_AGG_SPILLTUPLE);
-					Gpmon_M_Add(GpmonPktFromAggState(aggstate), GPMON_AGG_SPILLBYTE, written_bytes);
+		file_no = (hashtable->buckets[bucket_no].hashvalue >> hash_bit) %
+			spill_set->num_spill_files;
+		spill_file = &spill_set->spill_files[file_no];
 
-					Gpmon_M_Incr(GpmonPktFromAggState(aggstate), GPMON_AGG_CURRSPILLPASS_TUPLE);
-					Gpmon_M_Add(GpmonPktFromAggState(aggstate), GPMON_AGG_CURRSPILLPASS_BYTE, written_bytes);
-				}
-			}
+		written_bytes = writeHashEntry(aggstate, spill_file->file_info, spill_entry);
+		spill_file->file_info->ntuples++;
+		spill_file->file_info->total_bytes += written_bytes;
 
-			hashtable->buckets[bucket_no] = NULL;
-		}
+		hashtable->num_spill_groups++;
+
+		Gpmon_M_Incr(GpmonPktFromAggState(aggstate), GPMON_AGG_SPILLTUPLE);
+		Gpmon_M_Add(GpmonPktFromAggState(aggstate), GPMON_AGG_SPILLBYTE, written_bytes);
+
+		Gpmon_M_Incr(GpmonPktFromAggState(aggstate), GPMON_AGG_CURRSPILLPASS_TUPLE);
+		Gpmon_M_Add(GpmonPktFromAggState(aggstate), GPMON_AGG_CURRSPILLPASS_BYTE, written_bytes);
 	}
 
+	MemSet(hashtable->buckets, 0, hashtable->nbuckets * sizeof(HashAggBucket));
+	hashtable->nbuckets_used = 0;
+
 	/* Reset the buffer */
 	CdbCellBuf_Reset(&(hashtable->entry_buf));
 	mpool_reset(hashtable->group_buf);
@@ -1580,23 +1713,26 @@ writeHashEntry(AggState *aggstate, BatchFileInfo *file_info,
 
 /*
  * agg_hash_table_stat_upd
- *      collect hash chain statistics for EXPLAIN ANALYZE
+ *      collect hash probe statistics for EXPLAIN ANALYZE
+ *
+ * The probe length of an entry is the number of buckets a lookup of its
+ * group visits, from its home bucket up to the bucket it sits in.
  */
 static void
-agg_hash_table_stat_upd(HashAggTable *ht)
+agg_hash_table_stat_upd(HashAggTable *ht, unsigned hash_bit)
 {
     unsigned int	i;
+    unsigned int	mask = ht->nbuckets - 1;
 
     for (i = 0; i < ht->nbuckets; i++)
     {
-        HashAggEntry   *entry = ht->buckets[i];
-        int             chainlength = 0;
+        HashAggBucket  *bucket = &ht->buckets[i];
+        unsigned int    home;
 
-        if (entry)
+        if (bucket->entry)
         {
-            for (chainlength = 0; entry; chainlength++)
-                entry = entry->next;
-            cdbexplain_agg_upd(&ht->chainlength, chainlength, i);
+            home = (bucket->hashvalue >> hash_bit) & mask;
+            cdbexplain_agg_upd(&ht->probelength, ((i - home) & mask) + 1, i);
         }
     }
 }                               /* agg_hash_table_stat_upd */
@@ -1609,7 +1745,6 @@ void init_agg_hash_iter(HashAggTable* hashtable)
 	Assert( hashtable != NULL && hashtable->buckets != NULL && hashtable->nbuckets > 0 );
 	
 	hashtable->curr_bucket_idx = -1;
-	hashtable->next_entry = NULL;
 }
 
 /* Function: agg_hash_iter
@@ -1625,21 +1760,18 @@ HashAggEntry *
 agg_hash_iter(AggState *aggstate)
 {
 	HashAggTable* hashtable = aggstate->hhashtable;
-	HashAggEntry *entry = hashtable->next_entry;
-	SpillSet *spill_set = hashtable->spill_set;
-	MemoryContext oldcxt;
+	HashAggEntry *entry = NULL;
 
 	Assert( hashtable != NULL && hashtable->buckets != NULL && hashtable->nbuckets > 0 );
 
-	if (hashtable->curr_spill_file != NULL)
-		spill_set = hashtable->curr_spill_file->spill_set;
-	
-	oldcxt = MemoryContextSwitchTo(hashtable->entry_cxt);
-
-	while (entry == NULL &&
-		   hashtable->nbuckets > ++ hashtable->curr_bucket_idx)
+	while (hashtable->nbuckets > ++ hashtable->curr_bucket_idx)
 	{
-		entry = hashtable->buckets[hashtable->curr_bucket_idx];
+		unsigned ahead = hashtable->curr_bucket_idx + HHA_PREFETCH_DISTANCE;
+
+		if (ahead < hashtable->nbuckets && hashtable->buckets[ahead].entry != NULL)
+			hha_prefetch(hashtable->buckets[ahead].entry);
+
+		entry = hashtable->buckets[hashtable->curr_bucket_idx].entry;
 		if (entry != NULL)
 		{
 			Assert(entry->is_primodial);
@@ -1648,13 +1780,7 @@ agg_hash_iter(AggState *aggstate)
 	}
 
 	if (entry != NULL)
-	{
 		hashtable->num_output_groups++;
-		hashtable->next_entry = entry->next;
-		entry->next = NULL;
-	}
-
-	MemoryContextSwitchTo(oldcxt);
 
 	return entry;
 }
@@ -1667,11 +1793,13 @@ agg_hash_iter(AggState *aggstate)
  * The complete format can be found at writeHashEntry(). The size
  * of the byte array is also returned.
  *
- * The byte array is allocated inside the per-tuple memory context.
+ * The byte array either points into the buffer of the batch file, and is
+ * only good until the next read, or, if it is not all in the buffer or
+ * 'copy' is true, is allocated inside the per-tuple memory context.
  */
 static void *
 readHashEntry(AggState *aggstate, BatchFileInfo *file_info,
-			  HashKey *p_hashkey, int32 *p_input_size)
+			  HashKey *p_hashkey, int32 *p_input_size, bool copy)
 {
 	void *tuple_and_aggs = NULL;
 	MemoryContext oldcxt;
@@ -1692,7 +1820,8 @@ readHashEntry(AggState *aggstate, BatchFileInfo *file_info,
 						errmsg("could not read from temporary file: %m")));
 	}
 
-	tuple_and_aggs = ExecWorkFile_ReadFromBuffer(file_info->wfile, *p_input_size);
+	if (!copy)
+		tuple_and_aggs = ExecWorkFile_ReadFromBuffer(file_info->wfile, *p_input_size);
 	if (tuple_and_aggs == NULL)
 	{
 		oldcxt = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
@@ -1747,6 +1876,7 @@ agg_hash_reload(AggState *aggstate)
 	bool has_tuples = false;
 	SpillFile *spill_file = hashtable->curr_spill_file;
 	int reloaded_hash_bit;
+	bool done = false;
 
 	/*
 	 * Record the start value for mem_for_metadata, since its value
@@ -1773,17 +1903,33 @@ agg_hash_reload(AggState *aggstate)
 		hashtable->mem_for_metadata  += FREEABLE_BATCHFILE_METADATA;
 	}
 
-	while(true)
+	while (!done)
 	{
-		HashKey hashkey;
-		HashAggEntry *entry;
-		bool isNew = false;
-		int input_size = 0;
-		
-		void *input = readHashEntry(aggstate, spill_file->file_info, &hashkey, &input_size);
+		HashKey hashkeys[HHA_PREFETCH_BATCH];
+		int32 input_sizes[HHA_PREFETCH_BATCH];
+		void *inputs[HHA_PREFETCH_BATCH];
+		int ninputs;
+		int i;
 
-		if (input != NULL)
+		/*
+		 * Read a batch of records and prefetch their buckets, so that the
+		 * cache misses of the lookups below overlap.  The records are copied
+		 * out of the file buffer, which the next read may overwrite.
+		 */
+		for (ninputs = 0; ninputs < HHA_PREFETCH_BATCH; ninputs++)
 		{
+			HashKey hashkey;
+			int32 input_size = 0;
+			void *input = readHashEntry(aggstate, spill_file->file_info, &hashkey, &input_size, true);
+
+			if (input == NULL)
+			{
+				/* Check we processed all tuples, only when not reading from disk */
+				AssertImply(!aggstate->cached_workfiles_loaded, spill_file->file_info->ntuples == 0);
+				done = true;
+				break;
+			}
+
 			spill_file->file_info->ntuples--;
 			Assert(spill_file->parent_spill_set != NULL);
 			/* The following asserts the mapping between a hashkey bucket and the index in parent.
@@ -1796,89 +1942,97 @@ agg_hash_reload(AggState *aggstate)
 
 			Gpmon_M_Incr(GpmonPktFromAggState(aggstate), GPMON_AGG_CURRSPILLPASS_READTUPLE);
 			Gpmon_M_Add(GpmonPktFromAggState(aggstate), GPMON_AGG_CURRSPILLPASS_READBYTE, input_size);
-		}
 
-		else
-		{
-			/* Check we processed all tuples, only when not reading from disk */
-			AssertImply(!aggstate->cached_workfiles_loaded, spill_file->file_info->ntuples == 0);
-			break;
+			prefetch_agg_hash_bucket(hashtable, hashkey, reloaded_hash_bit);
+
+			hashkeys[ninputs] = hashkey;
+			input_sizes[ninputs] = input_size;
+			inputs[ninputs] = input;
 		}
 
-		has_tuples = true;
+		if (ninputs > 0)
+			has_tuples = true;
 
-		/* set up for advance_aggregates call */
-		tmpcontext->ecxt_scantuple = aggstate->hashslot;
+		for (i = 0; i < ninputs; i++)
+		{
+			HashAggEntry *entry;
+			bool isNew = false;
+			void *input = inputs[i];
+
+			/* set up for advance_aggregates call */
+			tmpcontext->ecxt_scantuple = aggstate->hashslot;
 
-		entry = lookup_agg_hash_entry(aggstate, input, INPUT_RECORD_GROUP_AND_AGGS, input_size,
-									  hashkey, reloaded_hash_bit, &isNew);
+			entry = lookup_agg_hash_entry(aggstate, input, INPUT_RECORD_GROUP_AND_AGGS, input_sizes[i],
+										  hashkeys[i], reloaded_hash_bit, &isNew);
 		
-		if (entry == NULL)
-		{
-			Assert(!aggstate->cached_workfiles_loaded && "no re-spilling allowed when re-using cached workfiles");
-			Assert(hashtable->curr_spill_file != NULL);
-			Assert(hashtable->curr_spill_file->parent_spill_set != NULL);
+			if (entry == NULL)
+			{
+				Assert(!aggstate->cached_workfiles_loaded && "no re-spilling allowed when re-using cached workfiles");
+				Assert(hashtable->curr_spill_file != NULL);
+				Assert(hashtable->curr_spill_file->parent_spill_set != NULL);
 			
-			if (GET_TOTAL_USED_SIZE(hashtable) > hashtable->mem_used)
-				hashtable->mem_used = GET_TOTAL_USED_SIZE(hashtable);
+				if (GET_TOTAL_USED_SIZE(hashtable) > hashtable->mem_used)
+					hashtable->mem_used = GET_TOTAL_USED_SIZE(hashtable);
 
-			if (hashtable->num_ht_groups <= 1)
-				ereport(ERROR,
-						(errcode(ERRCODE_GP_INTERNAL_ERROR),
-								 ERRMSG_GP_INSUFFICIENT_STATEMENT_MEMORY));
+				if (hashtable->num_ht_groups <= 1)
+					ereport(ERROR,
+							(errcode(ERRCODE_GP_INTERNAL_ERROR),
+									 ERRMSG_GP_INSUFFICIENT_STATEMENT_MEMORY));
 
-			/* CDB: Report statistics for EXPLAIN ANALYZE. */
-			if (!hashtable->is_spilling && aggstate->ss.ps.instrument)
-				agg_hash_table_stat_upd(hashtable);
+				/* CDB: Report statistics for EXPLAIN ANALYZE. */
+				if (!hashtable->is_spilling && aggstate->ss.ps.instrument)
+					agg_hash_table_stat_upd(hashtable, reloaded_hash_bit);
 
-			elog(gp_workfile_caching_loglevel, "HashAgg: respill occurring in agg_hash_reload while loading batch data");
+				elog(gp_workfile_caching_loglevel, "HashAgg: respill occurring in agg_hash_reload while loading batch data");
 
-			spill_hash_table(aggstate);
+				spill_hash_table(aggstate);
 
-			entry = lookup_agg_hash_entry(aggstate, input, INPUT_RECORD_GROUP_AND_AGGS, input_size,
-										  hashkey, reloaded_hash_bit, &isNew);
-		}
+				entry = lookup_agg_hash_entry(aggstate, input, INPUT_RECORD_GROUP_AND_AGGS, input_sizes[i],
+											  hashkeys[i], reloaded_hash_bit, &isNew);
+			}
 
-		if (!isNew)
-		{
-			int aggno;
-			AggStatePerGroup input_pergroupstate = (AggStatePerGroup)
-				((char *)input + MAXALIGN(memtuple_get_size((MemTuple) input, mt_bind)));
+			if (!isNew)
+			{
+				int aggno;
+				AggStatePerGroup input_pergroupstate = (AggStatePerGroup)
+					((char *)input + MAXALIGN(memtuple_get_size((MemTuple) input, mt_bind)));
 
-			setGroupAggs(hashtable, mt_bind, entry);
+				setGroupAggs(hashtable, mt_bind, entry);
 
-			adjustInputGroup(aggstate, input, mt_bind);
+				adjustInputGroup(aggstate, input, mt_bind);
 			
-			/* Advance the aggregates for the group by applying preliminary function. */
-			for (aggno = 0; aggno < aggstate->numaggs; aggno++)
-			{
-				AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
-				AggStatePerGroup pergroupstate = &hashtable->groupaggs->aggs[aggno];
-				FunctionCallInfoData fcinfo;
-
-				/* Set the input aggregate values */
-				fcinfo.arg[1] = input_pergroupstate[aggno].transValue;
-				fcinfo.argnull[1] = input_pergroupstate[aggno].transValueIsNull;
-
-				pergroupstate->transValue =
-					invoke_agg_trans_func(&(peraggstate->prelimfn),
-							peraggstate->prelimfn.fn_nargs - 1,
-							pergroupstate->transValue,
-							&(pergroupstate->noTransValue),
-							&(pergroupstate->transValueIsNull),
-							peraggstate->transtypeByVal,
-							peraggstate->transtypeLen,
-							&fcinfo, (void *)aggstate,
-							aggstate->tmpcontext->ecxt_per_tuple_memory,
-							&(aggstate->mem_manager));
-				Assert(peraggstate->transtypeByVal ||
-				       (pergroupstate->transValueIsNull ||
-					PointerIsValid(DatumGetPointer(pergroupstate->transValue))));
+				/* Advance the aggregates for the group by applying preliminary function. */
+				for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+				{
+					AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
+					AggStatePerGroup pergroupstate = &hashtable->groupaggs->aggs[aggno];
+					FunctionCallInfoData fcinfo;
+
+					/* Set the input aggregate values */
+					fcinfo.arg[1] = input_pergroupstate[aggno].transValue;
+					fcinfo.argnull[1] = input_pergroupstate[aggno].transValueIsNull;
+
+					pergroupstate->transValue =
+						invoke_agg_trans_func(&(peraggstate->prelimfn),
+								peraggstate->prelimfn.fn_nargs - 1,
+								pergroupstate->transValue,
+								&(pergroupstate->noTransValue),
+								&(pergroupstate->transValueIsNull),
+								peraggstate->transtypeByVal,
+								peraggstate->transtypeLen,
+								&fcinfo, (void *)aggstate,
+								aggstate->tmpcontext->ecxt_per_tuple_memory,
+								&(aggstate->mem_manager));
+					Assert(peraggstate->transtypeByVal ||
+					       (pergroupstate->transValueIsNull ||
+						PointerIsValid(DatumGetPointer(pergroupstate->transValue))));
 				       
+				}
 			}
-		}
 		
-		/* Reset per-input-tuple context after each tuple */
+		}
+
+		/* Reset per-input-tuple context after each batch */
 		ResetExprContext(tmpcontext);
 	}
 
@@ -1916,7 +2070,7 @@ agg_hash_reload(AggState *aggstate)
 
 	/* CDB: Report statistics for EXPLAIN ANALYZE. */
 	if (!hashtable->is_spilling && aggstate->ss.ps.instrument)
-		agg_hash_table_stat_upd(hashtable);
+		agg_hash_table_stat_upd(hashtable, reloaded_hash_bit);
 
 	return has_tuples;
 }
@@ -2138,14 +2292,14 @@ agg_hash_next_pass(AggState *aggstate)
 
 		appendStringInfo(hbuf, ".\n");
 
-        /* Hash chain statistics */
-        if (hashtable->chainlength.vcnt > 0)
+        /* Hash probe statistics */
+        if (hashtable->probelength.vcnt > 0)
             appendStringInfo(hbuf,
-                             "Hash chain length %.1f avg, %.0f max,"
+                             "Hash probe length %.1f avg, %.0f max,"
                              " using %d of " INT64_FORMAT " buckets.\n",
-                             cdbexplain_agg_avg(&hashtable->chainlength),
-                             hashtable->chainlength.vmax,
-                             hashtable->chainlength.vcnt,
+                             cdbexplain_agg_avg(&hashtable->probelength),
+                             hashtable->probelength.vmax,
+                             hashtable->probelength.vcnt,
                              hashtable->total_buckets);
 	}
 	
@@ -2165,8 +2319,8 @@ void reset_agg_hash_table(AggState *aggstate)
 		"HashAgg: resetting " INT64_FORMAT "-entry hash table",
 		hashtable->num_ht_groups);
 	
-	MemSet(hashtable->buckets, 0, hashtable->nbuckets * sizeof(HashAggEntry*));
-	MemSet(hashtable->bloom, 0, hashtable->nbuckets * sizeof(uint64));
+	MemSet(hashtable->buckets, 0, hashtable->nbuckets * sizeof(HashAggBucket));
+	hashtable->nbuckets_used = 0;
 	hashtable->num_ht_groups = 0;
 
 	CdbCellBuf_Reset(&(hashtable->entry_buf));
@@ -2205,7 +2359,6 @@ void destroy_agg_hash_table(AggState *aggstate)
 
 		/* destroy_batches(aggstate->hhashtable); */
 		pfree(aggstate->hhashtable->buckets);
-		pfree(aggstate->hhashtable->bloom);
 		if (aggstate->hhashtable->hashkey_buf)
 			pfree(aggstate->hhashtable->hashkey_buf);
 
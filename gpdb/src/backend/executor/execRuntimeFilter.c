@@ -0,0 +1,405 @@
+/*-------------------------------------------------------------------------
+ *
+ * execRuntimeFilter.c
+ *	  Runtime join filters built by a Hash node and applied by the scans
+ *	  on the probe side of its hash join.  See execRuntimeFilter.h.
+ *
+ * Each filtered hash key keeps a bloom filter of the hash values of the
+ * inner key values, computed with the hash function of the join, so that
+ * the scan tests exactly what the probe would; integer keys also keep the
+ * smallest and largest inner value.  A key whose bloom filter came out too
+ * full, or that turns out to reject too few rows, stops being tested.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "executor/execRuntimeFilter.h"
+#include "executor/executor.h"
+#include "parser/parse_expr.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/* Bloom filter size bounds, in bits; powers of 2 */
+#define RF_MIN_BLOOM_BITS	(1 << 12)
+#define RF_MAX_BLOOM_BITS	(1 << 25)
+
+/* Bloom filter bits per expected inner row */
+#define RF_BITS_PER_ROW		8
+
+/* Stop testing a key that rejects less than 1/RF_MIN_REJECT_RATIO of the
+ * first RF_SAMPLE_ROWS rows it sees */
+#define RF_SAMPLE_ROWS		16384
+#define RF_MIN_REJECT_RATIO	32
+
+/* One filtered hash key */
+typedef struct RuntimeFilterKey
+{
+	RuntimeFilter *filter;		/* the filter the key belongs to */
+
+	/* Build side */
+	ExprState  *innerkey;		/* inner hash key */
+	FmgrInfo	hashfn;			/* hash function of the join operator */
+
+	/*
+	 * Probe side.  scanvar points into the target list of the scan, where a
+	 * dynamic table scan renumbers it for each partition.
+	 */
+	Var		   *scanvar;
+
+	/* Range of the inner values, if useMinMax */
+	bool		useMinMax;
+	int64		min;
+	int64		max;
+
+	/* Bloom filter of the hashes of the inner values, if useBloom */
+	bool		useBloom;
+	uint64	   *bloom;
+	uint32		bloomMask;		/* number of bits - 1 */
+
+	uint64		nvalues;		/* inner values added */
+	uint64		nprobed;		/* scan values tested */
+	uint64		nrejected;		/* scan values rejected */
+	bool		disabled;		/* given up on this key? */
+} RuntimeFilterKey;
+
+struct RuntimeFilter
+{
+	bool		ready;			/* published? */
+	List	   *keys;			/* RuntimeFilterKeys */
+	uint32		bloomBits;		/* size of each bloom filter */
+};
+
+static bool
+RuntimeFilterIntType(Oid typid)
+{
+	return (typid == INT2OID || typid == INT4OID || typid == INT8OID);
+}
+
+static int64
+RuntimeFilterIntValue(Datum value, Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+			return (int64) DatumGetInt16(value);
+		case INT4OID:
+			return (int64) DatumGetInt32(value);
+		default:
+			Assert(typid == INT8OID);
+			return DatumGetInt64(value);
+	}
+}
+
+/*
+ * The two bits of a hash value in a bloom filter.  The second is taken from
+ * the other half of the hash so the two are independent for filters of up
+ * to 2^16 bits, and nearly so beyond.
+ */
+#define RF_BLOOM_BIT1(h, mask)	((h) & (mask))
+#define RF_BLOOM_BIT2(h, mask)	((((h) >> 16) | ((h) << 16)) * 0x9E3779B1U & (mask))
+
+#define RF_BLOOM_SET(bloom, bit)	((bloom)[(bit) >> 6] |= ((uint64) 1) << ((bit) & 63))
+#define RF_BLOOM_TEST(bloom, bit)	(((bloom)[(bit) >> 6] >> ((bit) & 63)) & 1)
+
+/*
+ * Find the scan producing the given output column of a node on the outer
+ * side of an inner hash join.  Returns the Var of the scanned relation the
+ * column comes from, and sets *scan to the scan, or returns NULL.
+ */
+static Var *
+RuntimeFilterFindScanVar(PlanState *ps, AttrNumber attno, ScanState **scan)
+{
+	while (ps != NULL)
+	{
+		TargetEntry *tle;
+		Expr	   *expr;
+
+		if (attno <= 0 || attno > list_length(ps->plan->targetlist))
+			return NULL;
+
+		tle = (TargetEntry *) list_nth(ps->plan->targetlist, attno - 1);
+		expr = tle->expr;
+		while (expr && IsA(expr, RelabelType))
+			expr = ((RelabelType *) expr)->arg;
+		if (expr == NULL || !IsA(expr, Var))
+			return NULL;
+
+		switch (nodeTag(ps))
+		{
+			case T_TableScanState:
+			case T_AOCSScanState:
+			case T_DynamicTableScanState:
+				if (((Var *) expr)->varno != ((Scan *) ps->plan)->scanrelid ||
+					((Var *) expr)->varattno <= 0 ||
+					((Var *) expr)->varlevelsup != 0)
+					return NULL;
+				*scan = (ScanState *) ps;
+				return (Var *) expr;
+
+			case T_HashJoinState:
+				{
+					HashJoinState *hjstate = (HashJoinState *) ps;
+
+					/* Outer rows that can't match above can't match here */
+					if ((hjstate->js.jointype != JOIN_INNER &&
+						 hjstate->js.jointype != JOIN_IN) ||
+						((Var *) expr)->varno != OUTER)
+						return NULL;
+					attno = ((Var *) expr)->varattno;
+					ps = outerPlanState(ps);
+				}
+				break;
+
+			default:
+				return NULL;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * ExecInitRuntimeFilter
+ *   Set up the runtime filter of a hash join, see execRuntimeFilter.h.
+ */
+RuntimeFilter *
+ExecInitRuntimeFilter(HashJoinState *hjstate,
+					  List *outerkeys,
+					  List *innerkeys,
+					  List *hashoperators)
+{
+	RuntimeFilter *filter;
+	ListCell   *lo;
+	ListCell   *li;
+	ListCell   *lh;
+	double		innerrows;
+
+	if (hjstate->js.jointype != JOIN_INNER && hjstate->js.jointype != JOIN_IN)
+		return NULL;
+	if (hjstate->hj_nonequijoin)
+		return NULL;
+
+	filter = (RuntimeFilter *) palloc0(sizeof(RuntimeFilter));
+
+	/* Size the bloom filters for the expected number of inner rows. */
+	innerrows = innerPlanState(hjstate)->plan->plan_rows;
+	filter->bloomBits = RF_MIN_BLOOM_BITS;
+	while (filter->bloomBits < RF_MAX_BLOOM_BITS &&
+		   filter->bloomBits < innerrows * RF_BITS_PER_ROW)
+		filter->bloomBits *= 2;
+
+	lh = list_head(hashoperators);
+	forboth(lo, outerkeys, li, innerkeys)
+	{
+		ExprState  *outerkey = (ExprState *) lfirst(lo);
+		ExprState  *innerkey = (ExprState *) lfirst(li);
+		Oid			hashop = lfirst_oid(lh);
+		Expr	   *expr = outerkey->expr;
+		ScanState  *scan = NULL;
+		Var		   *scanvar;
+		RuntimeFilterKey *key;
+		Oid			hashfn;
+
+		lh = lnext(lh);
+
+		while (IsA(expr, RelabelType))
+			expr = ((RelabelType *) expr)->arg;
+		if (!IsA(expr, Var) || ((Var *) expr)->varno != OUTER)
+			continue;
+
+		/* A NULL must not be able to match. */
+		if (!op_strict(hashop))
+			continue;
+		hashfn = get_op_hash_function(hashop);
+		if (!OidIsValid(hashfn))
+			continue;
+
+		scanvar = RuntimeFilterFindScanVar(outerPlanState(hjstate),
+										   ((Var *) expr)->varattno,
+										   &scan);
+		if (scanvar == NULL)
+			continue;
+
+		key = (RuntimeFilterKey *) palloc0(sizeof(RuntimeFilterKey));
+		key->filter = filter;
+		key->innerkey = innerkey;
+		fmgr_info(hashfn, &key->hashfn);
+		key->scanvar = scanvar;
+		key->useMinMax = (RuntimeFilterIntType(scanvar->vartype) &&
+						  RuntimeFilterIntType(exprType((Node *) innerkey->expr)));
+		key->bloomMask = filter->bloomBits - 1;
+
+		filter->keys = lappend(filter->keys, key);
+		scan->ss_runtimeFilters = lappend(scan->ss_runtimeFilters, key);
+	}
+
+	if (filter->keys == NIL)
+	{
+		pfree(filter);
+		return NULL;
+	}
+
+	ExecRuntimeFilterReset(filter);
+
+	return filter;
+}
+
+/*
+ * ExecRuntimeFilterReset
+ *   Withdraw the filter and clear it for a new build.
+ */
+void
+ExecRuntimeFilterReset(RuntimeFilter *filter)
+{
+	ListCell   *lc;
+
+	filter->ready = false;
+
+	foreach(lc, filter->keys)
+	{
+		RuntimeFilterKey *key = (RuntimeFilterKey *) lfirst(lc);
+
+		if (key->bloom == NULL)
+			key->bloom = (uint64 *) palloc0(filter->bloomBits / 8);
+		else
+			memset(key->bloom, 0, filter->bloomBits / 8);
+		key->useBloom = true;
+		key->min = 0;
+		key->max = 0;
+		key->nvalues = 0;
+		key->nprobed = 0;
+		key->nrejected = 0;
+		key->disabled = false;
+	}
+}
+
+/*
+ * ExecRuntimeFilterAdd
+ *   Add the inner row in econtext->ecxt_innertuple to the filter.
+ *
+ * Called by the Hash node for each row it puts in the hash table, right
+ * after ExecHashGetHashValue, so the row has no NULL key.
+ */
+void
+ExecRuntimeFilterAdd(RuntimeFilter *filter, ExprContext *econtext)
+{
+	ListCell   *lc;
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	foreach(lc, filter->keys)
+	{
+		RuntimeFilterKey *key = (RuntimeFilterKey *) lfirst(lc);
+		Datum		value;
+		bool		isNull;
+		uint32		h;
+
+		value = ExecEvalExpr(key->innerkey, econtext, &isNull, NULL);
+		if (isNull)
+			continue;
+
+		if (key->useMinMax)
+		{
+			int64		v = RuntimeFilterIntValue(value,
+												  exprType((Node *) key->innerkey->expr));
+
+			if (key->nvalues == 0 || v < key->min)
+				key->min = v;
+			if (key->nvalues == 0 || v > key->max)
+				key->max = v;
+		}
+		key->nvalues++;
+
+		h = DatumGetUInt32(FunctionCall1(&key->hashfn, value));
+		RF_BLOOM_SET(key->bloom, RF_BLOOM_BIT1(h, key->bloomMask));
+		RF_BLOOM_SET(key->bloom, RF_BLOOM_BIT2(h, key->bloomMask));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * ExecRuntimeFilterPublish
+ *   Make the filter visible to the scans once all inner rows are added.
+ *
+ * A bloom filter with less than two bits per value passes too many rows to
+ * be worth testing; the range of such a key may still be useful.
+ */
+void
+ExecRuntimeFilterPublish(RuntimeFilter *filter)
+{
+	ListCell   *lc;
+
+	foreach(lc, filter->keys)
+	{
+		RuntimeFilterKey *key = (RuntimeFilterKey *) lfirst(lc);
+
+		if (key->nvalues > filter->bloomBits / 2)
+			key->useBloom = false;
+		if (!key->useBloom && !key->useMinMax)
+			key->disabled = true;
+	}
+
+	filter->ready = true;
+}
+
+/*
+ * ExecRuntimeFilterPass
+ *   Can the scan tuple in slot match any inner row of the published
+ *   filters in keys?
+ */
+bool
+ExecRuntimeFilterPass(List *keys, TupleTableSlot *slot, ExprContext *econtext)
+{
+	ListCell   *lc;
+	bool		pass = true;
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	foreach(lc, keys)
+	{
+		RuntimeFilterKey *key = (RuntimeFilterKey *) lfirst(lc);
+		Datum		value;
+		bool		isNull;
+
+		if (!key->filter->ready || key->disabled)
+			continue;
+
+		value = slot_getattr(slot, key->scanvar->varattno, &isNull);
+
+		key->nprobed++;
+
+		if (isNull || key->nvalues == 0)
+			pass = false;
+		else if (key->useMinMax &&
+				 (RuntimeFilterIntValue(value, key->scanvar->vartype) < key->min ||
+				  RuntimeFilterIntValue(value, key->scanvar->vartype) > key->max))
+			pass = false;
+		else if (key->useBloom)
+		{
+			uint32		h = DatumGetUInt32(FunctionCall1(&key->hashfn, value));
+
+			if (!RF_BLOOM_TEST(key->bloom, RF_BLOOM_BIT1(h, key->bloomMask)) ||
+				!RF_BLOOM_TEST(key->bloom, RF_BLOOM_BIT2(h, key->bloomMask)))
+				pass = false;
+		}
+
+		if (!pass)
+			key->nrejected++;
+
+		if (key->nprobed == RF_SAMPLE_ROWS &&
+			key->nrejected < RF_SAMPLE_ROWS / RF_MIN_REJECT_RATIO)
+			key->disabled = true;
+
+		if (!pass)
+			break;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return pass;
+}
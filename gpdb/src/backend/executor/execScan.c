@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/execRuntimeFilter.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 #include "utils/debugbreak.h"
@@ -93,18 +94,20 @@ ExecScan(ScanState *node,
 	ExprContext *econtext;
 	List	   *qual;
 	ProjectionInfo *projInfo;
+	List	   *runtimeFilters;
 
 	/*
 	 * Fetch data from node
 	 */
 	qual = node->ps.qual;
 	projInfo = node->ps.ps_ProjInfo;
+	runtimeFilters = node->ss_runtimeFilters;
 
 	/*
 	 * If we have neither a qual to check nor a projection to do, just skip
 	 * all the overhead and return the raw scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && !runtimeFilters)
 		return (*accessMtd) (node);
 
 	/*
@@ -148,6 +151,16 @@ ExecScan(ScanState *node,
 		 */
 		econtext->ecxt_scantuple = slot;
 
+		/*
+		 * CDB: drop the tuple early if a hash join above can't match it.
+		 */
+		if (runtimeFilters &&
+			!ExecRuntimeFilterPass(runtimeFilters, slot, econtext))
+		{
+			ResetExprContext(econtext);
+			continue;
+		}
+
 		/*
 		 * check that the current tuple satisfies the qual-clause
 		 *
@@ -0,0 +1,978 @@
+/*-------------------------------------------------------------------------
+ *
+ * execVecQual.c
+ *	  Batch-at-a-time evaluation of simple scan quals over column vectors.
+ *
+ * A scan that reads a batch of rows at a time (see aocs_getnextbatch) can
+ * hand the batch to ExecVecQualEval together with a selection vector, and
+ * only form tuples for the rows that survive.  We only handle the handful of
+ * clause shapes that dominate fact table scans:
+ *
+ *		Var op Const, Const op Var		op is = <> < <= > >=
+ *		Var IN (Const, ...)				and Var NOT IN (Const, ...)
+ *		Var IS [NOT] NULL
+ *		AND / OR of the above
+ *
+ * on int2/int4/int8, float4/float8, date and numeric.  The comparison is
+ * recognized by its implementing function, so no fmgr call is made per row.
+ * Everything else is left to ExecQual.
+ *
+ * When the scan knows that runs of rows hold the same value of a column
+ * (RLE_TYPE compressed blocks), a comparison on that column is evaluated
+ * once per run instead of once per row.
+ *
+ * Quals are only ever evaluated at the top level of a WHERE clause, where a
+ * NULL result is as good as false.  That lets us treat NULL as false inside
+ * AND and OR too; we never accept NOT (other than IS NOT NULL) for exactly
+ * that reason.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "catalog/pg_type.h"
+#include "executor/execVecQual.h"
+#include "utils/array.h"
+#include "utils/date.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/numeric.h"
+
+typedef enum VecQualKind
+{
+	VQ_AND,
+	VQ_OR,
+	VQ_CMP,
+	VQ_IN,
+	VQ_NULLTEST,
+	VQ_FALSE					/* e.g. comparison with a NULL constant */
+} VecQualKind;
+
+/* Value domain a comparison is carried out in */
+typedef enum VecQualDomain
+{
+	VQD_INT,					/* int2/int4/int8/date, compared as int64 */
+	VQD_FLOAT,					/* float4/float8, compared as double */
+	VQD_NUMERIC
+} VecQualDomain;
+
+typedef enum VecQualOp
+{
+	VQOP_EQ,
+	VQOP_NE,
+	VQOP_LT,
+	VQOP_LE,
+	VQOP_GT,
+	VQOP_GE
+} VecQualOp;
+
+struct VecQual
+{
+	VecQualKind kind;
+
+	/* VQ_AND, VQ_OR */
+	int			nargs;
+	VecQual   **args;
+	bool	   *pass;			/* VQ_OR scratch, per row of the batch */
+	int		   *subsel;			/* VQ_OR scratch selection vector */
+
+	/* VQ_CMP, VQ_IN, VQ_NULLTEST */
+	int			col;			/* column index in the batch */
+	Oid			coltype;
+
+	/* VQ_CMP, VQ_IN */
+	VecQualDomain domain;
+	VecQualOp	op;
+	int64		ival;
+	double		fval;
+	Numeric		nval;
+
+	/* VQ_IN: sorted (int/float) constant list, useOr false means NOT IN */
+	bool		useOr;
+	int			nvals;
+	int64	   *ivals;
+	double	   *fvals;
+	Numeric    *nvals_arr;
+
+	/* VQ_NULLTEST */
+	bool		isnulltest;		/* IS NULL (true) or IS NOT NULL (false) */
+
+	/* scratch for VQ_CMP/VQ_IN: gathered rows and their values */
+	int		   *rows;
+	int64	   *iscratch;
+	double	   *fscratch;
+};
+
+/*
+ * Comparison functions we know how to evaluate inline.
+ */
+typedef struct VecQualFunc
+{
+	Oid			funcid;
+	VecQualDomain domain;
+	VecQualOp	op;
+} VecQualFunc;
+
+static const VecQualFunc vecQualFuncs[] =
+{
+	{F_INT2EQ, VQD_INT, VQOP_EQ}, {F_INT2NE, VQD_INT, VQOP_NE},
+	{F_INT2LT, VQD_INT, VQOP_LT}, {F_INT2LE, VQD_INT, VQOP_LE},
+	{F_INT2GT, VQD_INT, VQOP_GT}, {F_INT2GE, VQD_INT, VQOP_GE},
+	{F_INT4EQ, VQD_INT, VQOP_EQ}, {F_INT4NE, VQD_INT, VQOP_NE},
+	{F_INT4LT, VQD_INT, VQOP_LT}, {F_INT4LE, VQD_INT, VQOP_LE},
+	{F_INT4GT, VQD_INT, VQOP_GT}, {F_INT4GE, VQD_INT, VQOP_GE},
+	{F_INT8EQ, VQD_INT, VQOP_EQ}, {F_INT8NE, VQD_INT, VQOP_NE},
+	{F_INT8LT, VQD_INT, VQOP_LT}, {F_INT8LE, VQD_INT, VQOP_LE},
+	{F_INT8GT, VQD_INT, VQOP_GT}, {F_INT8GE, VQD_INT, VQOP_GE},
+	{F_INT24EQ, VQD_INT, VQOP_EQ}, {F_INT24NE, VQD_INT, VQOP_NE},
+	{F_INT24LT, VQD_INT, VQOP_LT}, {F_INT24LE, VQD_INT, VQOP_LE},
+	{F_INT24GT, VQD_INT, VQOP_GT}, {F_INT24GE, VQD_INT, VQOP_GE},
+	{F_INT42EQ, VQD_INT, VQOP_EQ}, {F_INT42NE, VQD_INT, VQOP_NE},
+	{F_INT42LT, VQD_INT, VQOP_LT}, {F_INT42LE, VQD_INT, VQOP_LE},
+	{F_INT42GT, VQD_INT, VQOP_GT}, {F_INT42GE, VQD_INT, VQOP_GE},
+	{F_INT28EQ, VQD_INT, VQOP_EQ}, {F_INT28NE, VQD_INT, VQOP_NE},
+	{F_INT28LT, VQD_INT, VQOP_LT}, {F_INT28LE, VQD_INT, VQOP_LE},
+	{F_INT28GT, VQD_INT, VQOP_GT}, {F_INT28GE, VQD_INT, VQOP_GE},
+	{F_INT82EQ, VQD_INT, VQOP_EQ}, {F_INT82NE, VQD_INT, VQOP_NE},
+	{F_INT82LT, VQD_INT, VQOP_LT}, {F_INT82LE, VQD_INT, VQOP_LE},
+	{F_INT82GT, VQD_INT, VQOP_GT}, {F_INT82GE, VQD_INT, VQOP_GE},
+	{F_INT48EQ, VQD_INT, VQOP_EQ}, {F_INT48NE, VQD_INT, VQOP_NE},
+	{F_INT48LT, VQD_INT, VQOP_LT}, {F_INT48LE, VQD_INT, VQOP_LE},
+	{F_INT48GT, VQD_INT, VQOP_GT}, {F_INT48GE, VQD_INT, VQOP_GE},
+	{F_INT84EQ, VQD_INT, VQOP_EQ}, {F_INT84NE, VQD_INT, VQOP_NE},
+	{F_INT84LT, VQD_INT, VQOP_LT}, {F_INT84LE, VQD_INT, VQOP_LE},
+	{F_INT84GT, VQD_INT, VQOP_GT}, {F_INT84GE, VQD_INT, VQOP_GE},
+	{F_DATE_EQ, VQD_INT, VQOP_EQ}, {F_DATE_NE, VQD_INT, VQOP_NE},
+	{F_DATE_LT, VQD_INT, VQOP_LT}, {F_DATE_LE, VQD_INT, VQOP_LE},
+	{F_DATE_GT, VQD_INT, VQOP_GT}, {F_DATE_GE, VQD_INT, VQOP_GE},
+	{F_FLOAT4EQ, VQD_FLOAT, VQOP_EQ}, {F_FLOAT4NE, VQD_FLOAT, VQOP_NE},
+	{F_FLOAT4LT, VQD_FLOAT, VQOP_LT}, {F_FLOAT4LE, VQD_FLOAT, VQOP_LE},
+	{F_FLOAT4GT, VQD_FLOAT, VQOP_GT}, {F_FLOAT4GE, VQD_FLOAT, VQOP_GE},
+	{F_FLOAT8EQ, VQD_FLOAT, VQOP_EQ}, {F_FLOAT8NE, VQD_FLOAT, VQOP_NE},
+	{F_FLOAT8LT, VQD_FLOAT, VQOP_LT}, {F_FLOAT8LE, VQD_FLOAT, VQOP_LE},
+	{F_FLOAT8GT, VQD_FLOAT, VQOP_GT}, {F_FLOAT8GE, VQD_FLOAT, VQOP_GE},
+	{F_FLOAT48EQ, VQD_FLOAT, VQOP_EQ}, {F_FLOAT48NE, VQD_FLOAT, VQOP_NE},
+	{F_FLOAT48LT, VQD_FLOAT, VQOP_LT}, {F_FLOAT48LE, VQD_FLOAT, VQOP_LE},
+	{F_FLOAT48GT, VQD_FLOAT, VQOP_GT}, {F_FLOAT48GE, VQD_FLOAT, VQOP_GE},
+	{F_FLOAT84EQ, VQD_FLOAT, VQOP_EQ}, {F_FLOAT84NE, VQD_FLOAT, VQOP_NE},
+	{F_FLOAT84LT, VQD_FLOAT, VQOP_LT}, {F_FLOAT84LE, VQD_FLOAT, VQOP_LE},
+	{F_FLOAT84GT, VQD_FLOAT, VQOP_GT}, {F_FLOAT84GE, VQD_FLOAT, VQOP_GE},
+	{F_NUMERIC_EQ, VQD_NUMERIC, VQOP_EQ}, {F_NUMERIC_NE, VQD_NUMERIC, VQOP_NE},
+	{F_NUMERIC_LT, VQD_NUMERIC, VQOP_LT}, {F_NUMERIC_LE, VQD_NUMERIC, VQOP_LE},
+	{F_NUMERIC_GT, VQD_NUMERIC, VQOP_GT}, {F_NUMERIC_GE, VQD_NUMERIC, VQOP_GE},
+};
+
+static const VecQualFunc *
+lookup_vecqual_func(Oid funcid)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(vecQualFuncs); i++)
+	{
+		if (vecQualFuncs[i].funcid == funcid)
+			return &vecQualFuncs[i];
+	}
+	return NULL;
+}
+
+static bool
+vecqual_type_ok(Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* Commute the sense of a comparison, for Const op Var */
+static VecQualOp
+vecqual_commute(VecQualOp op)
+{
+	switch (op)
+	{
+		case VQOP_LT: return VQOP_GT;
+		case VQOP_LE: return VQOP_GE;
+		case VQOP_GT: return VQOP_LT;
+		case VQOP_GE: return VQOP_LE;
+		default: return op;
+	}
+}
+
+static inline int64
+vecqual_get_int(Oid typid, Datum d)
+{
+	switch (typid)
+	{
+		case INT2OID: return (int64) DatumGetInt16(d);
+		case INT4OID: return (int64) DatumGetInt32(d);
+		case DATEOID: return (int64) DatumGetDateADT(d);
+		default:
+			Assert(typid == INT8OID);
+			return DatumGetInt64(d);
+	}
+}
+
+static inline double
+vecqual_get_float(Oid typid, Datum d)
+{
+	if (typid == FLOAT4OID)
+		return (double) DatumGetFloat4(d);
+	Assert(typid == FLOAT8OID);
+	return DatumGetFloat8(d);
+}
+
+/* Same ordering as float8_cmp_internal: NaN is equal to NaN and above all */
+static inline int
+vecqual_float_cmp(double a, double b)
+{
+	if (isnan(a))
+		return isnan(b) ? 0 : 1;
+	if (isnan(b))
+		return -1;
+	return (a > b) ? 1 : ((a < b) ? -1 : 0);
+}
+
+static int
+vecqual_int64_cmp(const void *a, const void *b)
+{
+	int64		x = *(const int64 *) a;
+	int64		y = *(const int64 *) b;
+
+	return (x > y) ? 1 : ((x < y) ? -1 : 0);
+}
+
+static int
+vecqual_double_cmp(const void *a, const void *b)
+{
+	return vecqual_float_cmp(*(const double *) a, *(const double *) b);
+}
+
+/*
+ * Match a Var of the scanned relation that is part of the batch.
+ */
+static Var *
+vecqual_var(Node *node, Index scanrelid, int *attmap, int natts)
+{
+	Var		   *var;
+
+	if (node == NULL || !IsA(node, Var))
+		return NULL;
+
+	var = (Var *) node;
+	if (var->varno != scanrelid || var->varlevelsup != 0 ||
+		var->varattno <= 0 || var->varattno > natts ||
+		attmap[var->varattno - 1] < 0 ||
+		!vecqual_type_ok(var->vartype))
+		return NULL;
+
+	return var;
+}
+
+bool
+ExecVecQualSupported(Expr *clause, Index scanrelid, int *attmap, int natts)
+{
+	if (clause == NULL)
+		return false;
+
+	switch (nodeTag(clause))
+	{
+		case T_OpExpr:
+			{
+				OpExpr	   *op = (OpExpr *) clause;
+				Node	   *larg;
+				Node	   *rarg;
+				Node	   *carg;
+
+				if (list_length(op->args) != 2 ||
+					lookup_vecqual_func(op->opfuncid) == NULL)
+					return false;
+
+				larg = (Node *) linitial(op->args);
+				rarg = (Node *) lsecond(op->args);
+
+				if (vecqual_var(larg, scanrelid, attmap, natts))
+					carg = rarg;
+				else if (vecqual_var(rarg, scanrelid, attmap, natts))
+					carg = larg;
+				else
+					return false;
+
+				return IsA(carg, Const) && vecqual_type_ok(((Const *) carg)->consttype);
+			}
+
+		case T_ScalarArrayOpExpr:
+			{
+				ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) clause;
+				const VecQualFunc *f = lookup_vecqual_func(saop->opfuncid);
+				Node	   *aarg;
+
+				if (f == NULL || list_length(saop->args) != 2)
+					return false;
+
+				/* IN (...) and NOT IN (...) only */
+				if (!((saop->useOr && f->op == VQOP_EQ) ||
+					  (!saop->useOr && f->op == VQOP_NE)))
+					return false;
+
+				if (!vecqual_var((Node *) linitial(saop->args), scanrelid, attmap, natts))
+					return false;
+
+				aarg = (Node *) lsecond(saop->args);
+				return IsA(aarg, Const) &&
+					vecqual_type_ok(get_element_type(((Const *) aarg)->consttype));
+			}
+
+		case T_NullTest:
+			{
+				NullTest   *ntest = (NullTest *) clause;
+
+				return vecqual_var((Node *) ntest->arg, scanrelid, attmap, natts) != NULL;
+			}
+
+		case T_BoolExpr:
+			{
+				BoolExpr   *bexpr = (BoolExpr *) clause;
+				ListCell   *lc;
+
+				if (bexpr->boolop == NOT_EXPR)
+					return false;
+
+				foreach(lc, bexpr->args)
+				{
+					if (!ExecVecQualSupported((Expr *) lfirst(lc), scanrelid, attmap, natts))
+						return false;
+				}
+				return true;
+			}
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Convert a constant to the comparison domain of a clause.
+ */
+static void
+vecqual_set_const(VecQual *vq, Oid consttype, Datum value)
+{
+	switch (vq->domain)
+	{
+		case VQD_INT:
+			vq->ival = vecqual_get_int(consttype, value);
+			break;
+		case VQD_FLOAT:
+			vq->fval = vecqual_get_float(consttype, value);
+			break;
+		case VQD_NUMERIC:
+			vq->nval = DatumGetNumericCopy(value);
+			break;
+	}
+}
+
+static VecQual *
+vecqual_make(VecQualKind kind, int maxrows)
+{
+	VecQual    *vq = palloc0(sizeof(VecQual));
+
+	vq->kind = kind;
+	if (kind == VQ_CMP || kind == VQ_IN)
+	{
+		vq->rows = palloc(sizeof(int) * maxrows);
+		vq->iscratch = palloc(sizeof(int64) * maxrows);
+		vq->fscratch = palloc(sizeof(double) * maxrows);
+	}
+	return vq;
+}
+
+static VecQual *
+vecqual_compile_bool(VecQualKind kind, List *args, Index scanrelid,
+					 int *attmap, int natts, int maxrows);
+
+static VecQual *
+vecqual_compile(Expr *clause, Index scanrelid, int *attmap, int natts, int maxrows)
+{
+	VecQual    *vq;
+
+	switch (nodeTag(clause))
+	{
+		case T_OpExpr:
+			{
+				OpExpr	   *op = (OpExpr *) clause;
+				const VecQualFunc *f = lookup_vecqual_func(op->opfuncid);
+				Var		   *var;
+				Const	   *con;
+				VecQualOp	cmp = f->op;
+
+				var = vecqual_var((Node *) linitial(op->args), scanrelid, attmap, natts);
+				if (var)
+					con = (Const *) lsecond(op->args);
+				else
+				{
+					var = (Var *) lsecond(op->args);
+					con = (Const *) linitial(op->args);
+					cmp = vecqual_commute(cmp);
+				}
+
+				/* Comparisons are strict: a NULL constant never matches */
+				if (con->constisnull)
+					return vecqual_make(VQ_FALSE, maxrows);
+
+				vq = vecqual_make(VQ_CMP, maxrows);
+				vq->col = attmap[var->varattno - 1];
+				vq->coltype = var->vartype;
+				vq->domain = f->domain;
+				vq->op = cmp;
+				vecqual_set_const(vq, con->consttype, con->constvalue);
+				return vq;
+			}
+
+		case T_ScalarArrayOpExpr:
+			{
+				ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) clause;
+				const VecQualFunc *f = lookup_vecqual_func(saop->opfuncid);
+				Var		   *var = (Var *) linitial(saop->args);
+				Const	   *con = (Const *) lsecond(saop->args);
+				ArrayType  *arr;
+				Oid			elemtype;
+				int16		elmlen;
+				bool		elmbyval;
+				char		elmalign;
+				Datum	   *elems;
+				bool	   *elemnulls;
+				int			nelems;
+				int			i;
+
+				if (con->constisnull)
+					return vecqual_make(VQ_FALSE, maxrows);
+
+				arr = DatumGetArrayTypeP(con->constvalue);
+				elemtype = ARR_ELEMTYPE(arr);
+				get_typlenbyvalalign(elemtype, &elmlen, &elmbyval, &elmalign);
+				deconstruct_array(arr, elemtype, elmlen, elmbyval, elmalign,
+								  &elems, &elemnulls, &nelems);
+
+				vq = vecqual_make(VQ_IN, maxrows);
+				vq->col = attmap[var->varattno - 1];
+				vq->coltype = var->vartype;
+				vq->domain = f->domain;
+				vq->useOr = saop->useOr;
+
+				switch (vq->domain)
+				{
+					case VQD_INT:
+						vq->ivals = palloc(sizeof(int64) * Max(nelems, 1));
+						break;
+					case VQD_FLOAT:
+						vq->fvals = palloc(sizeof(double) * Max(nelems, 1));
+						break;
+					case VQD_NUMERIC:
+						vq->nvals_arr = palloc(sizeof(Numeric) * Max(nelems, 1));
+						break;
+				}
+
+				for (i = 0; i < nelems; i++)
+				{
+					/*
+					 * A NULL in an IN list can never make a row pass, and a
+					 * NULL in a NOT IN list means no row can pass.
+					 */
+					if (elemnulls[i])
+					{
+						if (!vq->useOr)
+						{
+							pfree(vq);
+							return vecqual_make(VQ_FALSE, maxrows);
+						}
+						continue;
+					}
+
+					switch (vq->domain)
+					{
+						case VQD_INT:
+							vq->ivals[vq->nvals] = vecqual_get_int(elemtype, elems[i]);
+							break;
+						case VQD_FLOAT:
+							vq->fvals[vq->nvals] = vecqual_get_float(elemtype, elems[i]);
+							break;
+						case VQD_NUMERIC:
+							vq->nvals_arr[vq->nvals] = DatumGetNumericCopy(elems[i]);
+							break;
+					}
+					vq->nvals++;
+				}
+
+				if (vq->domain == VQD_INT)
+					qsort(vq->ivals, vq->nvals, sizeof(int64), vecqual_int64_cmp);
+				else if (vq->domain == VQD_FLOAT)
+					qsort(vq->fvals, vq->nvals, sizeof(double), vecqual_double_cmp);
+
+				return vq;
+			}
+
+		case T_NullTest:
+			{
+				NullTest   *ntest = (NullTest *) clause;
+				Var		   *var = (Var *) ntest->arg;
+
+				vq = vecqual_make(VQ_NULLTEST, maxrows);
+				vq->col = attmap[var->varattno - 1];
+				vq->coltype = var->vartype;
+				vq->isnulltest = (ntest->nulltesttype == IS_NULL);
+				return vq;
+			}
+
+		case T_BoolExpr:
+			{
+				BoolExpr   *bexpr = (BoolExpr *) clause;
+
+				Assert(bexpr->boolop != NOT_EXPR);
+				return vecqual_compile_bool(bexpr->boolop == AND_EXPR ? VQ_AND : VQ_OR,
+											bexpr->args, scanrelid, attmap, natts, maxrows);
+			}
+
+		default:
+			elog(ERROR, "unexpected node type %d in vectorized qual", (int) nodeTag(clause));
+			return NULL;		/* keep compiler quiet */
+	}
+}
+
+static VecQual *
+vecqual_compile_bool(VecQualKind kind, List *args, Index scanrelid,
+					 int *attmap, int natts, int maxrows)
+{
+	VecQual    *vq = vecqual_make(kind, maxrows);
+	ListCell   *lc;
+	int			i = 0;
+
+	vq->nargs = list_length(args);
+	vq->args = palloc(sizeof(VecQual *) * vq->nargs);
+	foreach(lc, args)
+		vq->args[i++] = vecqual_compile((Expr *) lfirst(lc), scanrelid, attmap, natts, maxrows);
+
+	if (kind == VQ_OR)
+	{
+		vq->pass = palloc0(sizeof(bool) * maxrows);
+		vq->subsel = palloc(sizeof(int) * maxrows);
+	}
+
+	return vq;
+}
+
+VecQual *
+ExecVecQualCompile(List *clauses, Index scanrelid, int *attmap, int natts, int maxrows)
+{
+	if (clauses == NIL)
+		return NULL;
+
+	if (list_length(clauses) == 1)
+		return vecqual_compile((Expr *) linitial(clauses), scanrelid, attmap, natts, maxrows);
+
+	return vecqual_compile_bool(VQ_AND, clauses, scanrelid, attmap, natts, maxrows);
+}
+
+/*
+ * Filter the gathered rows/values of a VQ_CMP node.  Written as a macro so
+ * that each (domain, op) pair gets its own branch-free inner loop.
+ */
+#define VECQUAL_FILTER(n, cond) \
+	do { \
+		int		_i; \
+		for (_i = 0; _i < (n); _i++) \
+		{ \
+			sel[nout] = rows[_i]; \
+			nout += (cond) ? 1 : 0; \
+		} \
+	} while (0)
+
+static int
+vecqual_eval_cmp(VecQual *vq, Datum **datum, bool **isnull, int *sel, int nsel)
+{
+	int		   *rows = vq->rows;
+	int			col = vq->col;
+	int			n = 0;
+	int			nout = 0;
+	int			i;
+
+	switch (vq->domain)
+	{
+		case VQD_INT:
+			{
+				int64	   *v = vq->iscratch;
+				int64		k = vq->ival;
+
+				for (i = 0; i < nsel; i++)
+				{
+					int			r = sel[i];
+
+					if (isnull[r][col])
+						continue;
+					rows[n] = r;
+					v[n++] = vecqual_get_int(vq->coltype, datum[r][col]);
+				}
+
+				switch (vq->op)
+				{
+					case VQOP_EQ: VECQUAL_FILTER(n, v[_i] == k); break;
+					case VQOP_NE: VECQUAL_FILTER(n, v[_i] != k); break;
+					case VQOP_LT: VECQUAL_FILTER(n, v[_i] < k); break;
+					case VQOP_LE: VECQUAL_FILTER(n, v[_i] <= k); break;
+					case VQOP_GT: VECQUAL_FILTER(n, v[_i] > k); break;
+					case VQOP_GE: VECQUAL_FILTER(n, v[_i] >= k); break;
+				}
+				break;
+			}
+
+		case VQD_FLOAT:
+			{
+				double	   *v = vq->fscratch;
+				double		k = vq->fval;
+
+				for (i = 0; i < nsel; i++)
+				{
+					int			r = sel[i];
+
+					if (isnull[r][col])
+						continue;
+					rows[n] = r;
+					v[n++] = vecqual_get_float(vq->coltype, datum[r][col]);
+				}
+
+				if (isnan(k))
+				{
+					/* Rare; go through the NaN-aware comparison */
+					switch (vq->op)
+					{
+						case VQOP_EQ: VECQUAL_FILTER(n, vecqual_float_cmp(v[_i], k) == 0); break;
+						case VQOP_NE: VECQUAL_FILTER(n, vecqual_float_cmp(v[_i], k) != 0); break;
+						case VQOP_LT: VECQUAL_FILTER(n, vecqual_float_cmp(v[_i], k) < 0); break;
+						case VQOP_LE: VECQUAL_FILTER(n, vecqual_float_cmp(v[_i], k) <= 0); break;
+						case VQOP_GT: VECQUAL_FILTER(n, vecqual_float_cmp(v[_i], k) > 0); break;
+						case VQOP_GE: VECQUAL_FILTER(n, vecqual_float_cmp(v[_i], k) >= 0); break;
+					}
+					break;
+				}
+
+				/*
+				 * With a non-NaN constant, the only difference from plain C
+				 * comparisons is that a NaN value sorts above everything.
+				 */
+				switch (vq->op)
+				{
+					case VQOP_EQ: VECQUAL_FILTER(n, v[_i] == k); break;
+					case VQOP_NE: VECQUAL_FILTER(n, !(v[_i] == k)); break;
+					case VQOP_LT: VECQUAL_FILTER(n, v[_i] < k); break;
+					case VQOP_LE: VECQUAL_FILTER(n, v[_i] <= k); break;
+					case VQOP_GT: VECQUAL_FILTER(n, v[_i] > k || isnan(v[_i])); break;
+					case VQOP_GE: VECQUAL_FILTER(n, v[_i] >= k || isnan(v[_i])); break;
+				}
+				break;
+			}
+
+		case VQD_NUMERIC:
+			for (i = 0; i < nsel; i++)
+			{
+				int			r = sel[i];
+				int			c;
+				bool		ok = false;
+
+				if (isnull[r][col])
+					continue;
+
+				c = cmp_numerics(DatumGetNumeric(datum[r][col]), vq->nval);
+				switch (vq->op)
+				{
+					case VQOP_EQ: ok = (c == 0); break;
+					case VQOP_NE: ok = (c != 0); break;
+					case VQOP_LT: ok = (c < 0); break;
+					case VQOP_LE: ok = (c <= 0); break;
+					case VQOP_GT: ok = (c > 0); break;
+					case VQOP_GE: ok = (c >= 0); break;
+				}
+				if (ok)
+					sel[nout++] = r;
+			}
+			break;
+	}
+
+	return nout;
+}
+
+static bool vecqual_in_int(VecQual *vq, int64 v);
+static bool vecqual_in_float(VecQual *vq, double v);
+
+/*
+ * Does a single non-NULL value pass a VQ_CMP or VQ_IN qual?
+ */
+static bool
+vecqual_value_passes(VecQual *vq, Datum value)
+{
+	int			c = 0;
+
+	if (vq->kind == VQ_IN)
+	{
+		bool		found = false;
+
+		switch (vq->domain)
+		{
+			case VQD_INT:
+				found = vecqual_in_int(vq, vecqual_get_int(vq->coltype, value));
+				break;
+			case VQD_FLOAT:
+				found = vecqual_in_float(vq, vecqual_get_float(vq->coltype, value));
+				break;
+			case VQD_NUMERIC:
+				{
+					Numeric		num = DatumGetNumeric(value);
+					int			j;
+
+					for (j = 0; j < vq->nvals && !found; j++)
+						found = (cmp_numerics(num, vq->nvals_arr[j]) == 0);
+					break;
+				}
+		}
+		return found == vq->useOr;
+	}
+
+	switch (vq->domain)
+	{
+		case VQD_INT:
+			{
+				int64		v = vecqual_get_int(vq->coltype, value);
+
+				c = (v > vq->ival) - (v < vq->ival);
+				break;
+			}
+		case VQD_FLOAT:
+			c = vecqual_float_cmp(vecqual_get_float(vq->coltype, value), vq->fval);
+			break;
+		case VQD_NUMERIC:
+			c = cmp_numerics(DatumGetNumeric(value), vq->nval);
+			break;
+	}
+
+	switch (vq->op)
+	{
+		case VQOP_EQ: return c == 0;
+		case VQOP_NE: return c != 0;
+		case VQOP_LT: return c < 0;
+		case VQOP_LE: return c <= 0;
+		case VQOP_GT: return c > 0;
+		case VQOP_GE: return c >= 0;
+	}
+	return false;
+}
+
+/*
+ * VQ_CMP or VQ_IN over a column with runs: rows of a run are adjacent in
+ * sel, so only the first row of each run looked at needs evaluating.
+ */
+static int
+vecqual_eval_runs(VecQual *vq, Datum **datum, bool **isnull, int32 *runs,
+				  int *sel, int nsel)
+{
+	int			col = vq->col;
+	int32		lastRun = -1;
+	bool		pass = false;
+	int			nout = 0;
+	int			i;
+
+	for (i = 0; i < nsel; i++)
+	{
+		int			r = sel[i];
+
+		if (isnull[r][col])
+			continue;
+
+		if (runs[r] != lastRun)
+		{
+			lastRun = runs[r];
+			pass = vecqual_value_passes(vq, datum[r][col]);
+		}
+		sel[nout] = r;
+		nout += pass ? 1 : 0;
+	}
+
+	return nout;
+}
+
+static bool
+vecqual_in_int(VecQual *vq, int64 v)
+{
+	int			lo = 0;
+	int			hi = vq->nvals - 1;
+
+	while (lo <= hi)
+	{
+		int			mid = (lo + hi) / 2;
+
+		if (vq->ivals[mid] == v)
+			return true;
+		if (vq->ivals[mid] < v)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return false;
+}
+
+static bool
+vecqual_in_float(VecQual *vq, double v)
+{
+	int			lo = 0;
+	int			hi = vq->nvals - 1;
+
+	while (lo <= hi)
+	{
+		int			mid = (lo + hi) / 2;
+		int			c = vecqual_float_cmp(vq->fvals[mid], v);
+
+		if (c == 0)
+			return true;
+		if (c < 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return false;
+}
+
+static int
+vecqual_eval_in(VecQual *vq, Datum **datum, bool **isnull, int *sel, int nsel)
+{
+	int			col = vq->col;
+	int			nout = 0;
+	int			i;
+
+	for (i = 0; i < nsel; i++)
+	{
+		int			r = sel[i];
+		bool		found = false;
+
+		if (isnull[r][col])
+			continue;
+
+		switch (vq->domain)
+		{
+			case VQD_INT:
+				found = vecqual_in_int(vq, vecqual_get_int(vq->coltype, datum[r][col]));
+				break;
+			case VQD_FLOAT:
+				found = vecqual_in_float(vq, vecqual_get_float(vq->coltype, datum[r][col]));
+				break;
+			case VQD_NUMERIC:
+				{
+					Numeric		num = DatumGetNumeric(datum[r][col]);
+					int			j;
+
+					for (j = 0; j < vq->nvals && !found; j++)
+						found = (cmp_numerics(num, vq->nvals_arr[j]) == 0);
+					break;
+				}
+		}
+
+		if (found == vq->useOr)
+			sel[nout++] = r;
+	}
+
+	return nout;
+}
+
+int
+ExecVecQualEval(VecQual *vq, Datum **datum, bool **isnull, int32 **runs,
+				int *sel, int nsel)
+{
+	int			nout = 0;
+	int			i;
+	int			j;
+
+	if (vq == NULL || nsel == 0)
+		return nsel;
+
+	switch (vq->kind)
+	{
+		case VQ_FALSE:
+			return 0;
+
+		case VQ_CMP:
+			if (runs != NULL && runs[vq->col] != NULL)
+				return vecqual_eval_runs(vq, datum, isnull, runs[vq->col],
+										 sel, nsel);
+			return vecqual_eval_cmp(vq, datum, isnull, sel, nsel);
+
+		case VQ_IN:
+			if (runs != NULL && runs[vq->col] != NULL)
+				return vecqual_eval_runs(vq, datum, isnull, runs[vq->col],
+										 sel, nsel);
+			return vecqual_eval_in(vq, datum, isnull, sel, nsel);
+
+		case VQ_NULLTEST:
+			for (i = 0; i < nsel; i++)
+			{
+				int			r = sel[i];
+
+				sel[nout] = r;
+				nout += (isnull[r][vq->col] == vq->isnulltest) ? 1 : 0;
+			}
+			return nout;
+
+		case VQ_AND:
+			for (i = 0; i < vq->nargs && nsel > 0; i++)
+				nsel = ExecVecQualEval(vq->args[i], datum, isnull, runs, sel, nsel);
+			return nsel;
+
+		case VQ_OR:
+			{
+				/*
+				 * Each arm only looks at rows no earlier arm has accepted;
+				 * the survivors are then merged back in the original order.
+				 */
+				int			nleft = nsel;
+
+				memcpy(vq->subsel, sel, sizeof(int) * nsel);
+				for (i = 0; i < vq->nargs && nleft > 0; i++)
+				{
+					int			npass;
+					int			k;
+
+					npass = ExecVecQualEval(vq->args[i], datum, isnull, runs,
+											vq->subsel, nleft);
+					for (k = 0; k < npass; k++)
+						vq->pass[vq->subsel[k]] = true;
+
+					nleft = 0;
+					for (j = 0; j < nsel; j++)
+					{
+						if (!vq->pass[sel[j]])
+							vq->subsel[nleft++] = sel[j];
+					}
+				}
+
+				for (j = 0; j < nsel; j++)
+				{
+					int			r = sel[j];
+
+					if (vq->pass[r])
+					{
+						sel[nout++] = r;
+						vq->pass[r] = false;
+					}
+				}
+				return nout;
+			}
+	}
+
+	Assert(false);
+	return 0;
+}
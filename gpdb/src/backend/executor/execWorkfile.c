@@ -456,6 +456,7 @@ ExecWorkFile_Close(ExecWorkFile *workfile)
 				ExecWorkFile_AdjustBFZSize(workfile, file_size);
 			}
 
+			workfile_update_bfz_stats(workfile, bfz_file);
 			bfz_close(bfz_file, true);
 			break;
 		default:
@@ -579,6 +580,28 @@ ExecWorkFile_Flush(ExecWorkFile *workfile)
 	}
 }
 
+/*
+ * ExecWorkFile_Prefetch
+ *    hint that the given range of the file is going to be read soon.
+ *
+ * Only files that support random access can be prefetched; for other
+ * file types this does nothing.
+ */
+void
+ExecWorkFile_Prefetch(ExecWorkFile *workfile, uint64 offset, uint64 size)
+{
+	Assert(workfile != NULL);
+	switch(workfile->fileType)
+	{
+	case BUFFILE:
+		/* a failed hint is not an error */
+		(void) BufFilePrefetch((BufFile *) workfile->file, offset, (int) size);
+		break;
+	default:
+		break;
+	}
+}
+
 /*
  * Suspend a file without closing it. For bfz, which allocates a buffer for
  * each open a file, this frees up that buffer but keeps the fd so we can
@@ -733,8 +756,13 @@ ExecWorkFile_AdjustBFZSize(ExecWorkFile *workfile, int64 file_size)
 		/* Actual file on disk is bigger than expected. This can happen when:
 		 *  - added checksums to an uncompressed file
 		 *  - closing empty or very small compressed file (zlib header overhead larger than saved space)
+		 *  - closing an incompressible lz4 or zstd file (per-block frame headers)
 		 */
-		Assert( (bfz_file->has_checksum && bfz_file->compression_index == 0) || (bfz_file->compression_index > 0 && workfile->size < BFZ_BUFFER_SIZE));
+		Assert( (bfz_file->has_checksum && bfz_file->compression_index == 0) ||
+				(bfz_file->compression_index > 0 && workfile->size < BFZ_BUFFER_SIZE) ||
+				(bfz_file->compression_index > 1 &&
+				 extra_bytes <= (workfile->size / (BFZ_BUFFER_SIZE - sizeof(pg_crc32)) + 1) *
+				 (BFZ_FRAME_HEADER_SIZE + sizeof(pg_crc32))));
 
 		/*
 		 * If we're already under disk full, don't try to reserve, as it will
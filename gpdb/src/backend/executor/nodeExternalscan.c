@@ -120,21 +120,6 @@ ExternalNext(ExternalScanState *node)
 	direction = estate->es_direction;
 	slot = node->ss.ss_ScanTupleSlot;
 
-    if ((scandesc->fs_uri != NULL && IS_XDRIVE_URI(scandesc->fs_uri)) 
-            || (scandesc->fs_formatter && exx_is_spq_format(scandesc->fs_formatter->fmt_user_tag))) { 
-        /*
-         * EXX: EXX_IN_PG.
-         *  Intercept spq formatter.
-         *  XDrive implies spq formatter, or, in old loftd code, an execute curl url will run spq formatter.
-         *  We should deprecate loftd.
-         */
-        if (scandesc->fs_noop) {
-            return NULL;
-        }
-		elog(ERROR, "Cannot use spq");
-        return slot;
-    }
-
 	/*
 	 * get the next tuple from the file access methods
 	 */
@@ -363,10 +348,6 @@ ExecStopExternalScan(ExternalScanState *node)
 	 */
 	fileScanDesc = node->ess_ScanDesc;
 
-    if (fileScanDesc->fs_formatter && exx_is_spq_format(fileScanDesc->fs_formatter->fmt_user_tag)) {
-        elog(ERROR, "SSPPQQ: cannot use spq."); 
-    }
-
 	/*
 	 * stop the file scan
 	 */
@@ -408,11 +389,7 @@ ExecExternalReScan(ExternalScanState *node, ExprContext *exprCtxt)
 
 	ItemPointerSet(&node->cdb_fake_ctid, 0, 0);
 
-    if (fileScan->fs_formatter && exx_is_spq_format(fileScan->fs_formatter->fmt_user_tag)) { 
-        elog(ERROR, "SSPPQQ: External table rescan???"); 
-    } else { 
-        external_rescan(fileScan);
-    }
+	external_rescan(fileScan);
 }
 
 void
@@ -435,12 +412,7 @@ initGpmonPktForExternalScan(Plan *planNode, gpmon_packet_t *gpmon_pkt, EState *e
 void
 ExecEagerFreeExternalScan(ExternalScanState *node)
 {
-	FileScanDesc fileScan = node->ess_ScanDesc;
-    Assert(node->ess_ScanDesc != NULL);
-
-    if (fileScan->fs_formatter && exx_is_spq_format(fileScan->fs_formatter->fmt_user_tag)) { 
-        elog(ERROR, "SSPPQQ: External table eager free!"); 
-    }
+	Assert(node->ess_ScanDesc != NULL);
 
-    external_endscan(node->ess_ScanDesc);
+	external_endscan(node->ess_ScanDesc);
 }
@@ -27,6 +27,7 @@
 
 #include "access/hash.h"
 #include "executor/execdebug.h"
+#include "executor/execRuntimeFilter.h"
 #include "executor/hashjoin.h"
 #include "executor/instrument.h"
 #include "executor/nodeHash.h"
@@ -51,6 +52,10 @@ ExecHashTableExplainBatches(HashJoinTableStats *stats,
                             const char     *title);
 static void ExecHashTableReallocBatchData(HashJoinTable hashtable, int new_nbatch);
 static int ExecChoosePrimeNBuckets(int nbuckets);
+static void ExecHashTableStage(HashJoinTable hashtable, HashJoinTuple hashTuple,
+				   int bucketno);
+static HashJoinTuple ExecScanHashCluster(HashJoinState *hjstate,
+					ExprContext *econtext);
 
 void ExecChooseHashTableSize(double ntuples, int tupwidth,
 						int *numbuckets,
@@ -66,6 +71,24 @@ void ExecChooseHashTableSize(double ntuples, int tupwidth,
 /* Amount of metadata memory required per bucket */
 #define MD_MEM_PER_BUCKET (sizeof(HashJoinTuple) + sizeof(uint64))
 
+/*
+ * Radix clustering, see HashJoinClusterEntry.  The staging array of a batch
+ * starts with HJ_MIN_STAGED entries and doubles up to HJ_MAX_STAGED, beyond
+ * which the batch is split.  The partitioning pass makes partitions of about
+ * HJ_PARTITION_BYTES of entries, so that the counting sort of one partition
+ * stays in cache, and at most HJ_MAX_PARTITIONS of them.
+ */
+#define HJ_MIN_STAGED		1024
+#define HJ_MAX_STAGED		((uint32) (MaxAllocSize / sizeof(HashJoinClusterEntry)))
+#define HJ_PARTITION_BYTES	(256 * 1024)
+#define HJ_MAX_PARTITIONS	1024
+
+#ifdef __GNUC__
+#define hj_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hj_prefetch(addr) ((void) (addr))
+#endif
+
 /* ----------------------------------------------------------------
  *		ExecHash
  *
@@ -120,6 +143,9 @@ MultiExecHash(HashState *node)
             ""); // tableName
 #endif
 
+	if (node->runtimeFilter)
+		ExecRuntimeFilterReset(node->runtimeFilter);
+
 	/*
 	 * get all inner tuples and insert into the hash table (or temp files)
 	 */
@@ -138,6 +164,9 @@ MultiExecHash(HashState *node)
 		if (ExecHashGetHashValue(node, hashtable, econtext, hashkeys, node->hs_keepnull, &hashvalue, &hashkeys_null))
 		{
 			ExecHashTableInsert(node, hashtable, slot, hashvalue);
+
+			if (node->runtimeFilter)
+				ExecRuntimeFilterAdd(node->runtimeFilter, econtext);
 		}
 
 		if (hashkeys_null)
@@ -155,6 +184,12 @@ MultiExecHash(HashState *node)
 	/* Now we have set up all the initial batches & primary overflow batches. */
 	hashtable->nbatch_outstart = hashtable->nbatch;
 
+	ExecHashTableCluster(node, hashtable);
+
+	/* The probe side scans can start filtering with the inner keys. */
+	if (node->runtimeFilter)
+		ExecRuntimeFilterPublish(node->runtimeFilter);
+
 	/* must provide our own instrumentation support */
 	if (node->ps.instrument)
 		InstrStopNode(node->ps.instrument, hashtable->totalTuples);
@@ -305,6 +340,12 @@ ExecHashTableCreate(HashState *hashState, HashJoinState *hjstate, List *hashOper
 	hashtable = (HashJoinTable)palloc0(sizeof(HashJoinTableData));
 	hashtable->buckets = NULL;
 	hashtable->bloom = NULL;
+	hashtable->radix = gp_hashjoin_radix_cluster;
+	hashtable->staged = NULL;
+	hashtable->nstaged = 0;
+	hashtable->maxstaged = 0;
+	hashtable->cluster = NULL;
+	hashtable->clusterstart = NULL;
 	hashtable->curbatch = 0;
 	hashtable->growEnabled = true;
 	hashtable->totalTuples = 0;
@@ -830,6 +871,29 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 			hashtable->bloom[i] = bloom;
 	}
 
+	/* The dumped tuples are gone; drop them from the staging array too. */
+	if (hashtable->radix)
+	{
+		HashJoinClusterEntry *staged = hashtable->staged;
+		uint32		nstaged = hashtable->nstaged;
+		uint32		nkept = 0;
+		uint32		j;
+
+		for (j = 0; j < nstaged; j++)
+		{
+			int			bucketno;
+			int			batchno;
+
+			ExecHashGetBucketAndBatch(hashtable, staged[j].hashvalue,
+					&bucketno, &batchno);
+			if (batchno == curbatch)
+				staged[nkept++] = staged[j];
+		}
+		Assert(nstaged - nkept == nfreed);
+		hashtable->nstaged = nkept;
+		fullbatch->innerspace -= nfreed * HJ_CLUSTER_SPACE;
+	}
+
 #ifdef HJDEBUG
 	elog(gp_workfile_caching_loglevel, "HJ batch %d: Freed %ld of %ld tuples, %lu of %lu bytes, space now %lu",
 			curbatch,
@@ -971,9 +1035,19 @@ ExecHashTableInsert(HashState *hashState, HashJoinTable hashtable,
 		if(gp_hashjoin_bloomfilter!=0)
 			hashtable->bloom[bucketno] |= BLOOMVAL(hashvalue);
 
-		/* Double the number of batches when too much data in hash table. */
+		if (hashtable->radix)
+		{
+			ExecHashTableStage(hashtable, hashTuple, bucketno);
+			batch->innerspace += HJ_CLUSTER_SPACE;
+		}
+
+		/*
+		 * Double the number of batches when too much data in hash table,
+		 * or too many tuples to cluster.
+		 */
 		if (batch->innerspace > hashtable->spaceAllowed ||
-			batch->innertuples > UINT_MAX/2)
+			batch->innertuples > UINT_MAX/2 ||
+			(hashtable->radix && hashtable->nstaged >= HJ_MAX_STAGED))
 		{
 			ExecHashIncreaseNumBatches(hashtable);
 
@@ -1168,6 +1242,10 @@ ExecScanHashBucket(HashState *hashState, HashJoinState *hjstate,
 
 	START_MEMORY_ACCOUNT(hashState->ps.plan->memoryAccount);
 	{
+	/* A clustered table is scanned through its cluster array. */
+	if (hashtable->cluster != NULL)
+		return ExecScanHashCluster(hjstate, econtext);
+
 	/*
 	 * hj_CurTuple is NULL to start scanning a new bucket, or the address of
 	 * the last tuple returned from the current bucket.
@@ -1213,6 +1291,226 @@ ExecScanHashBucket(HashState *hashState, HashJoinState *hjstate,
 	return NULL;
 }
 
+/*
+ * ExecScanHashCluster
+ *		ExecScanHashBucket for a clustered hash table
+ *
+ * The run of the current bucket in the cluster array holds the hash values
+ * of its tuples, so only tuples with a matching hash value are touched.
+ * hj_CurClusterPos remembers where the last match was found.
+ */
+static HashJoinTuple
+ExecScanHashCluster(HashJoinState *hjstate, ExprContext *econtext)
+{
+	List	   *hjclauses = hjstate->hashqualclauses;
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	HashJoinClusterEntry *cluster = hashtable->cluster;
+	uint32		hashvalue = hjstate->hj_CurHashValue;
+	int			bucketno = hjstate->hj_CurBucketNo;
+	uint32		pos;
+	uint32		end;
+
+	if (hjstate->hj_CurTuple == NULL)
+		pos = hashtable->clusterstart[bucketno];
+	else
+		pos = hjstate->hj_CurClusterPos + 1;
+	end = hashtable->clusterstart[bucketno + 1];
+
+	for (; pos < end; pos++)
+	{
+		if (cluster[pos].hashvalue == hashvalue)
+		{
+			HashJoinTuple hashTuple = cluster[pos].tuple;
+
+			econtext->ecxt_innertuple =
+				ExecStoreMemTuple(HJTUPLE_MINTUPLE(hashTuple),
+								  hjstate->hj_HashTupleSlot,
+								  false);	/* do not pfree */
+
+			/* reset temp memory each time to avoid leaks from qual expr */
+			ResetExprContext(econtext);
+
+			if (ExecQual(hjclauses, econtext, false))
+			{
+				hjstate->hj_CurTuple = hashTuple;
+				hjstate->hj_CurClusterPos = pos;
+				return hashTuple;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * ExecHashTableStage
+ *		append a tuple just put in the hash table to the staging array
+ *
+ * The array is grown by doubling.  ExecHashTableInsert splits the batch
+ * before it outgrows HJ_MAX_STAGED; if the batch can't be split any more,
+ * give up clustering.
+ */
+static void
+ExecHashTableStage(HashJoinTable hashtable, HashJoinTuple hashTuple,
+				   int bucketno)
+{
+	HashJoinClusterEntry *entry;
+
+	if (hashtable->nstaged == hashtable->maxstaged)
+	{
+		uint32		newmax;
+
+		if (hashtable->maxstaged >= HJ_MAX_STAGED)
+		{
+			elog(LOG, "HJ: too many tuples in batch %d to cluster, disabling clustering",
+				 hashtable->curbatch);
+			pfree(hashtable->staged);
+			hashtable->staged = NULL;
+			hashtable->nstaged = 0;
+			hashtable->maxstaged = 0;
+			hashtable->radix = false;
+			return;
+		}
+
+		if (hashtable->maxstaged == 0)
+		{
+			newmax = HJ_MIN_STAGED;
+			hashtable->staged = (HashJoinClusterEntry *)
+				MemoryContextAlloc(hashtable->batchCxt,
+								   newmax * sizeof(HashJoinClusterEntry));
+		}
+		else
+		{
+			if (hashtable->maxstaged > HJ_MAX_STAGED / 2)
+				newmax = HJ_MAX_STAGED;
+			else
+				newmax = hashtable->maxstaged * 2;
+			hashtable->staged = (HashJoinClusterEntry *)
+				repalloc(hashtable->staged,
+						 newmax * sizeof(HashJoinClusterEntry));
+		}
+		hashtable->maxstaged = newmax;
+	}
+
+	entry = &hashtable->staged[hashtable->nstaged++];
+	entry->tuple = hashTuple;
+	entry->hashvalue = hashTuple->hashvalue;
+	entry->bucketno = bucketno;
+}
+
+/*
+ * ExecHashTableCluster
+ *		cluster the tuples of the current batch by bucket
+ *
+ * Called once all the inner tuples of the batch are in the hash table.  The
+ * staging array is first scattered into partitions of consecutive buckets,
+ * each small enough to stay in cache, and each partition is then counting
+ * sorted by bucket back into the staging array, which becomes the cluster
+ * array.  Both passes write sequentially to a bounded number of places, so
+ * neither stalls on a cache miss per tuple the way a direct counting sort
+ * over all the buckets would.
+ */
+void
+ExecHashTableCluster(HashState *hashState, HashJoinTable hashtable)
+{
+	HashJoinClusterEntry *staged = hashtable->staged;
+	HashJoinClusterEntry *parts;
+	uint32		ntuples = hashtable->nstaged;
+	uint32		nbuckets = (uint32) hashtable->nbuckets;
+	uint32	   *clusterstart;
+	uint32		partstart[HJ_MAX_PARTITIONS + 1];
+	uint32		partnext[HJ_MAX_PARTITIONS];
+	uint32		npart;
+	uint32		i;
+	uint32		p;
+	MemoryContext oldcxt;
+
+	if (!hashtable->radix || ntuples == 0)
+		return;
+
+	Assert(hashtable->cluster == NULL);
+
+	START_MEMORY_ACCOUNT(hashState->ps.plan->memoryAccount);
+	{
+	oldcxt = MemoryContextSwitchTo(hashtable->batchCxt);
+
+	clusterstart = (uint32 *) palloc0((nbuckets + 1) * sizeof(uint32));
+	parts = (HashJoinClusterEntry *) palloc(ntuples * sizeof(HashJoinClusterEntry));
+
+	npart = 1;
+	while (npart < HJ_MAX_PARTITIONS &&
+		   (Size) ntuples * sizeof(HashJoinClusterEntry) / npart > HJ_PARTITION_BYTES)
+		npart *= 2;
+
+#define HJ_PARTITION_OF(bucketno) \
+	((uint32) (((uint64) (bucketno) * npart) / nbuckets))
+
+	/* Pass 1: scatter the entries into partitions of consecutive buckets. */
+	memset(partstart, 0, (npart + 1) * sizeof(uint32));
+	for (i = 0; i < ntuples; i++)
+		partstart[HJ_PARTITION_OF(staged[i].bucketno) + 1]++;
+	for (p = 0; p < npart; p++)
+	{
+		partstart[p + 1] += partstart[p];
+		partnext[p] = partstart[p];
+	}
+	for (i = 0; i < ntuples; i++)
+		parts[partnext[HJ_PARTITION_OF(staged[i].bucketno)]++] = staged[i];
+
+#undef HJ_PARTITION_OF
+
+	/*
+	 * Pass 2: counting sort each partition by bucket.  clusterstart[b + 1]
+	 * first counts the tuples of bucket b, then becomes the start of bucket
+	 * b, is advanced past the run of b by the scatter, and is finally
+	 * shifted down into place.
+	 */
+	for (i = 0; i < ntuples; i++)
+		clusterstart[parts[i].bucketno + 1]++;
+	for (i = 1; i <= nbuckets; i++)
+		clusterstart[i] += clusterstart[i - 1];
+	for (p = 0; p < npart; p++)
+	{
+		for (i = partstart[p]; i < partstart[p + 1]; i++)
+			staged[clusterstart[parts[i].bucketno]++] = parts[i];
+	}
+	for (i = nbuckets; i > 0; i--)
+		clusterstart[i] = clusterstart[i - 1];
+	clusterstart[0] = 0;
+	Assert(clusterstart[nbuckets] == ntuples);
+
+	pfree(parts);
+
+	hashtable->cluster = staged;
+	hashtable->clusterstart = clusterstart;
+
+	MemoryContextSwitchTo(oldcxt);
+	}
+	END_MEMORY_ACCOUNT();
+}
+
+/*
+ * ExecHashTablePrefetch
+ *		prefetch the bucket runs a batch of outer tuples is about to probe
+ *
+ * The starts of all the runs are prefetched first, then the runs themselves,
+ * so the cache misses of the batch overlap instead of being taken one
+ * probe at a time.
+ */
+void
+ExecHashTablePrefetch(HashJoinTable hashtable, const uint32 *hashvalues, int n)
+{
+	uint32		nbuckets = (uint32) hashtable->nbuckets;
+	int			i;
+
+	Assert(hashtable->cluster != NULL);
+
+	for (i = 0; i < n; i++)
+		hj_prefetch(&hashtable->clusterstart[hashvalues[i] % nbuckets]);
+	for (i = 0; i < n; i++)
+		hj_prefetch(&hashtable->cluster[hashtable->clusterstart[hashvalues[i] % nbuckets]]);
+}
+
 /*
  * ExecHashTableReset
  *
@@ -1245,6 +1543,13 @@ ExecHashTableReset(HashState *hashState, HashJoinTable hashtable)
 	if(gp_hashjoin_bloomfilter != 0)
 		hashtable->bloom = (uint64*) palloc0(nbuckets * sizeof(uint64));
 
+	/* The staging and cluster arrays went away with the batch context. */
+	hashtable->staged = NULL;
+	hashtable->nstaged = 0;
+	hashtable->maxstaged = 0;
+	hashtable->cluster = NULL;
+	hashtable->clusterstart = NULL;
+
 	hashtable->batches[hashtable->curbatch]->innerspace = 0;
 	hashtable->batches[hashtable->curbatch]->innertuples = 0;
 	hashtable->totalTuples = 0;
@@ -17,6 +17,7 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/execRuntimeFilter.h"
 #include "executor/hashjoin.h"
 #include "executor/instrument.h"        /* Instrumentation */
 #include "executor/nodeHash.h"
@@ -32,6 +33,11 @@
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 						  HashJoinState *hjstate,
 						  uint32 *hashvalue);
+static TupleTableSlot *ExecHashJoinOuterNextTuple(PlanState *outerNode,
+						  HashJoinState *hjstate,
+						  uint32 *hashvalue);
+static int	ExecHashJoinFillOuterBatch(PlanState *outerNode,
+						   HashJoinState *hjstate);
 static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinBatchSide *side,
 						  uint32 *hashvalue,
 						  TupleTableSlot *tupleSlot);
@@ -655,6 +661,28 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_CurHashValue = 0;
 	hjstate->hj_CurBucketNo = 0;
 	hjstate->hj_CurTuple = NULL;
+	hjstate->hj_CurClusterPos = 0;
+
+	/*
+	 * CDB: slots to fetch outer tuples into a batch at a time, for probing
+	 * a clustered hash table.
+	 */
+	hjstate->hj_OuterBatchSlots = NULL;
+	hjstate->hj_OuterBatchHash = NULL;
+	hjstate->hj_OuterBatchCount = 0;
+	hjstate->hj_OuterBatchNext = 0;
+	if (gp_hashjoin_radix_cluster)
+	{
+		TupleDesc	outerDesc = ExecGetResultType(outerPlanState(hjstate));
+		int			i;
+
+		hjstate->hj_OuterBatchSlots = (TupleTableSlot **)
+			palloc(HJ_OUTER_BATCH_SIZE * sizeof(TupleTableSlot *));
+		for (i = 0; i < HJ_OUTER_BATCH_SIZE; i++)
+			hjstate->hj_OuterBatchSlots[i] = MakeSingleTupleTableSlot(outerDesc);
+		hjstate->hj_OuterBatchHash = (uint32 *)
+			palloc(HJ_OUTER_BATCH_SIZE * sizeof(uint32));
+	}
 
 	/*
 	 * Deconstruct the hash clauses into outer and inner argument values, so
@@ -683,6 +711,11 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	/* child Hash node needs to evaluate inner hash keys, too */
 	((HashState *) innerPlanState(hjstate))->hashkeys = rclauses;
 
+	/* CDB: let the Hash node filter the scans on the probe side */
+	if (gp_hashjoin_runtime_filter)
+		((HashState *) innerPlanState(hjstate))->runtimeFilter =
+			ExecInitRuntimeFilter(hjstate, lclauses, rclauses, hoperators);
+
 	hjstate->js.ps.ps_OuterTupleSlot = NULL;
 	hjstate->hj_NeedNewOuter = true;
 	hjstate->hj_MatchedOuter = false;
@@ -740,6 +773,18 @@ ExecEndHashJoin(HashJoinState *node)
 	ExecClearTuple(node->hj_OuterTupleSlot);
 	ExecClearTuple(node->hj_HashTupleSlot);
 
+	if (node->hj_OuterBatchSlots != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < HJ_OUTER_BATCH_SIZE; i++)
+			ExecDropSingleTupleTableSlot(node->hj_OuterBatchSlots[i]);
+		pfree(node->hj_OuterBatchSlots);
+		pfree(node->hj_OuterBatchHash);
+		node->hj_OuterBatchSlots = NULL;
+		node->hj_OuterBatchHash = NULL;
+	}
+
 	/*
 	 * clean up subtrees
 	 */
@@ -759,6 +804,11 @@ ExecEndHashJoin(HashJoinState *node)
  * Returns a null slot if no more outer tuples.  On success, the tuple's
  * hash value is stored at *hashvalue --- this is either originally computed,
  * or re-read from the temp file.
+ *
+ * CDB: when the hash table of the current batch is clustered, outer tuples
+ * are fetched HJ_OUTER_BATCH_SIZE at a time and the buckets they will probe
+ * prefetched, then handed out one by one.  A batch of outer tuples never
+ * spans two hash join batches.
  */
 static TupleTableSlot *
 ExecHashJoinOuterGetTuple(PlanState *outerNode,
@@ -768,6 +818,122 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	HashJoinTable hashtable = hjstate->hj_HashTable;
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		/* Hand out the rest of the current batch of outer tuples first. */
+		if (hjstate->hj_OuterBatchNext < hjstate->hj_OuterBatchCount)
+		{
+			int			i = hjstate->hj_OuterBatchNext++;
+
+			*hashvalue = hjstate->hj_OuterBatchHash[i];
+			return hjstate->hj_OuterBatchSlots[i];
+		}
+
+		if (curbatch >= hashtable->nbatch)
+			break;
+
+		/* 
+		 * For batches > 0, we can be reading many many outer tuples from disk
+		 * and probing them against the hashtable. If we don't find any matches, 
+		 * we'll keep coming back here to read tuples from disk and 
+		 * returning them (MPP-23213). Break this long tight loop here. 
+		 */
+		if (curbatch > 0 || hjstate->cached_workfiles_loaded)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			if (QueryFinishPending)
+				return NULL;
+		}
+
+		if (hashtable->cluster != NULL && hjstate->hj_OuterBatchSlots != NULL)
+		{
+			if (ExecHashJoinFillOuterBatch(outerNode, hjstate) > 0)
+				continue;
+		}
+		else
+		{
+			slot = ExecHashJoinOuterNextTuple(outerNode, hjstate, hashvalue);
+			if (!TupIsNull(slot))
+				return slot;
+		}
+
+		/*
+		 * We have just reached the end of the outer side of the current
+		 * batch.
+		 */
+		if (curbatch == 0 && !hjstate->cached_workfiles_loaded)
+		{
+			/*
+			 * We have just reached the end of the first pass. Write out the first
+			 * inner batch so that we can reuse it when the workfile caching is
+			 * enabled.
+			 */
+			if (gp_workfile_caching) 
+			  {
+			    ExecHashJoinSaveFirstInnerBatch(hashtable);
+			  }
+
+			/*
+			 * We have just reached the end of the first pass. Try to switch to a
+			 * saved batch.
+			 */
+
+			/* SFR: This can cause re-spill! */
+			curbatch = ExecHashJoinNewBatch(hjstate);
+
+#ifdef HJDEBUG
+			elog(gp_workfile_caching_loglevel, "HashJoin built table with %.1f tuples for batch %d", hashtable->totalTuples, curbatch);
+#endif
+
+			Gpmon_M_Incr_Rows_Out(GpmonPktFromHashJoinState(hjstate)); 
+			CheckSendPlanStateGpmonPkt(&hjstate->js.ps);
+		}
+		else
+		{
+			/*
+			 * Advance to the next batch.  NOTE: nbatch could increase inside
+			 * ExecHashJoinNewBatch, so don't try to optimize this loop.
+			 */
+			curbatch = ExecHashJoinNewBatch(hjstate);
+
+#ifdef HJDEBUG
+			elog(gp_workfile_caching_loglevel, "HashJoin built table with %.1f tuples for batch %d", hashtable->totalTuples, curbatch);
+#endif
+
+			Gpmon_M_Incr(GpmonPktFromHashJoinState(hjstate), GPMON_HASHJOIN_SPILLBATCH);
+			CheckSendPlanStateGpmonPkt(&hjstate->js.ps);
+		}
+	}
+
+	/* Write spill file state to disk. */
+	ExecHashJoinSaveState(hashtable);
+
+	if (gp_workfile_caching && hjstate->workfiles_created)
+	{
+		workfile_mgr_mark_complete(hashtable->work_set);
+	}
+
+	/* Out of batches... */
+	return NULL;
+}
+
+/*
+ * ExecHashJoinOuterNextTuple
+ *
+ *		get the next outer tuple of the current batch, from the outer plan
+ *		node in the first pass or from the batch's temp file after that.
+ *		Returns a null slot at the end of the batch's outer side.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterNextTuple(PlanState *outerNode,
+		HashJoinState *hjstate,
+		uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	TupleTableSlot *slot;
 	ExprContext    *econtext;
 
 	HashState *hashState = (HashState *) innerPlanState(hjstate);
@@ -791,7 +957,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			}
 
 			if (TupIsNull(slot))
-				break;
+				return NULL;
 
 			/*
 			 * We have to compute the tuple's hash value.
@@ -821,77 +987,57 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			 * and continue with the next one.
 			 */
 		} /* for (;;) */
+	} /* if (curbatch == 0) */
 
-		/*
-		 * We have just reached the end of the first pass. Write out the first
-		 * inner batch so that we can reuse it when the workfile caching is
-		 * enabled.
-		 */
-		if (gp_workfile_caching) 
-		  {
-		    ExecHashJoinSaveFirstInnerBatch(hashtable);
-		  }
-
-		/*
-		 * We have just reached the end of the first pass. Try to switch to a
-		 * saved batch.
-		 */
-
-		/* SFR: This can cause re-spill! */
-		curbatch = ExecHashJoinNewBatch(hjstate);
-
+	return ExecHashJoinGetSavedTuple(&hashtable->batches[curbatch]->outerside,
+									 hashvalue,
+									 hjstate->hj_OuterTupleSlot);
+}
 
-#ifdef HJDEBUG
-		elog(gp_workfile_caching_loglevel, "HashJoin built table with %.1f tuples for batch %d", hashtable->totalTuples, curbatch);
-#endif
+/*
+ * ExecHashJoinFillOuterBatch
+ *
+ *		fetch up to HJ_OUTER_BATCH_SIZE outer tuples of the current batch
+ *		into hj_OuterBatchSlots and prefetch the buckets they will probe.
+ *		Returns the number of tuples fetched, 0 at the end of the batch's
+ *		outer side.
+ */
+static int
+ExecHashJoinFillOuterBatch(PlanState *outerNode, HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	bool		firstpass = (curbatch == 0 && !hjstate->cached_workfiles_loaded);
+	int			n;
 
-		Gpmon_M_Incr_Rows_Out(GpmonPktFromHashJoinState(hjstate)); 
-		CheckSendPlanStateGpmonPkt(&hjstate->js.ps);
-	} /* if (curbatch == 0) */
+	Assert(hjstate->hj_OuterBatchNext == hjstate->hj_OuterBatchCount);
 
-	/*
-	 * Try to read from a temp file. Loop allows us to advance to new batches
-	 * as needed.  NOTE: nbatch could increase inside ExecHashJoinNewBatch, so
-	 * don't try to optimize this loop.
-	 */
-	while (curbatch < hashtable->nbatch)
+	for (n = 0; n < HJ_OUTER_BATCH_SIZE; n++)
 	{
-		/* 
-		 * For batches > 0, we can be reading many many outer tuples from disk
-		 * and probing them against the hashtable. If we don't find any matches, 
-		 * we'll keep coming back here to read tuples from disk and 
-		 * returning them (MPP-23213). Break this long tight loop here. 
-		 */
-		CHECK_FOR_INTERRUPTS();
-
-		if (QueryFinishPending)
-			return NULL;
+		TupleTableSlot *batchslot = hjstate->hj_OuterBatchSlots[n];
+		uint32	   *hashvalue = &hjstate->hj_OuterBatchHash[n];
 
-		slot = ExecHashJoinGetSavedTuple(&hashtable->batches[curbatch]->outerside,
-										 hashvalue,
-										 hjstate->hj_OuterTupleSlot);
-		if (!TupIsNull(slot))
-			return slot;
-		curbatch = ExecHashJoinNewBatch(hjstate);
-
-#ifdef HJDEBUG
-		elog(gp_workfile_caching_loglevel, "HashJoin built table with %.1f tuples for batch %d", hashtable->totalTuples, curbatch);
-#endif
+		if (firstpass)
+		{
+			/* The outer node's slot is overwritten by its next tuple; copy. */
+			TupleTableSlot *slot = ExecHashJoinOuterNextTuple(outerNode, hjstate,
+															  hashvalue);
 
-		Gpmon_M_Incr(GpmonPktFromHashJoinState(hjstate), GPMON_HASHJOIN_SPILLBATCH);
-		CheckSendPlanStateGpmonPkt(&hjstate->js.ps);
+			if (TupIsNull(slot))
+				break;
+			ExecCopySlot(batchslot, slot);
+		}
+		else if (TupIsNull(ExecHashJoinGetSavedTuple(&hashtable->batches[curbatch]->outerside,
+													  hashvalue, batchslot)))
+			break;
 	}
 
-	/* Write spill file state to disk. */
-	ExecHashJoinSaveState(hashtable);
+	if (n > 0)
+		ExecHashTablePrefetch(hashtable, hjstate->hj_OuterBatchHash, n);
 
-	if (gp_workfile_caching && hjstate->workfiles_created)
-	{
-		workfile_mgr_mark_complete(hashtable->work_set);
-	}
-
-	/* Out of batches... */
-	return NULL;
+	hjstate->hj_OuterBatchCount = n;
+	hjstate->hj_OuterBatchNext = 0;
+	return n;
 }
 
 /*
@@ -1083,6 +1229,8 @@ start_over:
 	if (batch->outerside.workfile == NULL)
 	    goto start_over;
 
+	ExecHashTableCluster(hashState, hashtable);
+
     /*
      * Rewind outer batch file, so that we can start reading it.
      * We only need to do that if we created those files, and not using cached workfiles.
@@ -1254,12 +1402,17 @@ ExecReScanHashJoin(HashJoinState *node, ExprContext *exprCtxt)
 		}
 		else
 		{
+			HashState *hashState = (HashState *) innerPlanState(node);
+
 			/* must destroy and rebuild hash table */
 			if (!node->hj_HashTable->eagerlyReleased)
 			{
-				HashState *hashState = (HashState *) innerPlanState(node);
 				ExecHashTableDestroy(hashState, node->hj_HashTable);
 			}
+
+			/* The filter is stale until the table is rebuilt. */
+			if (hashState->runtimeFilter)
+				ExecRuntimeFilterReset(hashState->runtimeFilter);
 			pfree(node->hj_HashTable);
 			node->hj_HashTable = NULL;
 
@@ -1276,6 +1429,8 @@ ExecReScanHashJoin(HashJoinState *node, ExprContext *exprCtxt)
 	node->hj_CurHashValue = 0;
 	node->hj_CurBucketNo = 0;
 	node->hj_CurTuple = NULL;
+	node->hj_OuterBatchCount = 0;
+	node->hj_OuterBatchNext = 0;
 
 	node->js.ps.ps_OuterTupleSlot = NULL;
 	node->hj_NeedNewOuter = true;
@@ -1319,6 +1474,8 @@ static void ReleaseHashTable(HashJoinState *node)
 	node->hj_CurHashValue = 0;
 	node->hj_CurBucketNo = 0;
 	node->hj_CurTuple = NULL;
+	node->hj_OuterBatchCount = 0;
+	node->hj_OuterBatchNext = 0;
 
 	node->js.ps.ps_OuterTupleSlot = NULL;
 	node->hj_NeedNewOuter = true;
@@ -104,16 +104,16 @@ CdbMergeComparator_DestroyContext(CdbMergeComparatorContext *ctx);
  * FUNCTIONS PROTOTYPES
  */
 static void execMotionSender(MotionState * node);
-static HeapTuple execMotionUnsortedReceiver(MotionState * node);
+static TupleTableSlot *execMotionUnsortedReceiver(MotionState * node);
 static HeapTuple execMotionSortedReceiver(MotionState * node);
 static HeapTuple execMotionSortedReceiver_mk(MotionState * node);
-HeapTuple ExecMotionRecvRaw(MotionState * node);
+static TupleTableSlot *ExecMotionRecvRaw(MotionState * node);
 
 static void execMotionSortedReceiverFirstTime(MotionState * node);
 
 static int
 CdbMergeComparator(void *lhs, void *rhs, void *context);
-static uint32 evalHashKey(ExprContext *econtext, List *hashkeys, List *hashtypes, CdbHash * h, FmgrInfo * hfns);
+static uint32 evalHashKey(MotionState *node, ExprContext *econtext, List *hashtypes);
 
 static void doSendEndOfStream(Motion * motion, MotionState * node);
 static void doSendTuple(Motion * motion, MotionState * node, TupleTableSlot *outerTupleSlot, MemTuple mtup, int reduced_hval);
@@ -236,10 +236,11 @@ setMotionStatsForGpmon(MotionState *node)
  *		ExecMotion
  * ----------------------------------------------------------------
  */
-HeapTuple
+static TupleTableSlot *
 ExecMotionRecvRaw(MotionState * node)
 {
 	Motion	   *motion = (Motion *) node->ps.plan;
+	TupleTableSlot *slot = NULL;
 	HeapTuple  htup;
 #ifdef MEASURE_MOTION_TIME
 	struct timeval startTime;
@@ -273,9 +274,12 @@ ExecMotionRecvRaw(MotionState * node)
 			htup = execMotionSortedReceiver_mk(node);
 		else
 			htup = execMotionSortedReceiver(node);
+
+		if (htup != NULL)
+			slot = ExecStoreGenericTuple(htup, node->ps.ps_ResultTupleSlot, true);
 	}
 	else
-		htup = execMotionUnsortedReceiver(node);
+		slot = execMotionUnsortedReceiver(node);
 
 	/*
 	 * We tell the upper node as if this was the end of tuple stream
@@ -288,9 +292,9 @@ ExecMotionRecvRaw(MotionState * node)
 	 * will be delivered to the sender side.
 	 */
 	if (QueryFinishPending)
-		htup = NULL;
+		slot = NULL;
 
-	if (htup == NULL)
+	if (slot == NULL)
 		node->ps.state->active_recv_id = -1;
 	else
 	{
@@ -318,7 +322,7 @@ ExecMotionRecvRaw(MotionState * node)
 #endif
 	CheckSendPlanStateGpmonPkt(&node->ps);
 
-	return htup;
+	return slot;
 }
 
 
@@ -331,16 +335,7 @@ ExecMotion(MotionState * node)
 	 */
 	if (node->mstype == MOTIONSTATE_RECV)
 	{
-		TupleTableSlot *tuple;
-		HeapTuple htup;
-
-		if (! (htup = ExecMotionRecvRaw(node))) {
-			return NULL;
-		}
-
-		tuple = node->ps.ps_ResultTupleSlot;
-		tuple = ExecStoreGenericTuple(htup, tuple, true);
-		return tuple;
+		return ExecMotionRecvRaw(node);
 	}
 	else if(node->mstype == MOTIONSTATE_SEND)
 	{
@@ -456,11 +451,11 @@ execMotionSender(MotionState * node)
 }
 
 
-static HeapTuple
+static TupleTableSlot *
 execMotionUnsortedReceiver(MotionState * node)
 {
 	/* RECEIVER LOGIC */
-	HeapTuple	tuple;
+	TupleTableSlot *slot = node->ps.ps_ResultTupleSlot;
 	Motion	   *motion = (Motion *) node->ps.plan;
 	ReceiveReturnCode recvRC;
 
@@ -479,9 +474,9 @@ execMotionUnsortedReceiver(MotionState * node)
 		return NULL;
 	}
 
-	recvRC = RecvTupleFrom(node->ps.state->motionlayer_context,
-						   node->ps.state->interconnect_context,
-						   motion->motionID, &tuple, ANY_ROUTE);
+	recvRC = RecvTupleSlotFrom(node->ps.state->motionlayer_context,
+							   node->ps.state->interconnect_context,
+							   motion->motionID, slot);
 
 	if (recvRC == END_OF_STREAM)
 	{
@@ -508,20 +503,14 @@ execMotionUnsortedReceiver(MotionState * node)
         appendStringInfo(&buf, "   motion%-3d rcv      %5d.",
                          motion->motionID,
                          node->numTuplesToParent);
-        formatTuple(&buf, tuple, ExecGetResultType(&node->ps),
+        formatTuple(&buf, ExecFetchSlotHeapTuple(slot), ExecGetResultType(&node->ps),
                     node->outputFunArray);
         elog(DEBUG3, buf.data);
         pfree(buf.data);
     }
 #endif
 
-	return tuple;
-#ifdef UNDEF
-    /* store it in our result slot and return this. */
-    slot = node->ps.ps_ResultTupleSlot;
-    slot = ExecStoreGenericTuple(tuple, slot, true /* shouldFree */);
 	return slot;
-#endif
 }
 
 
@@ -996,6 +985,9 @@ ExecInitMotion(Motion * node, EState *estate, int eflags)
 	motionstate->hashExpr = NULL;
 	motionstate->cdbhash = NULL;
 	motionstate->hashfunctions = NULL;
+	motionstate->hashkeyfuncs = NULL;
+	motionstate->hashkeyattnos = NULL;
+	motionstate->sendBatches = false;
 
     /* Look up the sending gang's slice table entry. */
     sendSlice = (Slice *)list_nth(sliceTable->slices, node->motionID);
@@ -1146,8 +1138,26 @@ ExecInitMotion(Motion * node, EState *estate, int eflags)
 		 */
 		motionstate->cdbhash = makeCdbHash(node->numOutputSegs);
 		motionstate->hashfunctions = (FmgrInfo *) palloc0(nkeys * sizeof(FmgrInfo)); 
+		motionstate->hashkeyfuncs = (CdbHashKeyFunction *) palloc0(nkeys * sizeof(CdbHashKeyFunction));
+		motionstate->hashkeyattnos = (AttrNumber *) palloc0(nkeys * sizeof(AttrNumber));
 		int nth = 0;
 		ListCell *ht;
+		ListCell *hk;
+
+		/*
+		 * Resolve each key's hash function once, and note the keys that are
+		 * just a column of the outer tuple so they can be fetched directly.
+		 */
+		forboth (hk, node->hashExpr, ht, node->hashDataTypes) {
+			Var *var = (Var *) lfirst(hk);
+
+			motionstate->hashkeyfuncs[nth] = cdbhash_get_keyfunction(lfirst_oid(ht));
+			if (IsA(var, Var) && var->varno == OUTER && var->varattno > 0)
+				motionstate->hashkeyattnos[nth] = var->varattno;
+			nth++;
+		}
+
+		nth = 0;
 		foreach (ht, node->hashDataTypes) {
 			Operator optup;
 			Oid eqoid;
@@ -1200,6 +1210,23 @@ ExecInitMotion(Motion * node, EState *estate, int eflags)
 			tupDesc, 
 			PlanStateOperatorMemKB((PlanState *) motionstate));
 
+	/*
+	 * Redistribute and broadcast senders may batch their rows.  Gather
+	 * motions are left alone, they are mostly small, and their rows are
+	 * fixed up on the way to the master (see mapTransientTypeMod()).
+	 */
+	if (gp_enable_motion_batch &&
+		motionstate->mstype == MOTIONSTATE_SEND &&
+		!node->sendSorted &&
+		(node->motionType == MOTIONTYPE_HASH ||
+		 (node->motionType == MOTIONTYPE_FIXED && node->numOutputSegs == 0)))
+	{
+		MotionNodeEntry *pEntry = getMotionNodeEntry(motionstate->ps.state->motionlayer_context,
+													 node->motionID, "ExecInitMotion");
+
+		motionstate->sendBatches = SerTupInfoCanBatch(&pEntry->ser_tup_info);
+	}
+
 	
 #ifdef CDB_MOTION_DEBUG
     motionstate->outputFunArray = (Oid *)palloc(tupDesc->natts * sizeof(Oid));
@@ -1483,11 +1510,16 @@ CdbMergeComparator_DestroyContext(CdbMergeComparatorContext *ctx)
 
 
 /*
- * Experimental code that will be replaced later with new hashing mechanism
+ * Hash the keys of the outer tuple in econtext and reduce the hash to a
+ * segment.  Keys that are plain columns are fetched from the slot without
+ * going through expression evaluation, and hashed with the function
+ * ExecInitMotion resolved for their type.
  */
 static uint32
-evalHashKey(ExprContext *econtext, List *hashkeys, List *hashtypes, CdbHash * h, FmgrInfo *hashfns)
+evalHashKey(MotionState *node, ExprContext *econtext, List *hashtypes)
 {
+	CdbHash    *h = node->cdbhash;
+	List	   *hashkeys = node->hashExpr;
 	ListCell   *hk;
 	ListCell   *ht;
 	MemoryContext oldContext;
@@ -1517,15 +1549,21 @@ evalHashKey(ExprContext *econtext, List *hashkeys, List *hashtypes, CdbHash * h,
 			/*
 			 * Get the attribute value of the tuple
 			 */
-			keyval = ExecEvalExpr(keyexpr, econtext, &isNull, NULL);
+			if (node->hashkeyattnos[nth] > 0)
+				keyval = slot_getattr(econtext->ecxt_outertuple,
+									  node->hashkeyattnos[nth], &isNull);
+			else
+				keyval = ExecEvalExpr(keyexpr, econtext, &isNull, NULL);
 			
 			/*
 			 * Compute the hash function
 			 */
-			if (!isNull)			/* treat nulls as having hash key 0 */
-				cdbhash(h, keyval, lfirst_oid(ht), &hashfns[nth]);
-			else
+			if (isNull)				/* treat nulls as having hash key 0 */
 				cdbhashnull(h);
+			else if (node->hashkeyfuncs[nth] != NULL)
+				cdbhashkey(h, node->hashkeyfuncs[nth], keyval);
+			else
+				cdbhash(h, keyval, lfirst_oid(ht), &node->hashfunctions[nth]);
 
 			nth++;
 		}
@@ -1633,7 +1671,7 @@ void
 doSendTuple(Motion * motion, MotionState * node, TupleTableSlot *outerTupleSlot, MemTuple mtup, int reduced_hval)
 {
 	int16		    targetRoute;
-	HeapTuple       tuple;
+	HeapTuple       tuple = NULL;
 	SendReturnCode  sendRC;
 	ExprContext    *econtext = node->ps.ps_ExprContext;
 	
@@ -1672,8 +1710,7 @@ doSendTuple(Motion * motion, MotionState * node, TupleTableSlot *outerTupleSlot,
 		
 		hval = (reduced_hval >= 0
 				? reduced_hval
-				: evalHashKey(econtext, node->hashExpr,
-							  motion->hashDataTypes, node->cdbhash, node->hashfunctions));
+				: evalHashKey(node, econtext, motion->hashDataTypes));
 
 		Assert(0 <= hval && hval < getgpsegmentCount() && "redistribute destination outside segment array");
 		
@@ -1708,18 +1745,30 @@ doSendTuple(Motion * motion, MotionState * node, TupleTableSlot *outerTupleSlot,
 		mapTransientTypeMod(outerTupleSlot);
 	}
 
-    if (mtup) {
-        tuple = (HeapTuple) mtup;
-    } else {
-        tuple = ExecFetchSlotGenericTuple(outerTupleSlot, true);
-    }
-	
-	/* send the tuple out. */
-	sendRC = SendTuple(node->ps.state->motionlayer_context,
-			node->ps.state->interconnect_context,
-			motion->motionID,
-			tuple,
-			targetRoute);
+	if (node->sendBatches && !mtup)
+	{
+		/* add the row to the batch for its route */
+		sendRC = SendTupleSlot(node->ps.state->motionlayer_context,
+							   node->ps.state->interconnect_context,
+							   motion->motionID,
+							   outerTupleSlot,
+							   targetRoute);
+	}
+	else
+	{
+		if (mtup) {
+			tuple = (HeapTuple) mtup;
+		} else {
+			tuple = ExecFetchSlotGenericTuple(outerTupleSlot, true);
+		}
+
+		/* send the tuple out. */
+		sendRC = SendTuple(node->ps.state->motionlayer_context,
+				node->ps.state->interconnect_context,
+				motion->motionID,
+				tuple,
+				targetRoute);
+	}
 
 	Assert(sendRC == SEND_COMPLETE || sendRC == STOP_SENDING);
 	if (sendRC == SEND_COMPLETE)
@@ -1739,8 +1788,9 @@ doSendTuple(Motion * motion, MotionState * node, TupleTableSlot *outerTupleSlot,
 				motion->motionID,
 				targetRoute,
 				node->numTuplesToAMS);
-		formatTuple(&buf, tuple, ExecGetResultType(&node->ps),
-				node->outputFunArray);
+		if (tuple != NULL)
+			formatTuple(&buf, tuple, ExecGetResultType(&node->ps),
+					node->outputFunArray);
 		elog(DEBUG3, buf.data);
 		pfree(buf.data);
 	}
@@ -227,6 +227,12 @@ typedef struct WindowStatePerLevelData
 	FrameBufferEntry *curr_entry_buf;
 	FrameBufferEntry *trail_entry_buf;
 	FrameBufferEntry *lead_entry_buf;
+
+	/*
+	 * Sliding-window state for the aggregates in this level that are
+	 * computed by combining frame buffer entries, or NULL.
+	 */
+	struct WindowFrameAggData *frame_agg;
 }	WindowStatePerLevelData;
 
 /*
@@ -307,6 +313,12 @@ typedef struct WindowStatePerFunctionData
 	 * The total number of not NULL arguments for this function so far.
 	 */
 	uint64		numNotNulls;
+
+	/*
+	 * The index of this function in its level's frame_agg, or -1 if its
+	 * frame value is computed by scanning the frame buffer.
+	 */
+	int			frame_agg_index;
 }	WindowStatePerFunctionData;
 
 #define FRAME_TRAIL_ROWS	0
@@ -454,6 +466,79 @@ typedef struct WindowFrameBufferData
 }	WindowFrameBufferData;
 typedef WindowFrameBufferData *WindowFrameBuffer;
 
+/*
+ * WindowFrameAggData: the frame values of aggregates that have a
+ * preliminary function but no inverse preliminary function (min, max and
+ * the like) are computed by combining the partial aggregate values in the
+ * frame buffer entries between the frame edges.  Rather than combining all
+ * of them again for every row, this keeps the entries of the last frame in
+ * two stacks:
+ *
+ * - the back stack holds the newest entries in the order they were added,
+ *	 along with the combined value of all of them;
+ * - the front stack holds the older entries, each with the combined value
+ *	 of itself and all the newer entries in the front stack, so that the
+ *	 oldest entry is on top and carries the value of the whole stack.
+ *
+ * Entries that enter the frame are pushed on the back stack; entries that
+ * leave it are popped off the front stack, after moving the back stack over
+ * if the front one is empty.  The frame value is the top of the front stack
+ * combined with the value of the back stack, so each entry is combined a
+ * constant number of times as long as the frame edges only move forward.
+ * When they do not, everything is thrown away and the frame is rebuilt.
+ *
+ * This relies on the preliminary function being associative, which it has
+ * to be anyway to combine the partial results from the segments; the order
+ * of the entries is kept.
+ *
+ * Entries are identified by their position in the frame buffer.
+ *
+ * The stacks live outside the frame buffer and cannot spill, so they get
+ * the same share of the operator memory as the frame buffer of the level.
+ * Once they outgrow it, the sliding-window state is given up and the
+ * functions go back to scanning the frame buffer for every row.
+ */
+typedef struct WindowFrameAggValue
+{
+	Datum		value;
+	bool		isnull;
+	bool		novalue;
+}	WindowFrameAggValue;
+
+typedef struct WindowFrameAggData
+{
+	/* The functions, and where each one's value is kept in an entry */
+	int			numfuncs;
+	WindowStatePerFunction *funcs;
+
+	/* Holds the values of the entries; reset with the frame */
+	MemoryContext context;
+	MemoryManagerContainer mem_manager;
+
+	/* Used to read new entries; kept unpositioned between calls */
+	NTupleStoreAccessor *reader;
+
+	/* Memory the values and the stacks may take up */
+	long		maxbytes;
+
+	/*
+	 * The stacks.  Values are stored numfuncs per entry; front[i] is below
+	 * front[i + 1], back[0] is the oldest entry of the back stack.
+	 */
+	int			maxentries;
+	int			nfront;
+	NTupleStorePos *front_pos;
+	WindowFrameAggValue *front_values;
+	int			nback;
+	NTupleStorePos *back_pos;
+	WindowFrameAggValue *back_values;
+	WindowFrameAggValue *back_total;
+
+	/* Position of the newest entry, valid if there are any entries */
+	NTupleStorePos last_pos;
+}	WindowFrameAggData;
+typedef WindowFrameAggData *WindowFrameAgg;
+
 static WindowFrameBuffer createRangeFrameBuffer(Datum trail_range,
 					   Datum lead_range,
 					   int bytes);
@@ -488,6 +573,14 @@ static void resetTransValues(WindowStatePerLevel level_state,
 static void freeFrameBuffer(WindowFrameBuffer buffer);
 static void freeFrameBuffers(WindowState * wstate);
 
+static void initFrameAgg(WindowStatePerLevel level_state, WindowState * wstate);
+static void resetFrameAgg(WindowFrameAgg frame_agg);
+static void freeFrameAgg(WindowStatePerLevel level_state);
+static bool computeFrameAggValues(WindowStatePerLevel level_state,
+					  WindowState * wstate,
+					  NTupleStorePos *first_pos,
+					  NTupleStorePos *last_pos);
+
 /*
  * WindowBufferCursor
  * This is an abstract cursor to scan the frame buffer.  This holds transient
@@ -671,6 +764,13 @@ createFrameBuffers(WindowState * wstate)
 			ntuplestore_create_accessor(level_state->frame_buffer->tuplestore, false);
 
 		level_state->frame_buffer->level_state = level_state;
+
+		if (level_state->frame_agg)
+		{
+			resetFrameAgg(level_state->frame_agg);
+			level_state->frame_agg->reader =
+				ntuplestore_create_accessor(level_state->frame_buffer->tuplestore, false);
+		}
 	}
 }
 
@@ -727,6 +827,8 @@ resetFrameBuffers(WindowState * wstate)
 				ntuplestore_destroy_accessor(level_state->trail_reader);
 			if (level_state->lead_reader)
 				ntuplestore_destroy_accessor(level_state->lead_reader);
+			if (level_state->frame_agg && level_state->frame_agg->reader)
+				ntuplestore_destroy_accessor(level_state->frame_agg->reader);
 
 			level_state->frame_buffer = resetFrameBuffer(level_state->frame_buffer);
 
@@ -735,6 +837,14 @@ resetFrameBuffers(WindowState * wstate)
 				ntuplestore_create_accessor(level_state->frame_buffer->tuplestore, false);
 			level_state->lead_reader =
 				ntuplestore_create_accessor(level_state->frame_buffer->tuplestore, false);
+
+			/* positions in the buffer start over */
+			if (level_state->frame_agg)
+			{
+				resetFrameAgg(level_state->frame_agg);
+				level_state->frame_agg->reader =
+					ntuplestore_create_accessor(level_state->frame_buffer->tuplestore, false);
+			}
 		}
 
 		level_state->num_trail_rows = 0;
@@ -779,6 +889,11 @@ freeFrameBuffers(WindowState * wstate)
 				ntuplestore_destroy_accessor(level_state->trail_reader);
 			if (level_state->lead_reader)
 				ntuplestore_destroy_accessor(level_state->lead_reader);
+			if (level_state->frame_agg && level_state->frame_agg->reader)
+			{
+				ntuplestore_destroy_accessor(level_state->frame_agg->reader);
+				level_state->frame_agg->reader = NULL;
+			}
 
 			freeFrameBuffer(level_state->frame_buffer);
 			level_state->frame_buffer = NULL;
@@ -1872,6 +1987,427 @@ freeTransValue(Datum *transValue,
 	*noTransValue = true;
 }
 
+/*
+ * initFrameAgg -- set up the sliding-window state for the aggregates of the
+ * given level that can use it.
+ */
+static void
+initFrameAgg(WindowStatePerLevel level_state, WindowState * wstate)
+{
+	WindowFrameAgg frame_agg;
+	ListCell   *lc;
+	int			numfuncs = 0;
+
+	foreach(lc, level_state->level_funcs)
+	{
+		WindowStatePerFunction funcstate = (WindowStatePerFunction) lfirst(lc);
+
+		funcstate->frame_agg_index = -1;
+
+		if (gp_enable_sliding_window_agg &&
+			funcstate->isAgg &&
+			!funcstate->trivial_frame &&
+			!funcstate->winpeercount &&
+			!funcstate->cumul_frame &&
+			OidIsValid(funcstate->prelimfn_oid) &&
+			!OidIsValid(funcstate->invprelimfn_oid))
+			funcstate->frame_agg_index = numfuncs++;
+	}
+
+	level_state->frame_agg = NULL;
+	if (numfuncs == 0)
+		return;
+
+	frame_agg = (WindowFrameAgg) palloc0(sizeof(WindowFrameAggData));
+	frame_agg->numfuncs = numfuncs;
+	frame_agg->funcs = (WindowStatePerFunction *)
+		palloc(numfuncs * sizeof(WindowStatePerFunction));
+	foreach(lc, level_state->level_funcs)
+	{
+		WindowStatePerFunction funcstate = (WindowStatePerFunction) lfirst(lc);
+
+		if (funcstate->frame_agg_index >= 0)
+			frame_agg->funcs[funcstate->frame_agg_index] = funcstate;
+	}
+
+	frame_agg->context = AllocSetContextCreate(wstate->transcontext,
+											   "WindowFrameAggContext",
+											   ALLOCSET_DEFAULT_MINSIZE,
+											   ALLOCSET_DEFAULT_INITSIZE,
+											   ALLOCSET_DEFAULT_MAXSIZE);
+	frame_agg->mem_manager.manager = frame_agg->context;
+	frame_agg->mem_manager.alloc = cxt_alloc;
+	frame_agg->mem_manager.free = cxt_free;
+	frame_agg->mem_manager.realloc_ratio = 1;
+
+	frame_agg->maxbytes = ((PlanStateOperatorMemKB((PlanState *) wstate) * 1024L) / 2) /
+		Max(wstate->numlevels, 1);
+
+	frame_agg->maxentries = 64;
+	frame_agg->front_pos = (NTupleStorePos *)
+		palloc(frame_agg->maxentries * sizeof(NTupleStorePos));
+	frame_agg->front_values = (WindowFrameAggValue *)
+		palloc(frame_agg->maxentries * numfuncs * sizeof(WindowFrameAggValue));
+	frame_agg->back_pos = (NTupleStorePos *)
+		palloc(frame_agg->maxentries * sizeof(NTupleStorePos));
+	frame_agg->back_values = (WindowFrameAggValue *)
+		palloc(frame_agg->maxentries * numfuncs * sizeof(WindowFrameAggValue));
+	frame_agg->back_total = (WindowFrameAggValue *)
+		palloc(numfuncs * sizeof(WindowFrameAggValue));
+
+	level_state->frame_agg = frame_agg;
+	resetFrameAgg(frame_agg);
+}
+
+/*
+ * resetFrameAgg -- forget all the entries in the sliding-window state.
+ */
+static void
+resetFrameAgg(WindowFrameAgg frame_agg)
+{
+	int			i;
+
+	MemoryContextReset(frame_agg->context);
+	frame_agg->nfront = 0;
+	frame_agg->nback = 0;
+
+	for (i = 0; i < frame_agg->numfuncs; i++)
+	{
+		frame_agg->back_total[i].value = 0;
+		frame_agg->back_total[i].isnull = true;
+		frame_agg->back_total[i].novalue = true;
+	}
+}
+
+/*
+ * freeFrameAgg -- give up the sliding-window state of the given level; its
+ * functions are computed by scanning the frame buffer from now on.
+ */
+static void
+freeFrameAgg(WindowStatePerLevel level_state)
+{
+	WindowFrameAgg frame_agg = level_state->frame_agg;
+	int			i;
+
+	for (i = 0; i < frame_agg->numfuncs; i++)
+		frame_agg->funcs[i]->frame_agg_index = -1;
+
+	if (frame_agg->reader)
+		ntuplestore_destroy_accessor(frame_agg->reader);
+	MemoryContextDelete(frame_agg->context);
+
+	pfree(frame_agg->front_pos);
+	pfree(frame_agg->front_values);
+	pfree(frame_agg->back_pos);
+	pfree(frame_agg->back_values);
+	pfree(frame_agg->back_total);
+	pfree(frame_agg->funcs);
+	pfree(frame_agg);
+
+	level_state->frame_agg = NULL;
+}
+
+/*
+ * Memory taken up by the values and the stacks of the sliding-window state.
+ */
+static long
+frameAggSpace(WindowFrameAgg frame_agg)
+{
+	return (long) MemoryContextGetCurrentSpace(frame_agg->context) +
+		(long) frame_agg->maxentries *
+		(2 * sizeof(NTupleStorePos) +
+		 2 * frame_agg->numfuncs * sizeof(WindowFrameAggValue));
+}
+
+/*
+ * Copy the initial value of an aggregate into 'result'.
+ */
+static void
+frameAggInitValue(WindowFrameAgg frame_agg, WindowStatePerFunction funcstate,
+				  WindowFrameAggValue *result)
+{
+	result->value = datumCopyWithMemManager(0, funcstate->aggInitValue,
+											funcstate->aggTranstypeByVal,
+											funcstate->aggTranstypeLen,
+											&frame_agg->mem_manager);
+	result->isnull = funcstate->aggInitValueIsNull;
+	result->novalue = funcstate->aggInitValueIsNull;
+}
+
+/*
+ * Combine 'value' into 'result' with the preliminary function.
+ */
+static void
+frameAggCombine(WindowStatePerFunction funcstate, WindowState * wstate,
+				MemoryManagerContainer *mem_manager,
+				WindowFrameAggValue *result, WindowFrameAggValue *value)
+{
+	FunctionCallInfoData fcinfo;
+
+	fcinfo.arg[1] = value->value;
+	fcinfo.argnull[1] = value->isnull;
+	result->value =
+		invoke_agg_trans_func(&funcstate->prelimfn,
+							  funcstate->prelimfn.fn_nargs - 1,
+							  result->value,
+							  &result->novalue,
+							  &result->isnull,
+							  funcstate->aggTranstypeByVal,
+							  funcstate->aggTranstypeLen,
+							  &fcinfo, (void *) wstate,
+							  wstate->ps.ps_ExprContext->ecxt_per_tuple_memory,
+							  mem_manager);
+}
+
+static void
+frameAggFreeValue(WindowStatePerFunction funcstate, WindowFrameAggValue *value)
+{
+	if (!funcstate->aggTranstypeByVal && !value->isnull &&
+		DatumGetPointer(value->value) != NULL)
+		pfree(DatumGetPointer(value->value));
+}
+
+/*
+ * frameAggPush -- add the frame buffer entry in 'entry' at 'pos' to the
+ * back stack.
+ */
+static void
+frameAggPush(WindowFrameAgg frame_agg, WindowState * wstate,
+			 FrameBufferEntry *entry, NTupleStorePos *pos)
+{
+	int			i;
+
+	if (frame_agg->nback == frame_agg->maxentries)
+	{
+		int			maxentries = frame_agg->maxentries * 2;
+		int			numfuncs = frame_agg->numfuncs;
+
+		frame_agg->front_pos = (NTupleStorePos *)
+			repalloc(frame_agg->front_pos, maxentries * sizeof(NTupleStorePos));
+		frame_agg->front_values = (WindowFrameAggValue *)
+			repalloc(frame_agg->front_values,
+					 maxentries * numfuncs * sizeof(WindowFrameAggValue));
+		frame_agg->back_pos = (NTupleStorePos *)
+			repalloc(frame_agg->back_pos, maxentries * sizeof(NTupleStorePos));
+		frame_agg->back_values = (WindowFrameAggValue *)
+			repalloc(frame_agg->back_values,
+					 maxentries * numfuncs * sizeof(WindowFrameAggValue));
+		frame_agg->maxentries = maxentries;
+	}
+
+	for (i = 0; i < frame_agg->numfuncs; i++)
+	{
+		WindowStatePerFunction funcstate = frame_agg->funcs[i];
+		WindowValue *entry_value = (WindowValue *)
+			list_nth(entry->func_values, funcstate->serial_index);
+		WindowFrameAggValue *value =
+			&frame_agg->back_values[frame_agg->nback * frame_agg->numfuncs + i];
+
+		Assert(entry_value);
+
+		value->isnull = entry_value->valueIsNull;
+		value->novalue = false;
+		value->value = 0;
+		if (!value->isnull)
+			value->value = datumCopyWithMemManager(0, entry_value->value,
+												   funcstate->aggTranstypeByVal,
+												   funcstate->aggTranstypeLen,
+												   &frame_agg->mem_manager);
+
+		if (frame_agg->nback == 0)
+			frameAggInitValue(frame_agg, funcstate, &frame_agg->back_total[i]);
+		frameAggCombine(funcstate, wstate, &frame_agg->mem_manager,
+						&frame_agg->back_total[i], value);
+	}
+
+	frame_agg->back_pos[frame_agg->nback++] = *pos;
+	frame_agg->last_pos = *pos;
+}
+
+/*
+ * frameAggFlip -- move the back stack over to the empty front stack,
+ * computing the combined value of each entry and all the newer ones.
+ */
+static void
+frameAggFlip(WindowFrameAgg frame_agg, WindowState * wstate)
+{
+	int			numfuncs = frame_agg->numfuncs;
+	int			n = frame_agg->nback;
+	int			j;
+	int			i;
+
+	Assert(frame_agg->nfront == 0);
+
+	/* front[n - 1 - j] holds back[j], so that the oldest one is on top */
+	for (j = n - 1; j >= 0; j--)
+	{
+		int			k = n - 1 - j;
+
+		for (i = 0; i < numfuncs; i++)
+		{
+			WindowStatePerFunction funcstate = frame_agg->funcs[i];
+			WindowFrameAggValue *value = &frame_agg->back_values[j * numfuncs + i];
+			WindowFrameAggValue *result = &frame_agg->front_values[k * numfuncs + i];
+
+			frameAggInitValue(frame_agg, funcstate, result);
+			frameAggCombine(funcstate, wstate,
+							&frame_agg->mem_manager, result, value);
+			if (k > 0)
+				frameAggCombine(funcstate, wstate,
+								&frame_agg->mem_manager, result,
+								&frame_agg->front_values[(k - 1) * numfuncs + i]);
+			frameAggFreeValue(funcstate, value);
+		}
+		frame_agg->front_pos[k] = frame_agg->back_pos[j];
+	}
+
+	for (i = 0; i < numfuncs; i++)
+	{
+		frameAggFreeValue(frame_agg->funcs[i], &frame_agg->back_total[i]);
+		frame_agg->back_total[i].value = 0;
+		frame_agg->back_total[i].isnull = true;
+		frame_agg->back_total[i].novalue = true;
+	}
+
+	frame_agg->nfront = n;
+	frame_agg->nback = 0;
+}
+
+/*
+ * frameAggPop -- remove the oldest entry.
+ */
+static void
+frameAggPop(WindowFrameAgg frame_agg, WindowState * wstate)
+{
+	int			i;
+
+	if (frame_agg->nfront == 0)
+		frameAggFlip(frame_agg, wstate);
+
+	Assert(frame_agg->nfront > 0);
+
+	frame_agg->nfront--;
+	for (i = 0; i < frame_agg->numfuncs; i++)
+		frameAggFreeValue(frame_agg->funcs[i],
+						  &frame_agg->front_values[frame_agg->nfront *
+												   frame_agg->numfuncs + i]);
+}
+
+/*
+ * Position of the oldest entry in the sliding-window state.
+ */
+static NTupleStorePos *
+frameAggFirstPos(WindowFrameAgg frame_agg)
+{
+	Assert(frame_agg->nfront + frame_agg->nback > 0);
+
+	if (frame_agg->nfront > 0)
+		return &frame_agg->front_pos[frame_agg->nfront - 1];
+	return &frame_agg->back_pos[0];
+}
+
+/*
+ * computeFrameAggValues -- compute the values of the sliding-window
+ * aggregates of the given level over the frame buffer entries from
+ * 'first_pos' to 'last_pos', inclusive.
+ *
+ * The final_aggTransValue of each function must hold its initial value;
+ * the combined value of the entries is added to it.
+ *
+ * Returns false, leaving the final_aggTransValues alone, if the state grew
+ * past its memory limit and was given up; the caller has to scan instead.
+ */
+static bool
+computeFrameAggValues(WindowStatePerLevel level_state,
+					  WindowState * wstate,
+					  NTupleStorePos *first_pos,
+					  NTupleStorePos *last_pos)
+{
+	WindowFrameAgg frame_agg = level_state->frame_agg;
+	NTupleStore *ts = level_state->frame_buffer->tuplestore;
+	FrameBufferEntry *entry = level_state->curr_entry_buf;
+	NTupleStorePos pos;
+	bool		found;
+	int			i;
+
+	Assert(frame_agg != NULL && frame_agg->reader != NULL);
+
+	/* Start over if the frame moved backwards or past what we have. */
+	if (frame_agg->nfront + frame_agg->nback > 0 &&
+		(ntuplestore_compare_pos(ts, first_pos, frameAggFirstPos(frame_agg)) < 0 ||
+		 ntuplestore_compare_pos(ts, first_pos, &frame_agg->last_pos) > 0 ||
+		 ntuplestore_compare_pos(ts, last_pos, &frame_agg->last_pos) < 0))
+		resetFrameAgg(frame_agg);
+
+	/* Drop the entries that left the frame */
+	while (frame_agg->nfront + frame_agg->nback > 0 &&
+		   ntuplestore_compare_pos(ts, frameAggFirstPos(frame_agg), first_pos) < 0)
+		frameAggPop(frame_agg, wstate);
+
+	/* Moving the back stack over may have taken up more memory */
+	if (frameAggSpace(frame_agg) > frame_agg->maxbytes)
+	{
+		freeFrameAgg(level_state);
+		return false;
+	}
+
+	/* Add the entries that entered it */
+	if (frame_agg->nfront + frame_agg->nback == 0)
+	{
+		ntuplestore_acc_seek(frame_agg->reader, first_pos);
+		found = getCurrentValue(frame_agg->reader, level_state, entry);
+		Assert(found);
+		frameAggPush(frame_agg, wstate, entry, first_pos);
+	}
+	else
+		ntuplestore_acc_seek(frame_agg->reader, &frame_agg->last_pos);
+
+	while (ntuplestore_compare_pos(ts, &frame_agg->last_pos, last_pos) < 0)
+	{
+		ntuplestore_acc_advance(frame_agg->reader, 1);
+		found = ntuplestore_acc_tell(frame_agg->reader, &pos);
+		Assert(found);
+		found = getCurrentValue(frame_agg->reader, level_state, entry);
+		Assert(found);
+		frameAggPush(frame_agg, wstate, entry, &pos);
+
+		if (frameAggSpace(frame_agg) > frame_agg->maxbytes)
+		{
+			freeFrameAgg(level_state);
+			return false;
+		}
+	}
+
+	/* Do not keep a page of the frame buffer pinned */
+	ntuplestore_acc_set_invalid(frame_agg->reader);
+
+	for (i = 0; i < frame_agg->numfuncs; i++)
+	{
+		WindowStatePerFunction funcstate = frame_agg->funcs[i];
+		WindowFrameAggValue result;
+
+		result.value = funcstate->final_aggTransValue;
+		result.isnull = funcstate->final_aggTransValueIsNull;
+		result.novalue = funcstate->final_aggNoTransValue;
+
+		if (frame_agg->nfront > 0)
+			frameAggCombine(funcstate, wstate, &wstate->mem_manager,
+							&result,
+							&frame_agg->front_values[(frame_agg->nfront - 1) *
+													 frame_agg->numfuncs + i]);
+		if (frame_agg->nback > 0)
+			frameAggCombine(funcstate, wstate, &wstate->mem_manager,
+							&result, &frame_agg->back_total[i]);
+
+		funcstate->final_aggTransValue = result.value;
+		funcstate->final_aggTransValueIsNull = result.isnull;
+		funcstate->final_aggNoTransValue = result.novalue;
+		funcstate->final_aggShouldFree = true;
+	}
+
+	return true;
+}
+
 /*
  * computeTransValuesThroughScan -- compute transition values
  * for those functions in the given level whose aggregate values
@@ -1891,6 +2427,7 @@ computeTransValuesThroughScan(WindowStatePerLevel level_state,
 	ExprContext *econtext = wstate->ps.ps_ExprContext;
 	FunctionCallInfoData fcinfo;
 	NTupleStorePos orig_pos;
+	bool		need_scan = false;
 
 	has_tuples = hasTuplesInFrame(level_state, wstate);
 
@@ -1944,13 +2481,43 @@ computeTransValuesThroughScan(WindowStatePerLevel level_state,
 		funcstate->final_aggTransValueIsNull = funcstate->aggInitValueIsNull;
 		funcstate->final_aggNoTransValue = funcstate->aggInitValueIsNull;
 		funcstate->final_aggShouldFree = !funcstate->aggInitValueIsNull;
+
+		if (funcstate->frame_agg_index < 0)
+			need_scan = true;
 	}
 
 	if (has_tuples)
 	{
 		bool		include_last_agg = false;
+		NTupleStorePos first_pos;
+		NTupleStorePos last_pos;
 
-		while (ntuplestore_acc_tell(level_state->trail_reader, NULL))
+		/*
+		 * Combine the entries between the edges for the functions that keep
+		 * a sliding-window state, then scan them for the others.
+		 */
+		if (level_state->frame_agg != NULL &&
+			ntuplestore_acc_tell(level_state->trail_reader, &first_pos))
+		{
+			bool		has_entries;
+
+			if (ntuplestore_acc_tell(level_state->lead_reader, &last_pos))
+				has_entries = !ntuplestore_acc_is_before(level_state->lead_reader,
+												  level_state->trail_reader);
+			else
+			{
+				has_entries =
+					ntuplestore_acc_seek_last(level_state->frame_agg->reader) &&
+					ntuplestore_acc_tell(level_state->frame_agg->reader, &last_pos);
+				ntuplestore_acc_set_invalid(level_state->frame_agg->reader);
+			}
+
+			if (has_entries &&
+				!computeFrameAggValues(level_state, wstate, &first_pos, &last_pos))
+				need_scan = true;
+		}
+
+		while (need_scan && ntuplestore_acc_tell(level_state->trail_reader, NULL))
 		{
 			if (ntuplestore_acc_tell(level_state->lead_reader, NULL) &&
 				ntuplestore_acc_is_before(level_state->lead_reader,
@@ -1976,7 +2543,8 @@ computeTransValuesThroughScan(WindowStatePerLevel level_state,
 					funcstate->winpeercount ||
 					(funcstate->isAgg &&
 					 OidIsValid(funcstate->invprelimfn_oid)) ||
-					!funcstate->isAgg)
+					!funcstate->isAgg ||
+					funcstate->frame_agg_index >= 0)
 					continue;
 
 				if (OidIsValid(funcstate->prelimfn_oid))
@@ -5849,6 +6417,8 @@ init_frames(WindowState * wstate)
 		level_state->curr_entry_buf = createFrameBufferEntry(level_state);
 		level_state->trail_entry_buf = createFrameBufferEntry(level_state);
 		level_state->lead_entry_buf = createFrameBufferEntry(level_state);
+
+		initFrameAgg(level_state, wstate);
 	}
 }
 
@@ -126,6 +126,88 @@ test__getSpillFile__Initialize_wfile_exception(void **state)
 	assert_true(false);
 }
 
+/* ==================== grow_agg_hash_table ==================== */
+/*
+ * Test that growing the hash table keeps every entry reachable by probing
+ * from its home bucket, including entries that had moved past the end of
+ * the old bucket array.
+ */
+void
+test__grow_agg_hash_table__Rehash(void **state)
+{
+	AggState *aggstate = (AggState *) palloc0(sizeof(AggState));
+	HashAggTable *hashtable = (HashAggTable *) palloc0(sizeof(HashAggTable));
+	HashAggEntry *entries = (HashAggEntry *) palloc0(24 * sizeof(HashAggEntry));
+	unsigned hash_bit = 3;
+	unsigned mask;
+	int i;
+
+	aggstate->aggcontext = CurrentMemoryContext;
+	aggstate->hhashtable = hashtable;
+	hashtable->max_mem = 1024.0 * 1024.0;
+	hashtable->nbuckets = 32;
+	hashtable->buckets = (HashAggBucket *) palloc0(32 * sizeof(HashAggBucket));
+
+	/* All entries share the last four home buckets, so most of them wrap. */
+	mask = hashtable->nbuckets - 1;
+	for (i = 0; i < 24; i++)
+	{
+		HashKey hashvalue = ((HashKey) (i * 64 + 28 + i % 4) << hash_bit) | 5;
+		unsigned bucket_idx = (hashvalue >> hash_bit) & mask;
+
+		while (hashtable->buckets[bucket_idx].entry != NULL)
+			bucket_idx = (bucket_idx + 1) & mask;
+
+		entries[i].hashvalue = hashvalue;
+		hashtable->buckets[bucket_idx].entry = &entries[i];
+		hashtable->buckets[bucket_idx].hashvalue = hashvalue;
+	}
+	hashtable->nbuckets_used = 24;
+
+	expect_value(mpool_bytes_used, mpool, NULL);
+	will_return(mpool_bytes_used, 0);
+
+	assert_true(grow_agg_hash_table(aggstate, hash_bit));
+	assert_int_equal(hashtable->nbuckets, 64);
+
+	mask = hashtable->nbuckets - 1;
+	for (i = 0; i < 24; i++)
+	{
+		unsigned bucket_idx = (entries[i].hashvalue >> hash_bit) & mask;
+
+		while (hashtable->buckets[bucket_idx].entry != &entries[i])
+		{
+			assert_true(hashtable->buckets[bucket_idx].entry != NULL);
+			bucket_idx = (bucket_idx + 1) & mask;
+		}
+		assert_int_equal(hashtable->buckets[bucket_idx].hashvalue, entries[i].hashvalue);
+	}
+}
+
+/* ==================== calcHashAggTableSizes ==================== */
+/*
+ * Test that the number of buckets is a power of 2 even when it is raised
+ * to a gp_hashagg_default_nbatches that is not one.
+ */
+void
+test__calcHashAggTableSizes__BucketsPowerOfTwo(void **state)
+{
+	HashAggTableSizes hats;
+
+	gp_hashagg_default_nbatches = 1000;
+	gp_hashagg_groups_per_bucket = 5;
+
+	/*
+	 * Barely enough memory for the batch files, so far fewer buckets than
+	 * batches are wanted.
+	 */
+	assert_true(calcHashAggTableSizes(1001 * BATCHFILE_METADATA + 10,
+									  1000000.0, 1, 8, 0, true, &hats));
+
+	assert_int_equal(hats.nbatches, 1000);
+	assert_int_equal(hats.nbuckets, 1024);
+}
+
 /* ==================== main ==================== */
 int
 main(int argc, char* argv[])
@@ -134,7 +216,9 @@ main(int argc, char* argv[])
 
 	const UnitTest tests[] = {
 		unit_test(test__getSpillFile__Initialize_wfile_success),
-		unit_test(test__getSpillFile__Initialize_wfile_exception)
+		unit_test(test__getSpillFile__Initialize_wfile_exception),
+		unit_test(test__grow_agg_hash_table__Rehash),
+		unit_test(test__calcHashAggTableSizes__BucketsPowerOfTwo)
 	};
 
 	return run_tests(tests);
@@ -3160,4 +3160,68 @@ gpdb::FMDCacheNeedsReset
 	return true;
 }
 
+bool
+gpdb::FSharedMDCacheEnabled
+	(
+	void
+	)
+{
+	GP_WRAP_START;
+	{
+		return SharedMDCacheEnabled();
+	}
+	GP_WRAP_END;
+
+	return false;
+}
+
+uint64
+gpdb::UllSharedMDCacheBeginLoad
+	(
+	void
+	)
+{
+	GP_WRAP_START;
+	{
+		// catalog tables: all, invalidations are absorbed here
+		return SharedMDCacheBeginLoad();
+	}
+	GP_WRAP_END;
+
+	return 0;
+}
+
+void *
+gpdb::PvSharedMDCacheLookup
+	(
+	const char *szMDId,
+	Size *psize
+	)
+{
+	GP_WRAP_START;
+	{
+		return SharedMDCacheLookup(szMDId, psize);
+	}
+	GP_WRAP_END;
+
+	return NULL;
+}
+
+void
+gpdb::SharedMDCacheInsert
+	(
+	const char *szMDId,
+	const void *pv,
+	Size size,
+	uint64 ullGeneration
+	)
+{
+	GP_WRAP_START;
+	{
+		::SharedMDCacheInsert(szMDId, pv, size, ullGeneration);
+		return;
+	}
+	GP_WRAP_END;
+}
+
 // EOF
@@ -25,6 +25,11 @@
 
 #include "naucrates/exception.h"
 
+#include "nodes/primnodes.h"
+#include "utils/sharedmdcache.h"
+
+#include "gpopt/gpdbwrappers.h"
+
 using namespace gpos;
 using namespace gpdxl;
 using namespace gpmd;
@@ -47,12 +52,51 @@ CMDProviderRelcache::CMDProviderRelcache
 	GPOS_ASSERT(NULL != m_pmp);
 }
 
+//---------------------------------------------------------------------------
+//	@function:
+//		CMDProviderRelcache::FSharedCacheKey
+//
+//	@doc:
+//		Build the key of the given metadata object in the metadata cache
+//		shared by all sessions; return false if the object cannot be
+//		kept there
+//
+//---------------------------------------------------------------------------
+BOOL
+CMDProviderRelcache::FSharedCacheKey
+	(
+	IMDId *pmdid,
+	CHAR *szKey,
+	ULONG ulKeyLen
+	)
+{
+	const WCHAR *wszMDId = pmdid->Wsz();
+
+	// metadata ids are made of digits and separators only
+	ULONG ul = 0;
+	for (; WCHAR('\0') != wszMDId[ul]; ul++)
+	{
+		if (ul + 1 >= ulKeyLen || 0x7f < wszMDId[ul])
+		{
+			return false;
+		}
+		szKey[ul] = (CHAR) wszMDId[ul];
+	}
+	szKey[ul] = '\0';
+
+	return true;
+}
+
+
 //---------------------------------------------------------------------------
 //	@function:
 //		CMDProviderRelcache::PstrObject
 //
 //	@doc:
-//		Returns the DXL of the requested object in the provided memory pool
+//		Returns the DXL of the requested object in the provided memory pool;
+//		the metadata cache shared by all sessions is consulted before
+//		translating the object from the relcache, unless the current
+//		transaction has changed catalogs
 //
 //---------------------------------------------------------------------------
 CWStringBase *
@@ -64,6 +108,27 @@ CMDProviderRelcache::PstrObject
 	)
 	const
 {
+	CHAR szKey[SHARED_MDCACHE_MDID_LEN];
+	BOOL fShared = gpdb::FSharedMDCacheEnabled() && FSharedCacheKey(pmdid, szKey, GPOS_ARRAY_SIZE(szKey));
+
+	uint64 ullGeneration = 0;
+	if (fShared)
+	{
+		Size size = 0;
+		WCHAR *wsz = (WCHAR *) gpdb::PvSharedMDCacheLookup(szKey, &size);
+		if (NULL != wsz)
+		{
+			GPOS_ASSERT(WCHAR('\0') == wsz[size / GPOS_SIZEOF(WCHAR) - 1]);
+
+			CWStringDynamic *pstr = GPOS_NEW(m_pmp) CWStringDynamic(m_pmp, wsz);
+			gpdb::GPDBFree(wsz);
+
+			return pstr;
+		}
+
+		ullGeneration = gpdb::UllSharedMDCacheBeginLoad();
+	}
+
 	IMDCacheObject *pimdobj = CTranslatorRelcacheToDXL::Pimdobj(pmp, pmda, pmdid);
 
 	GPOS_ASSERT(NULL != pimdobj);
@@ -73,6 +138,11 @@ CMDProviderRelcache::PstrObject
 	// cleanup DXL object
 	pimdobj->Release();
 
+	if (fShared)
+	{
+		gpdb::SharedMDCacheInsert(szKey, pstr->Wsz(), (pstr->UlLength() + 1) * GPOS_SIZEOF(WCHAR), ullGeneration);
+	}
+
 	return pstr;
 }
 
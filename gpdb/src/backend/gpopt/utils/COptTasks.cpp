@@ -519,8 +519,9 @@ COptTasks::Execute
 	if (optimizer_parallel)
 	{
 		// be-aware that parallel optimizer mode may conflict with GPDB signal handlers,
-		// this mode should be avoided unless optimizer is spawned in a different process
-		if (gpos_set_threads(4, 4))
+		// this mode should be avoided unless optimizer is spawned in a different process;
+		// one extra worker runs the optimizer task itself while the search workers run
+		if (gpos_set_threads(optimizer_parallel_workers + 1, optimizer_parallel_workers + 1))
 		{
 			elog(ERROR, "unable to set number of threads in gpos");
 			return;
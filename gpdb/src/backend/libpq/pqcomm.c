@@ -56,6 +56,7 @@
  *		pq_putbytes		- send bytes to connection (not flushed until pq_flush)
  *		pq_flush		- flush pending output
  *		pq_getbyte_if_available - get a byte if available without blocking
+ *		pq_is_input_pending - check for client input without blocking
  *
  * message-level I/O (and old-style-COPY-OUT cruft):
  *		pq_putmessage	- send a normal message (suppressed in COPY OUT mode)
@@ -75,6 +76,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <poll.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #ifdef HAVE_NETINET_TCP_H
@@ -1047,6 +1049,36 @@ pq_getbyte_if_available(unsigned char *c)
 	return r;
 }
 
+/* --------------------------------
+ *		pq_is_input_pending - is there client input waiting to be read?
+ *
+ * Never blocks and consumes nothing.  A closed or broken socket counts as
+ * pending input, so that the caller goes on to read and notices.
+ * --------------------------------
+ */
+bool
+pq_is_input_pending(void)
+{
+	struct pollfd pfd;
+
+	if (PqRecvPointer < PqRecvLength)
+		return true;
+
+#ifdef USE_SSL
+	if (MyProcPort->ssl && SSL_pending(MyProcPort->ssl) > 0)
+		return true;
+#endif
+
+	pfd.fd = MyProcPort->sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	if (poll(&pfd, 1, 0) < 0)
+		return errno != EINTR;
+
+	return pfd.revents != 0;
+}
+
 /* --------------------------------
  *		pq_getbytes		- get a known number of bytes from connection
  *
@@ -494,6 +494,7 @@ PlannerConfig *DefaultPlannerConfig(void)
 	c1->gp_enable_agg_distinct = gp_enable_agg_distinct;
 	c1->gp_enable_dqa_pruning = gp_enable_dqa_pruning;
 	c1->gp_eager_dqa_pruning = gp_eager_dqa_pruning;
+	c1->gp_enable_approx_count_distinct = gp_enable_approx_count_distinct;
 	c1->gp_eager_one_phase_agg = gp_eager_one_phase_agg;
 	c1->gp_eager_two_phase_agg = gp_eager_two_phase_agg;
 	c1->gp_enable_groupext_distinct_pruning = gp_enable_groupext_distinct_pruning;
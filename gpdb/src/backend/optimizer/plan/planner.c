@@ -1536,6 +1536,13 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 
 		if (parse->hasAggs)
 		{
+			/*
+			 * Multiple COUNT(DISTINCT) arguments may be estimated instead,
+			 * which saves planning a join of one aggregation per argument.
+			 */
+			if (root->config->gp_enable_approx_count_distinct)
+				approximate_count_distinct((Node *) tlist, parse->havingQual);
+
 			count_agg_clauses((Node *) tlist, &agg_counts);
 			count_agg_clauses(parse->havingQual, &agg_counts);
 		}
@@ -7,6 +7,7 @@
 #include "storage/fd.h"
 #include "miscadmin.h"
 #include "access/xact.h"
+#include "portability/instr_time.h"
 
 #include "utils/memutils.h"		/* For MemoryContext stuff */
 #include "cdb/cdbvars.h"
@@ -36,6 +37,8 @@ static const struct{
 {
     {{"none", "false", "no", "off", "0", 0}, bfz_nothing_init},
     {{"zlib", 0}, bfz_zlib_init},
+    {{"lz4", 0}, bfz_lz4_init},
+    {{"zstd", 0}, bfz_zstd_init},
     {{0}}
 };
 
@@ -134,7 +137,16 @@ write_bfz_buffer(bfz_t *bfz, bool isLast)
 	
 	PG_TRY();
 	{
+		instr_time	starttime;
+		instr_time	endtime;
+
+		INSTR_TIME_SET_CURRENT(starttime);
 		fs->write_ex(bfz, fs->buffer, fs->buffer_pointer - fs->buffer);
+		INSTR_TIME_SET_CURRENT(endtime);
+
+		INSTR_TIME_SUBTRACT(endtime, starttime);
+		bfz->stat_write_usecs += INSTR_TIME_GET_MICROSEC(endtime);
+		bfz->stat_raw_written += fs->buffer_pointer - fs->buffer;
 	}
 	PG_CATCH();
 	{
@@ -167,6 +179,8 @@ read_bfz_buffer(bfz_t *bfz, char *buffer)
 	struct bfz_freeable_stuff *fs = bfz->freeable_stuff;
 	int dataSize = 0;
 	char *oldBuffer = NULL;
+	instr_time	starttime;
+	instr_time	endtime;
 	
 	/*
 	 * Copy the original buffer so that we can simulate a torn page
@@ -178,9 +192,15 @@ read_bfz_buffer(bfz_t *bfz, char *buffer)
 		memcpy(oldBuffer, buffer, sizeof(fs->buffer));
 	}
 
+	INSTR_TIME_SET_CURRENT(starttime);
 	bytesRead = fs->read_ex(bfz, buffer, sizeof(fs->buffer));
+	INSTR_TIME_SET_CURRENT(endtime);
 	Assert(bytesRead <= sizeof(fs->buffer));
 
+	INSTR_TIME_SUBTRACT(endtime, starttime);
+	bfz->stat_read_usecs += INSTR_TIME_GET_MICROSEC(endtime);
+	bfz->stat_raw_read += bytesRead;
+
 	if (bytesRead == 0)
 		return 0;
 
@@ -498,6 +518,8 @@ bfz_append_end(bfz_t * thiz)
 				(errcode(ERRCODE_IO_ERROR),
 				errmsg("could not seek in temporary file: %m")));
 
+	thiz->stat_compressed_written = tot_compressed;
+
 	elog(DEBUG1, "bfz file size uncompressed %lld, compressed %lld, savings %d%%",
 		 (long long) tot_bytes, (long long) tot_compressed,
 		 tot_bytes == 0 ? 0 : (int) ((tot_bytes - tot_compressed) * 100 / tot_bytes));
@@ -613,6 +635,107 @@ bfz_read_ex(bfz_t * thiz, char *buffer, int size)
 	return orig_size - size;
 }
 
+/*
+ * Write one frame of a block compression algorithm.
+ *
+ * frame must have room for BFZ_FRAME_HEADER_SIZE + rawsize bytes, and hold
+ * compsize bytes of compressed data after the header.  If the block did not
+ * compress (compsize <= 0 or no smaller than rawsize), the uncompressed data
+ * in buffer is stored instead.
+ */
+void
+bfz_write_frame(bfz_t * thiz, char *frame, const char *buffer,
+				int rawsize, int compsize)
+{
+	bfz_frame_header hdr;
+	char	   *p;
+	int			size;
+
+	if (compsize <= 0 || compsize >= rawsize)
+	{
+		memcpy(frame + BFZ_FRAME_HEADER_SIZE, buffer, rawsize);
+		compsize = 0;
+	}
+
+	hdr.rawsize = rawsize;
+	hdr.compsize = compsize;
+	memcpy(frame, &hdr, BFZ_FRAME_HEADER_SIZE);
+
+	p = frame;
+	size = BFZ_FRAME_HEADER_SIZE + (compsize > 0 ? compsize : rawsize);
+	while (size)
+	{
+		int			i = writeAndRetry(thiz->fd, p, size);
+
+		if (i < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_IO_ERROR),
+					errmsg("could not write to temporary file: %m")));
+		p += i;
+		size -= i;
+	}
+}
+
+/*
+ * Read exactly size bytes, or nothing at end of file.
+ */
+static bool
+read_fully(bfz_t * thiz, char *buffer, int size)
+{
+	int			orig_size = size;
+
+	while (size)
+	{
+		int			i = readAndRetry(thiz->fd, buffer, size);
+
+		if (i < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_IO_ERROR),
+					errmsg("could not read from temporary file: %m")));
+		if (i == 0)
+		{
+			if (size == orig_size)
+				return false;
+			ereport(ERROR,
+					(errcode(ERRCODE_IO_ERROR),
+					errmsg("could not read from temporary file: unexpected end of file")));
+		}
+		buffer += i;
+		size -= i;
+	}
+	return true;
+}
+
+/*
+ * Read the next frame of a block compression algorithm into *hdr.  Returns
+ * false at end of file.
+ *
+ * A block stored uncompressed is read straight into buffer (size bytes
+ * long), and hdr->compsize is 0.  Otherwise the compressed data is read into
+ * cbuf (cbufsize bytes long) for the caller to decompress into buffer.
+ */
+bool
+bfz_read_frame(bfz_t * thiz, char *buffer, int size,
+			   char *cbuf, int cbufsize, bfz_frame_header *hdr)
+{
+	if (!read_fully(thiz, (char *) hdr, BFZ_FRAME_HEADER_SIZE))
+		return false;
+
+	if (hdr->rawsize < 0 || hdr->rawsize > size ||
+		hdr->compsize < 0 || hdr->compsize > cbufsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_ERROR),
+				errmsg("invalid block header in temporary file: size %d, compressed size %d",
+					   hdr->rawsize, hdr->compsize)));
+
+	if (hdr->compsize == 0)
+		read_fully(thiz, buffer, hdr->rawsize);
+	else
+		read_fully(thiz, cbuf, hdr->compsize);
+
+	return true;
+}
+
 ssize_t
 readAndRetry(int fd, void *buffer, size_t size)
 {
@@ -490,6 +490,19 @@ BufFileFlush(BufFile *file)
 	}
 }
 
+/*
+ * BufFilePrefetch
+ *
+ * Ask the kernel to start reading the given range of the file, so that a
+ * later BufFileRead of it does not have to wait for the disk.  Does not
+ * move the logical position.
+ */
+int
+BufFilePrefetch(BufFile *file, int64 offset, int amount)
+{
+	return FilePrefetch(file->file, offset, amount);
+}
+
 /*
  * BufFileSeek
  *
@@ -0,0 +1,90 @@
+/* compress_lz4.c */
+#include "postgres.h"
+
+#include "c.h"
+#include <lz4.h>
+#include <storage/bfz.h>
+#include <storage/fd.h>
+
+/*
+ * This file implements bfz compression algorithm "lz4".
+ *
+ * Every block bfz writes is compressed on its own and stored as a frame
+ * (see bfz_frame_header), so a read returns exactly the block that was
+ * written, as the checksumming requires.
+ */
+
+#define BFZ_LZ4_BOUND	LZ4_COMPRESSBOUND(BFZ_BUFFER_SIZE)
+
+struct bfz_lz4_freeable_stuff
+{
+	struct bfz_freeable_stuff super;
+	char		frame[BFZ_FRAME_HEADER_SIZE + BFZ_LZ4_BOUND];
+};
+
+/*
+ * bfz_lz4_close_ex
+ *  Close a file and freeing up descriptor, buffers etc.
+ *
+ *  This is also called from an xact end callback, hence it should
+ *  not contain any elog(ERROR) calls.
+ */
+static void
+bfz_lz4_close_ex(bfz_t * thiz)
+{
+	gp_retry_close(thiz->fd);
+	thiz->fd = -1;
+	free(thiz->freeable_stuff);
+	thiz->freeable_stuff = NULL;
+}
+
+static void
+bfz_lz4_write_ex(bfz_t * thiz, const char *buffer, int size)
+{
+	struct bfz_lz4_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+	int			compsize;
+
+	Assert(size <= BFZ_BUFFER_SIZE);
+
+	compsize = LZ4_compress_default(buffer, fs->frame + BFZ_FRAME_HEADER_SIZE,
+									size, BFZ_LZ4_BOUND);
+	bfz_write_frame(thiz, fs->frame, buffer, size, compsize);
+}
+
+static int
+bfz_lz4_read_ex(bfz_t * thiz, char *buffer, int size)
+{
+	struct bfz_lz4_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+	bfz_frame_header hdr;
+	int			rawsize;
+
+	if (!bfz_read_frame(thiz, buffer, size, fs->frame, BFZ_LZ4_BOUND, &hdr))
+		return 0;
+
+	if (hdr.compsize == 0)
+		return hdr.rawsize;
+
+	rawsize = LZ4_decompress_safe(fs->frame, buffer, hdr.compsize, size);
+	if (rawsize != hdr.rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				errmsg("could not decompress temporary file block")));
+
+	return rawsize;
+}
+
+void
+bfz_lz4_init(bfz_t * thiz)
+{
+	struct bfz_lz4_freeable_stuff *fs = malloc(sizeof *fs);
+
+	if (!fs)
+		ereport(ERROR,
+			(errcode(ERRCODE_OUT_OF_MEMORY),
+			 errmsg("out of memory")));
+
+	thiz->freeable_stuff = &fs->super;
+	fs->super.read_ex = bfz_lz4_read_ex;
+	fs->super.write_ex = bfz_lz4_write_ex;
+	fs->super.close_ex = bfz_lz4_close_ex;
+}
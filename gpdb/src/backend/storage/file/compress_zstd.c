@@ -0,0 +1,123 @@
+/* compress_zstd.c */
+#include "postgres.h"
+
+#include "c.h"
+#include <zstd.h>
+#include <storage/bfz.h>
+#include <storage/fd.h>
+
+/*
+ * This file implements bfz compression algorithm "zstd".
+ *
+ * Like "lz4", every block is compressed on its own and stored as a frame
+ * (see bfz_frame_header).  zstd runs at its fastest level: spill files are
+ * short lived, and anything slower costs more CPU than it saves in I/O.
+ */
+
+#define BFZ_ZSTD_LEVEL	1
+#define BFZ_ZSTD_BOUND	ZSTD_COMPRESSBOUND(BFZ_BUFFER_SIZE)
+
+struct bfz_zstd_freeable_stuff
+{
+	struct bfz_freeable_stuff super;
+	char		frame[BFZ_FRAME_HEADER_SIZE + BFZ_ZSTD_BOUND];
+};
+
+/*
+ * The (de)compression contexts hold sizable tables, so a backend creates
+ * them once and shares them between all of its bfz files.
+ */
+static ZSTD_CCtx *bfz_zstd_cctx = NULL;
+static ZSTD_DCtx *bfz_zstd_dctx = NULL;
+
+/*
+ * bfz_zstd_close_ex
+ *  Close a file and freeing up descriptor, buffers etc.
+ *
+ *  This is also called from an xact end callback, hence it should
+ *  not contain any elog(ERROR) calls.
+ */
+static void
+bfz_zstd_close_ex(bfz_t * thiz)
+{
+	gp_retry_close(thiz->fd);
+	thiz->fd = -1;
+	free(thiz->freeable_stuff);
+	thiz->freeable_stuff = NULL;
+}
+
+static void
+bfz_zstd_write_ex(bfz_t * thiz, const char *buffer, int size)
+{
+	struct bfz_zstd_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+	size_t		compsize;
+
+	Assert(size <= BFZ_BUFFER_SIZE);
+
+	compsize = ZSTD_compressCCtx(bfz_zstd_cctx,
+								 fs->frame + BFZ_FRAME_HEADER_SIZE, BFZ_ZSTD_BOUND,
+								 buffer, size, BFZ_ZSTD_LEVEL);
+
+	/* On failure store the block uncompressed */
+	bfz_write_frame(thiz, fs->frame, buffer, size,
+					ZSTD_isError(compsize) ? -1 : (int) compsize);
+}
+
+static int
+bfz_zstd_read_ex(bfz_t * thiz, char *buffer, int size)
+{
+	struct bfz_zstd_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+	bfz_frame_header hdr;
+	size_t		rawsize;
+
+	if (!bfz_read_frame(thiz, buffer, size, fs->frame, BFZ_ZSTD_BOUND, &hdr))
+		return 0;
+
+	if (hdr.compsize == 0)
+		return hdr.rawsize;
+
+	rawsize = ZSTD_decompressDCtx(bfz_zstd_dctx, buffer, size,
+								  fs->frame, hdr.compsize);
+	if (ZSTD_isError(rawsize) || rawsize != hdr.rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				errmsg("could not decompress temporary file block")));
+
+	return (int) rawsize;
+}
+
+void
+bfz_zstd_init(bfz_t * thiz)
+{
+	struct bfz_zstd_freeable_stuff *fs;
+
+	if (thiz->mode == BFZ_MODE_APPEND)
+	{
+		if (bfz_zstd_cctx == NULL)
+			bfz_zstd_cctx = ZSTD_createCCtx();
+		if (bfz_zstd_cctx == NULL)
+			ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+	}
+	else
+	{
+		if (bfz_zstd_dctx == NULL)
+			bfz_zstd_dctx = ZSTD_createDCtx();
+		if (bfz_zstd_dctx == NULL)
+			ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+	}
+
+	fs = malloc(sizeof *fs);
+	if (!fs)
+		ereport(ERROR,
+			(errcode(ERRCODE_OUT_OF_MEMORY),
+			 errmsg("out of memory")));
+
+	thiz->freeable_stuff = &fs->super;
+	fs->super.read_ex = bfz_zstd_read_ex;
+	fs->super.write_ex = bfz_zstd_write_ex;
+	fs->super.close_ex = bfz_zstd_close_ex;
+}
@@ -1152,6 +1152,45 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FilePrefetch - initiate an asynchronous read of a range of the file, so
+ * that a later FileRead of it does not have to wait for the disk.  The
+ * seek position is unaffected.
+ *
+ * The only implementation uses posix_fadvise(POSIX_FADV_WILLNEED); where
+ * that is not available this is a no-op.  Returns 0, or -1 with errno set.
+ */
+int
+FilePrefetch(File file, int64 offset, int amount)
+{
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FilePrefetch: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   offset, amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	returnCode = posix_fadvise(VfdCache[file].fd, (off_t) offset,
+							   (off_t) amount, POSIX_FADV_WILLNEED);
+	if (returnCode != 0)
+	{
+		errno = returnCode;
+		return -1;
+	}
+
+	return 0;
+#else
+	Assert(FileIsValid(file));
+	return 0;
+#endif
+}
+
 int
 FileWrite(File file, char *buffer, int amount)
 {
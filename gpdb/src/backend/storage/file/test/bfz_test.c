@@ -17,6 +17,8 @@
 
 #include "../bfz.c"
 
+#include <stdlib.h>
+
 /* ==================== bfz_scan_begin =================== */
 /*
  * Tests that bfz->freeable_stuff->tot_bytes is initialized to 0
@@ -43,13 +45,181 @@ test__bfz_scan_begin_initbytes(void **state)
 
 }
 
+/* ==================== bfz_string_to_compression =================== */
+/*
+ * Tests that every compression algorithm name maps back to itself
+ */
+void
+test__bfz_string_to_compression(void **state)
+{
+	assert_int_equal(bfz_string_to_compression("none"), 0);
+	assert_int_equal(bfz_string_to_compression("off"), 0);
+	assert_int_equal(bfz_string_to_compression("zlib"), 1);
+	assert_int_equal(bfz_string_to_compression("LZ4"), 2);
+	assert_int_equal(bfz_string_to_compression("zstd"), 3);
+	assert_int_equal(bfz_string_to_compression("lzo"), -1);
+
+	assert_string_equal(bfz_compression_to_string(2), "lz4");
+	assert_string_equal(bfz_compression_to_string(3), "zstd");
+}
+
+/* ==================== lz4 / zstd round trip =================== */
+
+#define ROUNDTRIP_SIZE	(3 * BFZ_BUFFER_SIZE + 123)
+
+/*
+ * Fill buf with data whose first block compresses well, whose second block
+ * is random and does not compress at all, and whose remaining blocks are
+ * in between.  The last block is a partial one.
+ */
+static void
+fill_roundtrip_data(char *buf)
+{
+	int			i;
+
+	for (i = 0; i < BFZ_BUFFER_SIZE; i++)
+		buf[i] = 'a' + (i / 100) % 3;
+
+	srandom(42);
+	for (; i < 2 * BFZ_BUFFER_SIZE; i++)
+		buf[i] = (char) random();
+
+	for (; i < ROUNDTRIP_SIZE; i++)
+		buf[i] = "0123456789, tuple "[(i * 7) % 18] + (i % 1000 == 0);
+}
+
+/*
+ * Open a bfz file on a fresh temporary file, the way bfz_create() does
+ * without going through the workfile path machinery.
+ */
+static bfz_t *
+roundtrip_create(int compress)
+{
+	char		path[] = "/tmp/bfz_test_XXXXXX";
+	bfz_t	   *bfz = calloc(1, sizeof(bfz_t));
+	struct bfz_freeable_stuff *fs;
+
+	bfz->fd = mkstemp(path);
+	assert_true(bfz->fd >= 0);
+	unlink(path);
+
+	bfz->mode = BFZ_MODE_APPEND;
+	bfz->compression_index = compress;
+	compression_algorithms[compress].init(bfz);
+
+	fs = bfz->freeable_stuff;
+	fs->tot_bytes = 0;
+	fs->buffer_pointer = fs->buffer;
+	fs->buffer_end = fs->buffer + sizeof(fs->buffer);
+
+	return bfz;
+}
+
+/*
+ * Write data through bfz with algorithm compress in odd-sized pieces, so
+ * that writes straddle block boundaries, read it back in pieces of another
+ * size and compare.  Also checks how the blocks were stored: the first one
+ * compressed, the random one as is.
+ */
+static void
+roundtrip(const char *algorithm)
+{
+	int			compress = bfz_string_to_compression(algorithm);
+	char	   *data = malloc(ROUNDTRIP_SIZE);
+	char	   *back = malloc(ROUNDTRIP_SIZE);
+	bfz_t	   *bfz;
+	bfz_frame_header hdr;
+	int			off;
+	int			saved_fd;
+	int			n;
+
+	assert_true(compress > 0);
+	fill_roundtrip_data(data);
+
+	bfz = roundtrip_create(compress);
+
+	for (off = 0; off < ROUNDTRIP_SIZE; off += 1000)
+		bfz_append(bfz, data + off, Min(1000, ROUNDTRIP_SIZE - off));
+
+	/* the same steps as bfz_append_end() */
+	write_bfz_buffer(bfz, true);
+	assert_int_equal(bfz->numBlocks, 4);
+	assert_int_equal(bfz->stat_raw_written, ROUNDTRIP_SIZE);
+
+	saved_fd = dup(bfz->fd);
+	expect_value(gp_retry_close, fd, bfz->fd);
+	will_return(gp_retry_close, 0);
+	bfz->freeable_stuff->close_ex(bfz);
+	assert_true(bfz->fd == -1);
+	bfz->fd = saved_fd;
+	bfz->mode = BFZ_MODE_FREED;
+
+	/* Look at the frames on disk */
+	assert_true(lseek(bfz->fd, 0, SEEK_SET) == 0);
+
+	assert_int_equal(read(bfz->fd, &hdr, sizeof(hdr)), sizeof(hdr));
+	assert_int_equal(hdr.rawsize, BFZ_BUFFER_SIZE);
+	assert_true(hdr.compsize > 0 && hdr.compsize < BFZ_BUFFER_SIZE / 4);
+
+	assert_true(lseek(bfz->fd, hdr.compsize, SEEK_CUR) > 0);
+	assert_int_equal(read(bfz->fd, &hdr, sizeof(hdr)), sizeof(hdr));
+	assert_int_equal(hdr.rawsize, BFZ_BUFFER_SIZE);
+	assert_int_equal(hdr.compsize, 0);
+
+	/* Read it back, in pieces that do not line up with the writes */
+	off = 0;
+	while ((n = bfz_scan_next(bfz, back + off, Min(777, ROUNDTRIP_SIZE - off))) > 0)
+	{
+		off += n;
+		if (off == ROUNDTRIP_SIZE)
+			break;
+	}
+	assert_int_equal(off, ROUNDTRIP_SIZE);
+	assert_true(memcmp(data, back, ROUNDTRIP_SIZE) == 0);
+	assert_int_equal(bfz->stat_raw_read, ROUNDTRIP_SIZE);
+
+	/* and nothing after the end */
+	assert_int_equal(bfz_scan_next(bfz, back, 1), 0);
+
+	expect_value(gp_retry_close, fd, bfz->fd);
+	will_return(gp_retry_close, 0);
+	saved_fd = bfz->fd;
+	bfz->freeable_stuff->close_ex(bfz);
+	close(saved_fd);
+
+	free(bfz);
+	free(data);
+	free(back);
+}
+
+/*
+ * Tests an lz4 write/read round trip
+ */
+void
+test__bfz_roundtrip_lz4(void **state)
+{
+	roundtrip("lz4");
+}
+
+/*
+ * Tests a zstd write/read round trip
+ */
+void
+test__bfz_roundtrip_zstd(void **state)
+{
+	roundtrip("zstd");
+}
+
 int
 main(int argc, char* argv[])
 {
 	cmockery_parse_arguments(argc, argv);
 
 	const UnitTest tests[] = {
-		unit_test(test__bfz_scan_begin_initbytes)
+		unit_test(test__bfz_scan_begin_initbytes),
+		unit_test(test__bfz_string_to_compression),
+		unit_test(test__bfz_roundtrip_lz4),
+		unit_test(test__bfz_roundtrip_zstd)
 	};
 
 	return run_tests(tests);
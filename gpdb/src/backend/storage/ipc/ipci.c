@@ -69,6 +69,7 @@
 #include "executor/spi.h"
 #include "utils/workfile_mgr.h"
 #include "utils/session_state.h"
+#include "utils/sharedmdcache.h"
 
 shmem_startup_hook_type shmem_startup_hook = NULL;
 
@@ -141,6 +142,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		if (Gp_role == GP_ROLE_DISPATCH)
 		{
 			size = add_size(size, AppendOnlyWriterShmemSize());
+			size = add_size(size, SharedMDCacheShmemSize());
 			
 			if(ResourceScheduler)
 			{
@@ -314,6 +316,12 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	if (Gp_role == GP_ROLE_DISPATCH)
 		InitAppendOnlyWriter();
 
+	/*
+	 * Set up the optimizer's shared metadata cache
+	 */
+	if (Gp_role == GP_ROLE_DISPATCH)
+		SharedMDCacheShmemInit();
+
 	PersistentFileSysObj_ShmemInit();
 	PersistentFilespace_ShmemInit();
 	PersistentTablespace_ShmemInit();
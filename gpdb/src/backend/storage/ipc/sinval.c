@@ -20,6 +20,7 @@
 #include "storage/ipc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedmdcache.h"
 
 #include "cdb/cdbtm.h"          /* DtxContext */
 
@@ -56,6 +57,9 @@ void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
 	SIInsertDataEntries(msgs, n);
+
+	/* after the messages are queued, see SharedMDCacheBeginLoad() */
+	SharedMDCacheInvalidate(msgs, n);
 }
 
 /*
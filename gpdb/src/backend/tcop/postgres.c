@@ -4551,6 +4551,22 @@ PostgresMain(int argc, char *argv[],
 		 */
 		if (Gp_role == GP_ROLE_DISPATCH)
 			CheckForResetSession();
+
+		/*
+		 * (2c) Top up the session's pool of warm reader gangs while the
+		 * client is thinking.  This runs synchronously, so a query that
+		 * arrives meanwhile waits for it: skip it if the client has already
+		 * sent the next command, and let that query create its gangs the
+		 * usual way.  This is not a command read, so keep cancel and
+		 * deadlock checks working as usual meanwhile.
+		 */
+		if (gangPoolNeedsPrefork() && !IsTransactionOrTransactionBlock() &&
+			!(whereToSendOutput == DestRemote && pq_is_input_pending()))
+		{
+			DoingCommandRead = false;
+			preforkGangPool();
+			DoingCommandRead = true;
+		}
 		
 		/*
 		 * (3) read a command (loop blocks here)
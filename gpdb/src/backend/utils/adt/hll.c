@@ -0,0 +1,393 @@
+/*-------------------------------------------------------------------------
+ *
+ * hll.c
+ *	  HyperLogLog sketches, for approximate count(DISTINCT ...).
+ *
+ * The built-in type "hll" is a HyperLogLog sketch (Flajolet et al.,
+ * "HyperLogLog: the analysis of a near-optimal cardinality estimation
+ * algorithm") with 2^HLL_LOG2M one-byte registers.  Each input value is
+ * hashed with the hash function of its type; the first HLL_LOG2M bits of
+ * the hash pick a register, which keeps the largest position of the first
+ * set bit seen in the remaining bits.  The number of distinct values is
+ * estimated from the harmonic mean of the registers, with the usual
+ * corrections for small and, because the hash has 32 bits, very large
+ * cardinalities.  The standard error is about 1.04 / sqrt(2^HLL_LOG2M).
+ *
+ * Two sketches are merged by taking the larger value of each register,
+ * so a sketch can be built on each segment and the sketches combined in
+ * the second stage of aggregation, or stored in a table and rolled up
+ * later:
+ *
+ *	approx_count_distinct(anyelement) returns the estimate directly;
+ *	hll_agg(anyelement) returns the sketch;
+ *	hll_union_agg(hll) merges sketches;
+ *	hll_cardinality(hll) returns the estimate of a sketch.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "libpq/pqformat.h"
+#include "parser/parse_oper.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/syscache.h"
+
+#define HLL_VERSION		1
+#define HLL_LOG2M		12
+#define HLL_REGISTERS	(1 << HLL_LOG2M)
+
+/* Largest register value: all the bits after the register index are zero */
+#define HLL_MAX_RANK	(32 - HLL_LOG2M + 1)
+
+typedef struct HLLData
+{
+	int32		_len;			/* len for varattrib, do not touch directly */
+	uint8		version;
+	uint8		log2m;
+	uint8		pad[2];
+	uint8		registers[HLL_REGISTERS];
+} HLLData;
+
+/* Size of the data after the varlena header, the external representation */
+#define HLL_DATA_SIZE	(sizeof(HLLData) - VARHDRSZ)
+
+/* The hash function of the input type, cached in fn_extra */
+typedef struct HLLHashInfo
+{
+	Oid			typid;
+	FmgrInfo	hashfn;
+} HLLHashInfo;
+
+static HLLData *
+hll_create(void)
+{
+	HLLData    *hll = (HLLData *) palloc0(sizeof(HLLData));
+
+	SET_VARSIZE(hll, sizeof(HLLData));
+	hll->version = HLL_VERSION;
+	hll->log2m = HLL_LOG2M;
+
+	return hll;
+}
+
+/*
+ * Check a sketch that came from outside the backend.
+ */
+static bool
+hll_is_valid(HLLData *hll)
+{
+	int			i;
+
+	if (VARSIZE(hll) != sizeof(HLLData) ||
+		hll->version != HLL_VERSION ||
+		hll->log2m != HLL_LOG2M)
+		return false;
+
+	for (i = 0; i < HLL_REGISTERS; i++)
+	{
+		if (hll->registers[i] > HLL_MAX_RANK)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get the sketch argument to update.  When called as an aggregate
+ * transition function the transition value is owned by the aggregate and
+ * is updated in place; otherwise it must not be scribbled on.
+ */
+static HLLData *
+hll_getarg_for_update(FunctionCallInfo fcinfo, int argno)
+{
+	if (fcinfo->context && IS_AGG_EXECUTION_NODE(fcinfo->context))
+		return (HLLData *) PG_GETARG_BYTEA_P(argno);
+
+	return (HLLData *) PG_GETARG_BYTEA_P_COPY(argno);
+}
+
+/*
+ * Hash an argument of the function with the hash function of its type.
+ */
+static uint32
+hll_hash_arg(FunctionCallInfo fcinfo, int argno)
+{
+	HLLHashInfo *info = (HLLHashInfo *) fcinfo->flinfo->fn_extra;
+	Oid			typid = get_fn_expr_argtype(fcinfo->flinfo, argno);
+	uint32		h;
+
+	if (!OidIsValid(typid))
+		elog(ERROR, "could not determine input data type");
+
+	if (info == NULL || info->typid != typid)
+	{
+		Operator	optup;
+		Oid			hashfn = InvalidOid;
+
+		optup = equality_oper(getBaseType(typid), true);
+		if (optup != NULL)
+		{
+			hashfn = get_op_hash_function(oprid(optup));
+			ReleaseSysCache(optup);
+		}
+
+		if (!OidIsValid(hashfn))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(typid))));
+
+		if (info == NULL)
+			info = (HLLHashInfo *) MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+													  sizeof(HLLHashInfo));
+		info->typid = typid;
+		fmgr_info_cxt(hashfn, &info->hashfn, fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = info;
+	}
+
+	h = DatumGetUInt32(FunctionCall1(&info->hashfn, PG_GETARG_DATUM(argno)));
+
+	/*
+	 * Not every hash function spreads its input over all the bits, so mix
+	 * the result (the MurmurHash3 finalizer).
+	 */
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static void
+hll_add_hash(HLLData *hll, uint32 h)
+{
+	uint32		idx = h >> (32 - HLL_LOG2M);
+	uint32		w = h << HLL_LOG2M;
+	uint8		rank = 1;
+
+	while (rank < HLL_MAX_RANK && (w & 0x80000000) == 0)
+	{
+		rank++;
+		w <<= 1;
+	}
+
+	if (rank > hll->registers[idx])
+		hll->registers[idx] = rank;
+}
+
+static int64
+hll_estimate(HLLData *hll)
+{
+	const double m = HLL_REGISTERS;
+	const double two32 = 4294967296.0;
+	double		alpha = 0.7213 / (1 + 1.079 / m);
+	double		sum = 0;
+	int			zeros = 0;
+	double		estimate;
+	int			i;
+
+	for (i = 0; i < HLL_REGISTERS; i++)
+	{
+		sum += ldexp(1.0, -hll->registers[i]);
+		if (hll->registers[i] == 0)
+			zeros++;
+	}
+
+	estimate = alpha * m * m / sum;
+
+	if (estimate <= 2.5 * m)
+	{
+		/* small range correction: count the empty registers */
+		if (zeros > 0)
+			estimate = m * log(m / zeros);
+	}
+	else if (estimate > two32 / 30)
+	{
+		/* large range correction: account for hash collisions */
+		if (estimate >= two32)
+			estimate = two32;
+		else
+			estimate = -two32 * log(1 - estimate / two32);
+	}
+
+	return (int64) rint(estimate);
+}
+
+static int
+hll_hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/*
+ * hll_in -- the sketch as hexadecimal digits.
+ */
+Datum
+hll_in(PG_FUNCTION_ARGS)
+{
+	char	   *str = PG_GETARG_CSTRING(0);
+	HLLData    *hll;
+	char	   *dst;
+	int			i;
+
+	if (strlen(str) != 2 * HLL_DATA_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("invalid input syntax for type hll")));
+
+	hll = (HLLData *) palloc(sizeof(HLLData));
+	SET_VARSIZE(hll, sizeof(HLLData));
+	dst = (char *) hll + VARHDRSZ;
+
+	for (i = 0; i < HLL_DATA_SIZE; i++)
+	{
+		int			hi = hll_hex_value(str[2 * i]);
+		int			lo = hll_hex_value(str[2 * i + 1]);
+
+		if (hi < 0 || lo < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+					 errmsg("invalid input syntax for type hll")));
+		dst[i] = (char) ((hi << 4) | lo);
+	}
+
+	if (!hll_is_valid(hll))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("invalid hll value")));
+
+	PG_RETURN_POINTER(hll);
+}
+
+Datum
+hll_out(PG_FUNCTION_ARGS)
+{
+	static const char hextbl[] = "0123456789abcdef";
+	HLLData    *hll = (HLLData *) PG_GETARG_BYTEA_P(0);
+	unsigned char *src = (unsigned char *) hll + VARHDRSZ;
+	char	   *result = palloc(2 * HLL_DATA_SIZE + 1);
+	int			i;
+
+	for (i = 0; i < HLL_DATA_SIZE; i++)
+	{
+		result[2 * i] = hextbl[src[i] >> 4];
+		result[2 * i + 1] = hextbl[src[i] & 0xF];
+	}
+	result[2 * HLL_DATA_SIZE] = '\0';
+
+	PG_RETURN_CSTRING(result);
+}
+
+Datum
+hll_recv(PG_FUNCTION_ARGS)
+{
+	StringInfo	buf = (StringInfo) PG_GETARG_POINTER(0);
+	HLLData    *hll;
+
+	hll = (HLLData *) palloc(sizeof(HLLData));
+	SET_VARSIZE(hll, sizeof(HLLData));
+	memcpy((char *) hll + VARHDRSZ, pq_getmsgbytes(buf, HLL_DATA_SIZE),
+		   HLL_DATA_SIZE);
+
+	if (!hll_is_valid(hll))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("invalid hll value")));
+
+	PG_RETURN_POINTER(hll);
+}
+
+Datum
+hll_send(PG_FUNCTION_ARGS)
+{
+	HLLData    *hll = (HLLData *) PG_GETARG_BYTEA_P(0);
+	StringInfoData buf;
+
+	pq_begintypsend(&buf);
+	pq_sendbytes(&buf, (char *) hll + VARHDRSZ, HLL_DATA_SIZE);
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+/*
+ * transition function for approx_count_distinct() and hll_agg().
+ *
+ * Not strict: the initial value is NULL, and NULL inputs are ignored like
+ * count(DISTINCT ...) does.
+ */
+Datum
+hll_add_trans(PG_FUNCTION_ARGS)
+{
+	HLLData    *hll;
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+			PG_RETURN_NULL();
+		PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+	}
+
+	if (PG_ARGISNULL(0))
+		hll = hll_create();
+	else
+		hll = hll_getarg_for_update(fcinfo, 0);
+
+	hll_add_hash(hll, hll_hash_arg(fcinfo, 1));
+
+	PG_RETURN_POINTER(hll);
+}
+
+/*
+ * transition function for hll_union_agg(), and preliminary function of
+ * all the hll aggregates: merge two sketches.
+ */
+Datum
+hll_union_trans(PG_FUNCTION_ARGS)
+{
+	HLLData    *hll0 = hll_getarg_for_update(fcinfo, 0);
+	HLLData    *hll1 = (HLLData *) PG_GETARG_BYTEA_P(1);
+	int			i;
+
+	if (VARSIZE(hll0) != sizeof(HLLData) || VARSIZE(hll1) != sizeof(HLLData) ||
+		hll0->log2m != hll1->log2m)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("cannot merge incompatible hll values")));
+
+	for (i = 0; i < HLL_REGISTERS; i++)
+	{
+		if (hll1->registers[i] > hll0->registers[i])
+			hll0->registers[i] = hll1->registers[i];
+	}
+
+	PG_RETURN_POINTER(hll0);
+}
+
+/*
+ * final function for approx_count_distinct().  Not strict, so that no
+ * input rows count zero.
+ */
+Datum
+approx_count_distinct_final(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	PG_RETURN_INT64(hll_estimate((HLLData *) PG_GETARG_BYTEA_P(0)));
+}
+
+Datum
+hll_cardinality(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64(hll_estimate((HLLData *) PG_GETARG_BYTEA_P(0)));
+}
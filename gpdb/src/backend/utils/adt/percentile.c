@@ -10,6 +10,9 @@
  *-------------------------------------------------------------------------
  */
 #include "postgres.h"
+
+#include <math.h>
+
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
@@ -261,3 +264,352 @@ percentile_disc_trans(PG_FUNCTION_ARGS)
 
 	PG_RETURN_NULL();
 }
+
+/*
+ * approx_percentile(value, percentage)
+ *
+ * Unlike percentile_cont(), this is an ordinary aggregate that does not
+ * need sorted input.  The values are summarized in a t-digest (Dunning and
+ * Ertl, "Computing Extremely Accurate Quantiles Using t-Digests"): a list
+ * of centroids, each a mean and a weight, which are kept small near either
+ * end of the distribution and allowed to grow in the middle, so that the
+ * tail percentiles remain accurate.  The digest has a bounded size whatever
+ * the number of input rows, and two digests are merged by adding the
+ * centroids of one to the other, which is what the preliminary function
+ * does to combine the results from the segments.
+ *
+ * The transition state is a bytea holding the whole digest.  New values
+ * are appended as centroids of weight one; once the array is full it is
+ * grown, up to TDIGEST_MAX_CENTROIDS, and then compressed: sorted by mean
+ * and adjacent centroids merged as long as the result stays within the
+ * size allowed at its position by the k1 scale function.  After a
+ * compression there are at most TDIGEST_COMPRESSION + 1 centroids.
+ *
+ * For a digest where every centroid still has weight one the result is
+ * the same as percentile_cont().
+ */
+#define TDIGEST_COMPRESSION		100
+#define TDIGEST_MIN_CENTROIDS	16
+#define TDIGEST_MAX_CENTROIDS	(5 * TDIGEST_COMPRESSION)
+
+typedef struct TDigestCentroid
+{
+	float8		mean;
+	float8		weight;
+} TDigestCentroid;
+
+typedef struct TDigest
+{
+	int32		_len;			/* len for varattrib, do not touch directly */
+	int32		capacity;		/* number of centroid slots */
+	int32		nmerged;		/* sorted and compressed centroids first */
+	int32		nunmerged;		/* followed by the ones added since */
+	float8		percentage;
+	float8		count;			/* total weight of the centroids */
+	float8		min;
+	float8		max;
+	TDigestCentroid centroids[1];	/* VARIABLE LENGTH ARRAY */
+} TDigest;
+
+#define TDIGEST_SIZE(capacity) \
+	(offsetof(TDigest, centroids) + (capacity) * sizeof(TDigestCentroid))
+
+/* The initial value of the aggregate is an empty bytea */
+#define TDIGEST_IS_EMPTY(td)	(VARSIZE(td) == VARHDRSZ)
+
+static TDigest *
+tdigest_create(int capacity, float8 percentage)
+{
+	TDigest    *td = (TDigest *) palloc(TDIGEST_SIZE(capacity));
+
+	SET_VARSIZE(td, TDIGEST_SIZE(capacity));
+	td->capacity = capacity;
+	td->nmerged = 0;
+	td->nunmerged = 0;
+	td->percentage = percentage;
+	td->count = 0;
+	td->min = get_float8_infinity();
+	td->max = -get_float8_infinity();
+
+	return td;
+}
+
+static TDigest *
+tdigest_copy(TDigest *td, int capacity)
+{
+	TDigest    *newtd = tdigest_create(capacity, td->percentage);
+
+	Assert(capacity >= td->nmerged + td->nunmerged);
+
+	newtd->nmerged = td->nmerged;
+	newtd->nunmerged = td->nunmerged;
+	newtd->count = td->count;
+	newtd->min = td->min;
+	newtd->max = td->max;
+	memcpy(newtd->centroids, td->centroids,
+		   (td->nmerged + td->nunmerged) * sizeof(TDigestCentroid));
+
+	return newtd;
+}
+
+/*
+ * A digest as passed to one of the functions below.  A bytea is only
+ * int4-aligned, so a digest that comes straight from a tuple, such as the
+ * partial results sent by the segments, is copied out before its float8
+ * fields are read.
+ */
+static TDigest *
+tdigest_get_arg(FunctionCallInfo fcinfo, int argno)
+{
+	TDigest    *td = (TDigest *) PG_GETARG_BYTEA_P(argno);
+
+	if (DOUBLEALIGN(td) != (long) td)
+	{
+		TDigest    *copy = (TDigest *) palloc(VARSIZE(td));
+
+		memcpy(copy, td, VARSIZE(td));
+		td = copy;
+	}
+
+	return td;
+}
+
+static int
+tdigest_centroid_cmp(const void *a, const void *b)
+{
+	float8		ma = ((const TDigestCentroid *) a)->mean;
+	float8		mb = ((const TDigestCentroid *) b)->mean;
+
+	if (ma < mb)
+		return -1;
+	if (ma > mb)
+		return 1;
+	return 0;
+}
+
+/*
+ * The largest cumulative weight a centroid that starts at cumulative weight
+ * 'w' may reach: one unit further on the k1 scale,
+ *
+ *	k(q) = compression / (2 pi) * asin(2q - 1)
+ */
+static float8
+tdigest_weight_limit(float8 w, float8 count)
+{
+	float8		k;
+
+	k = TDIGEST_COMPRESSION / (2 * M_PI) * asin(2 * (w / count) - 1) + 1;
+	if (k >= TDIGEST_COMPRESSION / 4.0)
+		return count;
+
+	return count * (sin(k * (2 * M_PI) / TDIGEST_COMPRESSION) + 1) / 2;
+}
+
+/*
+ * Sort the centroids and merge the adjacent ones that fit together.
+ */
+static void
+tdigest_compress(TDigest *td)
+{
+	TDigestCentroid *c = td->centroids;
+	TDigestCentroid cur;
+	int			n = td->nmerged + td->nunmerged;
+	int			nout = 0;
+	float8		wsofar = 0;
+	float8		wlimit;
+	int			i;
+
+	if (td->nunmerged == 0)
+		return;
+
+	qsort(c, n, sizeof(TDigestCentroid), tdigest_centroid_cmp);
+
+	cur = c[0];
+	wlimit = tdigest_weight_limit(0, td->count);
+	for (i = 1; i < n; i++)
+	{
+		if (wsofar + cur.weight + c[i].weight <= wlimit)
+		{
+			cur.weight += c[i].weight;
+			if (c[i].mean != cur.mean)
+				cur.mean += (c[i].mean - cur.mean) * c[i].weight / cur.weight;
+		}
+		else
+		{
+			c[nout++] = cur;
+			wsofar += cur.weight;
+			wlimit = tdigest_weight_limit(wsofar, td->count);
+			cur = c[i];
+		}
+	}
+	c[nout++] = cur;
+
+	td->nmerged = nout;
+	td->nunmerged = 0;
+}
+
+/*
+ * Add a centroid.  The digest may be moved to make room for it.
+ */
+static TDigest *
+tdigest_add(TDigest *td, float8 mean, float8 weight)
+{
+	if (td->nmerged + td->nunmerged == td->capacity)
+	{
+		if (td->capacity < TDIGEST_MAX_CENTROIDS)
+			td = tdigest_copy(td, Min(td->capacity * 2, TDIGEST_MAX_CENTROIDS));
+		else
+			tdigest_compress(td);
+	}
+
+	Assert(td->nmerged + td->nunmerged < td->capacity);
+
+	td->centroids[td->nmerged + td->nunmerged].mean = mean;
+	td->centroids[td->nmerged + td->nunmerged].weight = weight;
+	td->nunmerged++;
+	td->count += weight;
+
+	return td;
+}
+
+/*
+ * The value at the given percentage of a compressed digest.
+ *
+ * Each centroid is taken to be centred on the middle of its weight, and
+ * the value is interpolated between the two centroids around the target,
+ * or between the outer centroids and the minimum or maximum.  The target
+ * is placed like percentile_cont() does, so that single values are
+ * interpolated the same way.
+ */
+static float8
+tdigest_quantile(TDigest *td, float8 percentage)
+{
+	TDigestCentroid *c = td->centroids;
+	int			n = td->nmerged;
+	float8		target = percentage * (td->count - 1) + 0.5;
+	float8		mid;
+	float8		cum = 0;
+	int			i;
+
+	Assert(td->nunmerged == 0 && n > 0);
+
+	mid = c[0].weight / 2;
+	if (target < mid)
+		return td->min + (c[0].mean - td->min) * (target - 0.5) / (mid - 0.5);
+
+	for (i = 0; i < n - 1; i++)
+	{
+		float8		next_mid = cum + c[i].weight + c[i + 1].weight / 2;
+
+		if (target <= next_mid)
+			return c[i].mean + (c[i + 1].mean - c[i].mean) *
+				(target - mid) / (next_mid - mid);
+
+		cum += c[i].weight;
+		mid = next_mid;
+	}
+
+	if (target > mid)
+		return c[n - 1].mean + (td->max - c[n - 1].mean) *
+			(target - mid) / (td->count - 0.5 - mid);
+
+	return c[n - 1].mean;
+}
+
+/*
+ * transition function for approx_percentile().
+ *
+ * The actual arguments are:
+ *		(state_value, target_value, percentage)
+ */
+Datum
+approx_percentile_trans(PG_FUNCTION_ARGS)
+{
+	TDigest    *td = tdigest_get_arg(fcinfo, 0);
+	float8		value = PG_GETARG_FLOAT8(1);
+	float8		percentage = PG_GETARG_FLOAT8(2);
+
+	Assert(fcinfo->context && IS_AGG_EXECUTION_NODE(fcinfo->context));
+
+	if (isnan(value) || isinf(value))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("input to approx_percentile must be a finite value")));
+
+	if (TDIGEST_IS_EMPTY(td))
+	{
+		if (percentage < 0.0 || percentage > 1.0)
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("input is out of range"),
+					 errhint("Argument to percentile function must be between 0.0 and 1.0.")));
+		td = tdigest_create(TDIGEST_MIN_CENTROIDS, percentage);
+	}
+	else if (td->percentage != percentage)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("percentage of approx_percentile must be the same for all rows of a group")));
+
+	td = tdigest_add(td, value, 1);
+	if (value < td->min)
+		td->min = value;
+	if (value > td->max)
+		td->max = value;
+
+	PG_RETURN_BYTEA_P(td);
+}
+
+/*
+ * preliminary function for approx_percentile(): merge two digests.
+ */
+Datum
+approx_percentile_merge(PG_FUNCTION_ARGS)
+{
+	TDigest    *td0 = tdigest_get_arg(fcinfo, 0);
+	TDigest    *td1 = tdigest_get_arg(fcinfo, 1);
+	int			i;
+
+	Assert(fcinfo->context && IS_AGG_EXECUTION_NODE(fcinfo->context));
+
+	if (TDIGEST_IS_EMPTY(td1) || td1->count == 0)
+		PG_RETURN_BYTEA_P(td0);
+
+	if (TDIGEST_IS_EMPTY(td0))
+		PG_RETURN_BYTEA_P(tdigest_copy(td1, td1->capacity));
+
+	if (td0->percentage != td1->percentage)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("percentage of approx_percentile must be the same for all rows of a group")));
+
+	for (i = 0; i < td1->nmerged + td1->nunmerged; i++)
+		td0 = tdigest_add(td0, td1->centroids[i].mean, td1->centroids[i].weight);
+
+	if (td1->min < td0->min)
+		td0->min = td1->min;
+	if (td1->max > td0->max)
+		td0->max = td1->max;
+
+	PG_RETURN_BYTEA_P(td0);
+}
+
+/*
+ * final function for approx_percentile().
+ */
+Datum
+approx_percentile_final(PG_FUNCTION_ARGS)
+{
+	TDigest    *td = tdigest_get_arg(fcinfo, 0);
+
+	if (TDIGEST_IS_EMPTY(td) || td->count == 0)
+		PG_RETURN_NULL();
+
+	/* Do not change the transition value, it may be used again. */
+	if (td->nunmerged > 0)
+	{
+		td = tdigest_copy(td, td->nmerged + td->nunmerged);
+		tdigest_compress(td);
+	}
+
+	PG_RETURN_FLOAT8(tdigest_quantile(td, td->percentage));
+}
@@ -1065,6 +1065,31 @@ CommandEndInvalidationMessages(void)
 							   &transInvalInfo->CurrentCmdInvalidMsgs);
 }
 
+/*
+ * TransactionHasPendingInvalidations
+ *		Has the current transaction queued any invalidation messages?
+ *
+ * True if this transaction or one of its open subtransactions changed
+ * catalog entries that other backends have not been told about yet.  The
+ * local caches then reflect changes that may still be rolled back.
+ */
+bool
+TransactionHasPendingInvalidations(void)
+{
+	TransInvalidationInfo *info;
+
+	for (info = transInvalInfo; info != NULL; info = info->parent)
+	{
+		if (info->CurrentCmdInvalidMsgs.cclist != NULL ||
+			info->CurrentCmdInvalidMsgs.rclist != NULL ||
+			info->PriorCmdInvalidMsgs.cclist != NULL ||
+			info->PriorCmdInvalidMsgs.rclist != NULL)
+			return true;
+	}
+
+	return false;
+}
+
 /*
  * CacheInvalidateHeapTuple
  *		Register the given tuple for invalidation at end of command
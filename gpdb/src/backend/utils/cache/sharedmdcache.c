@@ -0,0 +1,367 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedmdcache.c
+ *	  Cross-session cache of the metadata objects used by the optimizer.
+ *
+ * ORCA translates relcache and syscache contents into DXL metadata objects
+ * and keeps them in a per-backend cache (CMDCache), so the first query of
+ * every session pays for translating every relation, partition and
+ * histogram it touches.  This cache keeps the serialized DXL of those
+ * objects in shared memory on the master, keyed by database and metadata
+ * id, so that a new session can parse the DXL instead of translating the
+ * catalogs again.
+ *
+ * Entries are validated with a generation counter, which is advanced by
+ * the sender of every catalog or relcache invalidation message.  A backend
+ * that misses reads the generation, absorbs pending invalidations and only
+ * then translates the object; the entry it stores is tagged with the
+ * generation it read, so any catalog change committed after that point
+ * makes it invisible.  This invalidates more than strictly necessary, the
+ * same way the per-backend cache is reset on any relcache invalidation,
+ * but it does not depend on any backend having seen the message.
+ *
+ * A backend whose transaction has changed catalogs neither reads nor
+ * stores entries: its own caches then hold uncommitted changes, which the
+ * shared entries do not reflect, and which must not be shared since no
+ * invalidation is sent if the transaction aborts.
+ *
+ * The DXL is copied into an arena with a bump allocator.  The first entry
+ * stored after the generation moved on, or one that does not fit into the
+ * arena, empties the whole cache; there is no per-entry eviction.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "cdb/cdbvars.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/sharedmdcache.h"
+
+/* Translation settings that change the contents of a metadata object */
+#define SHARED_MDCACHE_MULTILEVEL_PARTITIONING	0x01
+
+/* Expected average size of a serialized metadata object, for sizing the hash table */
+#define SHARED_MDCACHE_AVG_ENTRY_SIZE	2048
+
+typedef struct SharedMDCacheKey
+{
+	Oid			dbid;
+	uint32		flags;			/* SHARED_MDCACHE_* settings */
+	char		mdid[SHARED_MDCACHE_MDID_LEN];
+} SharedMDCacheKey;
+
+typedef struct SharedMDCacheEntry
+{
+	SharedMDCacheKey key;		/* hash key --- must be first */
+	Size		offset;			/* of the data in the arena */
+	Size		len;
+	uint64		generation;		/* generation the data was translated in */
+} SharedMDCacheEntry;
+
+typedef struct SharedMDCacheCtl
+{
+	uint64		generation;		/* advanced by catalog invalidations */
+	uint64		arena_generation;	/* generation of the data in the arena */
+	Size		arena_size;
+	Size		arena_used;
+} SharedMDCacheCtl;
+
+static SharedMDCacheCtl *mdcacheCtl = NULL;
+static HTAB *mdcacheHash = NULL;
+static char *mdcacheArena = NULL;
+
+static int	SharedMDCacheMaxEntries(void);
+static void SharedMDCacheMakeKey(SharedMDCacheKey *key, const char *mdid);
+static void SharedMDCacheReset(void);
+
+/*
+ * Number of hash table entries for the configured arena size.
+ */
+static int
+SharedMDCacheMaxEntries(void)
+{
+	return Max(1024, (optimizer_mdcache_shared_size * 1024L) / SHARED_MDCACHE_AVG_ENTRY_SIZE);
+}
+
+/*
+ * SharedMDCacheShmemSize
+ *		Size of shared memory needed by the cache, zero if disabled.
+ */
+Size
+SharedMDCacheShmemSize(void)
+{
+	Size		size;
+
+	if (optimizer_mdcache_shared_size <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedMDCacheCtl));
+	size = add_size(size, MAXALIGN(mul_size(optimizer_mdcache_shared_size, 1024)));
+	size = add_size(size, hash_estimate_size(SharedMDCacheMaxEntries(),
+											 sizeof(SharedMDCacheEntry)));
+
+	return size;
+}
+
+/*
+ * SharedMDCacheShmemInit
+ *		Allocate or attach to the cache in shared memory.
+ */
+void
+SharedMDCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	Size		arena_size;
+
+	if (optimizer_mdcache_shared_size <= 0)
+		return;
+
+	arena_size = MAXALIGN(mul_size(optimizer_mdcache_shared_size, 1024));
+
+	mdcacheCtl = (SharedMDCacheCtl *)
+		ShmemInitStruct("Optimizer Shared MD Cache",
+						add_size(MAXALIGN(sizeof(SharedMDCacheCtl)), arena_size),
+						&found);
+	mdcacheArena = (char *) mdcacheCtl + MAXALIGN(sizeof(SharedMDCacheCtl));
+
+	if (!found)
+	{
+		mdcacheCtl->generation = 1;
+		mdcacheCtl->arena_generation = 1;
+		mdcacheCtl->arena_size = arena_size;
+		mdcacheCtl->arena_used = 0;
+	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SharedMDCacheKey);
+	info.entrysize = sizeof(SharedMDCacheEntry);
+	info.hash = tag_hash;
+
+	mdcacheHash = ShmemInitHash("Optimizer Shared MD Cache Hash",
+								SharedMDCacheMaxEntries(),
+								SharedMDCacheMaxEntries(),
+								&info,
+								HASH_ELEM | HASH_FUNCTION);
+}
+
+/*
+ * SharedMDCacheEnabled
+ *		Is the cache available in this backend?
+ */
+bool
+SharedMDCacheEnabled(void)
+{
+	return mdcacheCtl != NULL;
+}
+
+/*
+ * Build the key of an object; settings that make the translation of an
+ * object fail or differ are part of the key, so that sessions with other
+ * settings do not share it.
+ */
+static void
+SharedMDCacheMakeKey(SharedMDCacheKey *key, const char *mdid)
+{
+	MemSet(key, 0, sizeof(SharedMDCacheKey));
+	key->dbid = MyDatabaseId;
+	if (optimizer_multilevel_partitioning)
+		key->flags |= SHARED_MDCACHE_MULTILEVEL_PARTITIONING;
+	strlcpy(key->mdid, mdid, SHARED_MDCACHE_MDID_LEN);
+}
+
+/*
+ * Empty the cache. Caller must hold SharedMDCacheLock exclusively.
+ */
+static void
+SharedMDCacheReset(void)
+{
+	HASH_SEQ_STATUS status;
+	SharedMDCacheEntry *entry;
+
+	hash_seq_init(&status, mdcacheHash);
+	while ((entry = (SharedMDCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (hash_search(mdcacheHash, &entry->key, HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "optimizer shared metadata cache hash table corrupted");
+	}
+
+	mdcacheCtl->arena_used = 0;
+	mdcacheCtl->arena_generation = mdcacheCtl->generation;
+}
+
+/*
+ * SharedMDCacheBeginLoad
+ *		Called before translating an object that missed in the cache.
+ *
+ * Returns the generation to pass to SharedMDCacheInsert() once the object
+ * is translated.  The generation is read before absorbing invalidations, so
+ * that a change this backend has not seen yet always invalidates the entry.
+ */
+uint64
+SharedMDCacheBeginLoad(void)
+{
+	uint64		generation;
+
+	Assert(SharedMDCacheEnabled());
+
+	LWLockAcquire(SharedMDCacheLock, LW_SHARED);
+	generation = mdcacheCtl->generation;
+	LWLockRelease(SharedMDCacheLock);
+
+	AcceptInvalidationMessages();
+
+	return generation;
+}
+
+/*
+ * SharedMDCacheLookup
+ *		Look up the serialized object with the given metadata id.
+ *
+ * Returns a palloc'd copy of the data and sets *len, or returns NULL.
+ */
+void *
+SharedMDCacheLookup(const char *mdid, Size *len)
+{
+	SharedMDCacheKey key;
+	SharedMDCacheEntry *entry;
+	void	   *data = NULL;
+
+	Assert(SharedMDCacheEnabled());
+
+	if (strlen(mdid) >= SHARED_MDCACHE_MDID_LEN)
+		return NULL;
+
+	/* this backend must see its own uncommitted catalog changes */
+	if (TransactionHasPendingInvalidations())
+		return NULL;
+
+	SharedMDCacheMakeKey(&key, mdid);
+
+	LWLockAcquire(SharedMDCacheLock, LW_SHARED);
+
+	entry = (SharedMDCacheEntry *) hash_search(mdcacheHash, &key, HASH_FIND, NULL);
+	if (entry != NULL && entry->generation == mdcacheCtl->generation)
+	{
+		/*
+		 * Copying while holding the lock keeps the arena from being reset
+		 * under us; an ERROR from palloc releases the lock.
+		 */
+		data = palloc(entry->len);
+		memcpy(data, mdcacheArena + entry->offset, entry->len);
+		*len = entry->len;
+	}
+
+	LWLockRelease(SharedMDCacheLock);
+
+	return data;
+}
+
+/*
+ * SharedMDCacheInsert
+ *		Store a serialized object translated in the given generation.
+ */
+void
+SharedMDCacheInsert(const char *mdid, const void *data, Size len,
+					uint64 generation)
+{
+	SharedMDCacheKey key;
+	SharedMDCacheEntry *entry;
+	Size		alloc_len = MAXALIGN(len);
+	bool		found;
+
+	Assert(SharedMDCacheEnabled());
+
+	if (strlen(mdid) >= SHARED_MDCACHE_MDID_LEN)
+		return;
+
+	/*
+	 * The object may have been translated from uncommitted catalog changes;
+	 * if the transaction aborts, nothing would invalidate it.
+	 */
+	if (TransactionHasPendingInvalidations())
+		return;
+
+	/* do not let a single large object flush everything else */
+	if (alloc_len > mdcacheCtl->arena_size / 4)
+		return;
+
+	SharedMDCacheMakeKey(&key, mdid);
+
+	LWLockAcquire(SharedMDCacheLock, LW_EXCLUSIVE);
+
+	if (generation != mdcacheCtl->generation)
+	{
+		/* catalogs changed while the object was being translated */
+		LWLockRelease(SharedMDCacheLock);
+		return;
+	}
+
+	if (mdcacheCtl->arena_generation != mdcacheCtl->generation ||
+		mdcacheCtl->arena_used + alloc_len > mdcacheCtl->arena_size)
+		SharedMDCacheReset();
+
+	entry = (SharedMDCacheEntry *)
+		hash_search(mdcacheHash, &key, HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		/* hash table is full */
+		SharedMDCacheReset();
+		entry = (SharedMDCacheEntry *)
+			hash_search(mdcacheHash, &key, HASH_ENTER_NULL, &found);
+		if (entry == NULL)
+		{
+			LWLockRelease(SharedMDCacheLock);
+			return;
+		}
+	}
+
+	/*
+	 * An entry of the current generation may already be there if another
+	 * backend translated the same object concurrently; leave its data be.
+	 */
+	if (!found || entry->generation != generation)
+	{
+		entry->offset = mdcacheCtl->arena_used;
+		entry->len = len;
+		entry->generation = generation;
+		memcpy(mdcacheArena + entry->offset, data, len);
+		mdcacheCtl->arena_used += alloc_len;
+	}
+
+	LWLockRelease(SharedMDCacheLock);
+}
+
+/*
+ * SharedMDCacheInvalidate
+ *		Called by the sender of shared invalidation messages.
+ *
+ * Any catcache or relcache message advances the generation; smgr messages
+ * do not change metadata.
+ */
+void
+SharedMDCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	int			i;
+
+	if (!SharedMDCacheEnabled())
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		if (msgs[i].id != SHAREDINVALSMGR_ID)
+			break;
+	}
+
+	if (i == n)
+		return;
+
+	LWLockAcquire(SharedMDCacheLock, LW_EXCLUSIVE);
+	mdcacheCtl->generation++;
+	LWLockRelease(SharedMDCacheLock);
+}
@@ -1296,8 +1296,11 @@ datumstreamread_block_content(DatumStreamRead * acc)
 }
 
 
-int
-datumstreamread_block(DatumStreamRead * acc)
+/*
+ * Read the header of the next block, without its content.
+ */
+static bool
+datumstreamread_next_block_info(DatumStreamRead * acc)
 {
 	bool		readOK = false;
 
@@ -1313,7 +1316,7 @@ datumstreamread_block(DatumStreamRead * acc)
 												&acc->getBlockInfo.isLarge,
 											&acc->getBlockInfo.isCompressed);
 	if (!readOK)
-		return -1;
+		return false;
 
 	if (Debug_appendonly_print_datumstream)
 		elog(LOG,
@@ -1355,11 +1358,60 @@ datumstreamread_block(DatumStreamRead * acc)
 			 acc->blockFileOffset,
 			 acc->blockRowCount);
 
+	return true;
+}
+
+int
+datumstreamread_block(DatumStreamRead * acc)
+{
+	if (!datumstreamread_next_block_info(acc))
+		return -1;
+
 	datumstreamread_block_content(acc);
 
 	return 0;
 }
 
+/*
+ * Position the stream so that the next datumstreamread_advance returns the
+ * first row numbered rowNum or later.  The stream must be positioned on a
+ * row before rowNum, or before the first block of the file.  Blocks that
+ * end before rowNum are skipped without reading their content.
+ *
+ * Returns -1 if there is no such row in the file.
+ */
+int
+datumstreamread_skip_to_row(DatumStreamRead * acc, int64 rowNum)
+{
+	int32		rowNumInBlock;
+
+	Assert(acc);
+
+	if (rowNum >= acc->blockFirstRowNum + acc->blockRowCount)
+	{
+		while (true)
+		{
+			if (!datumstreamread_next_block_info(acc))
+				return -1;
+
+			if (rowNum < acc->blockFirstRowNum + acc->blockRowCount)
+				break;
+
+			AppendOnlyStorageRead_SkipCurrentBlock(&acc->ao_read);
+		}
+
+		datumstreamread_block_content(acc);
+	}
+
+	/* Stop just before rowNum, so that the caller's advance lands on it. */
+	rowNumInBlock = (int32) (rowNum - acc->blockFirstRowNum) - 1;
+	if (rowNumInBlock >= 0 &&
+		rowNumInBlock > datumstreamread_nth(acc))
+		datumstreamread_find(acc, rowNumInBlock);
+
+	return 0;
+}
+
 void
 datumstreamread_rewind_block(DatumStreamRead * datumStream)
 {
@@ -13,6 +13,23 @@
 /*	Forwards. */
 static char *VarlenaInfoToBuffer(char *buffer, uint8 * p);
 
+/*
+ * Batch decoding kernels.  Called through pointers that are set on first
+ * use to the fastest version the CPU supports (see the end of the file).
+ */
+typedef void (*DatumStreamExpandBitsFunc) (uint8 * bits, int32 firstBit,
+										   int32 bitCount, bool *out);
+typedef void (*DatumStreamWiden4Func) (uint8 * src, int32 count, Datum *out);
+
+static void DatumStreamBlock_ExpandBitsDetect(uint8 * bits, int32 firstBit,
+								  int32 bitCount, bool *out);
+static void DatumStreamBlock_Widen4Detect(uint8 * src, int32 count, Datum *out);
+
+static DatumStreamExpandBitsFunc DatumStreamBlock_ExpandBits =
+	DatumStreamBlock_ExpandBitsDetect;
+static DatumStreamWiden4Func DatumStreamBlock_Widen4 =
+	DatumStreamBlock_Widen4Detect;
+
 static void DatumStreamBlock_IntegrityCheckOrig(
 									uint8 * buffer,
 									int32 bufferSize,
@@ -931,6 +948,226 @@ DatumStreamBlockRead_GetReadyDense(
 	dsr->datump = dsr->datum_beginp;
 }
 
+/*
+ * Batch decoding.
+ *
+ * Plain Dense blocks (no RLE_TYPE or delta compression) of fixed-length types
+ * are decoded a whole batch at a time: the NULL bit-map is expanded into the
+ * nulls array by a vectorized kernel, and the physical datums are then
+ * loaded (and for 4 byte types widened, again vectorized) into Datums in one
+ * pass.
+ *
+ * Other blocks go through the per-row routines, except that each RLE_TYPE
+ * repeated item is decoded once and then copied into all the rows it
+ * repeats for.
+ */
+
+/*
+ * Load the physical datums of the next batchCount rows of a plain Dense
+ * block, given their NULL flags in nulls[].  Returns the number of physical
+ * datums.
+ */
+static int32
+DatumStreamBlockRead_LoadPlain(
+							   DatumStreamBlockRead * dsr,
+							   uint8 * nextp,
+							   int32 batchCount,
+							   bool *nulls,
+							   Datum *values)
+{
+	int32		datumlen = dsr->typeInfo.datumlen;
+	int32		i;
+	int32		k = 0;
+
+	if (!dsr->typeInfo.byval)
+	{
+		for (i = 0; i < batchCount; i++)
+		{
+			values[i] = nulls[i] ? 0 : PointerGetDatum(nextp + k * datumlen);
+			k += nulls[i] ? 0 : 1;
+		}
+		return k;
+	}
+
+#define LOAD_PLAIN_LOOP(fetch) \
+	for (i = 0; i < batchCount; i++) \
+	{ \
+		values[i] = nulls[i] ? 0 : (fetch); \
+		k += nulls[i] ? 0 : 1; \
+	}
+
+	switch (datumlen)
+	{
+		case 1:
+			LOAD_PLAIN_LOOP(*(uint8 *) (nextp + k));
+			break;
+		case 2:
+			LOAD_PLAIN_LOOP(*(uint16 *) (nextp + 2 * k));
+			break;
+		case 4:
+			LOAD_PLAIN_LOOP(*(uint32 *) (nextp + 4 * k));
+			break;
+		case 8:
+			LOAD_PLAIN_LOOP(*(Datum *) (nextp + 8 * k));
+			break;
+		default:
+			Assert(false);
+	}
+#undef LOAD_PLAIN_LOOP
+
+	return k;
+}
+
+/*
+ * Advance over the next batchCount rows of the block and return them, as
+ * batchCount calls of DatumStreamBlockRead_Advance and _Get would.
+ *
+ * Only the rows whose keep[] flag is set (all rows when keep is NULL) are
+ * returned, in values[] and nulls[], which must have room for batchCount
+ * entries.  If runids is not NULL, returned rows that come from the same
+ * RLE_TYPE repeated item get the same run id; every other row gets one of
+ * its own.  Returns the number of rows returned.
+ */
+int32
+DatumStreamBlockRead_GetBatch(
+							  DatumStreamBlockRead * dsr,
+							  int32 batchCount,
+							  const bool *keep,
+							  Datum *values,
+							  bool *nulls,
+							  int32 * runids)
+{
+	int32		datumlen = dsr->typeInfo.datumlen;
+	int32		nout;
+	int32		runid;
+	Datum		runValue = 0;
+	bool		runIsNull;
+	int32		i;
+
+	Assert(batchCount >= 0);
+	Assert(dsr->nth + batchCount < dsr->logical_row_count);
+
+	if (dsr->datumStreamVersion != DatumStreamVersion_Original &&
+		!dsr->rle_block_was_compressed &&
+		!dsr->delta_block_was_compressed &&
+		datumlen > 0 &&
+		(!dsr->typeInfo.byval ||
+		 datumlen == 1 || datumlen == 2 || datumlen == 4 || datumlen == 8))
+	{
+		uint8	   *nextp;
+		int32		physicalCount;
+
+		if (dsr->has_null)
+		{
+			DatumStreamBlock_ExpandBits(
+									dsr->null_bitmap_beginp,
+					  DatumStreamBitMapRead_Position(&dsr->null_bitmap) + 1,
+										batchCount,
+										nulls);
+			DatumStreamBitMapRead_Skip(&dsr->null_bitmap, batchCount);
+		}
+		else
+			memset(nulls, 0, batchCount * sizeof(bool));
+
+		/* The datum pointer is left on the last physical datum returned */
+		if (dsr->physical_datum_index == -1)
+			nextp = dsr->datump;
+		else
+			nextp = dsr->datump + datumlen;
+
+		if (!dsr->has_null && dsr->typeInfo.byval && datumlen == 4)
+		{
+			DatumStreamBlock_Widen4(nextp, batchCount, values);
+			physicalCount = batchCount;
+		}
+		else
+			physicalCount = DatumStreamBlockRead_LoadPlain(dsr, nextp, batchCount,
+														 nulls, values);
+
+		Assert(nextp + physicalCount * datumlen <= dsr->datum_afterp);
+		if (physicalCount > 0)
+		{
+			dsr->physical_datum_index += physicalCount;
+			dsr->datump = nextp + (physicalCount - 1) * datumlen;
+		}
+		dsr->nth += batchCount;
+
+		nout = 0;
+		for (i = 0; i < batchCount; i++)
+		{
+			if (keep != NULL && !keep[i])
+				continue;
+			values[nout] = values[i];
+			nulls[nout] = nulls[i];
+			if (runids != NULL)
+				runids[nout] = i;
+			nout++;
+		}
+		return nout;
+	}
+
+	/*
+	 * When we start inside a repeated item, pick up its value.
+	 */
+	runid = 0;
+	if (dsr->rle_in_repeated_item)
+		DatumStreamBlockRead_Get(dsr, &runValue, &runIsNull);
+
+	nout = 0;
+	i = 0;
+	while (i < batchCount)
+	{
+		if (dsr->rle_in_repeated_item)
+		{
+			int32		repeatCount;
+			int32		j;
+
+			/*
+			 * The rest of the repeated item (or as much of it as the batch
+			 * holds) all at once.
+			 */
+			repeatCount = Min(dsr->rle_repeated_item_count, batchCount - i);
+			Assert(repeatCount > 0);
+
+			for (j = i; j < i + repeatCount; j++)
+			{
+				if (keep != NULL && !keep[j])
+					continue;
+				values[nout] = runValue;
+				nulls[nout] = false;
+				if (runids != NULL)
+					runids[nout] = runid;
+				nout++;
+			}
+
+			dsr->nth += repeatCount;
+			dsr->rle_repeated_item_count -= repeatCount;
+			dsr->rle_total_repeat_items_read += repeatCount;
+			if (dsr->rle_repeated_item_count <= 0)
+				dsr->rle_in_repeated_item = false;
+
+			i += repeatCount;
+			continue;
+		}
+
+		DatumStreamBlockRead_Advance(dsr);
+		DatumStreamBlockRead_Get(dsr, &runValue, &runIsNull);
+		runid++;
+
+		if (keep == NULL || keep[i])
+		{
+			values[nout] = runValue;
+			nulls[nout] = runIsNull;
+			if (runids != NULL)
+				runids[nout] = runid;
+			nout++;
+		}
+		i++;
+	}
+
+	return nout;
+}
+
 static int
 errdetail_datumstreamblockwrite(
 								DatumStreamBlockWrite * dsw)
@@ -5622,3 +5859,182 @@ VarlenaInfoToString2(uint8 * p)
 {
 	return VarlenaInfoToBuffer(varlenaInfoBuffer2, p);
 }
+
+
+/*
+ * Batch decoding kernels.
+ */
+
+/*
+ * Expand bitCount bits of a bit-map, starting at bit firstBit, into one
+ * bool per bit.
+ */
+static void
+DatumStreamBlock_ExpandBitsScalar(uint8 * bits, int32 firstBit,
+								  int32 bitCount, bool *out)
+{
+	int32		i = 0;
+
+	/* Up to a byte boundary */
+	for (; i < bitCount && ((firstBit + i) & 7) != 0; i++)
+		out[i] = (bits[(firstBit + i) >> 3] >> ((firstBit + i) & 7)) & 1;
+
+	/* A byte at a time */
+	for (; i + 8 <= bitCount; i += 8)
+	{
+		uint8		b = bits[(firstBit + i) >> 3];
+
+		out[i] = b & 1;
+		out[i + 1] = (b >> 1) & 1;
+		out[i + 2] = (b >> 2) & 1;
+		out[i + 3] = (b >> 3) & 1;
+		out[i + 4] = (b >> 4) & 1;
+		out[i + 5] = (b >> 5) & 1;
+		out[i + 6] = (b >> 6) & 1;
+		out[i + 7] = (b >> 7) & 1;
+	}
+
+	for (; i < bitCount; i++)
+		out[i] = (bits[(firstBit + i) >> 3] >> ((firstBit + i) & 7)) & 1;
+}
+
+/*
+ * Widen count 4 byte (unaligned) values into Datums.
+ */
+static void
+DatumStreamBlock_Widen4Scalar(uint8 * src, int32 count, Datum *out)
+{
+	uint32	   *p = (uint32 *) src;
+	int32		i;
+
+	for (i = 0; i < count; i++)
+		out[i] = p[i];
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define DATUMSTREAM_USE_AVX2 1
+#endif
+
+#ifdef DATUMSTREAM_USE_AVX2
+#pragma GCC push_options
+#pragma GCC target ("avx2")
+#include <immintrin.h>
+
+static void
+DatumStreamBlock_ExpandBitsAvx2(uint8 * bits, int32 firstBit,
+								int32 bitCount, bool *out)
+{
+	const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+											1, 1, 1, 1, 1, 1, 1, 1,
+											2, 2, 2, 2, 2, 2, 2, 2,
+											3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i bitMask = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+											 1, 2, 4, 8, 16, 32, 64, -128,
+											 1, 2, 4, 8, 16, 32, 64, -128,
+											 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m256i one = _mm256_set1_epi8(1);
+	int32		i = 0;
+
+	/* Up to a byte boundary */
+	for (; i < bitCount && ((firstBit + i) & 7) != 0; i++)
+		out[i] = (bits[(firstBit + i) >> 3] >> ((firstBit + i) & 7)) & 1;
+
+	/*
+	 * 32 bits at a time: copy byte n of the 4 into output bytes 8n..8n+7,
+	 * then keep bit (output byte % 8) of each.
+	 */
+	for (; i + 32 <= bitCount; i += 32)
+	{
+		uint32		word;
+		__m256i		v;
+
+		memcpy(&word, &bits[(firstBit + i) >> 3], sizeof(word));
+		v = _mm256_shuffle_epi8(_mm256_set1_epi32(word), spread);
+		v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bitMask), bitMask);
+		_mm256_storeu_si256((__m256i *) & out[i], _mm256_and_si256(v, one));
+	}
+
+	if (i < bitCount)
+		DatumStreamBlock_ExpandBitsScalar(bits, firstBit + i, bitCount - i,
+										  &out[i]);
+}
+
+static void
+DatumStreamBlock_Widen4Avx2(uint8 * src, int32 count, Datum *out)
+{
+	int32		i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i		v = _mm_loadu_si128((__m128i *) (src + 4 * i));
+
+		_mm256_storeu_si256((__m256i *) & out[i], _mm256_cvtepu32_epi64(v));
+	}
+
+	if (i < count)
+		DatumStreamBlock_Widen4Scalar(src + 4 * i, count - i, &out[i]);
+}
+
+#pragma GCC pop_options
+
+#include <cpuid.h>
+
+/*
+ * Does the CPU, and the OS, support AVX2?
+ */
+static bool
+DatumStreamBlock_HasAvx2(void)
+{
+	uint32		eax,
+				ebx,
+				ecx,
+				edx;
+	uint32		xcr0;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__cpuid(1, eax, ebx, ecx, edx);
+	if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0)
+		return false;
+
+	/* The OS must save the YMM registers */
+	__asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+	if ((xcr0 & 6) != 6)
+		return false;
+
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx & bit_AVX2) != 0;
+}
+#endif   /* DATUMSTREAM_USE_AVX2 */
+
+static void
+DatumStreamBlock_DetectKernels(void)
+{
+	DatumStreamBlock_ExpandBits = DatumStreamBlock_ExpandBitsScalar;
+	DatumStreamBlock_Widen4 = DatumStreamBlock_Widen4Scalar;
+
+#ifdef DATUMSTREAM_USE_AVX2
+	if (DatumStreamBlock_HasAvx2())
+	{
+		DatumStreamBlock_ExpandBits = DatumStreamBlock_ExpandBitsAvx2;
+		DatumStreamBlock_Widen4 = DatumStreamBlock_Widen4Avx2;
+	}
+#endif
+}
+
+static void
+DatumStreamBlock_ExpandBitsDetect(uint8 * bits, int32 firstBit,
+								  int32 bitCount, bool *out)
+{
+	DatumStreamBlock_DetectKernels();
+	DatumStreamBlock_ExpandBits(bits, firstBit, bitCount, out);
+}
+
+static void
+DatumStreamBlock_Widen4Detect(uint8 * src, int32 count, Datum *out)
+{
+	DatumStreamBlock_DetectKernels();
+	DatumStreamBlock_Widen4(src, count, out);
+}
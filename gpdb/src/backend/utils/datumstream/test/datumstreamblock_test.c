@@ -167,13 +167,139 @@ test__DeltaCompression__Core(void **state)
 	free(dsw);
 }
 
+/*
+ * The batch bit-map expansion must agree with the byte-at-a-time one for
+ * any starting bit and length.
+ */
+void
+test__ExpandBits__MatchesScalar(void **state)
+{
+	uint8		bits[32];
+	bool		expected[200];
+	bool		actual[200];
+	int			firstBit;
+	int			bitCount;
+	int			i;
+
+	for (i = 0; i < sizeof(bits); i++)
+		bits[i] = (uint8) (i * 37 + 11);
+
+	for (firstBit = 0; firstBit < 12; firstBit++)
+	{
+		for (bitCount = 0; bitCount <= 100; bitCount++)
+		{
+			DatumStreamBlock_ExpandBitsScalar(bits, firstBit, bitCount, expected);
+			DatumStreamBlock_ExpandBits(bits, firstBit, bitCount, actual);
+
+			for (i = 0; i < bitCount; i++)
+			{
+				assert_int_equal(expected[i],
+								 (bits[(firstBit + i) / 8] >> ((firstBit + i) % 8)) & 1);
+				assert_int_equal(actual[i], expected[i]);
+			}
+		}
+	}
+}
+
+/*
+ * DatumStreamBlockRead_GetBatch over a plain Dense int4 block with NULLs must
+ * return what Advance and Get return row by row, and leave the reader where
+ * they would.
+ */
+void
+test__GetBatch__PlainDenseMatchesAdvance(void **state)
+{
+#define TEST_ROWS 100
+	DatumStreamBlockRead batchRead;
+	DatumStreamBlockRead rowRead;
+	uint8		nullBits[(TEST_ROWS + 7) / 8];
+	int32		data[TEST_ROWS];
+	bool		keep[TEST_ROWS];
+	Datum		values[TEST_ROWS];
+	bool		nulls[TEST_ROWS];
+	int32		physicalCount = 0;
+	int			batches[] = {1, 7, 40, 52};
+	int			row = 0;
+	int			b;
+	int			i;
+
+	memset(nullBits, 0, sizeof(nullBits));
+	for (i = 0; i < TEST_ROWS; i++)
+	{
+		if (i % 3 == 1 || (i >= 60 && i < 70))
+			nullBits[i / 8] |= 1 << (i % 8);
+		else
+			data[physicalCount++] = i * 1000;
+		keep[i] = (i % 5 != 0);
+	}
+
+	memset(&batchRead, 0, sizeof(batchRead));
+	strncpy(batchRead.eyecatcher, DatumStreamBlockRead_Eyecatcher,
+			DatumStreamBlockRead_EyecatcherLen);
+	batchRead.datumStreamVersion = DatumStreamVersion_Dense;
+	batchRead.typeInfo.datumlen = 4;
+	batchRead.typeInfo.typid = INT4OID;
+	batchRead.typeInfo.align = 'i';
+	batchRead.typeInfo.byval = true;
+	batchRead.nth = -1;
+	batchRead.physical_datum_index = -1;
+	batchRead.logical_row_count = TEST_ROWS;
+	batchRead.physical_datum_count = physicalCount;
+	batchRead.physical_data_size = physicalCount * sizeof(int32);
+	batchRead.has_null = true;
+	batchRead.null_bitmap_beginp = nullBits;
+	DatumStreamBitMapRead_Init(&batchRead.null_bitmap, nullBits, TEST_ROWS);
+	batchRead.datum_beginp = (uint8 *) data;
+	batchRead.datum_afterp = (uint8 *) &data[physicalCount];
+	batchRead.datump = batchRead.datum_beginp;
+
+	memcpy(&rowRead, &batchRead, sizeof(rowRead));
+
+	for (b = 0; b < lengthof(batches); b++)
+	{
+		int			n;
+		int			out = 0;
+
+		n = DatumStreamBlockRead_GetBatch(&batchRead, batches[b], &keep[row],
+										  values, nulls, NULL);
+
+		for (i = row; i < row + batches[b]; i++)
+		{
+			Datum		d = 0;
+			bool		isnull;
+
+			assert_int_equal(DatumStreamBlockRead_AdvanceDense(&rowRead), 1);
+			DatumStreamBlockRead_Get(&rowRead, &d, &isnull);
+			if (!keep[i])
+				continue;
+			assert_int_equal(nulls[out], isnull);
+			if (!isnull)
+				assert_int_equal(DatumGetInt32(values[out]), DatumGetInt32(d));
+			out++;
+		}
+		assert_int_equal(n, out);
+
+		assert_int_equal(batchRead.nth, rowRead.nth);
+		assert_int_equal(batchRead.physical_datum_index, rowRead.physical_datum_index);
+		assert_true(batchRead.datump == rowRead.datump);
+		assert_int_equal(DatumStreamBitMapRead_Position(&batchRead.null_bitmap),
+						 DatumStreamBitMapRead_Position(&rowRead.null_bitmap));
+
+		row += batches[b];
+	}
+	assert_int_equal(row, TEST_ROWS);
+#undef TEST_ROWS
+}
+
 int 
 main(int argc, char* argv[]) 
 {
 	cmockery_parse_arguments(argc, argv);
 
 	const UnitTest tests[] = {
-			unit_test(test__DeltaCompression__Core)
+			unit_test(test__DeltaCompression__Core),
+			unit_test(test__ExpandBits__MatchesScalar),
+			unit_test(test__GetBatch__PlainDenseMatchesAdvance)
 	};
 	return run_tests(tests);
 }
@@ -573,6 +573,138 @@ crc32cHardware32(pg_crc32 crc, const void* data, int length)
 }
 
 
+#ifdef __LP64__
+/*
+ * 3-way interleaved CRC-32C.
+ *
+ * The CRC32 instruction has a latency of 3 cycles but can start a new one
+ * every cycle, so one dependent chain of them only uses a third of what the
+ * CPU can do.  For long buffers we checksum three adjacent blocks at once,
+ * each in its own chain, and then combine the three CRCs: shifting a CRC
+ * over a block of n zero bytes is a linear operation, which we precompute
+ * into four lookup tables for each of the two block sizes we use.
+ */
+#define CRC32C_POLY			0x82F63B78
+#define CRC32C_LONG_BLOCK	8192
+#define CRC32C_SHORT_BLOCK	256
+
+static uint32 crc32cLongShift[4][256];
+static uint32 crc32cShortShift[4][256];
+static bool crc32cShiftTablesReady = false;
+
+/* Multiply a 32x32 GF(2) matrix by a vector. */
+static uint32
+gf2MatrixTimes(const uint32 *mat, uint32 vec)
+{
+	uint32		sum = 0;
+
+	while (vec)
+	{
+		if (vec & 1)
+			sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+	return sum;
+}
+
+/* square = mat * mat */
+static void
+gf2MatrixSquare(uint32 *square, const uint32 *mat)
+{
+	for (int n = 0; n < 32; n++)
+		square[n] = gf2MatrixTimes(mat, mat[n]);
+}
+
+/*
+ * Build the tables that shift a CRC over len zero bytes.  len must be a
+ * power of two.
+ */
+static void
+crc32cBuildShiftTable(uint32 table[4][256], size_t len)
+{
+	uint32		even[32];
+	uint32		odd[32];
+	uint32		row = 1;
+	uint32	   *op;
+
+	/* operator for one zero bit */
+	odd[0] = CRC32C_POLY;
+	for (int n = 1; n < 32; n++)
+	{
+		odd[n] = row;
+		row <<= 1;
+	}
+
+	/* square up to one zero byte, then once for every bit of len */
+	gf2MatrixSquare(even, odd);		/* 2 zero bits */
+	gf2MatrixSquare(odd, even);		/* 4 zero bits */
+	op = odd;
+	for (;;)
+	{
+		gf2MatrixSquare(even, odd);
+		op = even;
+		len >>= 1;
+		if (len == 0)
+			break;
+		gf2MatrixSquare(odd, even);
+		op = odd;
+		len >>= 1;
+		if (len == 0)
+			break;
+	}
+
+	for (uint32 n = 0; n < 256; n++)
+	{
+		table[0][n] = gf2MatrixTimes(op, n);
+		table[1][n] = gf2MatrixTimes(op, n << 8);
+		table[2][n] = gf2MatrixTimes(op, n << 16);
+		table[3][n] = gf2MatrixTimes(op, n << 24);
+	}
+}
+
+static inline uint32
+crc32cShift(uint32 table[4][256], uint32 crc)
+{
+	return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^
+		table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+/*
+ * Checksum as many whole groups of three blocks of blocklen bytes as there
+ * are at *p_buf, advancing *p_buf and *length past them.
+ */
+static inline uint64
+crc32cHardware64Interleaved(uint64 crc0, const char **p_buf, int *length,
+							int blocklen, uint32 shift[4][256])
+{
+	const char *next = *p_buf;
+
+	while (*length >= 3 * blocklen)
+	{
+		uint64		crc1 = 0;
+		uint64		crc2 = 0;
+		const char *end = next + blocklen;
+
+		do
+		{
+			crc0 = _mm_crc32_u64(crc0, *(uint64 *) next);
+			crc1 = _mm_crc32_u64(crc1, *(uint64 *) (next + blocklen));
+			crc2 = _mm_crc32_u64(crc2, *(uint64 *) (next + 2 * blocklen));
+			next += sizeof(uint64);
+		} while (next < end);
+
+		crc0 = crc32cShift(shift, (uint32) crc0) ^ crc1;
+		crc0 = crc32cShift(shift, (uint32) crc0) ^ crc2;
+		next += 2 * blocklen;
+		*length -= 3 * blocklen;
+	}
+
+	*p_buf = next;
+	return crc0;
+}
+#endif
+
 /* Hardware-accelerated CRC-32C (using CRC32 instruction) */
 pg_crc32
 crc32cHardware64(pg_crc32 crc, const void* data, int length)
@@ -583,6 +715,14 @@ crc32cHardware64(pg_crc32 crc, const void* data, int length)
     const char* p_buf = (const char*) data;
     uint64 crc64bit = crc;
 
+    if (length >= 3 * CRC32C_SHORT_BLOCK && crc32cShiftTablesReady)
+    {
+        crc64bit = crc32cHardware64Interleaved(crc64bit, &p_buf, &length,
+                                               CRC32C_LONG_BLOCK, crc32cLongShift);
+        crc64bit = crc32cHardware64Interleaved(crc64bit, &p_buf, &length,
+                                               CRC32C_SHORT_BLOCK, crc32cShortShift);
+    }
+
     for (int i = 0; i < length / sizeof(uint64); i++)
     {
         crc64bit = _mm_crc32_u64(crc64bit, *(uint64*) p_buf);
@@ -645,6 +785,12 @@ crc32cDetectBestMethod(pg_crc32 crc, const void* data, int length)
 	if (hasSSE42)
 	{
 #ifdef __LP64__
+		if (!crc32cShiftTablesReady)
+		{
+			crc32cBuildShiftTable(crc32cLongShift, CRC32C_LONG_BLOCK);
+			crc32cBuildShiftTable(crc32cShortShift, CRC32C_SHORT_BLOCK);
+			crc32cShiftTablesReady = true;
+		}
 		crc32c = &crc32cHardware64;
 #else
 		crc32c= &crc32cHardware32;
@@ -0,0 +1,154 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "c.h"
+#include "utils/pg_crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/* Large enough for several groups of the long interleaved blocks. */
+#define TEST_BUFSIZE (128 * 1024)
+
+static char test_buf[TEST_BUFSIZE + 64];
+
+static void
+fill_test_buf(void)
+{
+	srandom(42);
+	for (int i = 0; i < sizeof(test_buf); i++)
+		test_buf[i] = (char) random();
+}
+
+static pg_crc32
+checksum(CRC32CFunctionPtr fn, const void *data, int length)
+{
+	return crc32cFinish(fn(crc32cInit(), data, length));
+}
+
+/*
+ * The standard CRC-32C check value.
+ */
+void
+test__crc32c__check_value(void **state)
+{
+	const char *check = "123456789";
+
+	assert_int_equal(checksum(crc32cSlicingBy8, check, 9), 0xE3069283);
+	assert_int_equal(checksum(crc32c, check, 9), 0xE3069283);
+}
+
+/*
+ * Whatever implementation crc32c picked must agree with Slicing-by-8 for
+ * all lengths around the block sizes of the interleaved hardware path, at
+ * any alignment.
+ */
+void
+test__crc32c__matches_slicing(void **state)
+{
+	static const int lengths[] = {
+		0, 1, 3, 7, 8, 9, 255, 256, 767, 768, 769, 1000, 8192,
+		3 * 8192 - 1, 3 * 8192, 3 * 8192 + 8, 3 * 8192 + 3 * 256 + 5,
+		TEST_BUFSIZE
+	};
+
+	fill_test_buf();
+
+	for (int i = 0; i < lengthof(lengths); i++)
+	{
+		for (int offset = 0; offset < 16; offset++)
+		{
+			const char *data = test_buf + offset;
+
+			assert_int_equal(checksum(crc32c, data, lengths[i]),
+							 checksum(crc32cSlicingBy8, data, lengths[i]));
+		}
+	}
+}
+
+/*
+ * Checksumming a buffer in pieces gives the same result as in one go.
+ */
+void
+test__crc32c__incremental(void **state)
+{
+	pg_crc32	whole;
+	pg_crc32	crc;
+	int			done = 0;
+	int			piece = 1;
+
+	fill_test_buf();
+
+	whole = checksum(crc32c, test_buf, TEST_BUFSIZE);
+
+	crc = crc32cInit();
+	while (done < TEST_BUFSIZE)
+	{
+		int			len = Min(piece, TEST_BUFSIZE - done);
+
+		crc = crc32c(crc, test_buf + done, len);
+		done += len;
+		piece = piece * 3 + 1;
+	}
+	assert_int_equal(crc32cFinish(crc), whole);
+}
+
+static double
+throughput(CRC32CFunctionPtr fn, int length, int loops)
+{
+	struct timeval start;
+	struct timeval end;
+	volatile pg_crc32 crc = crc32cInit();
+	double		secs;
+
+	gettimeofday(&start, NULL);
+	for (int i = 0; i < loops; i++)
+		crc = fn(crc, test_buf, length);
+	gettimeofday(&end, NULL);
+
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+	if (secs <= 0)
+		secs = 0.000001;
+	return (double) length * loops / secs / (1024 * 1024);
+}
+
+/*
+ * Micro-benchmark: report the throughput of Slicing-by-8 and of the chosen
+ * implementation for an interconnect packet, an AO block and a large
+ * buffer.  Only prints, as timings are too noisy to assert on.
+ */
+void
+test__crc32c__benchmark(void **state)
+{
+	static const int lengths[] = {64, 8192, 32768, TEST_BUFSIZE};
+
+	fill_test_buf();
+
+	for (int i = 0; i < lengthof(lengths); i++)
+	{
+		int			loops = (256 * 1024 * 1024) / lengths[i];
+		double		slicing = throughput(crc32cSlicingBy8, lengths[i], loops);
+		double		best = throughput(crc32c, lengths[i], loops);
+
+		printf("crc32c %7d bytes: slicing-by-8 %8.0f MB/s, crc32c %8.0f MB/s (%.1fx)\n",
+			   lengths[i], slicing, best, best / slicing);
+	}
+}
+
+int
+main(int argc, char* argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const UnitTest tests[] = {
+		unit_test(test__crc32c__check_value),
+		unit_test(test__crc32c__matches_slicing),
+		unit_test(test__crc32c__incremental),
+		unit_test(test__crc32c__benchmark)
+	};
+
+	return run_tests(tests);
+}
@@ -87,6 +87,7 @@
 #include "pgstat.h"
 #include "cdb/cdbvars.h"
 #include "cdb/cdbdisp.h"
+#include "cdb/cdbsrlz.h"
 #include "cdb/cdbappendonlyblockdirectory.h"
 #include "cdb/memquota.h"
 #include "utils/vmem_tracker.h"
@@ -160,6 +161,7 @@ extern char *SSLCipherSuites;
  */
 static const char *assign_hashagg_compress_spill_files(const char *newval, bool doit, GucSource source);
 static const char *assign_gp_workfile_compress_algorithm(const char *newval, bool doit, GucSource source);
+static const char *assign_gp_dispatch_compression(const char *newval, bool doit, GucSource source);
 static const char *assign_gp_workfile_type_hashjoin(const char *newval, bool doit, GucSource source);
 static const char *assign_log_destination(const char *value,
 					   bool doit, GucSource source);
@@ -329,6 +331,9 @@ bool 		gp_appendonly_verify_write_block = false;
 bool        gp_appendonly_verify_eof = true;
 bool		gp_appendonly_compaction = true;
 int         gp_appendonly_compaction_threshold = 0;
+int			gp_appendonly_prefetch_depth = 4;
+int			gp_aocs_decompress_workers = 0;
+int			gp_aocs_decompress_memory = 16384;
 bool		gp_heap_require_relhasoids_match = true;
 bool		Debug_appendonly_rezero_quicklz_compress_scratch = false;
 bool		Debug_appendonly_rezero_quicklz_decompress_scratch = false;
@@ -534,6 +539,7 @@ int	test_appendonly_version_default = AORelationVersion_GetLatest();
  */
 static char *gp_hashagg_compress_spill_files_str;
 static char *gp_workfile_compress_algorithm_str;
+static char *gp_dispatch_compression_str;
 static char *gp_workfile_type_hashjoin_str;
 static char *client_min_messages_str;
 static char *optimizer_log_failure_str;
@@ -700,6 +706,7 @@ bool 		gp_hashagg_streambottom = true;
 bool		gp_enable_agg_distinct = true;
 bool		gp_enable_dqa_pruning = true;
 bool		gp_eager_dqa_pruning = FALSE;
+bool		gp_enable_approx_count_distinct = false;
 bool		gp_eager_one_phase_agg = FALSE;
 bool		gp_eager_two_phase_agg = FALSE;
 bool        gp_enable_groupext_distinct_pruning = true;
@@ -732,6 +739,7 @@ bool		optimizer_print_plan;
 bool		optimizer_print_xform;
 bool		optimizer_metadata_caching; 
 int         optimizer_mdcache_size;
+int			optimizer_mdcache_shared_size;
 bool		optimizer_disable_xform_result_printing;
 bool		optimizer_print_memo_after_exploration;
 bool		optimizer_print_memo_after_implementation;
@@ -742,6 +750,7 @@ bool		optimizer_print_group_properties;
 bool		optimizer_print_optimization_context;
 bool		optimizer_print_optimization_stats;
 bool		optimizer_parallel;
+int			optimizer_parallel_workers;
 bool		optimizer_local;
 int 		optimizer_retries;
 bool  		optimizer_xforms[OPTIMIZER_XFORMS_COUNT] = {[0 ... OPTIMIZER_XFORMS_COUNT - 1] = false}; /* array of xforms disable flags */
@@ -817,6 +826,14 @@ bool gp_plpgsql_clear_cache_always = false;
  */
 char *gp_default_storage_options = NULL;
 
+/*
+ * Trained zstd dictionary used by compresstype=zstd_dict; a path relative to
+ * the data directory, or absolute.  Blocks record the checksum of the
+ * dictionary they were written with, so the file must not change while any
+ * zstd_dict table exists.
+ */
+char *gp_zstd_dictionary = NULL;
+
 int writable_external_table_bufsize = 64;
 
 /*
@@ -1908,6 +1925,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true, NULL, NULL
 	},
 
+	{
+		{"gp_enable_approx_count_distinct", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Compute COUNT(DISTINCT) on several different arguments with approximate HyperLogLog counts."),
+			NULL,
+		},
+		&gp_enable_approx_count_distinct,
+		false, NULL, NULL
+	},
+
 	{
 		{"gp_enable_groupext_distinct_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 		     gettext_noop("Enable 3-phase aggregation and join to compute distinct-qualified aggregates"
@@ -2043,6 +2069,26 @@ static struct config_bool ConfigureNamesBool[] =
 		true, NULL, NULL
 	},
 
+	{
+		{"gp_enable_mk_radix_sort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enable radix sort of normalized keys in multi-key sort."),
+			gettext_noop("Used for integer, float, date and timestamp keys, and text keys under the C collation."),
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_enable_mk_radix_sort,
+		true, NULL, NULL
+	},
+
+	{
+		{"gp_enable_sliding_window_agg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enable incremental evaluation of moving window frames."),
+			gettext_noop("Used for window aggregates that have a preliminary function but no inverse preliminary function."),
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_enable_sliding_window_agg,
+		true, NULL, NULL
+	},
+
 
 #ifdef USE_ASSERT_CHECKING
 	{
@@ -2066,6 +2112,73 @@ static struct config_bool ConfigureNamesBool[] =
 		true, NULL, NULL
 	},
 
+	{
+		{"gp_enable_aocs_batch_scan", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Scan column oriented tables a batch of rows at a time."),
+			gettext_noop("Simple scan quals are evaluated over the whole batch, "
+						 "and only qualifying rows are formed into tuples."),
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_enable_aocs_batch_scan,
+		false, NULL, NULL
+	},
+
+	{
+		{"gp_hashjoin_radix_cluster", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Cluster hash join tables by bucket and probe them a batch of rows at a time."),
+			gettext_noop("Once built, the hash table is radix partitioned into cache-sized "
+						 "runs of buckets, and outer rows are probed in batches with their "
+						 "buckets prefetched."),
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_hashjoin_radix_cluster,
+		false, NULL, NULL
+	},
+
+	{
+		{"gp_hashjoin_runtime_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Filter the probe side scans of hash joins with the keys of the inner rows."),
+			gettext_noop("The Hash node builds a bloom filter and, for integer keys, a "
+						 "min/max range of its join keys, which table scans on the probe "
+						 "side of the join in the same slice use to drop rows early."),
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_hashjoin_runtime_filter,
+		false, NULL, NULL
+	},
+
+	{
+		{"gp_appendonly_zonemaps", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Maintain per-block min/max zone maps for append-only tables and use them to skip blocks."),
+			gettext_noop("Zone maps are kept in the block directory, which new append-only "
+						 "tables get when this is on. Off by default, because the block "
+						 "directory adds work to every insert."),
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_appendonly_zonemaps,
+		false, NULL, NULL
+	},
+
+	{
+		{"gp_enable_motion_batch", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Send the rows of redistribute and broadcast motions in column-major batches."),
+			NULL,
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_enable_motion_batch,
+		false, NULL, NULL
+	},
+
+	{
+		{"gp_motion_batch_compress", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Compress batches of motion rows with lz4."),
+			gettext_noop("Only applies when gp_enable_motion_batch is on."),
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_motion_batch_compress,
+		false, NULL, NULL
+	},
+
 	{
 		{"gp_enable_motion_deadlock_sanity", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Enable verbose check at planning time."),
@@ -2438,6 +2551,27 @@ static struct config_bool ConfigureNamesBool[] =
 		false, NULL, NULL
 	},
 
+	{
+		{"gp_dispatch_event_driven", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Wait for segment workers from a single event loop instead of dispatch threads."),
+			gettext_noop("Uses epoll() where the platform has it, and the UDP interconnect; otherwise "
+						 "gp_connections_per_thread applies."),
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE
+		},
+		&gp_dispatch_event_driven,
+		false, NULL, NULL
+	},
+
+	{
+		{"gp_interconnect_batch_io", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Send and receive UDP interconnect packets in batches."),
+			gettext_noop("Uses sendmmsg() and recvmmsg() where the platform has them."),
+            GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_interconnect_batch_io,
+		true, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_elide_setup", PGC_USERSET, DEPRECATED_OPTIONS,
 			gettext_noop("Avoid performing full startup handshake for every statement."),
@@ -4975,6 +5109,39 @@ static struct config_int ConfigureNamesInt[] =
 		10, 0, 100, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_prefetch_depth", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Number of large reads ahead of the current one to prefetch"
+						 " when scanning an append-only segment file."),
+			gettext_noop("Each column of a column-oriented table is prefetched separately."
+						 " 0 disables prefetching.")
+		},
+		&gp_appendonly_prefetch_depth,
+		4, 0, 256, NULL, NULL
+	},
+
+	{
+		{"gp_aocs_decompress_workers", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Number of threads that decompress column-oriented table blocks"
+						 " ahead of a scan."),
+			gettext_noop("Only lz4 and zstd compressed columns are decompressed ahead."
+						 " 0 decompresses every block in the scan itself.")
+		},
+		&gp_aocs_decompress_workers,
+		0, 0, 64, NULL, NULL
+	},
+
+	{
+		{"gp_aocs_decompress_memory", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Sets the maximum memory a column-oriented table scan uses for"
+						 " blocks decompressed ahead."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&gp_aocs_decompress_memory,
+		16384, 1024, MAX_KILOBYTES, NULL, NULL
+	},
+
 	{
 		{"max_prepared_transactions", PGC_POSTMASTER, RESOURCES,
 			gettext_noop("Sets the maximum number of simultaneously prepared transactions."),
@@ -5728,6 +5895,16 @@ static struct config_int ConfigureNamesInt[] =
 		5, 0, INT_MAX, NULL, NULL
 		},
 
+	{
+		{"gp_gang_pool_size", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Sets the number of reader segworker groups to pre-fork while the session is idle."),
+			gettext_noop("Pre-forked segworker groups are kept cached between statements; 0 disables pre-forking."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_gang_pool_size,
+		0, 0, 64, NULL, NULL
+	},
+
 
 	{
 #ifdef USE_ASSERT_CHECKING
@@ -5790,6 +5967,16 @@ static struct config_int ConfigureNamesInt[] =
 		20000, 0, INT_MAX, NULL, NULL
 	},
 
+	{
+		{"gp_mk_sort_readahead_blocks", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Max number of blocks read ahead on each input tape of an external sort merge."),
+			gettext_noop("Zero reads the tapes one block at a time."),
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE
+		},
+		&gp_mk_sort_readahead_blocks,
+		8, 0, 1024, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_setup_timeout", PGC_USERSET, GP_ARRAY_TUNING,
 			gettext_noop("Timeout (in seconds) on interconnect setup that occurs at query start"),
@@ -6444,6 +6631,16 @@ static struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX, NULL, NULL
 	},
 
+	{
+		{"optimizer_parallel_workers", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Number of worker threads used by the optimization engine when optimizer_parallel is on."),
+			NULL,
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE
+		},
+		&optimizer_parallel_workers,
+		4, 1, 64, NULL, NULL
+	},
+
 	{
 		{"optimizer_mdcache_size", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Sets the size of MDCache."), 
@@ -6454,6 +6651,16 @@ static struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX, NULL, NULL
 	},
 
+	{
+		{"optimizer_mdcache_shared_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the metadata cache shared by all sessions on the master, or 0 to disable it."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&optimizer_mdcache_shared_size,
+		16384, 0, MAX_KILOBYTES, NULL, NULL
+	},
+
 	{
 		{"memory_profiler_dataset_size", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Set the size in GB"),
@@ -6836,13 +7043,23 @@ static struct config_string ConfigureNamesString[] =
 	{
 		{"gp_workfile_compress_algorithm", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Specify the compression algorithm that work files in the query executor use."),
-			gettext_noop("Valid values are \"NONE\", \"ZLIB\"."),
+			gettext_noop("Valid values are \"NONE\", \"ZLIB\", \"LZ4\", \"ZSTD\"."),
 			GUC_GPDB_ADDOPT
 		},
 		&gp_workfile_compress_algorithm_str,
 		"none", assign_gp_workfile_compress_algorithm, NULL
 	},
 
+	{
+		{"gp_dispatch_compression", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Specify the compression algorithm for plans dispatched to segments."),
+			gettext_noop("Valid values are \"NONE\", \"ZLIB\", \"LZ4\", \"ZSTD\"."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_dispatch_compression_str,
+		"lz4", assign_gp_dispatch_compression, NULL
+	},
+
 	{
 		{"gp_workfile_type_hashjoin", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Specify the type of work files to use for executing hash join plans."),
@@ -7952,6 +8169,17 @@ static struct config_string ConfigureNamesString[] =
 		&gp_default_storage_options, "", assign_gp_default_storage_options, NULL
 	},
 
+	{
+		{"gp_zstd_dictionary", PGC_POSTMASTER, APPENDONLY_TABLES,
+			gettext_noop("Sets the zstd dictionary file used by compresstype zstd_dict."),
+			gettext_noop("The file must be a dictionary trained by zstd --train and "
+						 "must be identical on all segments. A relative path is "
+						 "relative to the data directory."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_zstd_dictionary, "", NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, NULL, NULL, NULL
@@ -12749,6 +12977,17 @@ assign_gp_workfile_compress_algorithm(const char *newval, bool doit, GucSource s
 	return newval;				/* OK */
 }
 
+static const char *
+assign_gp_dispatch_compression(const char *newval, bool doit, GucSource source)
+{
+	int i = dispatch_compression_from_string(newval);
+	if (i == -1)
+		return NULL;			/* fail */
+	if (doit)
+		gp_dispatch_compress_algorithm = i;
+	return newval;				/* OK */
+}
+
 static const char *
 assign_gp_workfile_type_hashjoin(const char * newval, bool doit, GucSource source)
 {
@@ -31,6 +31,20 @@
  * the illusion of N independent tape devices to tuplesort.c.  Note that
  * logtape.c itself depends on buffile.c to provide a "logical file" of
  * larger size than the underlying OS may support.
+ *
+ * A merge reads one block at a time from many tapes, which turns into small
+ * random reads of the underlying file.  The blocks of a run are however
+ * mostly allocated in ascending order, so a tape can be given a read-ahead
+ * window (see LogicalTapeSetReadAhead): when the tape moves past the blocks
+ * in its window, the next several blocks of the file are read in one go,
+ * and the kernel is asked to start reading the ones after them, while the
+ * merge goes on consuming the window.  Blocks that turn out not to belong
+ * to the tape are simply not used; the window shrinks when that happens and
+ * grows back while the tape keeps being laid out sequentially.
+ *
+ * In the same way, block writes that follow each other in the file are
+ * collected and written together, so that writing out the initial runs
+ * does large sequential writes.
  */
 
 #include "postgres.h"
@@ -40,6 +54,8 @@
 
 #include "cdb/cdbvars.h"                /* currentSliceId */
 
+/* Max # of consecutive blocks collected before they are written out */
+#define LOGTAPE_WRITE_BATCH_BLKS 8
 
 /* A logical tape block, log tape blocks are organized into doulbe linked lists */
 #define LOGTAPE_BLK_PAYLOAD_SIZE ((BLCKSZ - sizeof(long)*2 - sizeof(int) ))
@@ -67,6 +83,18 @@ struct LogicalTape
 
 	int64 		firstBlkNum;  /* First block block number */
 	LogicalTapePos   currPos;         /* current postion */
+
+	/*
+	 * Read-ahead window: raNBlks blocks of the file starting at block
+	 * raFirstBlkNum, of which raUsed have turned out to be on this tape.
+	 * raBlks is NULL if the tape has no read-ahead.
+	 */
+	LogicalTapeBlock *raBlks;
+	int			raMaxBlks;		/* allocated length of raBlks[] */
+	int			raSpan;			/* # of blocks to read on next refill */
+	int			raNBlks;
+	int			raUsed;
+	int64		raFirstBlkNum;
 };
 
 /*
@@ -99,6 +127,15 @@ struct LogicalTapeSet
 	long		nFreeBlocks;	/* # of currently free blocks */
 	long		freeBlocksLen;	/* current allocated length of freeBlocks[] */
 
+	/*
+	 * Blocks written but not yet passed to the underlying file: wbNBlks
+	 * consecutive blocks starting at block wbFirstBlkNum.  wbBlks is NULL if
+	 * writes are not batched.
+	 */
+	LogicalTapeBlock *wbBlks;
+	int			wbNBlks;
+	int64		wbFirstBlkNum;
+
 	/*
 	 * tapes[] is declared size 1 since C wants a fixed size, but actually it
 	 * is of length nTapes.
@@ -108,7 +145,12 @@ struct LogicalTapeSet
 };
 
 static void ltsWriteBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer);
+static void ltsWriteBlocks(LogicalTapeSet *lts, int64 blocknum, void *buffer, int nblocks);
+static void ltsFlushWrites(LogicalTapeSet *lts);
 static void ltsReadBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer);
+static int	ltsReadBlocks(LogicalTapeSet *lts, int64 blocknum, void *buffer, int nblocks);
+static void ltsReadNextBlock(LogicalTapeSet *lts, LogicalTape *lt, int64 blocknum);
+static void ltsResetReadAhead(LogicalTape *lt);
 static long ltsGetFreeBlock(LogicalTapeSet *lts);
 static void ltsReleaseBlock(LogicalTapeSet *lts, int64 blocknum);
 static LogicalTapeSet *LogicalTapeSetCreate_Named(const char *set_prefix, int ntapes, bool del_on_close);
@@ -158,9 +200,15 @@ LoadLogicalTapeSetState(ExecWorkFile *statefile, ExecWorkFile *tapefile)
 	lts->freeBlocks = NULL;
 	lts->nFreeBlocks = 0;
 	lts->freeBlocksLen = 0;
+	lts->wbBlks = NULL;
+	lts->wbNBlks = 0;
+	lts->wbFirstBlkNum = -1L;
 
 	lt->writing = false;
 	lt->frozen = true;
+	lt->raBlks = NULL;
+	lt->raMaxBlks = 0;
+	ltsResetReadAhead(lt);
 
 	readSize = ExecWorkFile_Read(statefile, &(lt->firstBlkNum), sizeof(lt->firstBlkNum));
 	if(readSize != sizeof(lt->firstBlkNum))
@@ -182,14 +230,50 @@ LoadLogicalTapeSetState(ExecWorkFile *statefile, ExecWorkFile *tapefile)
  * "holes" in file), since BufFile doesn't allow that.  The first write pass
  * must write blocks sequentially.
  *
- * No need for an error return convention; we ereport() on any error.
+ * The block may only be collected in the write batch; it is written out
+ * together with the blocks following it, before anything is read.
  */
 static void
 ltsWriteBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 {
 	Assert(lts != NULL);
+
+	if (lts->wbBlks == NULL)
+	{
+		ltsWriteBlocks(lts, blocknum, buffer, 1);
+		return;
+	}
+
+	if (lts->wbNBlks > 0)
+	{
+		if (blocknum >= lts->wbFirstBlkNum &&
+			blocknum < lts->wbFirstBlkNum + lts->wbNBlks)
+		{
+			/* rewriting a block that is still in the batch */
+			memcpy(&lts->wbBlks[blocknum - lts->wbFirstBlkNum], buffer, BLCKSZ);
+			return;
+		}
+
+		if (blocknum != lts->wbFirstBlkNum + lts->wbNBlks ||
+			lts->wbNBlks == LOGTAPE_WRITE_BATCH_BLKS)
+			ltsFlushWrites(lts);
+	}
+
+	if (lts->wbNBlks == 0)
+		lts->wbFirstBlkNum = blocknum;
+	memcpy(&lts->wbBlks[lts->wbNBlks++], buffer, BLCKSZ);
+}
+
+/*
+ * Write nblocks consecutive blocks to the underlying file.
+ *
+ * No need for an error return convention; we ereport() on any error.
+ */
+static void
+ltsWriteBlocks(LogicalTapeSet *lts, int64 blocknum, void *buffer, int nblocks)
+{
 	if (ExecWorkFile_Seek(lts->pfile, blocknum * BLCKSZ, SEEK_SET) != 0 ||
-			!ExecWorkFile_Write(lts->pfile, buffer, BLCKSZ))
+			!ExecWorkFile_Write(lts->pfile, buffer, (uint64) nblocks * BLCKSZ))
 	{
 		ereport(ERROR,
 		/* XXX is it okay to assume errno is correct? */
@@ -200,6 +284,22 @@ ltsWriteBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 	}
 }
 
+/*
+ * Write out the blocks collected in the write batch.
+ */
+static void
+ltsFlushWrites(LogicalTapeSet *lts)
+{
+	int			nblocks = lts->wbNBlks;
+
+	if (nblocks == 0)
+		return;
+
+	/* forget the batch first, in case the write fails */
+	lts->wbNBlks = 0;
+	ltsWriteBlocks(lts, lts->wbFirstBlkNum, lts->wbBlks, nblocks);
+}
+
 /*
  * Read a block-sized buffer from the specified block of the underlying file.
  *
@@ -210,8 +310,7 @@ static void
 ltsReadBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 {
 	Assert(lts != NULL);
-	if (ExecWorkFile_Seek(lts->pfile, blocknum * BLCKSZ, SEEK_SET) != 0 ||
-			ExecWorkFile_Read(lts->pfile, buffer, BLCKSZ) != BLCKSZ)
+	if (ltsReadBlocks(lts, blocknum, buffer, 1) != 1)
 	{
 		ereport(ERROR,
 		/* XXX is it okay to assume errno is correct? */
@@ -221,6 +320,100 @@ ltsReadBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 	}
 }
 
+/*
+ * Read up to nblocks consecutive blocks, starting at the specified block of
+ * the underlying file.  Returns the number of whole blocks read, which is
+ * less than nblocks if the file ends earlier.
+ */
+static int
+ltsReadBlocks(LogicalTapeSet *lts, int64 blocknum, void *buffer, int nblocks)
+{
+	uint64		nbytes;
+
+	ltsFlushWrites(lts);
+
+	if (ExecWorkFile_Seek(lts->pfile, blocknum * BLCKSZ, SEEK_SET) != 0)
+		return 0;
+
+	nbytes = ExecWorkFile_Read(lts->pfile, buffer, (uint64) nblocks * BLCKSZ);
+	return (int) (nbytes / BLCKSZ);
+}
+
+/*
+ * Make the specified block, which follows the current one on the tape,
+ * the current block of the tape.
+ *
+ * With a read-ahead window, the block is taken from the window if it is
+ * there; otherwise the window is refilled starting at that block.  All the
+ * blocks of a tape being read were written before it was rewound, and
+ * none of them is written again before the tape reads past it, so a
+ * window block that the tape's chain leads to is never stale.
+ */
+static void
+ltsReadNextBlock(LogicalTapeSet *lts, LogicalTape *lt, int64 blocknum)
+{
+	int			nread;
+
+	if (lt->raBlks == NULL)
+	{
+		ltsReadBlock(lts, blocknum, &lt->currBlk);
+		return;
+	}
+
+	if (blocknum >= lt->raFirstBlkNum &&
+		blocknum < lt->raFirstBlkNum + lt->raNBlks)
+	{
+		memcpy(&lt->currBlk, &lt->raBlks[blocknum - lt->raFirstBlkNum], BLCKSZ);
+		lt->raUsed++;
+		return;
+	}
+
+	/*
+	 * Size the window after how much of the last one was on this tape:
+	 * double it if all of it was, otherwise read just as much as was used.
+	 */
+	if (lt->raNBlks > 0)
+	{
+		if (lt->raUsed >= lt->raNBlks)
+			lt->raSpan = Min(lt->raSpan * 2, lt->raMaxBlks);
+		else
+			lt->raSpan = Max(lt->raUsed, 1);
+	}
+
+	nread = ltsReadBlocks(lts, blocknum, lt->raBlks,
+						  (int) Min((int64) lt->raSpan, lts->nFileBlocks - blocknum));
+	if (nread < 1)
+	{
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read block " INT64_FORMAT  " of temporary file: %m",
+						blocknum)));
+	}
+
+	lt->raFirstBlkNum = blocknum;
+	lt->raNBlks = nread;
+	lt->raUsed = 1;
+	memcpy(&lt->currBlk, &lt->raBlks[0], BLCKSZ);
+
+	/* Have the kernel read the blocks after the window in the meantime */
+	if (lt->raSpan > 1 && nread == lt->raSpan &&
+		blocknum + nread < lts->nFileBlocks)
+		ExecWorkFile_Prefetch(lts->pfile, (blocknum + nread) * BLCKSZ,
+							  (uint64) lt->raSpan * BLCKSZ);
+}
+
+/*
+ * Forget the contents of the read-ahead window of a tape.
+ */
+static void
+ltsResetReadAhead(LogicalTape *lt)
+{
+	lt->raFirstBlkNum = -1L;
+	lt->raNBlks = 0;
+	lt->raUsed = 0;
+	lt->raSpan = lt->raMaxBlks;
+}
+
 /*
  * qsort comparator for sorting freeBlocks[] into decreasing order.
  */
@@ -311,6 +504,10 @@ LogicalTapeCreate(LogicalTapeSet *lts, LogicalTape *lt)
 	if(lt == NULL)
 		lt = (LogicalTape *) palloc(sizeof(LogicalTape));
 
+	lt->raBlks = NULL;
+	lt->raMaxBlks = 0;
+	ltsResetReadAhead(lt);
+
 	lt->writing = true;
 	lt->frozen = false;
 	lt->firstBlkNum = -1L;
@@ -344,6 +541,9 @@ LogicalTapeSetCreate_Internal(int ntapes)
 	lts->freeBlocksLen = 32;	/* reasonable initial guess */
 	lts->freeBlocks = (long *) palloc(lts->freeBlocksLen * sizeof(long));
 	lts->nFreeBlocks = 0;
+	lts->wbBlks = (LogicalTapeBlock *) palloc(LOGTAPE_WRITE_BATCH_BLKS * sizeof(LogicalTapeBlock));
+	lts->wbNBlks = 0;
+	lts->wbFirstBlkNum = -1L;
 	lts->nTapes = ntapes;
 
 	/*
@@ -407,10 +607,19 @@ LogicalTapeSet *LogicalTapeSetCreate_File(ExecWorkFile *ewfile, int ntapes)
 void
 LogicalTapeSetClose(LogicalTapeSet *lts, workfile_set *workset)
 {
+	int			i;
+
 	Assert(lts != NULL);
 	workfile_mgr_close_file(workset, lts->pfile);
 	if(lts->freeBlocks)
 		pfree(lts->freeBlocks);
+	if(lts->wbBlks)
+		pfree(lts->wbBlks);
+	for (i = 0; i < lts->nTapes; i++)
+	{
+		if (lts->tapes[i].raBlks)
+			pfree(lts->tapes[i].raBlks);
+	}
 	pfree(lts);
 }
 
@@ -429,6 +638,33 @@ LogicalTapeSetForgetFreeSpace(LogicalTapeSet *lts)
 	lts->forgetFreeSpace = true;
 }
 
+/*
+ * Give a tape a read-ahead window of nblocks blocks, or take its window
+ * away if nblocks is less than 2.
+ *
+ * The window is allocated in the current memory context.  It is released
+ * when the tape is rewound for writing, or an unfrozen tape is read to the
+ * end.
+ */
+void
+LogicalTapeSetReadAhead(LogicalTapeSet *lts, LogicalTape *lt, int nblocks)
+{
+	if (nblocks < 2)
+		nblocks = 0;
+
+	if (nblocks == lt->raMaxBlks)
+		return;
+
+	if (lt->raBlks)
+		pfree(lt->raBlks);
+	lt->raBlks = NULL;
+
+	if (nblocks > 0)
+		lt->raBlks = (LogicalTapeBlock *) palloc(nblocks * sizeof(LogicalTapeBlock));
+	lt->raMaxBlks = nblocks;
+	ltsResetReadAhead(lt);
+}
+
 /*
  * Write to a logical tape.
  *
@@ -495,6 +731,8 @@ LogicalTapeRewind(LogicalTapeSet *lts, LogicalTape *lt, bool forWrite)
 
 	if (!forWrite)
 	{
+		ltsResetReadAhead(lt);
+
 		if (lt->writing)
 		{
 			if(lt->firstBlkNum != -1)
@@ -526,6 +764,8 @@ LogicalTapeRewind(LogicalTapeSet *lts, LogicalTape *lt, bool forWrite)
 	}
 	else
 	{
+		LogicalTapeSetReadAhead(lts, lt, 0);
+
 		lt->firstBlkNum = -1L;
 		lt->currBlk.prev_blk = -1L;
 		lt->currBlk.next_blk = -1L;
@@ -565,13 +805,14 @@ LogicalTapeRead(LogicalTapeSet *lts, LogicalTape *lt, void *ptr, size_t size)
 					lt->firstBlkNum = -1L;
 					lt->currPos.blkNum = -1L;
 					lt->currPos.offset = 0;
+					LogicalTapeSetReadAhead(lts, lt, 0);
 				}
 				return nread;
 			}
 			
 			lt->currPos.blkNum = lt->currBlk.next_blk;
 			lt->currPos.offset = 0;
-			ltsReadBlock(lts, lt->currBlk.next_blk, &lt->currBlk);
+			ltsReadNextBlock(lts, lt, lt->currBlk.next_blk);
 
 			if(!lt->frozen)
 			{
@@ -627,6 +868,7 @@ LogicalTapeFlush(LogicalTapeSet *lts, LogicalTape *lt, ExecWorkFile *pstatefile)
 	Assert(lts && lts->pfile);
 	Assert(lt->frozen);
 
+	ltsFlushWrites(lts);
 	ExecWorkFile_Flush(lts->pfile);
 	DumpLogicalTapeSetState(pstatefile, lts, lt);
 }
@@ -736,5 +978,10 @@ LogicalTape *LogicalTapeSetDuplicateTape(LogicalTapeSet *lts, LogicalTape *lt)
 	Assert(lt->frozen);
 	memcpy(dup, lt, sizeof(LogicalTape));
 
+	/* the window is not shared; the duplicate reads without one */
+	dup->raBlks = NULL;
+	dup->raMaxBlks = 0;
+	ltsResetReadAhead(dup);
+
 	return dup;
 }
@@ -99,6 +99,8 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/tuptoaster.h"
@@ -119,6 +121,8 @@
 #include "utils/tuplesort.h"
 #include "utils/pg_locale.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/timestamp.h"
 #include "utils/tuplesort_mk.h"
 #include "utils/string_wrapper.h"
 #include "utils/faultinjector.h"
@@ -412,6 +416,17 @@ static inline bool LACKMEM_WITH_ESTIMATE(Tuplesortstate_mk *state)
     return MemoryContextGetCurrentSpace(state->sortcontext) + state->mkctxt.estimatedExtraForPrep > state->memAllowed;
 }
 
+/*
+ * Let the radix pass of mk_qsort use the part of work_mem that the entries,
+ * and the data that preparing them will allocate, leave over.
+ */
+static inline void tuplesort_set_radix_mem(Tuplesortstate_mk *state)
+{
+    int64 used = MemoryContextGetCurrentSpace(state->sortcontext) + state->mkctxt.estimatedExtraForPrep;
+
+    state->mkctxt.radixMemAllowed = (used < state->memAllowed) ? (long) (state->memAllowed - used) : 0;
+}
+
 /*
  * NOTES about on-tape representation of tuples:
  *
@@ -483,6 +498,7 @@ static void readtup_datum(Tuplesortstate_mk *state, TuplesortPos_mk *pos, MKEntr
 
 static void tupsort_prepare_char(MKEntry *a, bool isChar);
 static int tupsort_compare_char(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *mkContext);
+static MKNormKeyType tupsort_select_normkey(MKLvContext *sinfo);
 
 static Datum tupsort_fetch_datum_mtup(MKEntry *a, MKContext *mkctxt, MKLvContext *lvctxt, bool *isNullOut);
 static Datum tupsort_fetch_datum_itup(MKEntry *a, MKContext *mkctxt, MKLvContext *lvctxt, bool *isNullOut);
@@ -726,6 +742,7 @@ create_mksort_context(
             sinfo->typByVal = tbyv;
             sinfo->typLen = tlen;
         }
+        sinfo->normkeytype = tupsort_select_normkey(sinfo);
         sinfo->mkctxt = mkctxt;
     }
 }
@@ -1282,6 +1299,7 @@ tuplesort_performsort_mk(Tuplesortstate_mk *state)
              * We were able to accumulate all the tuples within the allowed
              * amount of memory.  Just qsort 'em and we're done.
              */
+            tuplesort_set_radix_mem(state);
             if(state->mkctxt.limit == 0)
                 mk_qsort(state->entries, state->entry_count, &state->mkctxt);
             else
@@ -2181,6 +2199,7 @@ beginmerge(Tuplesortstate_mk *state)
     int 		totalSlots;
     int			slotsPerTape;
     long		spacePerTape;
+    int			readaheadBlocks;
 
     int i;
 
@@ -2226,6 +2245,19 @@ beginmerge(Tuplesortstate_mk *state)
     slotsPerTape = Max(slotsPerTape, 128);
     spacePerTape = state->memAllowed / activeTapes;
 
+    /*
+     * Give each input tape a read-ahead window out of its share, so that the
+     * runs are read in large sequential chunks.  The windows are sized on
+     * all input tapes, as tapes with only a dummy run in this merge keep
+     * theirs.
+     */
+    readaheadBlocks = Min(gp_mk_sort_readahead_blocks,
+                          state->memAllowed / state->tapeRange / 2 / BLCKSZ);
+    if (readaheadBlocks >= 2)
+        spacePerTape -= readaheadBlocks * BLCKSZ;
+    else
+        readaheadBlocks = 0;
+
 
     oldctxt = MemoryContextSwitchTo(state->sortcontext);
     if(state->mkheap)
@@ -2270,6 +2302,7 @@ beginmerge(Tuplesortstate_mk *state)
 
             mkhr_ctxt->pos.cur_work_tape = LogicalTapeSetGetTape(state->tapeset, srcTape);
             mkhr_ctxt->pos.eof_reached = false;
+            LogicalTapeSetReadAhead(state->tapeset, mkhr_ctxt->pos.cur_work_tape, readaheadBlocks);
             mkhr_ctxt->mem_allowed = spacePerTape;
             Assert(mkhr_ctxt->mem_allowed > 0);
             mkhr_ctxt->mem_used = 0;
@@ -3243,6 +3276,162 @@ static inline int bcTruelen(char *p, int len)
     return i + 1;
 }
 
+/**
+ * Pick the normalized key of a level from its comparison function.
+ *
+ * Only btree comparison procs are recognized, since the direction of the
+ * sort is then known from sortfnkind.  Text keys are byte prefixes, which
+ * only order like the comparator under the C collation.
+ */
+static MKNormKeyType tupsort_select_normkey(MKLvContext *sinfo)
+{
+    PGFunction fn = sinfo->fmgrinfo.fn_addr;
+
+    if (sinfo->sortfnkind != SORTFUNC_CMP && sinfo->sortfnkind != SORTFUNC_REVCMP)
+        return MKNK_NONE;
+
+    if (fn == btint2cmp)
+        return MKNK_INT16;
+    if (fn == btint4cmp || fn == date_cmp)
+        return MKNK_INT32;
+    if (fn == btfloat4cmp)
+        return MKNK_FLOAT4;
+    if (fn == btfloat8cmp)
+        return MKNK_FLOAT8;
+#ifdef HAVE_INT64_TIMESTAMP
+    if (fn == btint8cmp || fn == timestamp_cmp)
+        return MKNK_INT64;
+#else
+    if (fn == btint8cmp)
+        return MKNK_INT64;
+    if (fn == timestamp_cmp)
+        return MKNK_FLOAT8;
+#endif
+    if (lc_collate_is_c())
+    {
+        if (fn == bttextcmp)
+            return MKNK_TEXT;
+        if (fn == bpcharcmp)
+            return MKNK_BPCHAR;
+    }
+
+    return MKNK_NONE;
+}
+
+/* Order-preserving unsigned key of a signed integer */
+static inline uint64 normkey_from_int64(int64 v)
+{
+    return ((uint64) v) ^ (UINT64CONST(1) << 63);
+}
+
+/*
+ * Order-preserving unsigned key of a double, following float8 comparison:
+ * -0 equals 0, and NaN is equal to itself and above everything else.
+ */
+static inline uint64 normkey_from_float8(float8 v)
+{
+    union
+    {
+        float8 f;
+        uint64 u;
+    } bits;
+
+    if (isnan(v))
+        return ~UINT64CONST(0);
+
+    bits.f = (v == 0.0) ? 0.0 : v;
+    if (bits.u & (UINT64CONST(1) << 63))
+        return ~bits.u;
+    return bits.u | (UINT64CONST(1) << 63);
+}
+
+/*
+ * The first 8 bytes of a string, most significant first, zero padded.
+ * Text cannot contain zero bytes, so a shorter string always gets a smaller key.
+ */
+static inline uint64 normkey_from_bytes(const char *p, int len)
+{
+    uint64 key = 0;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        key <<= 8;
+        if (i < len)
+            key |= (unsigned char) p[i];
+    }
+    return key;
+}
+
+/**
+ * Compute the normalized key of a prepared, non-null entry.  Comparing keys as
+ * unsigned integers orders entries like the comparator of the level does,
+ * including its direction; for text, equal keys may still hold different values.
+ */
+uint64 tupsort_normalized_key(MKEntry *a, MKLvContext *lvctxt)
+{
+    uint64 key = 0;
+
+    Assert(!mke_is_null(a));
+
+    switch (lvctxt->normkeytype)
+    {
+        case MKNK_INT16:
+            key = normkey_from_int64(DatumGetInt16(a->d));
+            break;
+        case MKNK_INT32:
+            key = normkey_from_int64(DatumGetInt32(a->d));
+            break;
+        case MKNK_INT64:
+            key = normkey_from_int64(DatumGetInt64(a->d));
+            break;
+        case MKNK_FLOAT4:
+            key = normkey_from_float8((float8) DatumGetFloat4(a->d));
+            break;
+        case MKNK_FLOAT8:
+            key = normkey_from_float8(DatumGetFloat8(a->d));
+            break;
+        case MKNK_TEXT:
+            {
+                struct varlena *v = (struct varlena *) DatumGetPointer(a->d);
+
+                /* Only the first 8 bytes are needed: fetch just those of a toasted value */
+                if (VARATT_IS_COMPRESSED(v) || VARATT_IS_EXTERNAL(v))
+                {
+                    struct varlena *slice = PG_DETOAST_DATUM_SLICE(a->d, 0, 8);
+
+                    key = normkey_from_bytes(VARDATA_ANY(slice), VARSIZE_ANY_EXHDR(slice));
+                    pfree(slice);
+                }
+                else
+                    key = normkey_from_bytes(VARDATA_ANY(v), VARSIZE_ANY_EXHDR(v));
+            }
+            break;
+        case MKNK_BPCHAR:
+            {
+                char *p;
+                int len;
+                void *toFree;
+
+                /*
+                 * The key depends on where the trailing blanks of the whole
+                 * value start, so a toasted value is detoasted in full.
+                 */
+                varattrib_untoast_ptr_len(a->d, &p, &len, &toFree);
+                len = bcTruelen(p, len);
+                key = normkey_from_bytes(p, len);
+
+                if (toFree)
+                    pfree(toFree);
+            }
+            break;
+        default:
+            Assert(!"level has no normalized key");
+    }
+
+    return (lvctxt->sortfnkind == SORTFUNC_CMP) ? key : ~key;
+}
+
 /**
  * should only be called for non-null Datum (caller must check the isnull flag from the fetch)
  */
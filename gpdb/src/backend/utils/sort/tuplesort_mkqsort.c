@@ -8,13 +8,31 @@
  * 	See [1] J. Bentley, M. McIlroy.  Engineering a sort function, 
  * 		Software Practice and Experience, Vol 23(11) Nov, 1993.
  * 	    [2] R. Sedgewick, J. Bentley. Quicksort is optimal.
+ *
+ * Levels with an order-preserving normalized key (see tupsort_normalized_key)
+ * are instead sorted by an MSD radix sort on that key, and only runs of equal
+ * keys go back to the comparator.
  */
 
 #include "postgres.h"
 #include "utils/tuplesort.h"
 #include "utils/tuplesort_mk.h"
 
+#include "cdb/cdbvars.h"
 #include "miscadmin.h"
+#include "utils/memutils.h"
+
+/* Fewer entries than this are not worth computing normalized keys for */
+#define MKQS_RADIX_MIN_ENTRIES	256
+
+/* Radix buckets of at most this many items are finished by insertion sort */
+#define MKQS_RADIX_SMALL_BUCKET	32
+
+typedef struct MKRadixItem
+{
+	uint64 key;
+	int32 idx;		/* offset of the entry from the start of the sorted range */
+} MKRadixItem;
 
 #ifdef MKQSORT_VERIFY 
 extern void mkqsort_verify(MKEntry *a, int l, int r, MKContext *mkctxt);
@@ -251,6 +269,240 @@ static void mk_qsort_part3(MKEntry *a, int left, int right, int lv, MKContext *m
 	*firstInHighOut = rightIndex;
 }
 
+/*
+ * Sort a range of entries that are all equal at level lv: go down one level,
+ * or, at the deepest level, check uniqueness if requested.
+ */
+static void mk_qsort_equal_run(MKEntry *a, int left, int right, int lv, MKContext *ctxt, bool seenNull)
+{
+	if(lv < ctxt->total_lv-1)
+	{
+		mk_qsort_impl(a, left, right, lv+1, true, ctxt, seenNull);
+	}
+	else
+	{
+		/* values are all equal to the deepest level...no need for more compares, but check uniqueness if requested */
+		if(right > left && !seenNull)
+		{
+			if ( ctxt->enforceUnique )
+			{
+			    ERROR_UNIQUENESS_VIOLATED();
+			}
+			else if ( ctxt->unique)
+			{
+				int toFreeIndex;
+				for ( toFreeIndex = left + 1; toFreeIndex <= right; toFreeIndex++) /* +1 because we want to keep one around! */
+				{
+					MKEntry *toFree = a + toFreeIndex;
+					if ( ctxt->cpfr)
+						ctxt->cpfr(toFree, NULL, ctxt->lvctxt + lv); // todo: verify off-by-one
+					ctxt->freeTup(toFree);
+					mke_set_empty(toFree);
+				}
+			}
+		}
+	}
+}
+
+static void mk_radix_insertion_sort(MKRadixItem *v, int n)
+{
+	int i, j;
+
+	for (i = 1; i < n; i++)
+	{
+		MKRadixItem tmp = v[i];
+
+		for (j = i; j > 0 && v[j-1].key > tmp.key; j--)
+			v[j] = v[j-1];
+		v[j] = tmp;
+	}
+}
+
+/*
+ * MSD radix sort of v[0..n) on key bytes byte..0, most significant first.
+ * tmp has room for n items.  Bytes on which all items agree are skipped
+ * without moving anything, which is common for the high bytes of small
+ * integers.
+ */
+static void mk_radix_sort(MKRadixItem *v, MKRadixItem *tmp, int n, int byte)
+{
+	int count[256];
+	int offset[256];
+	int shift;
+	int i;
+
+	for (;;)
+	{
+		if (n <= MKQS_RADIX_SMALL_BUCKET)
+		{
+			mk_radix_insertion_sort(v, n);
+			return;
+		}
+		if (byte < 0)
+			return;
+
+		shift = byte * 8;
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < n; i++)
+			count[(v[i].key >> shift) & 0xFF]++;
+
+		if (count[(v[0].key >> shift) & 0xFF] != n)
+			break;
+		byte--;
+	}
+
+	offset[0] = 0;
+	for (i = 1; i < 256; i++)
+		offset[i] = offset[i-1] + count[i-1];
+
+	for (i = 0; i < n; i++)
+		tmp[offset[(v[i].key >> shift) & 0xFF]++] = v[i];
+	memcpy(v, tmp, n * sizeof(MKRadixItem));
+
+	for (i = 0; i < 256; i++)
+	{
+		int start = offset[i] - count[i];
+
+		if (count[i] > 1)
+			mk_radix_sort(v + start, tmp + start, count[i], byte - 1);
+	}
+}
+
+/*
+ * Move a[i] to position i of the range for every i, where idx of item i is
+ * the offset a[i] comes from; follows the cycles of the permutation, so that
+ * no copy of the range is needed.  Clobbers idx.
+ */
+static void mk_radix_permute(MKEntry *a, MKRadixItem *items, int n)
+{
+	int i, j, k;
+
+	for (i = 0; i < n; i++)
+	{
+		MKEntry first;
+
+		if (items[i].idx == i)
+			continue;
+
+		first = a[i];
+		for (j = i; (k = items[j].idx) != i; j = k)
+		{
+			a[j] = a[k];
+			items[j].idx = j;
+		}
+		a[j] = first;
+		items[j].idx = j;
+	}
+}
+
+/*
+ * Sort a range of entries, just prepared at level lv, by the normalized key
+ * of the level.  Returns false, leaving the range alone, if the level has no
+ * normalized key, the range is too small or too large for it, or its
+ * scratch space would not fit in what is left of the sort's memory.
+ *
+ * NULLs are moved to the end they sort to.  Non-null entries are radix
+ * sorted; runs of equal keys then go down one level, or, if the key is only
+ * a prefix of the value, back to the comparator at this level.
+ */
+static bool mk_qsort_radix(MKEntry *a, int left, int right, int lv, MKContext *ctxt, bool seenNull)
+{
+	MKLvContext *lvctxt = ctxt->lvctxt + lv;
+	int n = right - left + 1;
+	int nullLeft, nullRight;
+	int nnLeft, nnRight;
+	int nn;
+	int i, k;
+	MKRadixItem *items;
+	MKRadixItem *tmp;
+	long scratch;
+
+	if (!gp_enable_mk_radix_sort ||
+		lvctxt->normkeytype == MKNK_NONE ||
+		n < MKQS_RADIX_MIN_ENTRIES ||
+		(Size) n >= MaxAllocSize / sizeof(MKRadixItem))
+		return false;
+
+	/* items and tmp; items stays allocated while runs of equal keys are sorted */
+	scratch = (long) n * 2 * sizeof(MKRadixItem);
+	if (scratch > ctxt->radixMemAllowed)
+		return false;
+
+	/* Move NULLs to the end of the range they sort to */
+	if (lvctxt->nullfirst)
+	{
+		k = left;
+		for (i = left; i <= right; i++)
+		{
+			if (mke_is_null(a+i))
+				mkqs_swap(a, k++, i);
+		}
+		nullLeft = left;
+		nullRight = k - 1;
+		nnLeft = k;
+		nnRight = right;
+	}
+	else
+	{
+		k = right;
+		for (i = right; i >= left; i--)
+		{
+			if (mke_is_null(a+i))
+				mkqs_swap(a, k--, i);
+		}
+		nullLeft = k + 1;
+		nullRight = right;
+		nnLeft = left;
+		nnRight = k;
+	}
+
+	nn = nnRight - nnLeft + 1;
+	if (nn > 1)
+	{
+		items = (MKRadixItem *) palloc(nn * sizeof(MKRadixItem));
+		tmp = (MKRadixItem *) palloc(nn * sizeof(MKRadixItem));
+
+		for (i = 0; i < nn; i++)
+		{
+			items[i].key = tupsort_normalized_key(a + nnLeft + i, lvctxt);
+			items[i].idx = i;
+		}
+
+		mk_radix_sort(items, tmp, nn, 7);
+		pfree(tmp);
+
+		/* Put the entries in key order */
+		mk_radix_permute(a + nnLeft, items, nn);
+
+		/*
+		 * Resolve runs of equal keys.  items is still held meanwhile, so
+		 * radix passes below this one get less to work with.
+		 */
+		ctxt->radixMemAllowed -= (long) nn * sizeof(MKRadixItem);
+		for (i = 0; i < nn; i = k)
+		{
+			for (k = i + 1; k < nn && items[k].key == items[i].key; k++)
+				;
+
+			if (k - i == 1)
+				continue;
+
+			if (mk_normkey_is_exact(lvctxt))
+				mk_qsort_equal_run(a, nnLeft + i, nnLeft + k - 1, lv, ctxt, seenNull);
+			else
+				mk_qsort_impl(a, nnLeft + i, nnLeft + k - 1, lv, false, ctxt, seenNull);
+		}
+		ctxt->radixMemAllowed += (long) nn * sizeof(MKRadixItem);
+
+		pfree(items);
+	}
+
+	if (nullRight > nullLeft)
+		mk_qsort_equal_run(a, nullLeft, nullRight, lv, ctxt, true);
+
+	return true;
+}
+
 void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKContext *ctxt, bool seenNull)
 {
 	int lastInLow;
@@ -269,8 +521,13 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	
 	/* Prepare at level lv */
 	if(lvdown)
+	{
         mk_prepare_array(a, left, right, lv, ctxt);
 
+		if (mk_qsort_radix(a, left, right, lv, ctxt, seenNull))
+			return;
+	}
+
 	/* 
 	 * According to Bentley & McIlroy [1] (1993), using insert sort for case 
 	 * n < 7 is a significant saving.  However, according to Sedgewick & 
@@ -285,39 +542,11 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	/* recurse to left chunk */
 	mk_qsort_impl(a, left, lastInLow, lv, false, ctxt, seenNull);
 
-	/* recurse to middle (equal) chunk */
-	if(lv < ctxt->total_lv-1)
-	{
-		/*
-		 * [lastInLow+1,firstInHigh-1] defines the pivot region which was all equal at level lv.  So increase the level and compare that region!
-		 */
-		mk_qsort_impl(a, lastInLow+1, firstInHigh-1, lv+1, true, ctxt, seenNull || mke_is_null(a+lastInLow+1)); /* a + lastInLow + 1 points to the pivot */
-	}
-	else
-	{
-		/* values are all equal to the deepest level...no need for more compares, but check uniqueness if requested */
-		if(firstInHigh-1 > lastInLow+1 &&
-				!seenNull &&
-				!mke_is_null(a+lastInLow+1)) /* a + lastInLow + 1 points to the pivot */
-		{
-			if ( ctxt->enforceUnique )
-			{
-			    ERROR_UNIQUENESS_VIOLATED();
-			}
-			else if ( ctxt->unique)
-			{
-				int toFreeIndex;
-				for ( toFreeIndex = lastInLow + 2; toFreeIndex < firstInHigh; toFreeIndex++) /* +2 because we want to keep one around! */
-				{
-					MKEntry *toFree = a + toFreeIndex;
-					if ( ctxt->cpfr)
-						ctxt->cpfr(toFree, NULL, ctxt->lvctxt + lv); // todo: verify off-by-one
-					ctxt->freeTup(toFree);
-					mke_set_empty(toFree);
-				}
-			}
-		}
-	}
+	/*
+	 * recurse to middle (equal) chunk: [lastInLow+1,firstInHigh-1] defines the pivot region which
+	 * was all equal at level lv.  a + lastInLow + 1 points to the pivot.
+	 */
+	mk_qsort_equal_run(a, lastInLow+1, firstInHigh-1, lv, ctxt, seenNull || mke_is_null(a+lastInLow+1));
 
 	/* recurse to right chunk */
 	mk_qsort_impl(a, firstInHigh, right, lv, false, ctxt, seenNull);
@@ -12,6 +12,7 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include "utils/workfile_mgr.h"
+#include "storage/bfz.h"
 #include "miscadmin.h"
 #include "cdb/cdbvars.h"
 #include "cdb/cdbsrlz.h"
@@ -357,6 +358,11 @@ workfile_mgr_populate_set(const void *resource, const void *param)
 		work_set->no_files = 0;
 		work_set->size = 0L;
 		work_set->in_progress_size = 0L;
+		work_set->bfz_raw_written = 0L;
+		work_set->bfz_compressed_written = 0L;
+		work_set->bfz_write_usecs = 0L;
+		work_set->bfz_raw_read = 0L;
+		work_set->bfz_read_usecs = 0L;
 		work_set->node_type = set_info->nodeType;
 		work_set->metadata.type = set_info->file_type;
 		work_set->metadata.bfz_compress_type = gp_workfile_compress_algorithm;
@@ -1093,6 +1099,30 @@ workfile_update_in_progress_size(ExecWorkFile *workfile, int64 size)
 	}
 }
 
+/*
+ * Add the compression statistics of a bfz file that is being closed to
+ * its workfile set.
+ *
+ * Only files created by this backend are counted: the set is not shared
+ * with anyone else until it is cached.
+ */
+void
+workfile_update_bfz_stats(ExecWorkFile *workfile, bfz_t *bfz_file)
+{
+	workfile_set *work_set = workfile->work_set;
+
+	if (NULL == work_set || !(workfile->flags & EXEC_WORKFILE_CREATED))
+	{
+		return;
+	}
+
+	work_set->bfz_raw_written += bfz_file->stat_raw_written;
+	work_set->bfz_compressed_written += bfz_file->stat_compressed_written;
+	work_set->bfz_write_usecs += bfz_file->stat_write_usecs;
+	work_set->bfz_raw_read += bfz_file->stat_raw_read;
+	work_set->bfz_read_usecs += bfz_file->stat_read_usecs;
+}
+
 /*
  * Reports corresponding error message when the query or segment size limit is exceeded.
  */
@@ -25,13 +25,14 @@
 #include "utils/builtins.h"
 #include "utils/workfile_mgr.h"
 #include "utils/sharedcache.h"
+#include "storage/bfz.h"
 #include "miscadmin.h"
 
 /* The number of columns as defined in gp_workfile_mgr_cache_stats view */
 #define NUM_CACHE_STATS_ELEM 23
 
 /* The number of columns as defined in gp_workfile_mgr_cache_entries view */
-#define NUM_CACHE_ENTRIES_ELEM 13
+#define NUM_CACHE_ENTRIES_ELEM 19
 
 /* The number of columns as defined in gp_workfile_mgr_diskspace view */
 #define NUM_USED_DISKSPACE_ELEM 2
@@ -161,8 +162,20 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 				TIMESTAMPTZOID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 13, "numfiles",
 				INT4OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 14, "compression",
+				TEXTOID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 15, "raw_written",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 16, "compressed_written",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 17, "write_usecs",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 18, "raw_read",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 19, "read_usecs",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
 
-		Assert(NUM_CACHE_ENTRIES_ELEM == 13);
+		Assert(NUM_CACHE_ENTRIES_ELEM == 19);
 
 		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 
@@ -194,6 +207,7 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 		workfile_set *work_set = CACHE_ENTRY_PAYLOAD(crtEntry);
 		char work_set_path[MAXPGPATH] = "";
 		char *work_set_operator_name = NULL;
+		const char *work_set_compression = NULL;
 
 
 		/*
@@ -241,6 +255,16 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 		values[11] = TimestampTzGetDatum(work_set->session_start_time);
 		values[12] = UInt32GetDatum(work_set->no_files);
 
+		if (work_set->metadata.type == BFZ)
+		{
+			work_set_compression = bfz_compression_to_string(work_set->metadata.bfz_compress_type);
+		}
+		values[14] = Int64GetDatum(work_set->bfz_raw_written);
+		values[15] = Int64GetDatum(work_set->bfz_compressed_written);
+		values[16] = Int64GetDatum(work_set->bfz_write_usecs);
+		values[17] = Int64GetDatum(work_set->bfz_raw_read);
+		values[18] = Int64GetDatum(work_set->bfz_read_usecs);
+
 		/* Done reading from the payload of the entry, release lock */
 		Cache_UnlockEntry(cache, crtEntry);
 
@@ -253,6 +277,14 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 		 */
 		values[1] = CStringGetTextDatum(work_set_path);
 		values[7] = CStringGetTextDatum(work_set_operator_name);
+		if (work_set_compression)
+		{
+			values[13] = CStringGetTextDatum(work_set_compression);
+		}
+		else
+		{
+			nulls[13] = true;
+		}
 
 
 		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
@@ -0,0 +1,141 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_zonemap
+ *   maintain per-block min/max zone maps for append-only relations and
+ *   use them to skip blocks during scans.
+ *
+ * A zone map entry records, for one column of one block, the range of rows
+ * the block holds, the number of NULLs and the smallest and largest non-NULL
+ * value.  A scan with a qual like "col < 10" can skip every block whose
+ * minimum is at least 10 without reading or decompressing it.
+ *
+ * The entries are kept in the block directory relation of the table, in
+ * rows of their own: column group number -(attno) holds the zone map pages
+ * of attribute attno.  Real column groups are numbered from 0, so the two
+ * never collide, and the block directory's index, locking and cleanup of
+ * dropped segment files apply to the zone maps unchanged.
+ *
+ * Only fixed-length pass-by-value types with a default btree operator class
+ * are covered.  A block without an entry is never skipped.
+ *
+ * Zone maps are opt-in with gp_appendonly_zonemaps: a table gets a block
+ * directory, and so zone maps, only when it is created with the setting on,
+ * or when it has one anyway for its indexes.
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef APPENDONLY_ZONEMAP_H
+#define APPENDONLY_ZONEMAP_H
+
+#include "access/htup.h"
+#include "access/memtup.h"
+#include "cdb/cdbappendonlyblockdirectory.h"
+#include "nodes/pg_list.h"
+#include "utils/rel.h"
+
+/*
+ * The zone map of one column of one block.  min and max hold the Datum
+ * of the (pass-by-value) column and are meaningless when the block has
+ * only NULLs, that is when nullCount == rowCount.
+ */
+typedef struct AppendOnlyZoneMapEntry
+{
+	int64 firstRowNum;
+	int64 rowCount;
+	int64 nullCount;
+	int64 min;
+	int64 max;
+} AppendOnlyZoneMapEntry;
+
+/*
+ * Varlena stored in the minipage column of a zone map row of the block
+ * directory.  typid guards against reading the entries back with a
+ * different comparison than they were built with.
+ */
+typedef struct AppendOnlyZoneMapPage
+{
+	/* Total length. Must be the first. */
+	int32 _len;
+	int32 version;
+	uint32 nEntry;
+	Oid typid;
+
+	/* Varlena array */
+	AppendOnlyZoneMapEntry entry[1];
+} AppendOnlyZoneMapPage;
+
+#define APPENDONLY_ZONEMAP_VERSION 1
+
+/* Same sizing as the block directory minipages: about 8 pages per heap page */
+#define NUM_ZONEMAP_ENTRIES (((MaxTupleSize)/8 - sizeof(HeapTupleHeaderData) - 64 * 3)\
+							 / sizeof(AppendOnlyZoneMapEntry))
+
+/* Column group number of the zone map rows for attribute attno */
+#define AppendOnlyZoneMap_ColumnGroupNo(attno) (-(int) (attno))
+
+/*
+ * State to maintain the zone maps while inserting into one segment file.
+ * Embedded in the insert descriptors; columns is NULL when no zone maps
+ * are maintained.
+ */
+typedef struct AppendOnlyZoneMapInsert
+{
+	AppendOnlyBlockDirectory *blockDirectory;
+
+	MemoryContext memoryContext;
+
+	int numColumns;
+	struct AppendOnlyZoneMapColumn *columns;
+
+} AppendOnlyZoneMapInsert;
+
+/* Opaque, see appendonly_zonemap.c */
+typedef struct AppendOnlyZoneMapScan AppendOnlyZoneMapScan;
+
+extern void AppendOnlyZoneMap_Init_forInsert(
+	AppendOnlyZoneMapInsert *zoneMap,
+	AppendOnlyBlockDirectory *blockDirectory,
+	TupleDesc tupleDesc,
+	int64 lastSequence);
+extern void AppendOnlyZoneMap_AddValue(
+	AppendOnlyZoneMapInsert *zoneMap,
+	int columnNo,
+	Datum value,
+	bool isnull);
+extern void AppendOnlyZoneMap_AddMemTuple(
+	AppendOnlyZoneMapInsert *zoneMap,
+	MemTuple tuple,
+	MemTupleBinding *mt_bind);
+extern void AppendOnlyZoneMap_FinishBlock(
+	AppendOnlyZoneMapInsert *zoneMap,
+	int columnNo,
+	int64 firstRowNum,
+	int64 rowCount);
+extern void AppendOnlyZoneMap_FinishAllBlocks(
+	AppendOnlyZoneMapInsert *zoneMap,
+	int64 firstRowNum,
+	int64 rowCount);
+extern void AppendOnlyZoneMap_End_forInsert(
+	AppendOnlyZoneMapInsert *zoneMap);
+
+extern AppendOnlyZoneMapScan *AppendOnlyZoneMap_BeginScan(
+	Relation aoRel,
+	AppendOnlyEntry *aoEntry,
+	Snapshot appendOnlyMetaDataSnapshot,
+	List *quals,
+	Index scanrelid);
+extern void AppendOnlyZoneMap_LoadSegment(
+	AppendOnlyZoneMapScan *zoneMapScan,
+	int segno);
+extern bool AppendOnlyZoneMap_SkipRow(
+	AppendOnlyZoneMapScan *zoneMapScan,
+	int64 rowNum,
+	int64 *boundaryRowNum);
+extern bool AppendOnlyZoneMap_SkipRange(
+	AppendOnlyZoneMapScan *zoneMapScan,
+	int64 firstRowNum,
+	int64 rowCount);
+extern void AppendOnlyZoneMap_EndScan(
+	AppendOnlyZoneMapScan *zoneMapScan);
+
+#endif
@@ -33,6 +33,12 @@ typedef enum FmtUserTag
 
 #define exx_is_spq_format(tag) ((tag == EXX_FMT_SPQ || tag == EXX_FMT_SPQ_ALLSEGS)) 
 
+/* Formatter functions that are handled as the built-in spq format */
+#define EXX_FMT_SPQ_IN "vitesse_spq_formatter_in"
+#define EXX_FMT_SPQ_IN_ALLSEGS "vitesse_spq_formatter_in_allsegs"
+#define exx_is_spq_formatter(name) \
+	(strcmp((name), EXX_FMT_SPQ_IN) == 0 || strcmp((name), EXX_FMT_SPQ_IN_ALLSEGS) == 0)
+
 /*
  * FormatterData is the node type that is passed as fmgr "context" info
  * when a function is called by the External Table Formatter manager.
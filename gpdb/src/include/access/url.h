@@ -175,8 +175,8 @@ extern size_t url_fwrite(void *ptr, size_t size, size_t nmemb, URL_FILE *file, C
 extern void url_fflush(URL_FILE *file, CopyState pstate);
 
 extern URL_FILE *url_execute_fopen(char* url, char *cmd, bool forwrite, extvar_t *ev);
-extern URL_FILE *url_xdrive_fopen(char* url, bool forwrite, extvar_t *ev);
-extern void url_xdrive_fclose(URL_FILE *f); 
+extern URL_FILE *url_xdrive_fopen(char* url, bool forwrite, extvar_t *ev, CopyState pstate);
+extern void url_xdrive_fclose(URL_FILE *f, bool failOnError);
 
 extern int exx_execute_fopen(const char *cmd, int *pipes);
 extern void exx_execute_fclose(int pid, int *pipes, bool failOnClose);
@@ -0,0 +1,71 @@
+/*-------------------------------------------------------------------------
+ *
+ * xdrive.h
+ *	  Client side of the xdrive:// external table protocol.
+ *
+ * Every segment opens its own TCP connection to the xdrive daemon named in
+ * the location (normally one running on the segment host), so reads and
+ * writes run on all segments in parallel.
+ *
+ * The protocol is a sequence of frames.  A frame is an 8 byte header, the
+ * message type and the payload length as uint32 in network byte order,
+ * followed by the payload.
+ *
+ *   client -> daemon	OPEN	"key=value\0" pairs: version, mode (r/w),
+ *								fmt (text/csv/spq), path, segid, segcount,
+ *								session, xid, cid, sn, database, user
+ *   daemon -> client	OK		open accepted, or write fully flushed
+ *   daemon -> client	ERROR	message text; ends the session
+ *   either way			DATA	payload is a piece of the data stream
+ *   either way			CREDIT	uint32, more bytes the receiver will accept
+ *   either way			END		end of the data stream
+ *
+ * Flow control is credit based.  When reading, the client grants the
+ * daemon XDRIVE_WINDOW_SIZE bytes after OPEN, and grants more as it
+ * consumes DATA; the daemon must not send DATA beyond the credit it holds.
+ * When writing, the daemon grants credit and the client blocks when it runs
+ * out.  On END from a writer the daemon answers OK once everything is
+ * durably written, or ERROR.
+ *
+ * The spq format is a stream of binary rows: an int16 attribute count, then
+ * for each attribute an int32 length (-1 for NULL) followed by the output of
+ * the type's send function.  All integers are in network byte order.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef XDRIVE_H
+#define XDRIVE_H
+
+#define XDRIVE_PROTOCOL_VERSION		1
+#define XDRIVE_DEFAULT_PORT			7171
+/* Seconds to wait for the daemon to accept a connection */
+#define XDRIVE_CONNECT_TIMEOUT		60
+
+#define XDRIVE_MSG_OPEN				1
+#define XDRIVE_MSG_OK				2
+#define XDRIVE_MSG_ERROR			3
+#define XDRIVE_MSG_DATA				4
+#define XDRIVE_MSG_CREDIT			5
+#define XDRIVE_MSG_END				6
+
+/* Largest frame payload either side may send */
+#define XDRIVE_MAX_FRAME			(1024 * 1024)
+/* Payload size the client uses for DATA frames it writes */
+#define XDRIVE_WRITE_FRAME			(256 * 1024)
+/* Read credit the client keeps outstanding */
+#define XDRIVE_WINDOW_SIZE			(4 * 1024 * 1024)
+
+typedef struct XdriveConn XdriveConn;
+
+/*
+ * Open a connection for a read or write of url.  The OPEN message carries
+ * params, alternating key and value strings terminated by a NULL key.
+ */
+extern XdriveConn *xdrive_connect(const char *url, bool forwrite,
+								  const char **params);
+extern size_t xdrive_read(XdriveConn *conn, void *buf, size_t len);
+extern void xdrive_write(XdriveConn *conn, const void *buf, size_t len);
+extern void xdrive_flush(XdriveConn *conn);
+extern void xdrive_close(XdriveConn *conn, bool failOnError);
+
+#endif   /* XDRIVE_H */
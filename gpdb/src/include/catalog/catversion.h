@@ -53,6 +53,6 @@
  */
 
 /*                              yyyymmddN */
-#define CATALOG_VERSION_NO      201310150
+#define CATALOG_VERSION_NO      201310154
 
 #endif
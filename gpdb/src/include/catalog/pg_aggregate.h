@@ -142,6 +142,7 @@ typedef FormData_pg_aggregate *Form_pg_aggregate;
  */
 #define AGGFNOID_COUNT_ANY 2147 /* returns INT8OID */
 #define AGGFNOID_SUM_BIGINT 2107 /* returns NUMERICOID */
+#define AGGFNOID_APPROX_COUNT_DISTINCT 3086 /* returns INT8OID */
 
 /* ----------------
  * initial contents of pg_aggregate
@@ -328,6 +329,14 @@ DATA(insert ( 3538	string_agg_delim_transfn - - - string_agg_finalfn 0 2281 _nul
 
 DATA(insert ( 2913	pg_partition_oid_transfn      - - - pg_partition_oid_finalfn 0 2281 _null_ f));
 
+/* approximate percentile */
+DATA(insert ( 3075	approx_percentile_trans  - approx_percentile_merge - approx_percentile_final 0 17 "" f));
+
+/* HyperLogLog approximate count(DISTINCT) */
+DATA(insert ( 3086	hll_add_trans    - hll_union_trans - approx_count_distinct_final 0 3076 _null_ f));
+DATA(insert ( 3087	hll_add_trans    - hll_union_trans - -                           0 3076 _null_ f));
+DATA(insert ( 3088	hll_union_trans  - hll_union_trans - -                           0 3076 _null_ f));
+
 
 
 /*
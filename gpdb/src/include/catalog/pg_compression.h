@@ -104,12 +104,16 @@ typedef FormData_pg_compression *Form_pg_compression;
 /* Initial contents */
 DATA(insert OID = 3060 ( zlib gp_zlib_constructor gp_zlib_destructor gp_zlib_compress gp_zlib_decompress gp_zlib_validator PGUID ));
 
-DATA(insert OID = 3061 ( lz4 gp_quicklz_constructor gp_quicklz_destructor gp_quicklz_compress gp_quicklz_decompress gp_quicklz_validator PGUID ));
+DATA(insert OID = 3061 ( lz4 gp_codec_constructor gp_codec_destructor gp_codec_compress gp_codec_decompress gp_codec_validator PGUID ));
 
 DATA(insert OID = 3062 ( rle_type gp_rle_type_constructor gp_rle_type_destructor gp_rle_type_compress gp_rle_type_decompress gp_rle_type_validator PGUID ));
 
 DATA(insert OID = 3063 ( none gp_dummy_compression_constructor gp_dummy_compression_destructor gp_dummy_compression_compress gp_dummy_compression_decompress gp_dummy_compression_validator PGUID ));
 
+DATA(insert OID = 3070 ( zstd gp_codec_constructor gp_codec_destructor gp_codec_compress gp_codec_decompress gp_codec_validator PGUID ));
+
+DATA(insert OID = 3071 ( zstd_dict gp_codec_constructor gp_codec_destructor gp_codec_compress gp_codec_decompress gp_codec_validator PGUID ));
+
 #define NUM_COMPRESS_FUNCS 5
 
 #define COMPRESSION_CONSTRUCTOR 0
@@ -139,6 +143,33 @@ typedef struct StorageAttributes
 	Oid	typid; /* Oid of the type being compressed */
 } StorageAttributes;
 
+/*
+ * A built-in block codec (see codec_compression.c).  compress returns the
+ * compressed size, or 0 if the result does not fit in dst; decompress
+ * returns the decompressed size and raises an error on bad input.
+ *
+ * decompress_r, when not NULL, is a variant that may run in a thread other
+ * than the backend's: it uses only the context made by create_dctx (which
+ * may be NULL if the codec needs none), never pallocs or raises errors, and
+ * returns 0 with *error set to a static message on bad input.
+ */
+typedef struct CompressionCodec
+{
+	const char *name;			/* compresstype */
+	int			default_level;	/* used when compresslevel is not given */
+	int			max_level;
+	size_t		(*compress) (const void *src, size_t src_sz,
+							 void *dst, size_t dst_sz, int level);
+	size_t		(*decompress) (const void *src, size_t src_sz,
+							   void *dst, size_t dst_sz);
+	void	   *(*create_dctx) (void);
+	void		(*free_dctx) (void *dctx);
+	size_t		(*decompress_r) (void *dctx, const void *src, size_t src_sz,
+								 void *dst, size_t dst_sz, const char **error);
+} CompressionCodec;
+
+extern const CompressionCodec *GetCompressionCodec(const char *comptype);
+
 extern CompressionState *callCompressionConstructor(PGFunction constructor,
 										TupleDesc tupledesc,
 										StorageAttributes *sa,
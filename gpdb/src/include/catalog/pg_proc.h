@@ -10408,6 +10408,90 @@ DESCR("quicklz decompressor");
 DATA(insert OID = 9925 ( gp_quicklz_validator  PGNSP PGUID 12 f f f f i 1 2278 f "2281" _null_ _null_ _null_ quicklz_validator - _null_ n ));
 DESCR("quicklz compression validator");
 
+/* gp_codec_constructor(internal, internal, bool) => internal */ 
+DATA(insert OID = 5082 ( gp_codec_constructor  PGNSP PGUID 12 f f f f v 3 2281 f "2281 2281 16" _null_ _null_ _null_ codec_constructor - _null_ n ));
+DESCR("built-in codec constructor");
+
+/* gp_codec_destructor(internal) => void */ 
+DATA(insert OID = 5083 ( gp_codec_destructor  PGNSP PGUID 12 f f f f v 1 2278 f "2281" _null_ _null_ _null_ codec_destructor - _null_ n ));
+DESCR("built-in codec destructor");
+
+/* gp_codec_compress(internal, int4, internal, int4, internal, internal) => void */ 
+DATA(insert OID = 5084 ( gp_codec_compress  PGNSP PGUID 12 f f f f i 6 2278 f "2281 23 2281 23 2281 2281" _null_ _null_ _null_ codec_compress - _null_ n ));
+DESCR("built-in codec compressor");
+
+/* gp_codec_decompress(internal, int4, internal, int4, internal, internal) => void */ 
+DATA(insert OID = 5085 ( gp_codec_decompress  PGNSP PGUID 12 f f f f i 6 2278 f "2281 23 2281 23 2281 2281" _null_ _null_ _null_ codec_decompress - _null_ n ));
+DESCR("built-in codec decompressor");
+
+/* gp_codec_validator(internal) => void */ 
+DATA(insert OID = 5086 ( gp_codec_validator  PGNSP PGUID 12 f f f f i 1 2278 f "2281" _null_ _null_ _null_ codec_validator - _null_ n ));
+DESCR("built-in codec compression validator");
+
+/* gp_gang_pool_stats(OUT pool_size int4, OUT idle_gangs int4, OUT busy_gangs int4, OUT preforked int8, OUT reused int8, OUT created int8, OUT create_ms float8, OUT prefork_failures int8) => pg_catalog.record */ 
+DATA(insert OID = 5087 ( gp_gang_pool_stats  PGNSP PGUID 12 f f f f v 0 2249 f "" "{23,23,23,20,20,20,701,20}" "{o,o,o,o,o,o,o,o}" "{pool_size,idle_gangs,busy_gangs,preforked,reused,created,create_ms,prefork_failures}" gp_gang_pool_stats - _null_ n ));
+DESCR("statistics: segworker group pool of the current session");
+
+/* approx_percentile_trans(bytea, float8, float8) => bytea */ 
+DATA(insert OID = 3072 ( approx_percentile_trans  PGNSP PGUID 12 f f t f i 3 17 f "17 701 701" _null_ _null_ _null_ approx_percentile_trans - _null_ n ));
+DESCR("APPROX_PERCENTILE(double, double) transition function");
+
+/* approx_percentile_merge(bytea, bytea) => bytea */ 
+DATA(insert OID = 3073 ( approx_percentile_merge  PGNSP PGUID 12 f f t f i 2 17 f "17 17" _null_ _null_ _null_ approx_percentile_merge - _null_ n ));
+DESCR("APPROX_PERCENTILE(double, double) preliminary function");
+
+/* approx_percentile_final(bytea) => float8 */ 
+DATA(insert OID = 3074 ( approx_percentile_final  PGNSP PGUID 12 f f t f i 1 701 f "17" _null_ _null_ _null_ approx_percentile_final - _null_ n ));
+DESCR("APPROX_PERCENTILE(double, double) final function");
+
+/* approx_percentile(float8, float8) => float8 */ 
+DATA(insert OID = 3075 ( approx_percentile  PGNSP PGUID 12 t f f f i 2 701 f "701 701" _null_ _null_ _null_ aggregate_dummy - _null_ n ));
+DESCR("approximate percentile of the input values");
+
+/* hll_in(cstring) => hll */ 
+DATA(insert OID = 3078 ( hll_in  PGNSP PGUID 12 f f t f i 1 3076 f "2275" _null_ _null_ _null_ hll_in - _null_ n ));
+DESCR("I/O");
+
+/* hll_out(hll) => cstring */ 
+DATA(insert OID = 3079 ( hll_out  PGNSP PGUID 12 f f t f i 1 2275 f "3076" _null_ _null_ _null_ hll_out - _null_ n ));
+DESCR("I/O");
+
+/* hll_recv(internal) => hll */ 
+DATA(insert OID = 3080 ( hll_recv  PGNSP PGUID 12 f f t f i 1 3076 f "2281" _null_ _null_ _null_ hll_recv - _null_ n ));
+DESCR("I/O");
+
+/* hll_send(hll) => bytea */ 
+DATA(insert OID = 3081 ( hll_send  PGNSP PGUID 12 f f t f i 1 17 f "3076" _null_ _null_ _null_ hll_send - _null_ n ));
+DESCR("I/O");
+
+/* hll_add_trans(hll, anyelement) => hll */ 
+DATA(insert OID = 3082 ( hll_add_trans  PGNSP PGUID 12 f f f f i 2 3076 f "3076 2283" _null_ _null_ _null_ hll_add_trans - _null_ n ));
+DESCR("HLL_AGG(anyelement) transition function");
+
+/* hll_union_trans(hll, hll) => hll */ 
+DATA(insert OID = 3083 ( hll_union_trans  PGNSP PGUID 12 f f t f i 2 3076 f "3076 3076" _null_ _null_ _null_ hll_union_trans - _null_ n ));
+DESCR("HLL_UNION_AGG(hll) transition function");
+
+/* approx_count_distinct_final(hll) => int8 */ 
+DATA(insert OID = 3084 ( approx_count_distinct_final  PGNSP PGUID 12 f f f f i 1 20 f "3076" _null_ _null_ _null_ approx_count_distinct_final - _null_ n ));
+DESCR("APPROX_COUNT_DISTINCT(anyelement) final function");
+
+/* hll_cardinality(hll) => int8 */ 
+DATA(insert OID = 3085 ( hll_cardinality  PGNSP PGUID 12 f f t f i 1 20 f "3076" _null_ _null_ _null_ hll_cardinality - _null_ n ));
+DESCR("estimated number of distinct values in a hll");
+
+/* approx_count_distinct(anyelement) => int8 */ 
+DATA(insert OID = 3086 ( approx_count_distinct  PGNSP PGUID 12 t f f f i 1 20 f "2283" _null_ _null_ _null_ aggregate_dummy - _null_ n ));
+DESCR("approximate number of distinct input values");
+
+/* hll_agg(anyelement) => hll */ 
+DATA(insert OID = 3087 ( hll_agg  PGNSP PGUID 12 t f f f i 1 3076 f "2283" _null_ _null_ _null_ aggregate_dummy - _null_ n ));
+DESCR("HyperLogLog sketch of the input values");
+
+/* hll_union_agg(hll) => hll */ 
+DATA(insert OID = 3088 ( hll_union_agg  PGNSP PGUID 12 t f f f i 1 3076 f "3076" _null_ _null_ _null_ aggregate_dummy - _null_ n ));
+DESCR("union of HyperLogLog sketches");
+
 /* gp_zlib_constructor(internal, internal, bool) => internal */ 
 DATA(insert OID = 9910 ( gp_zlib_constructor  PGNSP PGUID 12 f f f f v 3 2281 f "2281 2281 16" _null_ _null_ _null_ zlib_constructor - _null_ n ));
 DESCR("zlib constructor");
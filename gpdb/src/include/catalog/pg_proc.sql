@@ -5537,6 +5537,48 @@ CREATE FUNCTION gp_nondbspecific_ptcat_verification() RETURNS bool LANGUAGE inte
 
  CREATE FUNCTION gp_quicklz_validator(internal) RETURNS void LANGUAGE internal IMMUTABLE AS 'quicklz_validator' WITH(OID=9925, DESCRIPTION="quicklz compression validator");
 
+ CREATE FUNCTION gp_codec_constructor(internal, internal, bool) RETURNS internal LANGUAGE internal VOLATILE AS 'codec_constructor' WITH (OID=5082, DESCRIPTION="built-in codec constructor");
+
+ CREATE FUNCTION gp_codec_destructor(internal) RETURNS void LANGUAGE internal VOLATILE AS 'codec_destructor' WITH(OID=5083, DESCRIPTION="built-in codec destructor");
+
+ CREATE FUNCTION gp_codec_compress(internal, int4, internal, int4, internal, internal) RETURNS void LANGUAGE internal IMMUTABLE AS 'codec_compress' WITH(OID=5084, DESCRIPTION="built-in codec compressor");
+
+ CREATE FUNCTION gp_codec_decompress(internal, int4, internal, int4, internal, internal) RETURNS void LANGUAGE internal IMMUTABLE AS 'codec_decompress' WITH(OID=5085, DESCRIPTION="built-in codec decompressor");
+
+ CREATE FUNCTION gp_codec_validator(internal) RETURNS void LANGUAGE internal IMMUTABLE AS 'codec_validator' WITH(OID=5086, DESCRIPTION="built-in codec compression validator");
+
+ CREATE FUNCTION gp_gang_pool_stats(OUT pool_size int4, OUT idle_gangs int4, OUT busy_gangs int4, OUT preforked int8, OUT reused int8, OUT created int8, OUT create_ms float8, OUT prefork_failures int8) RETURNS pg_catalog.record LANGUAGE internal VOLATILE AS 'gp_gang_pool_stats' WITH (OID=5087, DESCRIPTION="statistics: segworker group pool of the current session");
+
+ CREATE FUNCTION approx_percentile_trans(bytea, float8, float8) RETURNS bytea LANGUAGE internal IMMUTABLE STRICT AS 'approx_percentile_trans' WITH (OID=3072, DESCRIPTION="APPROX_PERCENTILE(double, double) transition function");
+
+ CREATE FUNCTION approx_percentile_merge(bytea, bytea) RETURNS bytea LANGUAGE internal IMMUTABLE STRICT AS 'approx_percentile_merge' WITH (OID=3073, DESCRIPTION="APPROX_PERCENTILE(double, double) preliminary function");
+
+ CREATE FUNCTION approx_percentile_final(bytea) RETURNS float8 LANGUAGE internal IMMUTABLE STRICT AS 'approx_percentile_final' WITH (OID=3074, DESCRIPTION="APPROX_PERCENTILE(double, double) final function");
+
+ CREATE FUNCTION approx_percentile(float8, float8) RETURNS float8 LANGUAGE internal IMMUTABLE AS 'aggregate_dummy' WITH (OID=3075, proisagg="t", DESCRIPTION="approximate percentile of the input values");
+
+ CREATE FUNCTION hll_in(cstring) RETURNS hll LANGUAGE internal IMMUTABLE STRICT AS 'hll_in' WITH (OID=3078, DESCRIPTION="I/O");
+
+ CREATE FUNCTION hll_out(hll) RETURNS cstring LANGUAGE internal IMMUTABLE STRICT AS 'hll_out' WITH (OID=3079, DESCRIPTION="I/O");
+
+ CREATE FUNCTION hll_recv(internal) RETURNS hll LANGUAGE internal IMMUTABLE STRICT AS 'hll_recv' WITH (OID=3080, DESCRIPTION="I/O");
+
+ CREATE FUNCTION hll_send(hll) RETURNS bytea LANGUAGE internal IMMUTABLE STRICT AS 'hll_send' WITH (OID=3081, DESCRIPTION="I/O");
+
+ CREATE FUNCTION hll_add_trans(hll, anyelement) RETURNS hll LANGUAGE internal IMMUTABLE AS 'hll_add_trans' WITH (OID=3082, DESCRIPTION="HLL_AGG(anyelement) transition function");
+
+ CREATE FUNCTION hll_union_trans(hll, hll) RETURNS hll LANGUAGE internal IMMUTABLE STRICT AS 'hll_union_trans' WITH (OID=3083, DESCRIPTION="HLL_UNION_AGG(hll) transition function");
+
+ CREATE FUNCTION approx_count_distinct_final(hll) RETURNS int8 LANGUAGE internal IMMUTABLE AS 'approx_count_distinct_final' WITH (OID=3084, DESCRIPTION="APPROX_COUNT_DISTINCT(anyelement) final function");
+
+ CREATE FUNCTION hll_cardinality(hll) RETURNS int8 LANGUAGE internal IMMUTABLE STRICT AS 'hll_cardinality' WITH (OID=3085, DESCRIPTION="estimated number of distinct values in a hll");
+
+ CREATE FUNCTION approx_count_distinct(anyelement) RETURNS int8 LANGUAGE internal IMMUTABLE AS 'aggregate_dummy' WITH (OID=3086, proisagg="t", DESCRIPTION="approximate number of distinct input values");
+
+ CREATE FUNCTION hll_agg(anyelement) RETURNS hll LANGUAGE internal IMMUTABLE AS 'aggregate_dummy' WITH (OID=3087, proisagg="t", DESCRIPTION="HyperLogLog sketch of the input values");
+
+ CREATE FUNCTION hll_union_agg(hll) RETURNS hll LANGUAGE internal IMMUTABLE AS 'aggregate_dummy' WITH (OID=3088, proisagg="t", DESCRIPTION="union of HyperLogLog sketches");
+
  CREATE FUNCTION gp_zlib_constructor(internal, internal, bool) RETURNS internal LANGUAGE internal VOLATILE AS 'zlib_constructor' WITH (OID=9910, DESCRIPTION="zlib constructor");
 
  CREATE FUNCTION gp_zlib_destructor(internal) RETURNS void LANGUAGE internal VOLATILE AS 'zlib_destructor' WITH(OID=9911, DESCRIPTION="zlib destructor");
@@ -642,6 +642,11 @@ DESCR("(h/h) -- the hexadecimal xlogid and xrecoff of an XLOG location");
 #define XLOGLOCOID	3310
 DATA(insert OID = 3311 (	_gpxlogloc	   PGNSP PGUID -1 f b t \054 0	3310 array_in array_out array_recv array_send - i x f 0 -1 0 _null_ _null_ ));
 
+DATA(insert OID = 3076 (	hll	   PGNSP PGUID -1 f b t \054 0	0 hll_in hll_out hll_recv hll_send - i x f 0 -1 0 _null_ _null_ ));
+DESCR("HyperLogLog sketch for approximate distinct counts");
+#define HLLOID			3076
+DATA(insert OID = 3077 (	_hll	   PGNSP PGUID -1 f b t \054 0	3076 array_in array_out array_recv array_send - i x f 0 -1 0 _null_ _null_ ));
+
 /*  
 **  pseudo-types 
 **  
@@ -733,6 +733,17 @@
  ) WITH (OID=3310, ARRAYOID=3311, DESCRIPTION="(h/h) -- the hexadecimal xlogid and xrecoff of an XLOG location");
 -- #define XLOGLOCOID	3310
 
+ CREATE TYPE hll(
+   INPUT = hll_in,
+   OUTPUT = hll_out,
+   RECEIVE = hll_recv,
+   SEND = hll_send,
+   INTERNALLENGTH = VARIABLE,
+   STORAGE = extended,
+   ALIGNMENT = int4
+ ) WITH (OID=3076, ARRAYOID=3077, DESCRIPTION="HyperLogLog sketch for approximate distinct counts");
+-- #define HLLOID			3076
+
 --
 -- pseudo-types
 --
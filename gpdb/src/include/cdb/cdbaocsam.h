@@ -16,6 +16,7 @@
 #include "access/xlogutils.h"
 #include "access/appendonlytid.h"
 #include "access/appendonly_visimap.h"
+#include "access/appendonly_zonemap.h"
 #include "executor/tuptable.h"
 #include "nodes/primnodes.h"
 #include "storage/block.h"
@@ -58,6 +59,9 @@ typedef struct AOCSInsertDescData
 
 	AppendOnlyBlockDirectory blockDirectory;
 
+	/* The zone maps, kept in the block directory relation. */
+	AppendOnlyZoneMapInsert zoneMap;
+
 	/**
 	 * When initialized in update mode, the insert is really part of
 	 * an AO update.
@@ -121,6 +125,18 @@ typedef struct AOCSScanDescData
 	AppendOnlyBlockDirectory *blockDirectory;
 
 	AppendOnlyVisimap visibilityMap;
+
+	/*
+	 * Zone maps used to skip runs of rows none of which can pass the scan qual,
+	 * or NULL.  Set up by the executor after aocs_beginscan.
+	 */
+	AppendOnlyZoneMapScan *zoneMap;
+
+	/*
+	 * Threads that decompress the blocks of the projected columns ahead of
+	 * the scan, or NULL.  Kept across rescans.
+	 */
+	struct AppendOnlyDecompressPool *decompressPool;
 }	AOCSScanDescData;
 
 typedef AOCSScanDescData *AOCSScanDesc;
@@ -282,6 +298,15 @@ typedef struct ExxAocsBatchReaderCtxt
     bool *isnull[EXX_AOCS_BATCH_NROW];
     AOTupleId *aotid;
 
+    /*
+     * If runs is not NULL (ncol entries), runs[col] is set for every batch
+     * to the run ids of the column (see DatumStreamBlockRead_GetBatch), or
+     * to NULL if the column's block has no RLE_TYPE runs.  runbuf holds
+     * maxrows run ids for each column.
+     */
+    int32 **runs;
+    int32 *runbuf;
+
     /*
      * ftian: I need some context.  This way, we can fix the interface.  You just code it.
      * Whatever I need, follows this, and you just ignore.
@@ -19,6 +19,7 @@
 #include "access/tupmacs.h"
 #include "access/xlogutils.h"
 #include "access/appendonly_visimap.h"
+#include "access/appendonly_zonemap.h"
 #include "executor/tuptable.h"
 #include "nodes/primnodes.h"
 #include "nodes/bitmapset.h"
@@ -104,6 +105,9 @@ typedef struct AppendOnlyInsertDescData
 	/* The block directory for the appendonly relation. */
 	AppendOnlyBlockDirectory blockDirectory;
 
+	/* The zone maps, kept in the block directory relation. */
+	AppendOnlyZoneMapInsert zoneMap;
+
 	bool update_mode;
 } AppendOnlyInsertDescData;
 
@@ -215,6 +219,12 @@ typedef struct AppendOnlyScanDescData
 	 */ 
 	AppendOnlyVisimap visibilityMap;
 
+	/*
+	 * Zone maps used to skip blocks no row of which can pass the scan
+	 * qual, or NULL.  Set up by the executor after appendonly_beginscan.
+	 */
+	AppendOnlyZoneMapScan *zoneMap;
+
 }	AppendOnlyScanDescData;
 
 typedef AppendOnlyScanDescData *AppendOnlyScanDesc;
@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbappendonlydecompress.h
+ *	  A pool of threads that decompress Append-Only Storage blocks ahead
+ *	  of the scan that reads them.
+ *
+ * A scan creates one pool and shares it among all the column streams it
+ * reads.  The streams read the compressed blocks themselves, copy them into
+ * jobs and submit the jobs; a worker decompresses the job's block while the
+ * scan goes on with earlier blocks.  When the scan gets to the block it
+ * waits for the job, or decompresses it itself if no worker has picked the
+ * job up yet.
+ *
+ * Workers touch nothing but the job buffers and their own codec contexts:
+ * they never palloc, raise errors or look at backend state.  All memory of
+ * the pool and its jobs is allocated by the backend, while the scan's memory
+ * account is active, in a context that lives until the pool is destroyed,
+ * so an error that throws away the scan's memory cannot pull buffers out
+ * from under a running worker.  Pools still alive at the end of the
+ * transaction are destroyed then.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CDBAPPENDONLYDECOMPRESS_H
+#define CDBAPPENDONLYDECOMPRESS_H
+
+#include "catalog/pg_compression.h"
+
+typedef struct AppendOnlyDecompressPool AppendOnlyDecompressPool;
+typedef struct AppendOnlyDecompressJob AppendOnlyDecompressJob;
+
+/*
+ * Start a pool of numWorkers threads.  Returns NULL if no thread could be
+ * started.
+ */
+extern AppendOnlyDecompressPool *AppendOnlyDecompressPool_Create(
+	int							numWorkers);
+
+/*
+ * Stop the workers and free the pool and all its jobs.
+ */
+extern void AppendOnlyDecompressPool_Destroy(
+	AppendOnlyDecompressPool	*pool);
+
+/*
+ * Allocate a job for blocks of the given codec, which must have a
+ * decompress_r function, with buffers of bufferLen bytes.
+ */
+extern AppendOnlyDecompressJob *AppendOnlyDecompressPool_AllocJob(
+	AppendOnlyDecompressPool	*pool,
+	const CompressionCodec		*codec,
+	int32						bufferLen);
+
+/*
+ * Free a job, cancelling it first if need be.
+ */
+extern void AppendOnlyDecompressJob_Free(
+	AppendOnlyDecompressJob		*job);
+
+/*
+ * Return the buffer to copy the compressed block into before submitting.
+ */
+extern uint8 *AppendOnlyDecompressJob_CompressedBuffer(
+	AppendOnlyDecompressJob		*job);
+
+/*
+ * Queue the job to decompress compressedLen bytes into uncompressedLen.
+ */
+extern void AppendOnlyDecompressJob_Submit(
+	AppendOnlyDecompressJob		*job,
+	int32						compressedLen,
+	int32						uncompressedLen);
+
+/*
+ * Wait for the job to finish and return the decompressed content.  Raises
+ * an error if the block could not be decompressed.
+ */
+extern uint8 *AppendOnlyDecompressJob_Wait(
+	AppendOnlyDecompressJob		*job);
+
+/*
+ * Forget a submitted job, waiting for it if a worker is running it.
+ */
+extern void AppendOnlyDecompressJob_Cancel(
+	AppendOnlyDecompressJob		*job);
+
+#endif   /* CDBAPPENDONLYDECOMPRESS_H */
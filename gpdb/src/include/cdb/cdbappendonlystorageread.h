@@ -10,6 +10,7 @@
 #define CDBAPPENDONLYSTORAGEREAD_H
 
 #include "catalog/pg_compression.h"
+#include "cdb/cdbappendonlydecompress.h"
 #include "cdb/cdbappendonlystorage.h"
 #include "cdb/cdbappendonlystoragelayer.h"
 #include "cdb/cdbbufferedread.h"
@@ -93,6 +94,28 @@ typedef struct AppendOnlyStorageReadCurrent
 			 */
 } AppendOnlyStorageReadCurrent;
 
+/*
+ * A block read ahead of the caller when decompressing ahead.
+ */
+typedef struct AppendOnlyStorageReadAhead
+{
+	AppendOnlyStorageReadCurrent	current;
+			/*
+			 * The current* information of the block.
+			 */
+
+	AppendOnlyDecompressJob			*job;
+			/*
+			 * The job that decompresses the block, unless isLive.
+			 */
+
+	bool							isLive;
+			/*
+			 * True if the block could not be decompressed ahead, and is
+			 * still the one in the BufferedRead buffer.
+			 */
+} AppendOnlyStorageReadAhead;
+
 /*
  * This structure contains read session information.  Consider the fields
  * inside to be private.
@@ -180,6 +203,20 @@ typedef struct AppendOnlyStorageRead
 	PGFunction       *compression_functions; /* For AO or CO compression funciton pointers.  */
 			/* The array index corresponds to COMP_FUNC_*   */
 
+	/*
+	 * Decompressing ahead (see ~_SetDecompressAhead).  The blocks after the
+	 * current one are read into the ring ahead[], aheadDepth long, and
+	 * decompressed by the pool's workers while the caller works on earlier
+	 * blocks.  aheadCurrent is the ring entry the current block came from.
+	 */
+	AppendOnlyStorageReadAhead	*ahead;
+	int							aheadDepth;
+	int							aheadFirst;
+	int							aheadCount;
+	bool						aheadAtLive;
+	bool						aheadAtEof;
+	AppendOnlyStorageReadAhead	*aheadCurrent;
+
 
 
 } AppendOnlyStorageRead;
@@ -244,6 +281,25 @@ extern char* AppendOnlyStorageRead_RelationName(
 extern char* AppendOnlyStorageRead_SegmentFileName(
 	AppendOnlyStorageRead			*storageRead);
 
+/*
+ * Set how many large reads ahead to prefetch.  ~Init sets
+ * gp_appendonly_prefetch_depth; random access should use 0.
+ */
+extern void AppendOnlyStorageRead_SetPrefetchDepth(
+	AppendOnlyStorageRead			*storageRead,
+	int32							prefetchDepth);
+
+/*
+ * Decompress up to depth - 1 blocks ahead of the caller with the workers
+ * of pool.  Only blocks of codecs that support it are; returns false, and
+ * leaves the session reading as before, if the compression type does not.
+ * Must be called before the first file is opened.
+ */
+extern bool AppendOnlyStorageRead_SetDecompressAhead(
+	AppendOnlyStorageRead			*storageRead,
+	AppendOnlyDecompressPool		*pool,
+	int								depth);
+
 /*
  * Finish using the AppendOnlyStorageRead session created with ~Init.
  */
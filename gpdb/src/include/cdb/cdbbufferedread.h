@@ -72,6 +72,21 @@ typedef struct BufferedRead
 	bool				haveTemporaryLimitInEffect;
 	int64				temporaryLimitFileLen;
 
+	/*
+	 * Prefetch support.
+	 */
+	int32				prefetchDepth;
+							/*
+							 * Number of large reads past the current one the
+							 * kernel is asked to read ahead asynchronously.
+							 * 0 disables prefetching.
+							 */
+	int64				prefetchPosition;
+							/*
+							 * The end of the range prefetch has been requested
+							 * for in the current file.
+							 */
+
 } BufferedRead;
 
 /*
@@ -97,6 +112,13 @@ extern void BufferedReadInit(
     int32                maxLargeReadLen,
     char				 *relationName);
 
+/*
+ * Set how many large reads ahead of the current one to prefetch.
+ */
+extern void BufferedReadSetPrefetchDepth(
+    BufferedRead         *bufferedRead,
+    int32                prefetchDepth);
+
 /*
  * Takes an open file handle for the next file.
  */
@@ -180,6 +180,13 @@ typedef struct CdbDispatchCmdThreads
 	struct DispatchCommandParms *dispatchCommandParmsAr;
 	int	dispatchCommandParmsArSize;
 	int	threadCount;
+
+	/*
+	 * epoll set of the QE connections still running, when the dispatch is
+	 * event-driven rather than threaded; -1 otherwise.  Each parameter
+	 * block then stands for one gang and has no thread of its own.
+	 */
+	int	epollfd;
 	
 }   CdbDispatchCmdThreads;
 
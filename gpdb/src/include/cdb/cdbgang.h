@@ -10,6 +10,7 @@
 #define _CDBGANG_H_
 
 #include "postgres.h"
+#include "fmgr.h"
 #include "cdb/cdbutil.h"
 #include "executor/execdesc.h"
 #include <pthread.h>
@@ -62,6 +63,22 @@ typedef struct Gang
 extern Gang *allocateGang(GangType type, int size, int content, char *portal_name);
 extern Gang *allocateWriterGang(void);
 
+/*
+ * gangPoolNeedsPrefork() and preforkGangPool().
+ *
+ * Keep gp_gang_pool_size reader N-gangs warm for the session: the QD fills
+ * the pool while waiting for the client, so that the next query does not pay
+ * for connecting to and starting QEs on every segment.
+ *
+ * preforkGangPool() forks the whole shortfall before returning, so the
+ * caller should only call it when the client has nothing pending.
+ */
+extern bool gangPoolNeedsPrefork(void);
+
+extern void preforkGangPool(void);
+
+extern Datum gp_gang_pool_stats(PG_FUNCTION_ARGS);
+
 struct DirectDispatchInfo;
 extern List *getCdbProcessList(Gang *gang, int sliceIndex, struct DirectDispatchInfo *directDispatch);
 
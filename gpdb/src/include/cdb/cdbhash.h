@@ -19,6 +19,7 @@ typedef struct CdbHash
 	int			numsegs;		/* number of segments in Greenplum Database used for
 								 * partitioning  */
 	int         mask;			/* only used when numsegs is powerof 2 */
+	uint64		modinv;			/* 2^64 / numsegs, rounded up, for cdbhashreduce */
 	uint32		rrindex;		/* round robin index for empty policy tables		*/
 	
 } CdbHash;
@@ -26,6 +27,11 @@ typedef struct CdbHash
 
 typedef void (*datumHashFunction)(void *clientData, void *buf, size_t len);
 
+/*
+ * Adds a value of one type to a hash, as cdbhash() would for that type.
+ */
+typedef uint32 (*CdbHashKeyFunction)(Datum datum, uint32 hval);
+
 /*
  * Create and initialize a CdbHash in the current memory context.
  * Parameter numsegs - number of segments in Greenplum Database.
@@ -43,6 +49,23 @@ extern void cdbhashinit(CdbHash *h);
  */
 extern void cdbhash(CdbHash *h, Datum val, Oid typid, FmgrInfo *hfn);
 
+/*
+ * Look up the function that adds values of type typid to the hash, so that
+ * callers hashing many values of the same type can skip cdbhash()'s type
+ * dispatch.  Returns NULL for types that cdbhash() hashes with their hash
+ * opclass function.
+ */
+extern CdbHashKeyFunction cdbhash_get_keyfunction(Oid typid);
+
+/*
+ * Add an attribute to the hash calculation with a function from
+ * cdbhash_get_keyfunction().
+ */
+static inline void cdbhashkey(CdbHash *h, CdbHashKeyFunction fn, Datum val)
+{
+	h->hash = fn(val, h->hash);
+}
+
 /*
  * Add a NULL attribute to the hash calculation.
  */
@@ -58,11 +81,22 @@ extern void cdbhashnokey(CdbHash *h);
  */
 static inline unsigned int cdbhashreduce(CdbHash* h)
 {
-	return h->mask ? (h->hash & h->mask) : (h->hash % h->numsegs);
+	if (h->mask)
+		return h->hash & h->mask;
+#ifdef __SIZEOF_INT128__
+	/*
+	 * h->hash % h->numsegs without the division: the low 64 bits of
+	 * hash * modinv are the fractional part of hash / numsegs, and
+	 * multiplying that by numsegs gives the remainder in the high bits.
+	 * Exact for any 32-bit hash and numsegs.
+	 */
+	return (unsigned int)
+		(((unsigned __int128) (h->modinv * h->hash) * (uint32) h->numsegs) >> 64);
+#else
+	return h->hash % h->numsegs;
+#endif
 }
 
-extern unsigned int cdbhashreduce(CdbHash *h);
-
 /*
  * Return true if Oid is hashable internally in Greenplum Database.
  */
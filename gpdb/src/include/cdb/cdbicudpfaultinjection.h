@@ -81,6 +81,7 @@ typedef enum {
 	/* These are used to inject network faults. */
 	FINC_NET_PKT_DUP = 24,
 	FINC_NET_RECV_ZERO = 25,
+	FINC_NET_PARTIAL_BATCH = 26,
 
 	/* This is a fault which is used to introduce a specific null return of malloc in bg thread */
 	FINC_RX_BUF_NULL = 29,
@@ -314,6 +315,149 @@ no_fault_inject:
 	return recvfrom(socket, buffer, length, flags, address, address_len);
 }
 
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+/*
+ * testmode_sendmmsg
+ * 		sendmmsg function with faults injected.
+ *
+ * Besides the errors, only part of the batch may be sent, as the kernel
+ * does when the socket buffer fills up; otherwise the packet faults of
+ * testmode_sendto() are injected into each message in turn.
+ */
+static int
+testmode_sendmmsg(const char *caller_name, int socket, struct mmsghdr *msgvec,
+				  unsigned int vlen, int flags)
+{
+	int		fault_type;
+	int		i;
+
+	if (!testmode_inject_fault(gp_udpic_fault_inject_percent))
+		goto no_fault_inject;
+
+	fault_type = random() % FINC_MAX_LIMITATION;
+
+	switch (fault_type)
+	{
+		case FINC_OS_EAGAIN:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to sendmmsg: FINC_OS_EAGAIN");
+			errno = EAGAIN;
+			return -1;
+
+		case FINC_OS_EINTR:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to sendmmsg: FINC_OS_EINTR");
+			errno = EINTR;
+			return -1;
+
+		case FINC_OS_NET_INTERFACE:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to sendmmsg: FINC_OS_NET_INTERFACE");
+			errno = EFAULT;
+			return -1;
+
+		case FINC_NET_PARTIAL_BATCH:
+			if (!FINC_HAS_FAULT(fault_type) || vlen < 2)
+				break;
+			write_log("inject fault to sendmmsg: FINC_NET_PARTIAL_BATCH");
+			vlen /= 2;
+			break;
+
+		default:
+			for (i = 0; i < vlen; i++)
+			{
+				struct msghdr *hdr = &msgvec[i].msg_hdr;
+				ssize_t		n;
+
+				n = testmode_sendto(caller_name, socket,
+									hdr->msg_iov[0].iov_base,
+									hdr->msg_iov[0].iov_len, flags,
+									(struct sockaddr *) hdr->msg_name,
+									hdr->msg_namelen);
+				if (n < 0)
+					return (i > 0 ? i : -1);
+				msgvec[i].msg_len = n;
+			}
+			return vlen;
+	}
+
+no_fault_inject:
+	return sendmmsg(socket, msgvec, vlen, flags);
+}
+
+/*
+ * testmode_recvmmsg
+ * 		recvmmsg function with faults injected.
+ */
+static int
+testmode_recvmmsg(const char *caller_name, int socket, struct mmsghdr *msgvec,
+				  unsigned int vlen, int flags, struct timespec *timeout)
+{
+	int		fault_type;
+
+	if (!testmode_inject_fault(gp_udpic_fault_inject_percent))
+		goto no_fault_inject;
+
+	fault_type = random() % FINC_MAX_LIMITATION;
+
+	switch (fault_type)
+	{
+		case FINC_OS_EAGAIN:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to recvmmsg: FINC_OS_EAGAIN");
+			errno = EAGAIN;
+			return -1;
+
+		case FINC_OS_EINTR:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to recvmmsg: FINC_OS_EINTR");
+			errno = EINTR;
+			return -1;
+
+		case FINC_OS_EWOULDBLOCK:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to recvmmsg: FINC_OS_EWOULDBLOCK");
+			errno = EWOULDBLOCK;
+			return -1;
+
+		case FINC_NET_RECV_ZERO:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			MemSet(msgvec[0].msg_hdr.msg_iov[0].iov_base, 0,
+				   msgvec[0].msg_hdr.msg_iov[0].iov_len);
+			msgvec[0].msg_len = 0;
+			write_log("inject fault to recvmmsg: FINC_NET_RECV_ZERO");
+			return 1;
+
+		case FINC_OS_NET_INTERFACE:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to recvmmsg: FINC_OS_NET_INTERFACE");
+			errno = EFAULT;
+			return -1;
+
+		case FINC_NET_PARTIAL_BATCH:
+			if (!FINC_HAS_FAULT(fault_type))
+				break;
+			write_log("inject fault to recvmmsg: FINC_NET_PARTIAL_BATCH");
+			vlen = 1;
+			break;
+
+		default:
+			break;
+	}
+
+no_fault_inject:
+	return recvmmsg(socket, msgvec, vlen, flags, timeout);
+}
+#endif
+
 /*
  * testmode_poll
  * 		poll function with faults injected.
@@ -555,6 +699,8 @@ testmode_pthread_create(const char *caller_name, pthread_t *thread,
 #undef ML_CHECK_FOR_INTERRUPTS
 #undef sendto
 #undef recvfrom
+#undef sendmmsg
+#undef recvmmsg
 #undef poll
 #undef socket
 #undef bind
@@ -576,6 +722,14 @@ testmode_pthread_create(const char *caller_name, pthread_t *thread,
 #define recvfrom(socket, buffer, length, flags, address, address_len) \
 	testmode_recvfrom(PG_FUNCNAME_MACRO, socket, buffer, length, flags, address, address_len)
 
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define sendmmsg(socket, msgvec, vlen, flags) \
+	testmode_sendmmsg(PG_FUNCNAME_MACRO, socket, msgvec, vlen, flags)
+
+#define recvmmsg(socket, msgvec, vlen, flags, timeout) \
+	testmode_recvmmsg(PG_FUNCNAME_MACRO, socket, msgvec, vlen, flags, timeout)
+#endif
+
 #define poll(fds, nfds, timeout) \
 	testmode_poll(PG_FUNCNAME_MACRO, fds, nfds, timeout)
 
@@ -410,6 +410,21 @@ typedef struct MotionNodeEntry
 	 */
 	htup_fifo       ready_tuples;
 
+	/*
+	 * Batches of rows received and not yet consumed, and the batch whose
+	 * rows are being returned.  Only used if preserve_order is false.
+	 */
+	SerTupBatch    *ready_batches_head;
+	SerTupBatch    *ready_batches_tail;
+	SerTupBatch    *cur_batch;
+
+	/*
+	 * Batches being collected for sending, one per route plus one for
+	 * broadcast, allocated on first use.
+	 */
+	SerTupBatchBuilder **send_batches;
+	int             num_send_batches;
+
 	/*
 	 * Variable that records the total number of senders to this motion node.
 	 * This is expected to always be (number of qExecs).
@@ -16,6 +16,7 @@
 #include "cdb/cdbselect.h"
 #include "cdb/cdbinterconnect.h"
 #include "cdb/ml_ipc.h"
+#include "executor/tuptable.h"
 
 /* Define this if you want tons of logs! */
 #undef AMS_VERBOSE_LOGGING
@@ -102,6 +103,16 @@ extern SendReturnCode SendTuple(MotionLayerState *mlStates,
 								HeapTuple tuple,
 								int16 targetRoute);
 
+/* Like SendTuple(), but the row in slot is added to a batch for its route,
+ * and the batch is sent once it is full or at end-of-stream.  Rows of
+ * motion nodes that use this must all go through it.
+ */
+extern SendReturnCode SendTupleSlot(MotionLayerState *mlStates,
+									ChunkTransportState *transportStates,
+									int16 motNodeID,
+									TupleTableSlot *slot,
+									int16 targetRoute);
+
 
 /* Send or broadcast an END_OF_STREAM token to the corresponding motion-node
  * on other segments.
@@ -131,6 +142,15 @@ extern ReceiveReturnCode RecvTupleFrom(MotionLayerState *mlStates,
 									   HeapTuple *tup_i,
 									   int16 srcRoute);
 
+/* Unordered receive of the next row into slot, whether it was sent on its
+ * own or in a batch.  Rows of batches are stored as virtual tuples that
+ * stay valid until the next call.
+ */
+extern ReceiveReturnCode RecvTupleSlotFrom(MotionLayerState *mlStates,
+										   ChunkTransportState *transportStates,
+										   int16 motNodeID,
+										   TupleTableSlot *slot);
+
 extern void SendStopMessage(MotionLayerState *mlStates,
 							ChunkTransportState *transportStates,
 							int16 motNodeID);
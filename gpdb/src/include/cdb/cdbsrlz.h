@@ -16,6 +16,14 @@
 #include "lib/stringinfo.h"
 #include "nodes/pg_list.h"
 
+/* Values of gp_dispatch_compression */
+#define DISPATCH_COMPRESS_NONE	0
+#define DISPATCH_COMPRESS_ZLIB	1
+#define DISPATCH_COMPRESS_LZ4	2
+#define DISPATCH_COMPRESS_ZSTD	3
+
+extern int	dispatch_compression_from_string(const char *name);
+
 extern char *serializeNode(Node *node, int *size, int *uncompressed_size);
 extern Node *deserializeNode(const char *strNode, int size);
 
@@ -185,6 +185,12 @@ extern bool gp_use_dispatch_agent;
 /*How many gangs to keep around from stmt to stmt.*/
 extern int			gp_cached_gang_threshold;
 
+/*
+ * How many reader N-gangs the QD pre-forks while the session waits for the
+ * client, so that the next query finds them warm.  0 disables pre-forking.
+ */
+extern int			gp_gang_pool_size;
+
 /*
  * gp_reject_percent_threshold
  *
@@ -421,6 +427,22 @@ extern int	gp_connections_per_thread; /* GUC var - server operating mode.  */
 extern bool assign_gp_connections_per_thread(int newval, bool doit, GucSource source);
 extern const char *show_gp_connections_per_thread(void);
 
+/*
+ * Parameter gp_dispatch_event_driven
+ *
+ * When set, the QD does not start dispatch threads at all: it sends the
+ * command to every QE and then waits for all of them on a single epoll set
+ * from the main thread, so gp_connections_per_thread does not apply.
+ * Ignored on platforms without epoll.
+ *
+ * Off by default, and ignored with the TCP interconnect.  Nothing reads the
+ * QE connections while the main thread sits in an interconnect receive,
+ * except the UDP interconnect's periodic cancel check; with TCP a QE that
+ * filled its libpq output buffer (NOTICEs, errors) would stall until the
+ * query finishes.
+ */
+extern bool gp_dispatch_event_driven;
+
 /*
  * If number of subtransactions within a transaction exceed this limit,
  * then a warning is given to the user.
@@ -549,6 +571,13 @@ extern bool gp_interconnect_aggressive_retry; /* fast-track app-level retry */
  */
 extern bool gp_interconnect_full_crc;
 
+/*
+ * Parameter gp_interconnect_batch_io
+ *
+ * Move several UDP-packets per system call where the platform allows it.
+ */
+extern bool gp_interconnect_batch_io;
+
 /*
  * Parameter gp_interconnect_elide_setup
  *
@@ -834,6 +863,18 @@ extern bool gp_enable_dqa_pruning;
  */
 extern bool gp_eager_dqa_pruning;
 
+/*
+ * "gp_enable_approx_count_distinct"
+ *
+ * May Greenplum replace COUNT(DISTINCT) aggregates with approximate
+ * HyperLogLog counts (approx_count_distinct) when a query has DISTINCT-
+ * qualified aggregates on more than one argument?  The sketches are merged
+ * in 2-phase aggregation, instead of joining one 3-phase plan per argument.
+ *
+ * The results are estimates, so this is off by default.
+ */
+extern bool gp_enable_approx_count_distinct;
+
 /*
  * "gp_eager_one_phase_agg"
  *
@@ -933,6 +974,25 @@ extern bool gp_enable_sort_distinct;
 extern bool gp_enable_mk_sort;
 extern bool gp_enable_motion_mk_sort;
 
+/*
+ * Radix sort multi-key sort levels of integer, float, date, timestamp and,
+ * under the C collation, text types on an order-preserving 64 bit key.
+ */
+extern bool gp_enable_mk_radix_sort;
+
+/*
+ * Max number of blocks read ahead on each input tape of an external
+ * multi-key sort merge, 0 to read one block at a time.
+ */
+extern int gp_mk_sort_readahead_blocks;
+
+/*
+ * Compute the moving frames of window aggregates that have a preliminary
+ * function but no inverse one by keeping the partial values of the frame,
+ * rather than scanning the whole frame for every row.
+ */
+extern bool gp_enable_sliding_window_agg;
+
 #ifdef USE_ASSERT_CHECKING
 extern bool gp_mk_sort_check;
 #endif
@@ -988,6 +1048,9 @@ extern int gp_segworker_relative_priority;
 /*  Max size of dispatched plans; 0 if no limit */
 extern int gp_max_plan_size;
 
+/* Codec for dispatched plans (DISPATCH_COMPRESS_xxx, see cdbsrlz.h) */
+extern int gp_dispatch_compress_algorithm;
+
 /* The maximum number of times on average that the hybrid hashed aggregation
  * algorithm will plan to spill an input row to disk before including it in
  * an aggregation.  Increasing this parameter will cause the planner to choose
@@ -1017,6 +1080,26 @@ extern int gp_hashagg_spillbatch_max;
 /* Hashjoin use bloom filter */
 extern int gp_hashjoin_bloomfilter;
 
+/* Hashjoin clusters the hash table by bucket and probes it in batches */
+extern bool gp_hashjoin_radix_cluster;
+
+/* Hashjoin builds runtime filters for the scans on its probe side */
+extern bool gp_hashjoin_runtime_filter;
+
+/* AOCS scan reads and evaluates simple quals a batch of rows at a time */
+extern bool gp_enable_aocs_batch_scan;
+
+/*
+ * Maintain per-block zone maps for append-only tables and skip blocks with
+ * them.  Append-only tables created while this is on get a block directory
+ * to hold the zone maps; off by default.
+ */
+extern bool gp_appendonly_zonemaps;
+
+/* Redistribute and broadcast motions send rows in batches, optionally lz4 compressed */
+extern bool gp_enable_motion_batch;
+extern bool gp_motion_batch_compress;
+
 /* Get statistics for partitioned parent from a child */
 extern bool 	gp_statistics_pullup_from_child_partition;
 
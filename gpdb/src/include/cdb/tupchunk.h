@@ -21,6 +21,10 @@ typedef enum TupleChunkType
 	TC_PARTIAL_END,				/* Contains the final portion of a tuple. */
 	TC_END_OF_STREAM,			/* Indicates "end of tuples" from this source. */
 	TC_EMPTY,					/* Empty tuple */
+	TC_BATCH,					/* Contains a whole batch of rows. */
+	TC_BATCH_START,				/* Contains the starting portion of a batch;
+								 * the rest follows in TC_PARTIAL_MID and
+								 * TC_PARTIAL_END chunks. */
 	TC_MAXVAL					/* For range checks on type values. */
 } TupleChunkType;
 
@@ -101,4 +101,58 @@ extern HeapTuple DeserializeTuple(SerTupInfo * pSerInfo, StringInfo serialTup);
  */
 extern HeapTuple CvtChunksToHeapTup(TupleChunkList tclist, SerTupInfo * pSerInfo);
 
+/*
+ * Batches.
+ *
+ * Instead of one tuple at a time, a sender may collect the rows for a
+ * destination in a SerTupBatchBuilder and send them as one batch, laid out
+ * column by column: for each column a null bitmap, if the column has any
+ * NULLs, followed by its non-NULL values, each aligned as in a heap tuple.
+ * The whole batch may be compressed with lz4.  The receiver returns the
+ * rows as Datums pointing into the batch, without forming tuples.
+ */
+#define TUPSER_BATCH_MAX_ROWS	1024
+#define TUPSER_BATCH_MAX_BYTES	(32 * 1024)
+
+typedef struct SerTupBatchBuilder SerTupBatchBuilder;
+
+/* A received batch, and the position of the next row to return from it. */
+typedef struct SerTupBatch
+{
+	struct SerTupBatch *next;	/* next batch in the motion node's queue */
+
+	TupleDesc	tupdesc;
+	int			nrows;
+	int			currow;			/* next row to return */
+
+	char	   *data;			/* the batch, decompressed */
+	char	  **colpos;			/* per column, where its next value is */
+	bits8	  **colnulls;		/* per column, its null bitmap or NULL */
+} SerTupBatch;
+
+/* Can tuples of this description be sent in batches? */
+extern bool SerTupInfoCanBatch(SerTupInfo *pSerInfo);
+
+/* Create an empty batch in the current memory context. */
+extern SerTupBatchBuilder *CreateSerTupBatchBuilder(SerTupInfo *pSerInfo);
+
+/* Number of rows added to the batch since it was last serialized. */
+extern int SerTupBatchNumRows(SerTupBatchBuilder *builder);
+
+/* Add a row to the batch; returns true if the batch should be sent now. */
+extern bool SerTupBatchAddRow(SerTupBatchBuilder *builder, SerTupInfo *pSerInfo,
+							  Datum *values, bool *isnull);
+
+/* Convert the rows of a batch into chunks ready to send out, and empty it. */
+extern void SerializeTupleBatchIntoChunks(SerTupBatchBuilder *builder, SerTupInfo *pSerInfo,
+										  TupleChunkList tcList, bool compress);
+
+/* Convert a sequence of chunks containing a serialized batch into a batch. */
+extern SerTupBatch *CvtChunksToTupleBatch(TupleChunkList tcList, SerTupInfo *pSerInfo);
+
+/* Fetch the next row of a batch; returns false when there are no more. */
+extern bool SerTupBatchNextRow(SerTupBatch *batch, Datum *values, bool *isnull);
+
+extern void FreeSerTupBatch(SerTupBatch *batch);
+
 #endif   /* TUPSER_H */
@@ -40,7 +40,6 @@ typedef struct BatchFileInfo BatchFileInfo;
  */
 typedef struct HashAggEntry
 {
-	struct HashAggEntry	   *next; /* Next entry in chain. */
 	void *tuple_and_aggs; /* point to a chunk that contains both grouping keys
 						   * and aggregate values.
 						   */
@@ -48,6 +47,23 @@ typedef struct HashAggEntry
 	bool is_primodial; /* indicate if this entry is there before spilling. */
 } HashAggEntry;
 
+/* A bucket of an Agg hash table.
+ *
+ * The table is open-addressed with linear probing: a group whose home
+ * bucket is taken goes to the next free bucket after it.  Each bucket
+ * keeps the full hash value of its entry next to the entry pointer, so
+ * that a probe rejects almost every non-matching bucket without touching
+ * the entry, and the probe sequence of a lookup runs through adjacent
+ * cache lines instead of a chain of scattered entries.
+ *
+ * A bucket with a NULL entry is empty.
+ */
+typedef struct HashAggBucket
+{
+	HashAggEntry *entry;
+	HashKey hashvalue;
+} HashAggBucket;
+
 /* A SpillFile controls access to a temporary file used to hold  
  * transition tuples spilled from the hash table in order to free 
  * up space.
@@ -161,9 +177,9 @@ typedef struct HashAggTable
 	/* Hash table */
 	MemoryContext   entry_cxt;	/* memory context for hash table entries */
 
-	unsigned nbuckets;
-	HashAggEntry  **buckets;
-	uint64 *bloom;
+	unsigned nbuckets;			/* always a power of 2 */
+	unsigned nbuckets_used;		/* number of non-empty buckets */
+	HashAggBucket  *buckets;
 
 	/* Overflow batches */
 	SpillSet       *spill_set;
@@ -192,7 +208,6 @@ typedef struct HashAggTable
 
 	/* Variables during iteration */
 	int curr_bucket_idx;
-	HashAggEntry *next_entry;
 
 	/* buffer for calculating the hashkey */
 	HashKey *hashkey_buf;
@@ -215,7 +230,7 @@ typedef struct HashAggTable
 	uint64 total_buckets; /* total number of buckets allocated */
 	bool is_spilling; /* indicate that spilling happened for this batch. */
 	struct TupleTableSlot *prev_slot; /* a slot that is read previously. */
-    CdbExplain_Agg      chainlength;
+    CdbExplain_Agg      probelength;
 } HashAggTable;
 
 extern HashAggTable *create_agg_hash_table(AggState *aggstate);
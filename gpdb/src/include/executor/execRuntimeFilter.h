@@ -0,0 +1,71 @@
+/*-------------------------------------------------------------------------
+ *
+ * execRuntimeFilter.h
+ *	  Runtime join filters built by a Hash node and applied by the scans
+ *	  on the probe side of its hash join.
+ *
+ * While the Hash node builds its table it also collects, for each hash key
+ * of the join that comes straight from a column of a table scan on the
+ * outer side, a bloom filter of the key's hash values and, for integer
+ * keys, the range of its values.  Once the build is done the filter is
+ * published, and from then on the scan drops the rows whose column can't
+ * match any inner row before they are qualified, projected and passed up
+ * through the join tree.
+ *
+ * Only inner and semi joins are filtered, and the scan must be reachable
+ * from the join through nodes that pass outer rows up unchanged, inner hash
+ * joins included, all within the slice of the join.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECRUNTIMEFILTER_H
+#define EXECRUNTIMEFILTER_H
+
+#include "executor/tuptable.h"
+#include "nodes/execnodes.h"
+
+/*
+ * The runtime filter of one Hash node.  Opaque to callers; see
+ * execRuntimeFilter.c.
+ */
+typedef struct RuntimeFilter RuntimeFilter;
+
+/*
+ * ExecInitRuntimeFilter
+ *   Set up the runtime filter of a hash join whose child nodes have been
+ *   initialized, and attach its keys to the scans they filter.  outerkeys
+ *   and innerkeys are the hash key ExprStates, hashoperators the OIDs of
+ *   the hash operators.  Returns NULL if no key can be filtered.
+ */
+extern RuntimeFilter *ExecInitRuntimeFilter(HashJoinState *hjstate,
+											List *outerkeys,
+											List *innerkeys,
+											List *hashoperators);
+
+/*
+ * ExecRuntimeFilterReset
+ *   Withdraw the filter and clear it for a new build.
+ */
+extern void ExecRuntimeFilterReset(RuntimeFilter *filter);
+
+/*
+ * ExecRuntimeFilterAdd
+ *   Add the inner row in econtext->ecxt_innertuple to the filter.
+ */
+extern void ExecRuntimeFilterAdd(RuntimeFilter *filter, ExprContext *econtext);
+
+/*
+ * ExecRuntimeFilterPublish
+ *   Make the filter visible to the scans once all inner rows are added.
+ */
+extern void ExecRuntimeFilterPublish(RuntimeFilter *filter);
+
+/*
+ * ExecRuntimeFilterPass
+ *   Can the scan tuple in slot match any inner row of the published
+ *   filters in keys, the ss_runtimeFilters list of a scan?
+ */
+extern bool ExecRuntimeFilterPass(List *keys, TupleTableSlot *slot,
+								  ExprContext *econtext);
+
+#endif   /* EXECRUNTIMEFILTER_H */
@@ -0,0 +1,53 @@
+/*-------------------------------------------------------------------------
+ *
+ * execVecQual.h
+ *	  Batch-at-a-time evaluation of simple scan quals over column vectors.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECVECQUAL_H
+#define EXECVECQUAL_H
+
+#include "nodes/primnodes.h"
+
+/*
+ * A compiled qual.  Opaque to callers; see execVecQual.c.
+ */
+typedef struct VecQual VecQual;
+
+/*
+ * ExecVecQualSupported
+ *   Can clause be evaluated by ExecVecQualEval?  attmap maps a (1-based)
+ *   attribute number of the scanned relation to the index of the column in
+ *   the batch, or -1 if the column is not part of the batch.
+ */
+extern bool ExecVecQualSupported(Expr *clause, Index scanrelid,
+								 int *attmap, int natts);
+
+/*
+ * ExecVecQualCompile
+ *   Compile a list of implicitly AND'ed clauses, all of which must pass
+ *   ExecVecQualSupported.  maxrows is the largest batch that will be
+ *   evaluated.  Returns NULL for an empty list.
+ */
+extern VecQual *ExecVecQualCompile(List *clauses, Index scanrelid,
+								   int *attmap, int natts, int maxrows);
+
+/*
+ * ExecVecQualEval
+ *   Evaluate the qual over the rows of a batch named by the selection
+ *   vector sel[0 .. nsel-1].  datum[row][col] and isnull[row][col] hold the
+ *   batch.  sel is compacted in place (order is preserved) to the rows that
+ *   pass, and the number of those rows is returned.
+ *
+ *   runs may be NULL.  Otherwise, if runs[col] is not NULL, consecutive rows
+ *   with equal runs[col][row] are known to hold the same value of column
+ *   col, and comparisons on that column are done once per run.
+ *
+ *   Any memory needed for detoasting is allocated in CurrentMemoryContext,
+ *   which the caller is expected to reset between batches.
+ */
+extern int ExecVecQualEval(VecQual *vq, Datum **datum, bool **isnull,
+						   int32 **runs, int *sel, int nsel);
+
+#endif   /* EXECVECQUAL_H */
@@ -78,6 +78,34 @@ typedef struct HashJoinTupleData
 #define HJTUPLE_MINTUPLE(hjtup)  \
 	((MemTuple) ((char *) (hjtup) + HJTUPLE_OVERHEAD))
 
+/*
+ * CDB: an entry of a clustered hash table.
+ *
+ * With gp_hashjoin_radix_cluster, once the inner tuples of a batch are all
+ * in the hash table, they are also listed in bucket order in an array of
+ * these, with the tuples of each bucket in one contiguous run.  A probe
+ * then reads the hash values of its bucket from a cache line or two and
+ * touches only the tuples whose hash value matches, instead of following
+ * the bucket chain through scattered tuples.
+ *
+ * The array is built with a radix partitioning pass that splits the tuples
+ * into partitions of consecutive buckets small enough to stay in cache,
+ * followed by a counting sort of each partition.  The bucket chains are
+ * left in place for spilling and for saving the batch to a workfile.
+ */
+typedef struct HashJoinClusterEntry
+{
+	struct HashJoinTupleData *tuple;
+	uint32		hashvalue;
+	uint32		bucketno;
+} HashJoinClusterEntry;
+
+/* Work memory charged per clustered tuple: the staging and cluster arrays */
+#define HJ_CLUSTER_SPACE  (2 * sizeof(HashJoinClusterEntry))
+
+/* Number of outer tuples fetched and prefetched at a time for a clustered table */
+#define HJ_OUTER_BATCH_SIZE  16
+
 
 /* Statistics collection workareas for EXPLAIN ANALYZE */
 typedef struct HashJoinBatchStats
@@ -152,6 +180,20 @@ typedef struct HashJoinTableData
 	uint64     				  *bloom; /* bloom[i] is bloomfilter for buckets[i] */
 	/* buckets array is per-batch storage, as are all the tuples */
 
+	/*
+	 * CDB: radix clustering, see HashJoinClusterEntry.  While a batch is
+	 * built its in-memory tuples are appended to staged[]; when it is built,
+	 * they are clustered into cluster[], where the run of bucket i starts at
+	 * clusterstart[i].  cluster is NULL while the current batch is not
+	 * clustered.  All of these are per-batch storage.
+	 */
+	bool		radix;			/* cluster each batch? */
+	HashJoinClusterEntry *staged;
+	uint32		nstaged;
+	uint32		maxstaged;
+	HashJoinClusterEntry *cluster;
+	uint32	   *clusterstart;	/* array [0..nbuckets] */
+
 	int			nbatch;			/* number of batches */
 	int			curbatch;		/* current batch #; 0 during 1st pass */
 
@@ -44,6 +44,9 @@ extern void ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 extern HashJoinTuple ExecScanHashBucket(HashState *hashState, HashJoinState *hjstate,
 				   ExprContext *econtext);
 extern void ExecHashTableReset(HashState *hashState, HashJoinTable hashtable);
+extern void ExecHashTableCluster(HashState *hashState, HashJoinTable hashtable);
+extern void ExecHashTablePrefetch(HashJoinTable hashtable,
+					  const uint32 *hashvalues, int n);
 extern HashJoinTableStats* ExecHashTableExplainInit(HashState *hashState, HashJoinState *hjstate, int nbatch); 
 extern void ExecHashTableExplainBatchEnd(HashState *hashState, HashJoinTable hashtable);
 
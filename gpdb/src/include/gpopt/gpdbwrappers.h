@@ -614,6 +614,18 @@ namespace gpdb {
 	// table has been changed?)
 	bool FMDCacheNeedsReset(void);
 
+	// is the metadata cache shared by all sessions available?
+	bool FSharedMDCacheEnabled(void);
+
+	// generation to store a metadata object translated from now on with
+	uint64 UllSharedMDCacheBeginLoad(void);
+
+	// look up a serialized metadata object in the shared metadata cache
+	void *PvSharedMDCacheLookup(const char *szMDId, Size *psize);
+
+	// store a serialized metadata object in the shared metadata cache
+	void SharedMDCacheInsert(const char *szMDId, const void *pv, Size size, uint64 ullGeneration);
+
 } //namespace gpdb
 
 #define ForEach(cell, l)	\
@@ -53,6 +53,10 @@ namespace gpmd
 			// private copy ctor
 			CMDProviderRelcache(const CMDProviderRelcache&);
 
+			// key of the given object in the shared metadata cache
+			static
+			BOOL FSharedCacheKey(IMDId *pmdid, CHAR *szKey, ULONG ulKeyLen);
+
 		public:
 			// ctor/dtor
 			explicit
@@ -63,6 +63,7 @@ extern "C" {
 #include "commands/trigger.h"
 #include "parser/parse_coerce.h"
 #include "utils/selfuncs.h"
+#include "utils/sharedmdcache.h"
 #include "utils/faultinjector.h"
 
 extern
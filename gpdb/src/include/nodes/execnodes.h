@@ -27,6 +27,7 @@
 #include "utils/relcache.h"
 #include "gpmon/gpmon.h"                /* gpmon_packet_t */
 #include "utils/memaccounting.h"
+#include "cdb/cdbhash.h"
 
 /*
  * partition selector ids start from 1. Sometimes we use 0 to initialize variables
@@ -1466,6 +1467,7 @@ typedef enum
  *	 ScanTupleSlot           pointer to slot in tuple table holding scan tuple
  *	 scan_state		the stage of scanning
  *	 tableType			the table type of the target relation
+ *	 runtimeFilters		runtime join filter keys applied by ExecScan
  * ----------------
  */
 typedef struct ScanState
@@ -1478,6 +1480,9 @@ typedef struct ScanState
 
 	/* The type of the table that is being scanned */
 	TableType	tableType;
+
+	/* CDB: keys of hash join runtime filters, see execRuntimeFilter.h */
+	List	   *ss_runtimeFilters;
 } ScanState;
 
 /*
@@ -1838,6 +1843,12 @@ typedef struct AOCSScanOpaqueData
 	int  ncol;
 
 	struct AOCSScanDescData *scandesc;
+
+	/*
+	 * Batch-at-a-time read state, NULL when reading a row at a time.
+	 * See execAOCSScan.c.
+	 */
+	struct AOCSBatchScanData *batch;
 } AOCSScanOpaqueData;
 
 /* -----------------------------------------------
@@ -2064,6 +2075,19 @@ typedef struct HashJoinState
         bool                prefetch_inner;
         bool                hj_nonequijoin;
 
+        /*
+         * CDB: probing a clustered hash table.  hj_CurClusterPos is the
+         * position in the cluster array of the last inner tuple matched to
+         * the current outer tuple.  Outer tuples are fetched and their
+         * buckets prefetched hj_OuterBatchCount at a time; hj_OuterBatchNext
+         * is the next one to return.
+         */
+        int                        hj_CurClusterPos;
+        struct TupleTableSlot **hj_OuterBatchSlots;
+        uint32           *hj_OuterBatchHash;
+        int                        hj_OuterBatchCount;
+        int                        hj_OuterBatchNext;
+
         /* true if found matching and usable cached workfiles */
         bool cached_workfiles_found;
         /* set after loading nbatch and nbuckets from cached workfile */
@@ -2391,6 +2415,9 @@ typedef struct HashState
 	bool		hs_quit_if_hashkeys_null;	/* quit building hash table if hashkeys are all null */
 	bool		hs_hashkeys_null;	/* found an instance wherein hashkeys are all null */
 	/* hashkeys is same as parent's hj_InnerHashKeys */
+
+	/* CDB: runtime join filter built along with the table, or NULL */
+	struct RuntimeFilter *runtimeFilter;
 } HashState;
 
 /* ----------------
@@ -2558,6 +2585,10 @@ typedef struct MotionState
 	List	   *hashExpr;		/* state struct used for evaluating the hash expressions */
 	struct CdbHash *cdbhash;	/* hash api object */
 	FmgrInfo *hashfunctions;	/* hash functions. */
+	CdbHashKeyFunction *hashkeyfuncs;	/* per hash key, its cdbhash function
+										 * if it has one */
+	AttrNumber *hashkeyattnos;	/* per hash key, the outer column it is, or 0 */
+	bool		sendBatches;	/* send rows in batches, see SendTupleSlot() */
 
 
 	/* For Motion recv */
@@ -38,6 +38,7 @@ typedef struct PlannerConfig
 	bool		gp_enable_agg_distinct;
 	bool		gp_enable_dqa_pruning;
 	bool		gp_eager_dqa_pruning;
+	bool		gp_enable_approx_count_distinct;
 	bool		gp_eager_one_phase_agg;
 	bool		gp_eager_two_phase_agg;
 	bool        gp_enable_groupext_distinct_pruning;
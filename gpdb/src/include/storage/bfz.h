@@ -60,14 +60,46 @@ typedef struct bfz
 	int64 numBlocks;
 	int64 blockNo;
 	int64 chosenBlockNo;
+
+	/*
+	 * Compression statistics.  raw_written and raw_read count the bytes
+	 * handed to and returned by the compression algorithm, compressed_written
+	 * the bytes it put on disk.  The times cover the algorithm's write_ex and
+	 * read_ex, including the file I/O they do.
+	 */
+	int64 stat_raw_written;
+	int64 stat_compressed_written;
+	int64 stat_write_usecs;
+	int64 stat_raw_read;
+	int64 stat_read_usecs;
 }	bfz_t;
 
+/*
+ * The block compression algorithms (lz4, zstd) compress every buffer they
+ * are handed by write_ex on its own, and store it as a frame: this header
+ * followed by compsize bytes of compressed data.  A compsize of 0 means the
+ * block did not compress and rawsize bytes are stored as is.
+ */
+typedef struct bfz_frame_header
+{
+	int32		rawsize;
+	int32		compsize;
+} bfz_frame_header;
+
+#define BFZ_FRAME_HEADER_SIZE	((int) sizeof(bfz_frame_header))
+
 /* These functions are internal to bfz. */
 extern void bfz_nothing_init(bfz_t * thiz);
 extern void bfz_zlib_init(bfz_t * thiz);
 extern void bfz_lzop_init(bfz_t * thiz);
+extern void bfz_lz4_init(bfz_t * thiz);
+extern void bfz_zstd_init(bfz_t * thiz);
 extern void bfz_write_ex(bfz_t * thiz, const char *buffer, int size);
 extern int	bfz_read_ex(bfz_t * thiz, char *buffer, int size);
+extern void bfz_write_frame(bfz_t * thiz, char *frame, const char *buffer,
+							int rawsize, int compsize);
+extern bool bfz_read_frame(bfz_t * thiz, char *buffer, int size,
+						   char *cbuf, int cbufsize, bfz_frame_header *hdr);
 
 /* These functions are interface to bfz. */
 extern const char *bfz_compression_to_string(int compress);
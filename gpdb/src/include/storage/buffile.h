@@ -49,6 +49,7 @@ extern int BufFileSeek(BufFile *file, int64 offset, int whence);
 extern void BufFileTell(BufFile *file, int64 *offset);
 extern int	BufFileSeekBlock(BufFile *file, int64 blknum);
 extern void BufFileFlush(BufFile *file);
+extern int	BufFilePrefetch(BufFile *file, int64 offset, int amount);
 extern int64 BufFileGetSize(BufFile *buffile);
 extern void BufFileSetWorkfile(BufFile *buffile);
 
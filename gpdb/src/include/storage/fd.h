@@ -81,6 +81,7 @@ extern void FileClose(File file);
 extern void FileUnlink(File file);
 extern int	FileRead(File file, char *buffer, int amount);
 extern int	FileReadIntr(File file, char *buffer, int amount, bool fRetryInt);
+extern int	FilePrefetch(File file, int64 offset, int amount);
 extern int	FileWrite(File file, char *buffer, int amount);
 extern int	FileSync(File file);
 extern int64 FileSeek(File file, int64 offset, int whence);
@@ -93,6 +93,7 @@ typedef enum LWLockId
 	FileRepAppendOnlyCommitCountLock,
 	SyncRepLock,
 	ErrorLogLock,
+	SharedMDCacheLock,
 	FirstWorkfileMgrLock,
 	FirstWorkfileQuerySpaceLock = FirstWorkfileMgrLock + NUM_WORKFILEMGR_PARTITIONS,
 	FirstBufMappingLock = FirstWorkfileQuerySpaceLock + NUM_WORKFILE_QUERYSPACE_PARTITIONS,
@@ -1186,6 +1186,13 @@ extern Datum quicklz_compress(PG_FUNCTION_ARGS);
 extern Datum quicklz_decompress(PG_FUNCTION_ARGS);
 extern Datum quicklz_validator(PG_FUNCTION_ARGS);
 
+/* catalog/codec_compression.c */
+extern Datum codec_constructor(PG_FUNCTION_ARGS);
+extern Datum codec_destructor(PG_FUNCTION_ARGS);
+extern Datum codec_compress(PG_FUNCTION_ARGS);
+extern Datum codec_decompress(PG_FUNCTION_ARGS);
+extern Datum codec_validator(PG_FUNCTION_ARGS);
+
 extern Datum zlib_constructor(PG_FUNCTION_ARGS);
 extern Datum zlib_destructor(PG_FUNCTION_ARGS);
 extern Datum zlib_compress(PG_FUNCTION_ARGS);
@@ -1217,6 +1224,19 @@ extern Datum test_quicklz_compression(PG_FUNCTION_ARGS);
 /* percentile.c */
 extern Datum percentile_cont_trans(PG_FUNCTION_ARGS);
 extern Datum percentile_disc_trans(PG_FUNCTION_ARGS);
+extern Datum approx_percentile_trans(PG_FUNCTION_ARGS);
+extern Datum approx_percentile_merge(PG_FUNCTION_ARGS);
+extern Datum approx_percentile_final(PG_FUNCTION_ARGS);
+
+/* hll.c */
+extern Datum hll_in(PG_FUNCTION_ARGS);
+extern Datum hll_out(PG_FUNCTION_ARGS);
+extern Datum hll_recv(PG_FUNCTION_ARGS);
+extern Datum hll_send(PG_FUNCTION_ARGS);
+extern Datum hll_add_trans(PG_FUNCTION_ARGS);
+extern Datum hll_union_trans(PG_FUNCTION_ARGS);
+extern Datum approx_count_distinct_final(PG_FUNCTION_ARGS);
+extern Datum hll_cardinality(PG_FUNCTION_ARGS);
 
 /* utils/workfile_manager/workfile_mgr_test.c */
 extern Datum gp_workfile_mgr_test_harness(PG_FUNCTION_ARGS);
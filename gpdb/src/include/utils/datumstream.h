@@ -276,6 +276,7 @@ extern void destroy_datumstreamread(DatumStreamRead * ds);
 extern int64 datumstreamwrite_block(DatumStreamWrite * ds);
 extern int64 datumstreamwrite_lob(DatumStreamWrite * ds, Datum d);
 extern int	datumstreamread_block(DatumStreamRead * ds);
+extern int	datumstreamread_skip_to_row(DatumStreamRead * ds, int64 rowNum);
 extern void datumstreamread_find(DatumStreamRead * datumStream,
 					 int32 rowNumInBlock);
 extern void datumstreamread_rewind_block(DatumStreamRead * datumStream);
@@ -528,6 +528,37 @@ DatumStreamBitMapRead_Next(
 #endif
 }
 
+/*
+ * Move the read position bitCount bits forward, as that many calls of
+ * DatumStreamBitMapRead_Next would.
+ */
+static inline void
+DatumStreamBitMapRead_Skip(
+						   DatumStreamBitMapRead * bmr,
+						   int32 bitCount)
+{
+	if (bitCount <= 0)
+		return;
+
+	Assert(bmr->bitPosition + bitCount < bmr->bitCount);
+
+#ifdef USE_ASSERT_CHECKING
+	{
+		int32		i;
+
+		for (i = bmr->bitPosition + 1; i <= bmr->bitPosition + bitCount; i++)
+		{
+			if ((bmr->buffer[i >> 3] & (1 << (i & 7))) != 0)
+				bmr->readBitOnCount++;
+		}
+	}
+#endif
+
+	bmr->bitPosition += bitCount;
+	bmr->bytePointer = &bmr->buffer[bmr->bitPosition >> 3];
+	bmr->byteBit = 1 << (bmr->bitPosition & 7);
+}
+
 static inline int32
 DatumStreamBitMapRead_Size(
 						   DatumStreamBitMapRead * bmr)
@@ -2014,6 +2045,14 @@ DatumStreamBlockRead_Nth(DatumStreamBlockRead * dsr)
 	return dsr->nth;
 }
 
+extern int32 DatumStreamBlockRead_GetBatch(
+							   DatumStreamBlockRead * dsr,
+							   int32 nrows,
+							   const bool *keep,
+							   Datum *values,
+							   bool *nulls,
+							   int32 *runids);
+
 extern void DatumStreamBlockRead_GetReadyOrig(
 								  DatumStreamBlockRead * dsr,
 								  uint8 * buffer,
@@ -174,6 +174,9 @@ extern bool gp_appendonly_compaction;
  * 10% of the tuples are hidden.
  */ 
 extern int  gp_appendonly_compaction_threshold;
+extern int  gp_appendonly_prefetch_depth;
+extern int  gp_aocs_decompress_workers;
+extern int  gp_aocs_decompress_memory;
 extern bool gp_heap_require_relhasoids_match;
 extern bool	Debug_appendonly_rezero_quicklz_compress_scratch;
 extern bool	Debug_appendonly_rezero_quicklz_decompress_scratch;
@@ -376,6 +379,7 @@ extern bool optimizer_print_plan;
 extern bool optimizer_print_xform;
 extern bool optimizer_metadata_caching; 
 extern int optimizer_mdcache_size;
+extern int optimizer_mdcache_shared_size;
 extern bool optimizer_disable_xform_result_printing;
 extern bool	optimizer_print_memo_after_exploration;
 extern bool	optimizer_print_memo_after_implementation;
@@ -386,6 +390,7 @@ extern bool	optimizer_print_group_properties;
 extern bool	optimizer_print_optimization_context;
 extern bool optimizer_print_optimization_stats;
 extern bool	optimizer_parallel;
+extern int	optimizer_parallel_workers;
 extern bool	optimizer_local;
 extern int  optimizer_retries;
 extern bool  optimizer_xforms[OPTIMIZER_XFORMS_COUNT];
@@ -490,6 +495,7 @@ extern char  *gp_hadoop_home;    /* $HADOOP_HOME on all segments */
 extern char  *gp_auth_time_override_str;
 
 extern char  *gp_default_storage_options;
+extern char  *gp_zstd_dictionary;
 
 /*
  * This is the batch size used when we want to display the number of files that
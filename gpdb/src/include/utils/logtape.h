@@ -40,6 +40,7 @@ extern LogicalTapeSet *LoadLogicalTapeSetState(ExecWorkFile *pfile, ExecWorkFile
 
 extern void LogicalTapeSetClose(LogicalTapeSet *lts, workfile_set *workset);
 extern void LogicalTapeSetForgetFreeSpace(LogicalTapeSet *lts);
+extern void LogicalTapeSetReadAhead(LogicalTapeSet *lts, LogicalTape *lt, int nblocks);
 
 extern size_t LogicalTapeRead(LogicalTapeSet *lts, LogicalTape *lt, void *ptr, size_t size);
 extern void LogicalTapeWrite(LogicalTapeSet *lts, LogicalTape *lt, void *ptr, size_t size);
@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedmdcache.h
+ *	  Interface for the cross-session cache of optimizer metadata.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDMDCACHE_H
+#define SHAREDMDCACHE_H
+
+#include "storage/sinval.h"
+
+/* Max length of a metadata id string, including the terminator */
+#define SHARED_MDCACHE_MDID_LEN 64
+
+extern Size SharedMDCacheShmemSize(void);
+extern void SharedMDCacheShmemInit(void);
+
+extern bool SharedMDCacheEnabled(void);
+extern uint64 SharedMDCacheBeginLoad(void);
+extern void *SharedMDCacheLookup(const char *mdid, Size *len);
+extern void SharedMDCacheInsert(const char *mdid, const void *data, Size len,
+								uint64 generation);
+extern void SharedMDCacheInvalidate(const SharedInvalidationMessage *msgs, int n);
+
+#endif   /* SHAREDMDCACHE_H */
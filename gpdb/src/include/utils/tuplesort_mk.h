@@ -215,6 +215,22 @@ typedef enum MKLvType
     MKLV_TYPE_TEXT,  /* this level contains text values */
 } MKLvType;
 
+/*
+ * Levels whose values map to an order-preserving unsigned 64 bit key, which
+ * lets mk_qsort radix sort them instead of calling the comparator.
+ */
+typedef enum MKNormKeyType
+{
+    MKNK_NONE,       /* no normalized key, always use the comparator */
+    MKNK_INT16,
+    MKNK_INT32,      /* int4, date */
+    MKNK_INT64,      /* int8, integer timestamps */
+    MKNK_FLOAT4,
+    MKNK_FLOAT8,     /* float8, float timestamps */
+    MKNK_TEXT,       /* first bytes of text, only under the C collation */
+    MKNK_BPCHAR,     /* same, after trailing blanks are stripped */
+} MKNormKeyType;
+
 typedef struct MKLvContext
 {
 	/* Is the type of datums in this level passed by value instead of reference */
@@ -226,6 +242,9 @@ typedef struct MKLvContext
     /* type of datums in this level, converted to our MKLvType enumeration */
     MKLvType lvtype;
 
+    /* normalized key of datums in this level, if any */
+    MKNormKeyType normkeytype;
+
     SortFunctionKind sortfnkind;
     FmgrInfo fmgrinfo;
 
@@ -288,6 +307,13 @@ typedef struct MKContext {
 
     /* enforce Unique, for index build */
     bool enforceUnique;
+
+    /*
+     * Scratch space, in bytes, that the radix pass of mk_qsort may still
+     * allocate; set by the sort from what is left of its work_mem.  A range
+     * that needs more is partitioned with the comparator instead.
+     */
+    long radixMemAllowed;
 } MKContext;
 
 /**
@@ -308,6 +334,16 @@ static inline void mk_prepare_array(MKEntry *a, int i, int j, int32 lv, struct M
 
 extern void tupsort_cpfr(MKEntry *dst, MKEntry *src, MKLvContext *ctxt);
 extern int tupsort_compare_datum(MKEntry *v1, MKEntry *v2, MKLvContext *ctxt, MKContext *mkContext);
+extern uint64 tupsort_normalized_key(MKEntry *a, MKLvContext *lvctxt);
+
+/**
+ * Does an equal normalized key mean an equal value at this level?  Text keys
+ * hold only a prefix of the value.
+ */
+static inline bool mk_normkey_is_exact(MKLvContext *lvctxt)
+{
+    return lvctxt->normkeytype != MKNK_TEXT && lvctxt->normkeytype != MKNK_BPCHAR;
+}
 
 extern void create_mksort_context(
         MKContext *mkctxt,
@@ -43,6 +43,8 @@
 #define WORKFILE_NUM_TUPLESTORE_LOB 2
 
 
+struct bfz;
+
 /* Placeholder snapshot type */
 typedef uint32 workfile_set_snapshot;
 
@@ -132,6 +134,16 @@ typedef struct workfile_set
 	/* Set to true during operator execution once set is complete */
 	bool complete;
 
+	/*
+	 * bfz compression statistics, summed over the files of the set when they
+	 * are closed (see the stat_ fields of bfz_t)
+	 */
+	int64 bfz_raw_written;
+	int64 bfz_compressed_written;
+	int64 bfz_write_usecs;
+	int64 bfz_raw_read;
+	int64 bfz_read_usecs;
+
 } workfile_set;
 
 /* The key for an entry stored in the Queryspace Hashtable */
@@ -175,6 +187,7 @@ Cache *workfile_mgr_get_cache(void);
 int32 workfile_mgr_clear_cache(int seg_id);
 int64 workfile_mgr_evict(int64 size_requested);
 void workfile_update_in_progress_size(ExecWorkFile *workfile, int64 size);
+void workfile_update_bfz_stats(ExecWorkFile *workfile, struct bfz *bfz_file);
 
 /* Workfile File operations */
 ExecWorkFile *workfile_mgr_create_file(workfile_set *work_set);
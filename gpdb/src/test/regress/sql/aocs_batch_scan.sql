@@ -0,0 +1,123 @@
+--
+-- Batch-at-a-time scans of column-oriented tables
+-- (gp_enable_aocs_batch_scan).  Simple quals are evaluated over a whole
+-- batch; every query is run with the batch scan on and off and the rows
+-- must be the same.
+--
+create table aocs_batch (id int, i2 int2, i4 int4, i8 int8, f4 float4,
+						 f8 float8, d date, n numeric, t text)
+with (appendonly=true, orientation=column, blocksize=8192)
+distributed by (id);
+
+insert into aocs_batch
+select i,
+	   case when i % 13 = 0 then null else (i % 200 - 100)::int2 end,
+	   case when i % 17 = 0 then null else i end,
+	   (i % 1000)::int8 * 10000000000,
+	   case when i % 19 = 0 then null else (i % 50) / 4.0 end,
+	   case when i % 23 = 0 then null else i / 7.0 end,
+	   date '2010-01-01' + i % 400,
+	   case when i % 29 = 0 then null else (i % 300)::numeric / 8 end,
+	   'row' || i
+from generate_series(1, 5000) i;
+
+-- a second insert, so that the table has several blocks per column of
+-- different row counts, and rows where every column is NULL
+insert into aocs_batch
+select 5000 + i, null, null, null, null, null, null, null, null
+from generate_series(1, 1500) i;
+
+insert into aocs_batch values
+	(7001, 0, 0, 0, 'NaN', 'NaN', '2010-01-01', 'NaN', 'nan'),
+	(7002, -32768, -2147483648, -9223372036854775808, '-Infinity', '-Infinity', '4713-01-01 BC', -1e20, 'min'),
+	(7003, 32767, 2147483647, 9223372036854775807, 'Infinity', 'Infinity', '5874897-12-31', 1e20, 'max');
+
+create function aocs_batch_check(query text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_enable_aocs_batch_scan = on';
+	execute 'create temp table aocs_batch_on as ' || query || ' distributed randomly';
+	execute 'set gp_enable_aocs_batch_scan = off';
+	execute 'create temp table aocs_batch_off as ' || query || ' distributed randomly';
+	execute 'reset gp_enable_aocs_batch_scan';
+
+	select count(*) into mismatches from
+		((select * from aocs_batch_on except all select * from aocs_batch_off)
+		 union all
+		 (select * from aocs_batch_off except all select * from aocs_batch_on)) x;
+
+	execute 'drop table aocs_batch_on';
+	execute 'drop table aocs_batch_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- comparisons with a constant, on every supported type
+select aocs_batch_check('select * from aocs_batch where i4 > 2500');
+select aocs_batch_check('select * from aocs_batch where i2 between -10 and 10');
+select aocs_batch_check('select * from aocs_batch where i8 >= 5000000000000 and i8 < 7000000000000');
+select aocs_batch_check('select * from aocs_batch where f4 <= 3.5');
+select aocs_batch_check('select * from aocs_batch where f8 > 300.5 or f8 < 10');
+select aocs_batch_check('select * from aocs_batch where d = ''2010-02-01''');
+select aocs_batch_check('select * from aocs_batch where n >= 10.5 and n <> 20');
+select aocs_batch_check('select id, i4 from aocs_batch where 100 > i4');
+
+-- NaN sorts above every other value, infinities at either end
+select aocs_batch_check('select * from aocs_batch where f8 = ''NaN''');
+select aocs_batch_check('select * from aocs_batch where f4 > ''Infinity''');
+select aocs_batch_check('select * from aocs_batch where f8 < ''-Infinity'' or f8 >= 700');
+select aocs_batch_check('select * from aocs_batch where n > 1e19');
+
+-- IN and NOT IN lists, IS [NOT] NULL
+select aocs_batch_check('select * from aocs_batch where d in (''2010-01-05'', ''2010-03-01'', ''2011-01-01'')');
+select aocs_batch_check('select * from aocs_batch where i4 not in (1, 2, 3, 100, 200)');
+select aocs_batch_check('select * from aocs_batch where i2 is null');
+select aocs_batch_check('select * from aocs_batch where i4 is not null and f8 is null');
+select aocs_batch_check('select * from aocs_batch where (i2 < -90 or i2 > 90) and f4 is not null');
+
+-- quals that cannot be vectorized fall back to the row-at-a-time check,
+-- alone or next to ones that can
+select aocs_batch_check('select * from aocs_batch where t like ''row1%''');
+select aocs_batch_check('select * from aocs_batch where t like ''row1%'' and i4 > 100');
+select aocs_batch_check('select * from aocs_batch where i4 + 1 = 101 or i2 = 5');
+select aocs_batch_check('select * from aocs_batch where i4 = i2');
+select aocs_batch_check('select * from aocs_batch where i2 > 50::int4 and f8 > 1::numeric');
+
+-- no column needed, and a single column
+select aocs_batch_check('select count(*) from aocs_batch where i4 > 2500');
+select aocs_batch_check('select i2 from aocs_batch where i2 >= 0');
+
+-- the counts themselves
+set gp_enable_aocs_batch_scan = on;
+select count(*) from aocs_batch where i4 > 2500;
+select count(*) from aocs_batch where i2 is null;
+select count(*) from aocs_batch where d in ('2010-01-05', '2010-03-01');
+select count(*) from aocs_batch where f8 = 'NaN';
+reset gp_enable_aocs_batch_scan;
+
+-- runs of equal values in RLE-compressed columns
+create table aocs_batch_rle (id int, r int4 encoding (compresstype=rle_type),
+							 rd date encoding (compresstype=rle_type), v int8)
+with (appendonly=true, orientation=column)
+distributed by (id);
+
+insert into aocs_batch_rle
+select i, case when i / 100 % 7 = 0 then null else i / 100 end,
+	   date '2012-01-01' + i / 500, i
+from generate_series(1, 20000) i order by i;
+
+select aocs_batch_check('select * from aocs_batch_rle where r = 42');
+select aocs_batch_check('select * from aocs_batch_rle where r between 10 and 20 and v % 3 = 0');
+select aocs_batch_check('select * from aocs_batch_rle where rd > ''2012-01-20'' or r is null');
+
+-- deleted rows are skipped
+delete from aocs_batch where id % 10 = 0;
+delete from aocs_batch_rle where r = 43;
+select aocs_batch_check('select * from aocs_batch where i4 > 2500');
+select aocs_batch_check('select * from aocs_batch where i2 is null');
+select aocs_batch_check('select * from aocs_batch_rle where r > 40 and r < 45');
+
+drop function aocs_batch_check(text);
+drop table aocs_batch;
+drop table aocs_batch_rle;
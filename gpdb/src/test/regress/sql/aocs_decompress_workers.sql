@@ -0,0 +1,114 @@
+--
+-- Decompressing column-oriented table blocks ahead of the scan in worker
+-- threads (gp_aocs_decompress_workers).  Every query is run with the
+-- workers off and on, and must return the same rows.
+--
+create table dw_lz4 (id int, a int, t text, f float8)
+with (appendonly=true, orientation=column, compresstype=lz4, blocksize=8192)
+distributed by (id);
+create table dw_zstd (id int, a int, t text, f float8)
+with (appendonly=true, orientation=column, compresstype=zstd, compresslevel=5)
+distributed by (id);
+
+-- columns that are decompressed ahead next to ones that are not
+create table dw_mixed (id int,
+					   a int encoding (compresstype=lz4),
+					   t text encoding (compresstype=zstd),
+					   f float8 encoding (compresstype=zlib),
+					   r int encoding (compresstype=rle_type),
+					   u int encoding (compresstype=none))
+with (appendonly=true, orientation=column)
+distributed by (id);
+
+insert into dw_lz4
+select i, i % 1000,
+	   case when i % 11 = 0 then null else 'v' || (i % 5000) || repeat('x', i % 40) end,
+	   i / 3.0
+from generate_series(1, 100000) i;
+
+-- a few values larger than a block are stored as large content
+insert into dw_lz4
+select 100000 + i, i, repeat(md5(i::text), 1500), i
+from generate_series(1, 5) i;
+
+insert into dw_zstd select * from dw_lz4;
+insert into dw_mixed select id, a, t, f, id / 1000, id from dw_lz4;
+
+create function dw_check(query text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_aocs_decompress_workers = 0';
+	execute 'create temp table dw_off as ' || query || ' distributed randomly';
+	execute 'set gp_aocs_decompress_workers = 4';
+	execute 'create temp table dw_on as ' || query || ' distributed randomly';
+	execute 'reset gp_aocs_decompress_workers';
+
+	select count(*) into mismatches from
+		((select * from dw_on except all select * from dw_off)
+		 union all
+		 (select * from dw_off except all select * from dw_on)) x;
+
+	execute 'drop table dw_on';
+	execute 'drop table dw_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+select dw_check('select * from dw_lz4');
+select dw_check('select * from dw_zstd');
+select dw_check('select * from dw_mixed');
+select dw_check('select id, t from dw_zstd where a < 10');
+select dw_check('select f, r from dw_mixed where id % 7 = 0');
+select dw_check('select count(*) as n, sum(a) as a, sum(length(t)) as t from dw_lz4');
+select dw_check('select l.id, l.t, z.f from dw_lz4 l join dw_zstd z using (id) where l.a = 5');
+
+-- a single worker, and ahead buffers smaller than a few blocks
+set gp_aocs_decompress_memory = 1024;
+select dw_check('select * from dw_mixed');
+reset gp_aocs_decompress_memory;
+
+set gp_aocs_decompress_workers = 1;
+select count(*), sum(a), sum(length(t)) from dw_zstd;
+reset gp_aocs_decompress_workers;
+
+-- the same sums without the workers
+select count(*), sum(a), sum(length(t)) from dw_zstd;
+
+-- an error in the middle of a scan, a cursor closed before its scan ends,
+-- and a statement canceled mid-scan leave nothing behind for the next one
+set gp_aocs_decompress_workers = 4;
+
+select count(*) from dw_lz4 where 1 / (id - 50000) <> 2;
+
+begin;
+declare dw_cur cursor for select * from dw_zstd;
+move 1000 in dw_cur;
+close dw_cur;
+declare dw_cur cursor for select * from dw_mixed;
+move 20000 in dw_cur;
+rollback;
+
+create function dw_slow(id int) returns bool as $$
+begin
+	if id = 77777 then
+		perform pg_sleep(60);
+	end if;
+	return true;
+end;
+$$ language plpgsql;
+
+set statement_timeout = '3s';
+select count(*) from dw_lz4 where dw_slow(id);
+reset statement_timeout;
+
+select count(*), sum(a), sum(length(t)) from dw_zstd;
+select dw_check('select * from dw_mixed');
+
+reset gp_aocs_decompress_workers;
+
+drop function dw_slow(int);
+drop function dw_check(text);
+drop table dw_lz4;
+drop table dw_zstd;
+drop table dw_mixed;
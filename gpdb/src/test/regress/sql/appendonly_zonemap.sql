@@ -0,0 +1,139 @@
+--
+-- Per-block min/max zone maps of append-only tables (gp_appendonly_zonemaps).
+-- Every query is run with the zone maps used and not used, and must return
+-- the same rows; a sequence called from the qual counts the rows the scan
+-- actually reads, to see that blocks are skipped.
+--
+set gp_appendonly_zonemaps = on;
+set optimizer = off;
+
+create table zm_ao (id int, v int, d date, n int)
+with (appendonly=true, blocksize=8192) distributed by (id);
+create table zm_co (id int, v int, d date, n int)
+with (appendonly=true, orientation=column, blocksize=8192) distributed by (id);
+
+-- v and d grow with id; n is NULL for a third of the rows in the middle
+insert into zm_ao
+select i, i, date '2000-01-01' + i / 100,
+	   case when i between 5001 and 15000 then null else i % 50 end
+from generate_series(1, 30000) i order by i;
+insert into zm_co select * from zm_ao order by id;
+
+create function zm_check(query text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_appendonly_zonemaps = on';
+	execute 'create temp table zm_on as ' || query || ' distributed randomly';
+	execute 'set gp_appendonly_zonemaps = off';
+	execute 'create temp table zm_off as ' || query || ' distributed randomly';
+	execute 'set gp_appendonly_zonemaps = on';
+
+	select count(*) into mismatches from
+		((select * from zm_on except all select * from zm_off)
+		 union all
+		 (select * from zm_off except all select * from zm_on)) x;
+
+	execute 'drop table zm_on';
+	execute 'drop table zm_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- the qual of the query must start with nextval('zm_read'), which the scan
+-- calls once for each row it does not skip
+create sequence zm_read;
+
+create function zm_rows_read(query text) returns bigint as $$
+declare
+	before bigint;
+	after bigint;
+	n bigint;
+begin
+	before := nextval('zm_read');
+	execute query into n;
+	after := nextval('zm_read');
+	return after - before - 1;
+end;
+$$ language plpgsql;
+
+-- range quals
+select zm_check('select * from zm_ao where v > 28000');
+select zm_check('select * from zm_co where v > 28000');
+select zm_check('select * from zm_ao where v between 10000 and 10100');
+select zm_check('select * from zm_co where v between 10000 and 10100');
+select zm_check('select * from zm_ao where v = 15000');
+select zm_check('select * from zm_co where 40000 < v');
+select zm_check('select * from zm_ao where d >= ''2000-10-01''');
+select zm_check('select * from zm_co where d >= ''2000-10-01'' and v < 27500');
+select zm_check('select * from zm_ao where v < 100 or v > 29900');
+
+select count(*) from zm_ao where v > 28000;
+select count(*) from zm_co where v between 10000 and 10100;
+select count(*) from zm_ao where d >= '2000-10-01';
+select count(*) from zm_co where 40000 < v;
+
+-- IS NULL and IS NOT NULL, and blocks whose n is all NULL
+select zm_check('select * from zm_ao where n is null');
+select zm_check('select * from zm_co where n is null');
+select zm_check('select * from zm_ao where n is not null');
+select zm_check('select * from zm_co where n is not null');
+select zm_check('select * from zm_ao where n = 7 and v > 20000');
+select zm_check('select * from zm_co where n = 7 and v < 20000');
+
+select count(*) from zm_ao where n is null;
+select count(*) from zm_co where n is not null;
+select count(*) from zm_ao where v > 28000 and n is null;
+select count(*) from zm_co where n = 7;
+
+-- blocks are skipped: with the zone maps, far fewer rows than the 30000 in
+-- each table are read
+select zm_rows_read('select count(*) from zm_ao where nextval(''zm_read'') > 0 and v > 28000') < 15000 as skipped;
+select zm_rows_read('select count(*) from zm_co where nextval(''zm_read'') > 0 and v > 28000') < 15000 as skipped;
+select zm_rows_read('select count(*) from zm_ao where nextval(''zm_read'') > 0 and v between 10000 and 10100') < 15000 as skipped;
+select zm_rows_read('select count(*) from zm_ao where nextval(''zm_read'') > 0 and n is not null') < 25000 as skipped;
+select zm_rows_read('select count(*) from zm_ao where nextval(''zm_read'') > 0 and n is null') < 15000 as skipped;
+
+-- and without them, all of it
+set gp_appendonly_zonemaps = off;
+select zm_rows_read('select count(*) from zm_ao where nextval(''zm_read'') > 0 and v > 28000') as rows_read;
+select zm_rows_read('select count(*) from zm_co where nextval(''zm_read'') > 0 and v > 28000') as rows_read;
+
+-- rows added without zone maps are in blocks with no entry, which are
+-- always read
+insert into zm_ao select 30000 + i, 50000 + i, date '2001-01-01', i from generate_series(1, 10) i;
+insert into zm_co select 30000 + i, 50000 + i, date '2001-01-01', i from generate_series(1, 10) i;
+set gp_appendonly_zonemaps = on;
+
+select count(*) from zm_ao where v > 40000;
+select count(*) from zm_co where v > 40000;
+select zm_check('select * from zm_ao where v > 28000');
+select zm_check('select * from zm_co where v > 28000');
+
+-- deleted and updated rows after the zone maps were built
+delete from zm_ao where v % 10 = 0;
+delete from zm_co where v % 10 = 0;
+update zm_ao set v = v + 100000 where id % 1000 = 1;
+update zm_co set v = v + 100000 where id % 1000 = 1;
+update zm_ao set n = null where id between 20001 and 20100;
+update zm_co set n = null where id between 20001 and 20100;
+
+select count(*) from zm_ao where v > 100000;
+select count(*) from zm_co where v > 100000;
+select count(*) from zm_ao where v > 28000;
+select count(*) from zm_co where n is null;
+select zm_check('select * from zm_ao where v > 28000');
+select zm_check('select * from zm_co where v > 28000');
+select zm_check('select * from zm_ao where v between 1000 and 1100');
+select zm_check('select * from zm_co where v = 2001');
+select zm_check('select * from zm_ao where n is null');
+select zm_check('select * from zm_co where n is not null and v > 19000');
+
+reset optimizer;
+reset gp_appendonly_zonemaps;
+
+drop function zm_rows_read(text);
+drop function zm_check(text);
+drop sequence zm_read;
+drop table zm_ao;
+drop table zm_co;
@@ -0,0 +1,82 @@
+--
+-- approx_percentile(value, percentage): an ordinary aggregate over a
+-- t-digest, whose partial digests are merged by the preliminary function.
+--
+create table approx_perc (id int, g int, x float8, y float8)
+distributed by (id);
+
+-- x is uniform over 1..100000; y is skewed towards small values
+insert into approx_perc
+select i, i % 4, i, (i % 1000)::float8 * (i % 1000) / 1000
+from generate_series(1, 100000) i;
+
+-- the aggregates below are computed on the segments and then merged
+set optimizer = off;
+set gp_enable_multiphase_agg = on;
+
+create function approx_perc_agg_nodes(query text) returns int as $$
+declare
+	line text;
+	n int := 0;
+begin
+	for line in execute 'explain ' || query loop
+		if line like '%Aggregate%' then
+			n := n + 1;
+		end if;
+	end loop;
+	return n;
+end;
+$$ language plpgsql;
+
+select approx_perc_agg_nodes('select approx_percentile(x, 0.5) from approx_perc') >= 2 as two_phase;
+select approx_perc_agg_nodes('select g, approx_percentile(x, 0.5) from approx_perc group by g') >= 2 as two_phase;
+
+-- accuracy on a known distribution: x at percentage p is 1 + 99999 p
+select abs(approx_percentile(x, 0.01) - 1000.99) < 500 as close from approx_perc;
+select abs(approx_percentile(x, 0.25) - 25000.75) < 500 as close from approx_perc;
+select abs(approx_percentile(x, 0.5) - 50000.5) < 500 as close from approx_perc;
+select abs(approx_percentile(x, 0.99) - 99000.01) < 500 as close from approx_perc;
+select g, abs(approx_percentile(x, 0.9) - 90000.1) < 500 as close
+from approx_perc group by g order by g;
+
+-- and on a skewed one, where the estimate must be within 1% of the
+-- requested rank
+select abs(count(*) / 100000.0 - 0.95) < 0.01 as close
+from approx_perc, (select approx_percentile(y, 0.95) as a from approx_perc) s
+where y <= a;
+select abs(count(*) / 100000.0 - 0.05) < 0.01 as close
+from approx_perc, (select approx_percentile(y, 0.05) as a from approx_perc) s
+where y <= a;
+
+-- the extremes are exact
+select approx_percentile(x, 0) = 1 as exact_min, approx_percentile(x, 1) = 100000 as exact_max
+from approx_perc;
+
+-- a few values are kept as they are, and match percentile_cont() up to
+-- rounding
+select abs(a - e) < 1e-9 as same
+from (select approx_percentile(x, 0.3) as a from approx_perc where id <= 40) s,
+	 (select percentile_cont(0.3) within group (order by x) as e from approx_perc where id <= 40) t;
+
+-- no input, or only NULLs, gives NULL
+select approx_percentile(x, 0.5) is null as is_null from approx_perc where false;
+select approx_percentile(null::float8, 0.5) is null as is_null from approx_perc;
+select g, approx_percentile(x, 0.5) from approx_perc where false group by g;
+
+-- the percentage must be in range, and the same for all rows of a group
+select approx_percentile(x, 1.5) from approx_perc;
+select approx_percentile(x, -0.1) from approx_perc;
+select approx_percentile(x, case when id % 2 = 0 then 0.5 else 0.9 end) from approx_perc;
+select approx_percentile(x, 0.5 + 0.1 * (id % 2)) from approx_perc where id <= 2;
+
+-- values must be finite
+select approx_percentile(v, 0.5) from (values (1::float8), ('NaN')) t(v);
+select approx_percentile(v, 0.5) from (values (1::float8), ('Infinity')) t(v);
+select approx_percentile(v, 0.5) from (values (1::float8), ('-Infinity')) t(v);
+select approx_percentile(case when id = 500 then 'NaN'::float8 else x end, 0.5) from approx_perc;
+
+reset gp_enable_multiphase_agg;
+reset optimizer;
+
+drop function approx_perc_agg_nodes(text);
+drop table approx_perc;
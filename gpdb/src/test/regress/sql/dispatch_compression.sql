@@ -0,0 +1,104 @@
+--
+-- Plans dispatched with each gp_dispatch_compression codec.  The same
+-- prepared statement, and the same plpgsql query plan, dispatched again
+-- must run the same plan and return the same rows.
+--
+create table sd_t (a int, b int, c text) distributed by (a);
+insert into sd_t select i, i % 100, 'c' || i from generate_series(1, 10000) i;
+
+set optimizer = off;
+
+-- a plan of many slices, so that the serialized plan is large
+prepare sd_q(int) as
+select count(*) as groups, sum(n) as n, sum(s) as s from (
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 0 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 1 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 2 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 3 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 4 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 5 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 6 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 7 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 8 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 9 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 10 and b > $1 group by b
+	union all
+	select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 11 and b > $1 group by b
+) x;
+
+create function sd_f(p int) returns text as $$
+declare
+	r text;
+begin
+	select count(*) || ' ' || sum(n) || ' ' || sum(s) into r from (
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 0 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 1 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 2 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 3 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 4 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 5 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 6 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 7 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 8 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 9 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 10 and b > p group by b
+		union all
+		select b, count(*) as n, sum(a) as s from sd_t where a % 12 = 11 and b > p group by b
+	) x;
+	return r;
+end;
+$$ language plpgsql;
+
+set gp_dispatch_compression = none;
+execute sd_q(49);
+execute sd_q(49);
+execute sd_q(89);
+select sd_f(49) as f49, sd_f(49) as f49_again, sd_f(89) as f89;
+
+set gp_dispatch_compression = zlib;
+execute sd_q(49);
+execute sd_q(49);
+execute sd_q(89);
+select sd_f(49) as f49, sd_f(49) as f49_again, sd_f(89) as f89;
+
+set gp_dispatch_compression = lz4;
+execute sd_q(49);
+execute sd_q(49);
+execute sd_q(89);
+select sd_f(49) as f49, sd_f(49) as f49_again, sd_f(89) as f89;
+
+set gp_dispatch_compression = zstd;
+execute sd_q(49);
+execute sd_q(49);
+execute sd_q(89);
+select sd_f(49) as f49, sd_f(49) as f49_again, sd_f(89) as f89;
+
+-- unknown codecs are rejected
+set gp_dispatch_compression = snappy;
+
+reset gp_dispatch_compression;
+reset optimizer;
+
+deallocate sd_q;
+drop function sd_f(int);
+drop table sd_t;
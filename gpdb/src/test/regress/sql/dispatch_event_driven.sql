@@ -0,0 +1,60 @@
+--
+-- Waiting for the QEs of a dispatch from one event loop in the main thread
+-- instead of dispatch threads (gp_dispatch_event_driven): queries that use
+-- several gangs, an error raised by one QE, and a statement canceled while
+-- its QEs are busy.  Each must leave the session usable for the next.
+--
+set gp_dispatch_event_driven = on;
+
+create table dd_t (a int, b int) distributed by (a);
+insert into dd_t select i, i % 10 from generate_series(1, 1000) i;
+
+-- one gang, several gangs, and a dispatch from within a transaction
+select count(*) from dd_t;
+select count(*) from dd_t t1 join dd_t t2 on t1.b = t2.a;
+select b, count(*) from dd_t group by b order by b;
+begin;
+update dd_t set b = b + 1 where a <= 100;
+select count(*) from dd_t where b = 10;
+rollback;
+select count(*) from dd_t where b = 10;
+
+-- an error on one QE while the others succeed
+select count(*) from dd_t where 1 / (a - 500) <> 2;
+select count(*) from dd_t t1 join dd_t t2 on t1.b = t2.a where 1 / (t1.a - 500) <> 2;
+select count(*) from dd_t;
+
+-- and within a transaction, which is then aborted
+begin;
+insert into dd_t values (1001, 1);
+select count(*) from dd_t where 1 / (a - 500) <> 2;
+select count(*) from dd_t;
+rollback;
+select count(*) from dd_t;
+
+-- a statement canceled while its QEs are still running
+create function dd_slow(a int) returns bool as $$
+begin
+	if a = 777 then
+		perform pg_sleep(60);
+	end if;
+	return true;
+end;
+$$ language plpgsql;
+
+set statement_timeout = '3s';
+select count(*) from dd_t where dd_slow(a);
+select count(*) from dd_t t1 join dd_t t2 on t1.b = t2.a where dd_slow(t1.a);
+reset statement_timeout;
+select count(*) from dd_t t1 join dd_t t2 on t1.b = t2.a;
+
+-- switched off between statements, and back on
+set gp_dispatch_event_driven = off;
+select count(*) from dd_t t1 join dd_t t2 on t1.b = t2.a;
+set gp_dispatch_event_driven = on;
+select count(*) from dd_t t1 join dd_t t2 on t1.b = t2.a;
+
+reset gp_dispatch_event_driven;
+
+drop function dd_slow(int);
+drop table dd_t;
@@ -0,0 +1,48 @@
+--
+-- Reader gang pool: gp_gang_pool_size keeps reader gangs forked while the
+-- session is idle, and queries take their reader gangs from the pool.
+--
+-- The pool is filled only when no client input is pending, so whether a
+-- particular gang was pre-forked or created on demand depends on timing.
+-- Only check what holds either way.
+--
+create table gang_pool_t1 (a int, b int) distributed by (a);
+create table gang_pool_t2 (a int, b int) distributed by (a);
+insert into gang_pool_t1 select i, i % 10 from generate_series(1, 100) i;
+insert into gang_pool_t2 select i, i % 10 from generate_series(1, 100) i;
+
+-- disabled: the view still reports the session, and nothing is pre-forked
+set gp_gang_pool_size = 0;
+select pool_size, preforked, prefork_failures from gp_session_gang_pool;
+
+-- taken before pre-forking is enabled, so that no reader gang exists yet
+create temp table gang_pool_before as
+	select * from gp_session_gang_pool;
+
+set gp_gang_pool_size = 2;
+show gp_gang_pool_size;
+
+-- a join on a non-distribution key needs reader gangs for its motions
+select count(*) from gang_pool_t1 t1, gang_pool_t2 t2 where t1.b = t2.b;
+select count(*) from gang_pool_t1 t1, gang_pool_t2 t2 where t1.b = t2.b;
+select count(*) from gang_pool_t1 t1, gang_pool_t2 t2 where t1.b = t2.b;
+
+-- reader gangs go back to the pool between statements
+select pool_size, idle_gangs > 0 as gangs_cached, busy_gangs
+from gp_session_gang_pool;
+
+-- the later joins took their reader gangs from the pool
+select s.reused > b.reused as gangs_reused,
+	   s.preforked + s.created > b.preforked + b.created as gangs_made,
+	   s.prefork_failures = 0 as no_failures
+from gp_session_gang_pool s, gang_pool_before b;
+
+-- counters only go up
+select s.preforked >= b.preforked and s.reused >= b.reused
+	   and s.created >= b.created and s.create_ms >= b.create_ms as monotonic
+from gp_gang_pool_stats() s, gang_pool_before b;
+
+reset gp_gang_pool_size;
+
+drop table gang_pool_t1;
+drop table gang_pool_t2;
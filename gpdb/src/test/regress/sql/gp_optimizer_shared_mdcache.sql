@@ -0,0 +1,66 @@
+--
+-- The metadata cache that ORCA shares across sessions must not leak
+-- catalog changes of an open transaction, whether it commits or not.
+--
+set optimizer = on;
+set optimizer_segments = 3;
+
+create table mdcache_t (a int, b int) distributed by (a);
+insert into mdcache_t select i, i % 5 from generate_series(1, 20) i;
+
+-- count the plan lines that have the given text
+create function mdcache_plan_lines(query text, node text) returns int as $$
+declare
+	line text;
+	n int := 0;
+begin
+	for line in execute 'explain ' || query loop
+		if line like '%' || node || '%' then
+			n := n + 1;
+		end if;
+	end loop;
+	return n;
+end;
+$$ language plpgsql;
+
+-- populate the shared cache
+select * from mdcache_t where a < 3 order by a;
+
+-- a transaction sees its own DDL, not the committed metadata in the cache
+begin;
+alter table mdcache_t add column c int default 7;
+select * from mdcache_t where a < 3 order by a;
+create index mdcache_t_b on mdcache_t (b);
+set optimizer_enable_tablescan = off;
+select mdcache_plan_lines('select b from mdcache_t where b = 1', 'mdcache_t_b') > 0 as uses_index;
+reset optimizer_enable_tablescan;
+rollback;
+
+-- after the rollback, this session and a new one see the committed table
+select * from mdcache_t where a < 3 order by a;
+\c regression
+set optimizer = on;
+set optimizer_segments = 3;
+select * from mdcache_t where a < 3 order by a;
+select count(*) from pg_index where indrelid = 'mdcache_t'::regclass;
+
+-- the same within a subtransaction that is rolled back
+begin;
+savepoint s1;
+alter table mdcache_t drop column b;
+select * from mdcache_t where a < 3 order by a;
+rollback to savepoint s1;
+select * from mdcache_t where a < 3 order by a;
+commit;
+
+-- committed DDL is picked up by the next session
+begin;
+alter table mdcache_t add column d text default 'x';
+commit;
+\c regression
+set optimizer = on;
+set optimizer_segments = 3;
+select * from mdcache_t where a < 3 order by a;
+
+drop function mdcache_plan_lines(text, text);
+drop table mdcache_t;
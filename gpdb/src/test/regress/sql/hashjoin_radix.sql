@@ -0,0 +1,110 @@
+--
+-- Hash joins whose tables are clustered by bucket and probed in prefetched
+-- groups of outer tuples (gp_hashjoin_radix_cluster).  Every join is run
+-- with the GUC on and off, and must return the same rows.
+--
+create table hj_inner (id int, k int, v int) distributed by (id);
+create table hj_outer (id int, k int, v int) distributed by (id);
+create table hj_small (v int) distributed by (v);
+
+-- keys with duplicates and NULLs on both sides, and keys on each side that
+-- the other does not have
+insert into hj_inner
+select i, case when i % 97 = 0 then null else i % 20000 end, i % 10
+from generate_series(1, 60000) i;
+insert into hj_outer
+select i, case when i % 89 = 0 then null else i % 30000 end, i % 10
+from generate_series(1, 40000) i;
+insert into hj_small select generate_series(0, 9);
+analyze hj_inner;
+analyze hj_outer;
+analyze hj_small;
+
+set optimizer = off;
+set enable_nestloop = off;
+set enable_mergejoin = off;
+
+create function hj_check(query text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_hashjoin_radix_cluster = on';
+	execute 'create temp table hj_on as ' || query || ' distributed randomly';
+	execute 'set gp_hashjoin_radix_cluster = off';
+	execute 'create temp table hj_off as ' || query || ' distributed randomly';
+	execute 'reset gp_hashjoin_radix_cluster';
+
+	select count(*) into mismatches from
+		((select * from hj_on except all select * from hj_off)
+		 union all
+		 (select * from hj_off except all select * from hj_on)) x;
+
+	execute 'drop table hj_on';
+	execute 'drop table hj_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- count the plan lines that have the given text
+create function hj_plan_lines(query text, node text, with_analyze bool) returns int as $$
+declare
+	line text;
+	n int := 0;
+begin
+	for line in execute 'explain ' || case when with_analyze then 'analyze ' else '' end || query loop
+		if line like '%' || node || '%' then
+			n := n + 1;
+		end if;
+	end loop;
+	return n;
+end;
+$$ language plpgsql;
+
+select hj_plan_lines('select * from hj_outer o join hj_inner i on o.k = i.k', 'Hash Join', false) > 0 as hash_join;
+select hj_plan_lines('select * from hj_outer o left join hj_inner i on o.k = i.k', 'Hash Left Join', false) > 0 as hash_left_join;
+select hj_plan_lines('select * from hj_outer o where not exists (select 1 from hj_inner i where i.k = o.k)', 'Anti', false) > 0 as hash_lasj;
+
+-- inner, left and left anti-semi joins, and a semi join
+select hj_check('select o.id, i.id as iid from hj_outer o join hj_inner i on o.k = i.k');
+select hj_check('select o.id, i.id as iid from hj_outer o join hj_inner i on o.k = i.k and o.v = i.v');
+select hj_check('select o.id, i.id as iid from hj_outer o join hj_inner i on o.k = i.k where i.v < 3 and o.v > 6');
+select hj_check('select o.id, i.id as iid from hj_outer o left join hj_inner i on o.k = i.k');
+select hj_check('select o.id, i.id as iid from hj_outer o left join hj_inner i on o.k = i.k and i.v = 4');
+select hj_check('select o.id from hj_outer o where not exists (select 1 from hj_inner i where i.k = o.k)');
+select hj_check('select o.id from hj_outer o where o.k not in (select k from hj_inner where k is not null)');
+select hj_check('select o.id from hj_outer o where o.k in (select k from hj_inner)');
+
+select count(*) from hj_outer o join hj_inner i on o.k = i.k;
+select count(*) from hj_outer o left join hj_inner i on o.k = i.k;
+select count(*) from hj_outer o where not exists (select 1 from hj_inner i where i.k = o.k);
+
+-- the inner side spills to several batches
+set work_mem = '128kB';
+set gp_hashjoin_radix_cluster = on;
+select hj_plan_lines('select count(*) from hj_outer o join hj_inner i on o.k = i.k', 'to inner workfile', true) > 0 as spilled;
+reset gp_hashjoin_radix_cluster;
+select hj_check('select o.id, i.id as iid from hj_outer o join hj_inner i on o.k = i.k');
+select hj_check('select o.id, i.id as iid from hj_outer o left join hj_inner i on o.k = i.k');
+select hj_check('select o.id from hj_outer o where not exists (select 1 from hj_inner i where i.k = o.k)');
+reset work_mem;
+
+-- rescans, with a parameter on the outer side only, which keeps the hash
+-- table, and on the inner side, which rebuilds it
+select hj_check('select s.v, (select count(*) from hj_outer o join hj_inner i on o.k = i.k where o.v = s.v) as n from hj_small s');
+select hj_check('select s.v, (select count(*) from hj_outer o join hj_inner i on o.k = i.k where i.v = s.v) as n from hj_small s');
+select hj_check('select s.v, (select count(*) from hj_outer o left join hj_inner i on o.k = i.k and i.v = s.v) as n from hj_small s');
+
+set gp_hashjoin_radix_cluster = on;
+select s.v, (select count(*) from hj_outer o join hj_inner i on o.k = i.k where i.v = s.v) as n
+from hj_small s order by s.v;
+reset gp_hashjoin_radix_cluster;
+
+reset enable_mergejoin;
+reset enable_nestloop;
+reset optimizer;
+
+drop function hj_plan_lines(text, text, bool);
+drop function hj_check(text);
+drop table hj_small;
+drop table hj_outer;
+drop table hj_inner;
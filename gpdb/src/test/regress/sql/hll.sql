@@ -0,0 +1,117 @@
+--
+-- HyperLogLog sketches: the hll type, hll_agg(), hll_union_agg(),
+-- hll_cardinality(), and COUNT(DISTINCT) estimated through them when
+-- gp_enable_approx_count_distinct is on.
+--
+create table hll_src (id int, a int, b text, c int, d bit(8))
+distributed by (id);
+
+-- a has 50000 distinct values, b 1000, c only 10 and d 256
+insert into hll_src
+select i, i % 50000, 'v' || (i % 1000), i % 10, (i % 256)::bit(8)
+from generate_series(1, 100000) i;
+insert into hll_src values (100001, null, null, null, null);
+
+-- the estimates are within a few percent of the exact counts, and within
+-- one of them when there are only a few
+select abs(hll_cardinality(hll_agg(a)) - 50000) < 50000 * 0.05 as close from hll_src;
+select abs(hll_cardinality(hll_agg(b)) - 1000) < 1000 * 0.05 as close from hll_src;
+select abs(hll_cardinality(hll_agg(c)) - 10) <= 1 as close from hll_src;
+
+-- NULLs are ignored, and no input at all counts nothing
+select hll_agg(a) is null as no_sketch from hll_src where a is null;
+select hll_agg(a) is null as no_sketch from hll_src where false;
+select approx_count_distinct(a) from hll_src where a is null;
+select approx_count_distinct(a) from hll_src where false;
+
+-- sketches stored in a table and combined later
+create table hll_sketches (part int, sketch hll) distributed by (part);
+insert into hll_sketches select c, hll_agg(a) from hll_src group by c;
+
+select count(*), count(sketch) from hll_sketches;
+select abs(hll_cardinality(hll_union_agg(sketch)) - 50000) < 50000 * 0.05 as close
+from hll_sketches;
+select (select hll_cardinality(hll_union_agg(sketch)) from hll_sketches) =
+	   (select hll_cardinality(hll_agg(a)) from hll_src) as same_as_direct;
+
+-- the text form, through hll_out() and hll_in(), reads back to the same
+-- sketch; plpgsql converts between the types with their I/O functions
+create function hll_to_text(h hll) returns text as $$
+begin
+	return h;
+end;
+$$ language plpgsql;
+
+create function hll_from_text(t text) returns hll as $$
+begin
+	return t;
+end;
+$$ language plpgsql;
+
+select hll_to_text(hll_from_text(hll_to_text(sketch))) = hll_to_text(sketch) as round_trip
+from hll_sketches order by part limit 3;
+select hll_cardinality(hll_from_text('010c0000' || repeat('00', 4096))) as empty_sketch;
+
+-- hll_in() rejects malformed input
+select 'abc'::hll;
+select hll_from_text('010c0000' || repeat('00', 4095));
+select hll_from_text('010c0000' || repeat('zz', 4096));
+select hll_from_text('020c0000' || repeat('00', 4096));
+select hll_from_text('010b0000' || repeat('00', 4096));
+select hll_from_text('010c0000' || repeat('00', 4095) || 'ff');
+
+-- count the plan nodes whose line has the given text
+create function hll_plan_nodes(query text, node text) returns int as $$
+declare
+	line text;
+	n int := 0;
+begin
+	for line in execute 'explain ' || query loop
+		if line like '%' || node || '%' then
+			n := n + 1;
+		end if;
+	end loop;
+	return n;
+end;
+$$ language plpgsql;
+
+set optimizer = off;
+
+-- without the rewrite, each distinct argument gets its own aggregation,
+-- and the results are joined
+set gp_enable_approx_count_distinct = off;
+select hll_plan_nodes('select count(distinct a), count(distinct b) from hll_src', 'Aggregate') > 2 as per_argument;
+select count(distinct a), count(distinct b), count(distinct c) from hll_src;
+
+-- with it, the counts are estimated in one 2-phase aggregation
+set gp_enable_approx_count_distinct = on;
+select hll_plan_nodes('select count(distinct a), count(distinct b) from hll_src', 'Aggregate') = 2 as two_phase;
+select hll_plan_nodes('select c, count(distinct a), count(distinct b) from hll_src group by c', 'Aggregate') = 2 as two_phase;
+select abs(count(distinct a) - 50000) < 50000 * 0.05 as close_a,
+	   abs(count(distinct b) - 1000) < 1000 * 0.05 as close_b,
+	   abs(count(distinct c) - 10) <= 1 as close_c
+from hll_src;
+select c, abs(count(distinct a) - 5000) < 5000 * 0.05 as close_a,
+	   abs(count(distinct b) - 100) < 100 * 0.05 as close_b
+from hll_src where c is not null group by c order by c;
+
+-- estimated counts of no rows, or only NULLs, are 0
+select count(distinct a), count(distinct b) from hll_src where false;
+select count(distinct a), count(distinct b) from hll_src where a is null;
+
+-- a single distinct argument is still counted exactly
+select count(distinct a) from hll_src;
+
+-- bit has no hash function, so its count is left exact
+select abs(count(distinct a) - 50000) < 50000 * 0.05 as close_a, count(distinct d) as d
+from hll_src;
+select count(distinct d), count(distinct d || d) from hll_src;
+
+reset gp_enable_approx_count_distinct;
+reset optimizer;
+
+drop function hll_plan_nodes(text, text);
+drop function hll_to_text(hll);
+drop function hll_from_text(text);
+drop table hll_sketches;
+drop table hll_src;
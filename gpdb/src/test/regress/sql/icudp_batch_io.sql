@@ -0,0 +1,87 @@
+--
+-- Sending and receiving interconnect packets in batches with sendmmsg() and
+-- recvmmsg() (gp_interconnect_batch_io).  Every query is run with the batches
+-- on and off, and must return the same rows.  A deep send queue lets the
+-- sender build batches of many packets.
+--
+CREATE SCHEMA ic_batch_test;
+SET search_path = ic_batch_test;
+
+CREATE TABLE small_table(dkey INT, jkey INT, rval REAL, tval TEXT default 'abcdefghijklmnopqrstuvwxyz') DISTRIBUTED BY (dkey);
+INSERT INTO small_table VALUES(generate_series(1, 5000), generate_series(5001, 10000), sqrt(generate_series(5001, 10000)));
+
+CREATE FUNCTION ic_check(query text) RETURNS bigint AS $$
+DECLARE
+    mismatches bigint;
+BEGIN
+    EXECUTE 'SET gp_interconnect_batch_io = on';
+    EXECUTE 'CREATE TEMP TABLE ic_on AS ' || query || ' DISTRIBUTED RANDOMLY';
+    EXECUTE 'SET gp_interconnect_batch_io = off';
+    EXECUTE 'CREATE TEMP TABLE ic_off AS ' || query || ' DISTRIBUTED RANDOMLY';
+    EXECUTE 'RESET gp_interconnect_batch_io';
+
+    SELECT COUNT(*) INTO mismatches FROM
+        ((SELECT * FROM ic_on EXCEPT ALL SELECT * FROM ic_off)
+         UNION ALL
+         (SELECT * FROM ic_off EXCEPT ALL SELECT * FROM ic_on)) x;
+
+    EXECUTE 'DROP TABLE ic_on';
+    EXECUTE 'DROP TABLE ic_off';
+    RETURN mismatches;
+END
+$$ LANGUAGE plpgsql;
+
+SET gp_interconnect_snd_queue_depth TO 32;
+SET gp_interconnect_queue_depth TO 32;
+
+-- Skew with gather+redistribute
+SELECT ic_check('SELECT ROUND(foo.rval * foo.rval)::INT % 30 AS rval2, COUNT(*) AS count, SUM(length(foo.tval)) AS sum_len_tval
+  FROM (SELECT 5001 AS jkey, rval, tval FROM small_table ORDER BY dkey LIMIT 3000) foo
+    JOIN small_table USING(jkey)
+  GROUP BY rval2');
+
+-- Redistribute and gather every row
+SELECT ic_check('SELECT * FROM small_table');
+SELECT ic_check('SELECT s1.dkey, s2.dkey AS dkey2, s2.tval FROM small_table s1 JOIN small_table s2 ON s1.jkey = s2.dkey + 5000');
+
+-- Wide rows from many slices
+SELECT ic_check('SELECT jkey % 30 AS jkey2, repeat(''0123456789'', 200) AS digits_string FROM small_table
+  UNION ALL
+  SELECT jkey % 31 AS jkey2, repeat(''9876543210'', 200) AS digits_string FROM small_table');
+
+-- Broadcast
+SELECT ic_check('SELECT foo.jkey, small_table.dkey
+  FROM (SELECT generate_series(5001, 5030) AS jkey FROM small_table) foo
+    JOIN small_table USING(jkey)');
+
+-- Tuples split across many packets
+SELECT ic_check('SELECT jkey, repeat(tval, 20000) AS long_tval
+  FROM (SELECT * FROM small_table ORDER BY dkey LIMIT 20) foo');
+
+-- The sender blocked on a full queue while the receiver consumes slowly
+SET gp_interconnect_snd_queue_depth TO 4096;
+SET gp_interconnect_queue_depth TO 1;
+SELECT ic_check('SELECT s1.dkey, s2.tval FROM small_table s1 JOIN small_table s2 ON s1.jkey = s2.dkey + 5000');
+SET gp_interconnect_snd_queue_depth TO 1;
+SET gp_interconnect_queue_depth TO 4096;
+SELECT ic_check('SELECT s1.dkey, s2.tval FROM small_table s1 JOIN small_table s2 ON s1.jkey = s2.dkey + 5000');
+SET gp_interconnect_snd_queue_depth TO 32;
+SET gp_interconnect_queue_depth TO 32;
+
+-- A LIMIT that stops the senders early
+SET gp_interconnect_batch_io = on;
+SELECT dkey FROM small_table ORDER BY dkey LIMIT 5;
+SELECT COUNT(*) AS count, SUM(length(s2.tval)) AS sum_len_tval
+  FROM small_table s1 JOIN small_table s2 USING(dkey);
+RESET gp_interconnect_batch_io;
+SELECT COUNT(*) AS count, SUM(length(s2.tval)) AS sum_len_tval
+  FROM small_table s1 JOIN small_table s2 USING(dkey);
+
+RESET gp_interconnect_snd_queue_depth;
+RESET gp_interconnect_queue_depth;
+
+DROP FUNCTION ic_check(text);
+DROP TABLE small_table;
+
+RESET search_path;
+DROP SCHEMA ic_batch_test CASCADE;
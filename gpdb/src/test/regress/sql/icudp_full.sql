@@ -364,6 +364,42 @@ SELECT SUM(length(long_tval)) AS sum_len_tval
 SET search_path = ic_udp_test;
 */
 
+-- Batched sends and receives (sendmmsg/recvmmsg): drop transmitted packets
+-- and acks, cut batches short and fail whole batches with EAGAIN and EINTR,
+-- so that the unsent and dropped packets of a batch are retransmitted.
+SET gp_interconnect_batch_io = on;
+SET gp_interconnect_snd_queue_depth TO 32;
+SET gp_interconnect_queue_depth TO 32;
+SET gp_udpic_dropxmit_percent = 10;
+SET gp_udpic_dropacks_percent = 10;
+SET gp_udpic_fault_inject_percent = 30;
+SET gp_udpic_fault_inject_bitmap = 67305472; -- EAGAIN, EINTR, partial batch
+SELECT ROUND(foo.rval * foo.rval)::INT % 30 AS rval2, COUNT(*) AS count, SUM(length(foo.tval)) AS sum_len_tval
+  FROM (SELECT 5001 AS jkey, rval, tval FROM small_table ORDER BY dkey LIMIT 3000) foo
+    JOIN small_table USING(jkey)
+  GROUP BY rval2
+  ORDER BY rval2;
+SELECT SUM(length(long_tval)) AS sum_len_tval
+  FROM (SELECT jkey, repeat(tval, 10000) AS long_tval
+          FROM small_table ORDER BY dkey LIMIT 20) foo
+            JOIN (SELECT * FROM small_table ORDER BY dkey LIMIT 100) bar USING(jkey);
+
+-- the same with one packet per system call
+SET gp_interconnect_batch_io = off;
+SELECT ROUND(foo.rval * foo.rval)::INT % 30 AS rval2, COUNT(*) AS count, SUM(length(foo.tval)) AS sum_len_tval
+  FROM (SELECT 5001 AS jkey, rval, tval FROM small_table ORDER BY dkey LIMIT 3000) foo
+    JOIN small_table USING(jkey)
+  GROUP BY rval2
+  ORDER BY rval2;
+SELECT SUM(length(long_tval)) AS sum_len_tval
+  FROM (SELECT jkey, repeat(tval, 10000) AS long_tval
+          FROM small_table ORDER BY dkey LIMIT 20) foo
+            JOIN (SELECT * FROM small_table ORDER BY dkey LIMIT 100) bar USING(jkey);
+
+RESET gp_interconnect_batch_io;
+RESET gp_interconnect_snd_queue_depth;
+RESET gp_interconnect_queue_depth;
+
 -- Cleanup
 DROP TABLE small_table;
 
@@ -0,0 +1,115 @@
+--
+-- External multi-key sorts whose merge reads each input tape ahead
+-- (gp_mk_sort_readahead_blocks).  With 2MB of work_mem a merge takes at
+-- most six input tapes at a time, and each sort below writes far more than
+-- six runs of 2MB, so it merges in several passes.  Every sort is run with
+-- read-ahead off and on, and must put the rows in the same order.
+--
+set gp_enable_mk_sort = on;
+set optimizer = off;
+
+create table lr_t (id int, k int, t text, pad text) distributed by (id);
+insert into lr_t
+select i, (i * 7919) % 1000, md5((i % 3000)::text), repeat('x', 800) || i
+from generate_series(1, 100000) i;
+analyze lr_t;
+
+-- number the rows of lr_t in the order given, on a single segment, carrying
+-- pad through the sort
+create function lr_sorted(keys text, name text) returns void as $$
+begin
+	execute 'create temp table ' || name || ' as select rn, id, k, t, len from '
+		|| '(select row_number() over (order by ' || keys || ') as rn, id, k, t, '
+		|| 'length(pad) as len from lr_t) x distributed by (rn)';
+end;
+$$ language plpgsql;
+
+create function lr_check(keys text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_mk_sort_readahead_blocks = 0';
+	perform lr_sorted(keys, 'lr_off');
+	execute 'set gp_mk_sort_readahead_blocks = 8';
+	perform lr_sorted(keys, 'lr_on');
+	execute 'set gp_mk_sort_readahead_blocks = 2';
+	perform lr_sorted(keys, 'lr_two');
+	execute 'set gp_mk_sort_readahead_blocks = 1024';
+	perform lr_sorted(keys, 'lr_max');
+	execute 'reset gp_mk_sort_readahead_blocks';
+
+	select count(*) into mismatches
+	from lr_off f
+		 full join lr_on o on f.rn = o.rn
+		 full join lr_two w on f.rn = w.rn
+		 full join lr_max m on f.rn = m.rn
+	where f.id is null or o.id is null or w.id is null or m.id is null
+		  or f.id <> o.id or f.id <> w.id or f.id <> m.id
+		  or f.len <> o.len or f.len <> w.len or f.len <> m.len;
+
+	execute 'drop table lr_off';
+	execute 'drop table lr_on';
+	execute 'drop table lr_two';
+	execute 'drop table lr_max';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- count the plan lines that have the given text
+create function lr_plan_lines(query text, node text) returns int as $$
+declare
+	line text;
+	n int := 0;
+begin
+	for line in execute 'explain analyze ' || query loop
+		if line like '%' || node || '%' then
+			n := n + 1;
+		end if;
+	end loop;
+	return n;
+end;
+$$ language plpgsql;
+
+set work_mem = '2MB';
+
+select lr_plan_lines('select row_number() over (order by k, t, id) as rn, length(pad) from lr_t', 'spilling') > 0 as spilled;
+
+select lr_check('k, t, id');
+select lr_check('t desc, k, id');
+select lr_check('pad, id');
+
+-- the order itself: each row sorts after the one before it
+set gp_mk_sort_readahead_blocks = 8;
+select lr_sorted('k, t, id', 'lr_sorted_rows');
+select count(*) as n, count(distinct id) as ids, sum(len) as len from lr_sorted_rows;
+select count(*) as out_of_order
+from lr_sorted_rows a join lr_sorted_rows b on b.rn = a.rn + 1
+where a.k > b.k or (a.k = b.k and (a.t > b.t or (a.t = b.t and a.id > b.id)));
+drop table lr_sorted_rows;
+
+-- a sort-based aggregate on each segment, merged with read-ahead
+set enable_hashagg = off;
+set gp_mk_sort_readahead_blocks = 0;
+create temp table lr_agg_off as
+	select t, count(*) as n, max(length(pad)) as len from lr_t group by t distributed by (t);
+set gp_mk_sort_readahead_blocks = 8;
+create temp table lr_agg_on as
+	select t, count(*) as n, max(length(pad)) as len from lr_t group by t distributed by (t);
+select count(*) as groups, sum(n) as n from lr_agg_on;
+select count(*) as mismatches from
+	((select * from lr_agg_on except all select * from lr_agg_off)
+	 union all
+	 (select * from lr_agg_off except all select * from lr_agg_on)) x;
+reset enable_hashagg;
+
+reset gp_mk_sort_readahead_blocks;
+reset work_mem;
+reset optimizer;
+reset gp_enable_mk_sort;
+
+drop table lr_agg_on;
+drop table lr_agg_off;
+drop function lr_plan_lines(text, text);
+drop function lr_check(text);
+drop function lr_sorted(text, text);
+drop table lr_t;
@@ -0,0 +1,104 @@
+--
+-- Radix sort of normalized keys in the multi-key sort
+-- (gp_enable_mk_radix_sort) must order rows exactly like the comparator.
+-- Each query is run with the radix pass on and off, numbering the rows in
+-- sort order, and the keys at each position are compared.  Only the keys are
+-- compared, so that ties may come out in either order.
+--
+-- text keys are only radix sorted under the C collation; elsewhere the
+-- text cases still check the comparator path.
+--
+set gp_enable_mk_sort = on;
+
+create table radix_src (id int, i2 int2, i4 int4, i8 int8, f4 float4, f8 float8,
+						d date, ts timestamp, t text, c char(12))
+distributed by (id);
+
+insert into radix_src
+select i,
+	   (i * 7919) % 601 - 300,
+	   (i * 104729) % 20011 - 10000,
+	   ((i * 104729) % 20011 - 10000)::int8 * 4000000000,
+	   ((i * 7919) % 601 - 300) / 7.0,
+	   ((i * 104729) % 20011 - 10000) / 3.0,
+	   date '2000-01-01' + (i * 7919) % 3001,
+	   timestamp '2000-01-01' + ((i * 104729) % 20011) * interval '1 minute',
+	   -- equal 8-byte prefixes that differ further on, and short strings
+	   case when i % 3 = 0 then 'prefix__' || (i * 7919) % 997
+			when i % 3 = 1 then 'prefix__'
+			else chr(65 + i % 26) || (i % 7) end,
+	   case when i % 2 = 0 then 'abcdefgh' || i % 5 else 'ab' || i % 11 end
+from generate_series(1, 5000) i;
+
+-- NULLs, -0, NaN and infinities
+insert into radix_src values
+	(5001, null, null, null, null, null, null, null, null, null),
+	(5002, null, null, null, null, null, null, null, null, null),
+	(5003, 0, 0, 0, '-0', '-0', null, null, '', ''),
+	(5004, 0, 0, 0, '0', '0', null, null, '', ''),
+	(5005, -32768, -2147483648, -9223372036854775808, 'NaN', 'NaN', '4713-01-01 BC', '-infinity', 'prefix_', 'prefix_'),
+	(5006, 32767, 2147483647, 9223372036854775807, 'Infinity', 'Infinity', '5874897-12-31', 'infinity', 'prefix__~', 'prefix__~'),
+	(5007, 1, 1, 1, '-Infinity', '-Infinity', '2000-01-01', '2000-01-01', 'prefix__', 'prefix__'),
+	(5008, -1, -1, -1, 'NaN', 'NaN', '2000-01-01', '2000-01-01', 'prefix__', 'prefix__');
+
+-- Sort radix_src by the given keys, with and without the radix pass
+create function radix_check(keys text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_enable_mk_radix_sort = on';
+	execute 'create temp table radix_on as select row_number() over (order by ' || keys
+		|| ') as rn, * from radix_src distributed by (rn)';
+	execute 'set gp_enable_mk_radix_sort = off';
+	execute 'create temp table radix_off as select row_number() over (order by ' || keys
+		|| ') as rn, * from radix_src distributed by (rn)';
+	execute 'reset gp_enable_mk_radix_sort';
+
+	execute 'select count(*) from radix_on a full join radix_off b on a.rn = b.rn where not ('
+		|| 'a.rn is not null and b.rn is not null and '
+		|| '(a.i2 = b.i2 or (a.i2 is null and b.i2 is null)) and '
+		|| '(a.i4 = b.i4 or (a.i4 is null and b.i4 is null)) and '
+		|| '(a.i8 = b.i8 or (a.i8 is null and b.i8 is null)) and '
+		|| '(a.f4 = b.f4 or (a.f4 is null and b.f4 is null)) and '
+		|| '(a.f8 = b.f8 or (a.f8 is null and b.f8 is null)) and '
+		|| '(a.d = b.d or (a.d is null and b.d is null)) and '
+		|| '(a.ts = b.ts or (a.ts is null and b.ts is null)) and '
+		|| '(a.t = b.t or (a.t is null and b.t is null)) and '
+		|| '(a.c = b.c or (a.c is null and b.c is null)))'
+	into mismatches;
+
+	execute 'drop table radix_on';
+	execute 'drop table radix_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- ties are compared on every column above, so break them on the rest
+select radix_check('i2, i4, i8, f4, f8, d, ts, t, c');
+select radix_check('i4 desc, i2, i8, f4, f8, d, ts, t, c');
+select radix_check('i8 nulls first, i2, i4, f4, f8, d, ts, t, c');
+select radix_check('i2 desc nulls last, i4, i8, f4, f8, d, ts, t, c');
+
+-- -0 equals 0, NaN sorts above infinity
+select radix_check('f4, i2, i4, i8, f8, d, ts, t, c');
+select radix_check('f8 desc, i2, i4, i8, f4, d, ts, t, c');
+select radix_check('f8 nulls first, f4 desc nulls last, i2, i4, i8, d, ts, t, c');
+
+select radix_check('d, ts, i2, i4, i8, f4, f8, t, c');
+select radix_check('ts desc, d desc, i2, i4, i8, f4, f8, t, c');
+
+-- text with equal prefixes goes back to the comparator, char ignores trailing blanks
+select radix_check('t, i2, i4, i8, f4, f8, d, ts, c');
+select radix_check('t desc nulls last, c, i2, i4, i8, f4, f8, d, ts');
+select radix_check('c, t, i2, i4, i8, f4, f8, d, ts');
+select radix_check('c desc, t desc, i2, i4, i8, f4, f8, d, ts');
+
+-- the edge values in sort order; -0 and 0 tie, so id orders them
+set gp_enable_mk_radix_sort = on;
+select f8, i4 from radix_src where id > 5000 order by f8, i4, id;
+select f8, i4 from radix_src where id > 5000 order by f8 desc nulls last, i4, id;
+select t, c from radix_src where id > 5000 order by t nulls first, c, id;
+reset gp_enable_mk_radix_sort;
+
+drop function radix_check(text);
+drop table radix_src;
@@ -0,0 +1,140 @@
+--
+-- Redistribute and broadcast motions that send their rows in column-major
+-- batches (gp_enable_motion_batch), plain and lz4-compressed
+-- (gp_motion_batch_compress).  Every query is run with one tuple at a time,
+-- with batches and with compressed batches, and must return the same rows.
+--
+create table mb_src (id int, k int, i2 int2, i8 int8, f float8, n numeric,
+					 b bool, d date, ts timestamp, c char(5), nm name,
+					 t text, ba bytea, arr int[])
+distributed by (id);
+create table mb_small (v int, label text) distributed by (label);
+create table mb_wide (id int, k int, t text, te text) distributed by (id);
+alter table mb_wide alter column te set storage external;
+
+-- k is a permutation of id, so joining on it moves every row; each column
+-- has NULLs at its own interval, and every 1000th row is all NULLs but for
+-- id and k
+insert into mb_src
+select i, (i * 7) % 20000 + 1,
+	   case when i % 1000 = 0 or i % 3 = 0 then null else i % 30000 end,
+	   case when i % 1000 = 0 or i % 4 = 0 then null else i * 100000000::int8 end,
+	   case when i % 1000 = 0 or i % 6 = 0 then null else i / 7.0 end,
+	   case when i % 1000 = 0 or i % 5 = 0 then null else i * 1.25 end,
+	   case when i % 1000 = 0 or i % 9 = 0 then null else i % 2 = 0 end,
+	   case when i % 1000 = 0 or i % 8 = 0 then null else date '2000-01-01' + i end,
+	   case when i % 1000 = 0 or i % 10 = 0 then null else timestamp '2000-01-01' + i * interval '1 minute' end,
+	   case when i % 1000 = 0 or i % 11 = 0 then null else (i % 100)::text end,
+	   case when i % 1000 = 0 or i % 12 = 0 then null else ('n' || i)::name end,
+	   case when i % 1000 = 0 or i % 7 = 0 then null else repeat('t', i % 300) || i end,
+	   case when i % 1000 = 0 or i % 13 = 0 then null else decode(md5(i::text), 'hex') end,
+	   case when i % 1000 = 0 or i % 14 = 0 then null else array[i, i + 1, i % 17] end
+from generate_series(1, 20000) i;
+
+insert into mb_small select v, 'l' || v from generate_series(0, 9) v;
+
+-- values well over a chunk: t is compressed in line, te is stored out of
+-- line uncompressed, and some rows have short values or NULLs in between
+insert into mb_wide
+select i, i * 3 % 40 + 1, repeat('abcdefgh', 10000),
+	   (select string_agg(md5(i::text || j::text), '') from generate_series(1, 1250) j)
+from generate_series(1, 20) i;
+insert into mb_wide
+select 20 + i, i, case when i % 2 = 0 then null else 'short' || i end,
+	   case when i % 3 = 0 then null else md5(i::text) end
+from generate_series(1, 20) i;
+
+analyze mb_src;
+analyze mb_small;
+analyze mb_wide;
+
+set optimizer = off;
+set enable_nestloop = off;
+set enable_mergejoin = off;
+
+create function mb_check(query text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_enable_motion_batch = off';
+	execute 'create temp table mb_off as ' || query || ' distributed randomly';
+	execute 'set gp_enable_motion_batch = on';
+	execute 'set gp_motion_batch_compress = off';
+	execute 'create temp table mb_on as ' || query || ' distributed randomly';
+	execute 'set gp_motion_batch_compress = on';
+	execute 'create temp table mb_lz4 as ' || query || ' distributed randomly';
+	execute 'reset gp_motion_batch_compress';
+	execute 'reset gp_enable_motion_batch';
+
+	select count(*) into mismatches from
+		((select * from mb_on except all select * from mb_off)
+		 union all
+		 (select * from mb_off except all select * from mb_on)
+		 union all
+		 (select * from mb_lz4 except all select * from mb_off)
+		 union all
+		 (select * from mb_off except all select * from mb_lz4)) x;
+
+	execute 'drop table mb_off';
+	execute 'drop table mb_on';
+	execute 'drop table mb_lz4';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- count the plan lines that have the given text
+create function mb_plan_lines(query text, node text) returns int as $$
+declare
+	line text;
+	n int := 0;
+begin
+	for line in execute 'explain ' || query loop
+		if line like '%' || node || '%' then
+			n := n + 1;
+		end if;
+	end loop;
+	return n;
+end;
+$$ language plpgsql;
+
+select mb_plan_lines('select a.*, b.id as bid from mb_src a join mb_src b on a.k = b.id', 'Redistribute Motion') > 0 as redistribute;
+select mb_plan_lines('select a.*, s.label from mb_src a join mb_small s on a.i2 % 10 = s.v', 'Broadcast Motion') > 0 as broadcast;
+select mb_plan_lines('select w.*, s.id as sid from mb_wide w join mb_src s on w.k = s.id', 'Redistribute Motion') +
+	   mb_plan_lines('select w.*, s.id as sid from mb_wide w join mb_src s on w.k = s.id', 'Broadcast Motion') > 0 as moved;
+
+-- every type, with NULLs, through a redistribute and a broadcast
+select mb_check('select a.*, b.id as bid from mb_src a join mb_src b on a.k = b.id');
+select mb_check('select a.*, s.label from mb_src a join mb_small s on a.i2 % 10 = s.v');
+select mb_check('select a.id, null::text as nt, a.n, null::int as ni, a.t from mb_src a join mb_src b on a.k = b.id');
+select mb_check('select a.id, a.b, a.d from mb_src a join mb_src b on a.k = b.id where a.id % 1000 = 0');
+
+-- wide, compressed and out-of-line values, each over a chunk, and NULLs
+select mb_check('select w.*, s.id as sid from mb_wide w join mb_src s on w.k = s.id');
+select mb_check('select w.id, w.te, s.label from mb_wide w join mb_small s on w.k % 10 = s.v');
+
+-- the same rows, counted
+set gp_enable_motion_batch = on;
+select count(*), count(a.t) as t, count(a.n) as n, count(a.nm) as nm
+from mb_src a join mb_src b on a.k = b.id;
+select count(*), sum(length(w.t)) as t, sum(length(w.te)) as te
+from mb_wide w join mb_src s on w.k = s.id;
+set gp_motion_batch_compress = on;
+select count(*), count(a.t) as t, count(a.n) as n, count(a.nm) as nm
+from mb_src a join mb_src b on a.k = b.id;
+select count(*), sum(length(w.t)) as t, sum(length(w.te)) as te
+from mb_wide w join mb_src s on w.k = s.id;
+
+-- a receiver that stops before the senders have sent all their batches
+select a.id from mb_src a join mb_src b on a.k = b.id order by a.id limit 3;
+reset gp_motion_batch_compress;
+reset gp_enable_motion_batch;
+
+reset enable_mergejoin;
+reset enable_nestloop;
+reset optimizer;
+
+drop function mb_plan_lines(text, text);
+drop function mb_check(text);
+drop table mb_wide;
+drop table mb_small;
+drop table mb_src;
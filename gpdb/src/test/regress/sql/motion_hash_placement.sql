@@ -0,0 +1,86 @@
+--
+-- Rows sent by a redistribute motion must land on the segment that a
+-- single-row INSERT of the same constants is dispatched to.  The motion
+-- hashes with per-type functions looked up once per key, and reduces the
+-- hash to a segment without a division; the single-row INSERT is routed by
+-- the planner with cdbhash().
+--
+set optimizer = off;
+
+create domain hp_dom as int;
+
+-- cols and keys are the column list and distribution key of the tables;
+-- vals is an expression of i that is the text of one row's values.  Returns
+-- -1 if the rows were not moved by a redistribute motion.
+create function hp_check(cols text, keys text, vals text, n int) returns bigint as $$
+declare
+	row_vals text;
+	line text;
+	redistributed bool := false;
+	mismatches bigint;
+begin
+	execute 'create table hp_direct (' || cols || ') distributed by (' || keys || ')';
+	execute 'create table hp_src (' || cols || ') distributed randomly';
+	execute 'create table hp_moved (' || cols || ') distributed by (' || keys || ')';
+
+	for row_vals in execute 'select ' || vals || ' from generate_series(1, ' || n || ') i' loop
+		execute 'insert into hp_direct values (' || row_vals || ')';
+	end loop;
+
+	execute 'insert into hp_src select * from hp_direct';
+	for line in execute 'explain insert into hp_moved select * from hp_src' loop
+		if line like '%Redistribute Motion%' then
+			redistributed := true;
+		end if;
+	end loop;
+	execute 'insert into hp_moved select * from hp_src';
+
+	execute 'select count(*) from
+		((select *, gp_segment_id from hp_direct except all select *, gp_segment_id from hp_moved)
+		 union all
+		 (select *, gp_segment_id from hp_moved except all select *, gp_segment_id from hp_direct)) x'
+	into mismatches;
+
+	execute 'drop table hp_direct';
+	execute 'drop table hp_src';
+	execute 'drop table hp_moved';
+	if not redistributed then
+		return -1;
+	end if;
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- a literal of val, or null, cast to typ
+create function hp_lit(val text, typ text) returns text as $$
+	select coalesce(quote_literal($1), 'null') || '::' || $2;
+$$ language sql;
+
+select hp_check('k int2', 'k', $$hp_lit(case when i % 17 = 0 then null else ((i * 331) % 32000 - 16000)::text end, 'int2')$$, 100);
+select hp_check('k int4', 'k', $$hp_lit(case when i % 17 = 0 then null else (i * 104729 - 5000000)::text end, 'int4')$$, 100);
+select hp_check('k int8', 'k', $$hp_lit(case when i % 17 = 0 then null else (i * 1000000007::int8)::text end, 'int8')$$, 100);
+select hp_check('k float8', 'k', $$hp_lit((i / 7.0 - 3)::text, 'float8')$$, 100);
+select hp_check('k numeric', 'k', $$hp_lit((i * 12.345 - 100)::text, 'numeric')$$, 100);
+select hp_check('k text', 'k', $$hp_lit(case when i % 17 = 0 then null else md5(i::text) end, 'text')$$, 100);
+select hp_check('k varchar(40)', 'k', $$hp_lit(repeat('v', i % 30) || i::text, 'varchar')$$, 100);
+select hp_check('k char(8)', 'k', $$hp_lit('c' || i::text, 'char(8)')$$, 100);
+select hp_check('k bytea', 'k', $$hp_lit(md5(i::text), 'bytea')$$, 100);
+select hp_check('k date', 'k', $$hp_lit((date '2000-01-01' + i * 37)::text, 'date')$$, 100);
+select hp_check('k timestamp', 'k', $$hp_lit((timestamp '2000-01-01' + i * interval '97 minutes')::text, 'timestamp')$$, 100);
+select hp_check('k interval', 'k', $$hp_lit((i * interval '1 day 3 hours')::text, 'interval')$$, 100);
+select hp_check('k bool', 'k', $$hp_lit(case when i % 3 = 0 then null when i % 2 = 0 then 'true' else 'false' end, 'bool')$$, 30);
+select hp_check('k inet', 'k', $$hp_lit('10.0.' || (i / 256)::text || '.' || (i % 256)::text, 'inet')$$, 100);
+select hp_check('k int[]', 'k', $$hp_lit('{' || i::text || ',' || (i * 2)::text || '}', 'int[]')$$, 100);
+select hp_check('k hp_dom', 'k', $$hp_lit((i * 7919)::text, 'hp_dom')$$, 100);
+
+-- keys of several columns
+select hp_check('a int4, b text, c date', 'a, b, c',
+				$$hp_lit((i % 10)::text, 'int4') || ', ' || hp_lit('b' || (i % 7)::text, 'text') || ', ' || hp_lit((date '2010-01-01' + i)::text, 'date')$$, 100);
+select hp_check('a int8, b numeric, v text', 'b, a',
+				$$hp_lit(i::text, 'int8') || ', ' || hp_lit(case when i % 5 = 0 then null else (i / 3.0)::text end, 'numeric') || ', ' || hp_lit('v', 'text')$$, 100);
+
+reset optimizer;
+
+drop function hp_lit(text, text);
+drop function hp_check(text, text, text, int);
+drop domain hp_dom;
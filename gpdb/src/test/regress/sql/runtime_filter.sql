@@ -0,0 +1,129 @@
+--
+-- Runtime join filters built by a hash join's Hash node and applied by the
+-- scan on its probe side (gp_hashjoin_runtime_filter).  Every join is run
+-- with the filters on and off, and must return the same rows; a sequence
+-- called from the probe scan's qual counts the rows the filter lets
+-- through, to see whether it was applied.
+--
+create table rf_dim (k int, v int) distributed by (k);
+create table rf_fact (id int, k int, amt int) distributed by (k);
+create table rf_part (id int, k int, amt int, p int) distributed by (k)
+partition by range (p) (start (0) end (10) every (2));
+
+-- fact keys that the dimension does not have, and NULL keys on both sides
+insert into rf_dim select k, k % 100 from generate_series(1, 2000) k;
+insert into rf_dim values (null, 1), (null, 2);
+insert into rf_fact
+select i, case when i % 101 = 0 then null else i % 3000 end, i % 7
+from generate_series(1, 50000) i;
+insert into rf_part select id, k, amt, id % 10 from rf_fact;
+analyze rf_dim;
+analyze rf_fact;
+analyze rf_part;
+
+set optimizer = off;
+set enable_nestloop = off;
+set enable_mergejoin = off;
+
+create function rf_check(query text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_hashjoin_runtime_filter = on';
+	execute 'create temp table rf_on as ' || query || ' distributed randomly';
+	execute 'set gp_hashjoin_runtime_filter = off';
+	execute 'create temp table rf_off as ' || query || ' distributed randomly';
+	execute 'reset gp_hashjoin_runtime_filter';
+
+	select count(*) into mismatches from
+		((select * from rf_on except all select * from rf_off)
+		 union all
+		 (select * from rf_off except all select * from rf_on)) x;
+
+	execute 'drop table rf_on';
+	execute 'drop table rf_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- the probe-side qual of the query must call nextval('rf_read') once for
+-- each row that reaches it
+create sequence rf_read;
+
+create function rf_rows_read(query text) returns bigint as $$
+declare
+	before bigint;
+	after bigint;
+	n bigint;
+begin
+	before := nextval('rf_read');
+	execute query into n;
+	after := nextval('rf_read');
+	return after - before - 1;
+end;
+$$ language plpgsql;
+
+-- applied: an inner join, and an IN join, on a selective dimension
+set gp_hashjoin_runtime_filter = on;
+select rf_rows_read('select count(*) from rf_fact f join rf_dim d on f.k = d.k
+					 where f.amt + nextval(''rf_read'') > 0 and d.v = 1') < 25000 as filtered;
+select rf_rows_read('select count(*) from rf_fact f
+					 where f.amt + nextval(''rf_read'') > 0
+					   and f.k in (select k from rf_dim where v = 1)') < 25000 as filtered;
+
+-- skipped: a left join, and the GUC off
+select rf_rows_read('select count(*) from rf_fact f left join rf_dim d on f.k = d.k and d.v = 1
+					 where f.amt + nextval(''rf_read'') > 0') as rows_read;
+set gp_hashjoin_runtime_filter = off;
+select rf_rows_read('select count(*) from rf_fact f join rf_dim d on f.k = d.k
+					 where f.amt + nextval(''rf_read'') > 0 and d.v = 1') as rows_read;
+reset gp_hashjoin_runtime_filter;
+
+-- inner and IN joins, where filters are built
+select rf_check('select f.id, d.v from rf_fact f join rf_dim d on f.k = d.k where d.v = 1');
+select rf_check('select f.id, d.v from rf_fact f join rf_dim d on f.k = d.k where d.v < 50');
+select rf_check('select f.id, d.v from rf_fact f join rf_dim d on f.k = d.k');
+select rf_check('select f.id from rf_fact f where f.k in (select k from rf_dim where v in (3, 7))');
+select rf_check('select f.id from rf_fact f join rf_dim d on f.k = d.k and f.amt = d.v % 7 where d.v > 90');
+
+-- and joins where they are not: outer and anti joins, and NULL keys
+select rf_check('select f.id, d.v from rf_fact f left join rf_dim d on f.k = d.k and d.v = 1');
+select rf_check('select f.id from rf_fact f where not exists (select 1 from rf_dim d where d.k = f.k and d.v = 1)');
+select rf_check('select f.id, d.v from rf_fact f join rf_dim d on f.k = d.k where d.k is null or d.v = 2');
+select rf_check('select f.id, d.v from rf_fact f join rf_dim d on f.k = d.k where f.k is null');
+
+-- rescans of the join, with a new parameter on the build side each time
+create table rf_params (v int) distributed by (v);
+insert into rf_params values (1), (2), (50), (99), (100);
+select rf_check('select p.v, (select count(*) from rf_fact f join rf_dim d on f.k = d.k where d.v = p.v) as n from rf_params p');
+select rf_check('select p.v, (select count(*) from rf_fact f join rf_dim d on f.k = d.k where d.v = p.v and f.amt = p.v % 7) as n from rf_params p');
+
+-- partitioned probe sides, planned as appended scans and as a dynamic scan
+select rf_check('select f.id, d.v from rf_part f join rf_dim d on f.k = d.k where d.v = 1');
+select rf_check('select f.id, d.v from rf_part f join rf_dim d on f.k = d.k where d.v = 1 and f.p < 4');
+set optimizer = on;
+select rf_check('select f.id, d.v from rf_part f join rf_dim d on f.k = d.k where d.v = 1');
+select rf_check('select f.id, d.v from rf_part f join rf_dim d on f.k = d.k where d.v = 1 and f.p < 4');
+select rf_check('select f.id from rf_part f where f.k in (select k from rf_dim where v in (3, 7))');
+set optimizer = off;
+
+-- the results themselves
+set gp_hashjoin_runtime_filter = on;
+select count(*) from rf_fact f join rf_dim d on f.k = d.k where d.v = 1;
+select count(*) from rf_fact f left join rf_dim d on f.k = d.k and d.v = 1;
+select count(*) from rf_part f join rf_dim d on f.k = d.k where d.v = 1 and f.p < 4;
+select p.v, (select count(*) from rf_fact f join rf_dim d on f.k = d.k where d.v = p.v) as n
+from rf_params p order by p.v;
+reset gp_hashjoin_runtime_filter;
+
+reset enable_mergejoin;
+reset enable_nestloop;
+reset optimizer;
+
+drop function rf_rows_read(text);
+drop function rf_check(text);
+drop sequence rf_read;
+drop table rf_params;
+drop table rf_part;
+drop table rf_fact;
+drop table rf_dim;
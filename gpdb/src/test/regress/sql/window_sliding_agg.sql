@@ -0,0 +1,87 @@
+--
+-- Window aggregates with a preliminary function but no inverse one (min,
+-- max and the like) keep a sliding-window state of partial values when
+-- gp_enable_sliding_window_agg is on.  Each window expression is computed
+-- with the GUC on and off, and the value on every row must be the same.
+--
+create table slide_src (id int, part int, o int, i int, f float8, t text)
+distributed by (id);
+
+insert into slide_src
+select g, g % 3, g / 3,
+	   case when g % 7 = 0 then null else (g * 7919) % 1009 - 500 end,
+	   case when g % 11 = 0 then null else ((g * 104729) % 20011) / 3.0 end,
+	   case when g % 5 = 0 then null else chr(65 + g % 26) || g % 13 end
+from generate_series(1, 3000) g;
+
+-- a partition with nothing but NULLs
+insert into slide_src
+select 3000 + g, 3, g, null, null, null from generate_series(1, 20) g;
+
+-- concatenation is associative but not commutative, so it also checks that
+-- the partial values are combined in frame order
+create aggregate slide_concat(text) (
+	sfunc = textcat, prefunc = textcat, stype = text, initcond = ''
+);
+
+create function slide_check(win text) returns bigint as $$
+declare
+	mismatches bigint;
+begin
+	execute 'set gp_enable_sliding_window_agg = on';
+	execute 'create temp table slide_on as select id, (' || win
+		|| ')::text as v from slide_src distributed by (id)';
+	execute 'set gp_enable_sliding_window_agg = off';
+	execute 'create temp table slide_off as select id, (' || win
+		|| ')::text as v from slide_src distributed by (id)';
+	execute 'reset gp_enable_sliding_window_agg';
+
+	select count(*) into mismatches
+	from slide_on a full join slide_off b on a.id = b.id
+	where a.id is null or b.id is null or a.v is distinct from b.v;
+
+	execute 'drop table slide_on';
+	execute 'drop table slide_off';
+	return mismatches;
+end;
+$$ language plpgsql;
+
+-- ROWS frames on both sides of the current row
+select slide_check('min(i) over (partition by part order by o, id rows between 1 preceding and 2 following)');
+select slide_check('max(f) over (partition by part order by o, id rows between 1 preceding and 2 following)');
+select slide_check('slide_concat(t) over (partition by part order by o, id rows between 1 preceding and 2 following)');
+select slide_check('max(t) over (order by id rows between 5 preceding and 5 following)');
+
+-- UNBOUNDED PRECEDING
+select slide_check('min(i) over (partition by part order by o, id rows between unbounded preceding and 3 following)');
+select slide_check('slide_concat(t) over (partition by part order by o, id rows between unbounded preceding and 1 preceding)');
+
+-- frames that are empty for some rows, at either end of a partition
+select slide_check('max(i) over (partition by part order by o, id rows between 3 preceding and 1 preceding)');
+select slide_check('min(f) over (partition by part order by o, id rows between 2 following and 4 following)');
+select slide_check('slide_concat(t) over (partition by part order by o, id rows between 10 following and 12 following)');
+
+-- RANGE frames, where the edges move by peer groups
+select slide_check('max(i) over (partition by part order by o range between 2 preceding and 1 following)');
+select slide_check('slide_concat(t) over (partition by part order by o range between 1 following and 3 following)');
+
+-- several functions on one level, only some of them using the state
+select slide_check('array[min(i) over (partition by part order by o, id rows between 2 preceding and 2 following), '
+				   'sum(i) over (partition by part order by o, id rows between 2 preceding and 2 following), '
+				   'count(t) over (partition by part order by o, id rows between 2 preceding and 2 following)]');
+
+-- a frame whose partial values outgrow the operator memory falls back to
+-- scanning the frame buffer
+set work_mem = '64kB';
+select slide_check('md5(slide_concat(t) over (order by id rows between 2000 preceding and current row))');
+reset work_mem;
+
+-- the same values on a known input
+select id, min(i) over w, max(i) over w, slide_concat(t) over w
+from (values (1, 3, 'a'), (2, null, 'b'), (3, 1, null), (4, 5, 'd'), (5, 2, 'e')) v(id, i, t)
+window w as (order by id rows between 1 preceding and 2 following)
+order by id;
+
+drop function slide_check(text);
+drop aggregate slide_concat(text);
+drop table slide_src;
@@ -119,6 +119,11 @@ namespace gpopt
 			static
 			void BreakCostTiesForJoinPlans(const CCostContext *pccFst, const CCostContext *pccSnd, CONST_COSTCTXT_PTR *ppccPrefered, BOOL *pfTiesResolved);
 
+			// for two cost contexts of the same cost, compare the shapes of their plans, which do not depend
+			// on the order in which search workers costed them; negative if first context is preferred
+			static
+			INT ICmpIndependentOfSearchOrder(const CCostContext *pccFst, const CCostContext *pccSnd);
+
 			// private copy ctor
 			CCostContext(const CCostContext &);
 
@@ -395,6 +395,81 @@ CCostContext::BreakCostTiesForJoinPlans
 }
 
 
+//---------------------------------------------------------------------------
+//	@function:
+//		CCostContext::ICmpIndependentOfSearchOrder
+//
+//	@doc:
+//		Compare two equivalent cost contexts of the same cost on the shape
+//		of their plans: the physical operator, the derived distribution, and
+//		then, child by child, the best plans of the child contexts;
+//		group, group expression and column ids are not used since they
+//		reflect the order in which workers inserted expressions into the
+//		memo and created columns; plans of the same shape compare as equal
+//
+//---------------------------------------------------------------------------
+INT
+CCostContext::ICmpIndependentOfSearchOrder
+	(
+	const CCostContext *pccFst,
+	const CCostContext *pccSnd
+	)
+{
+	GPOS_ASSERT(NULL != pccFst);
+	GPOS_ASSERT(NULL != pccSnd);
+
+	GPOS_CHECK_STACK_SIZE;
+
+	if (pccFst == pccSnd)
+	{
+		return 0;
+	}
+
+	ULONG ulOpFst = (ULONG) pccFst->Pgexpr()->Pop()->Eopid();
+	ULONG ulOpSnd = (ULONG) pccSnd->Pgexpr()->Pop()->Eopid();
+	if (ulOpFst != ulOpSnd)
+	{
+		return (ulOpFst < ulOpSnd) ? -1 : 1;
+	}
+
+	ULONG ulDistrFst = (ULONG) pccFst->Pdpplan()->Pds()->Edt();
+	ULONG ulDistrSnd = (ULONG) pccSnd->Pdpplan()->Pds()->Edt();
+	if (ulDistrFst != ulDistrSnd)
+	{
+		return (ulDistrFst < ulDistrSnd) ? -1 : 1;
+	}
+
+	DrgPoc *pdrgpocFst = pccFst->Pdrgpoc();
+	DrgPoc *pdrgpocSnd = pccSnd->Pdrgpoc();
+	const ULONG ulChildrenFst = (NULL == pdrgpocFst) ? 0 : pdrgpocFst->UlLength();
+	const ULONG ulChildrenSnd = (NULL == pdrgpocSnd) ? 0 : pdrgpocSnd->UlLength();
+	if (ulChildrenFst != ulChildrenSnd)
+	{
+		return (ulChildrenFst < ulChildrenSnd) ? -1 : 1;
+	}
+
+	for (ULONG ul = 0; ul < ulChildrenFst; ul++)
+	{
+		// child groups are done optimizing before their parent is costed,
+		// so their best contexts no longer change
+		CCostContext *pccChildFst = (*pdrgpocFst)[ul]->PccBest();
+		CCostContext *pccChildSnd = (*pdrgpocSnd)[ul]->PccBest();
+		if (NULL == pccChildFst || NULL == pccChildSnd)
+		{
+			continue;
+		}
+
+		INT iCmp = ICmpIndependentOfSearchOrder(pccChildFst, pccChildSnd);
+		if (0 != iCmp)
+		{
+			return iCmp;
+		}
+	}
+
+	return 0;
+}
+
+
 //---------------------------------------------------------------------------
 //	@function:
 //		CCostContext::FBetterThan
@@ -462,6 +537,16 @@ CCostContext::FBetterThan
 		}
 	}
 
+	// RULE 4: with several search workers, equivalent plans reach this point
+	// in an arbitrary order; break the remaining ties on the shape of the
+	// plans, so that equal-cost plans of different shapes are picked the same
+	// way on every run; plans of the same shape still keep whichever was
+	// costed first
+	if (GPOS_FTRACE(EopttraceParallel))
+	{
+		return (0 > ICmpIndependentOfSearchOrder(this, pcc));
+	}
+
 	return false;
 }
 
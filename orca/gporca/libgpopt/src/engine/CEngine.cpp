@@ -1682,7 +1682,10 @@ CEngine::Optimize()
 
 	if (GPOS_FTRACE(EopttraceParallel))
 	{
-		MultiThreadedOptimize(2 /*ulWorkers*/);
+		// the task running the optimizer occupies one worker of the pool
+		// while waiting for the search tasks, use the rest for searching
+		ULONG ulWorkersMax = CWorkerPoolManager::Pwpm()->UlWorkersMax();
+		MultiThreadedOptimize(ulWorkersMax > 1 ? ulWorkersMax - 1 : 1);
 	}
 	else
 	{
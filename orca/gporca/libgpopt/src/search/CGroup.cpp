@@ -318,13 +318,11 @@ CGroup::UpdateBestCost
 {
 	GPOS_ASSERT(CCostContext::estCosted == pcc->Est());
 
-	COptimizationContext *pocFound  = NULL;
-	
-	{
-		// scope for accessor
-		ShtAcc shta(Sht(), *poc);
-		pocFound = shta.PtLookup();
-	}
+	// several workers may cost group expressions of this group under the
+	// same context concurrently; keep the accessor while comparing and
+	// updating the best context so that a better context is never lost
+	ShtAcc shta(Sht(), *poc);
+	COptimizationContext *pocFound = shta.PtLookup();
 
 	GPOS_ASSERT(NULL != pocFound);
 
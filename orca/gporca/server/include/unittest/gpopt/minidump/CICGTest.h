@@ -48,6 +48,10 @@ namespace gpopt
 			static
 			ULONG m_ulNegativeIndexApplyTestCounter;
 
+			// counter used to mark last successful test with several search workers
+			static
+			ULONG m_ulParallelTestCounter;
+
 			// counter to mark last successful test for has joins versus index joins
 			static ULONG m_ulTestCounterPreferHashJoinToIndexJoin;
 
@@ -91,6 +95,9 @@ namespace gpopt
 			static
 			GPOS_RESULT EresUnittest_NegativeIndexApplyTests();
 
+			static
+			GPOS_RESULT EresUnittest_RunParallelMinidumpTests();
+
 			// test that hash join is preferred versus index join when estimation risk is high
 			static
 			GPOS_RESULT EresUnittest_PreferHashJoinVersusIndexJoinWhenRiskIsHigh();
@@ -17,6 +17,7 @@
 //---------------------------------------------------------------------------
 
 #include "gpos/task/CAutoTraceFlag.h"
+#include "gpos/task/CWorkerPoolManager.h"
 
 #include "gpopt/base/CAutoOptCtxt.h"
 #include "gpopt/exception.h"
@@ -42,6 +43,7 @@ ULONG CICGTest::m_ulUnsupportedTestCounter = 0; // start from first unsupported
 ULONG CICGTest::m_ulTestCounterPreferHashJoinToIndexJoin = 0;
 ULONG CICGTest::m_ulTestCounterPreferIndexJoinToHashJoin = 0;
 ULONG CICGTest::m_ulNegativeIndexApplyTestCounter = 0;
+ULONG CICGTest::m_ulParallelTestCounter = 0;
 
 // minidump files
 const CHAR *rgszFileNames[] =
@@ -269,6 +271,17 @@ const CHAR *rgszNegativeIndexApplyFileNames[] =
 		"../data/dxl/minidump/Negative-IndexApply2.mdp",
 	};
 
+// minidump files optimized with several search workers; their plans depend on
+// breaking ties between equal-cost plans the same way whatever the order in which
+// the workers cost them
+const CHAR *rgszParallelFileNames[] =
+	{
+		"../data/dxl/minidump/ExpandJoinOrder.mdp",
+		"../data/dxl/minidump/EqualityJoin.mdp",
+		"../data/dxl/minidump/InnerJoin-With-OuterRefs.mdp",
+		"../data/dxl/minidump/FullOuterJoin.mdp",
+	};
+
 // index join penalization tests
 const CHAR *rgszPreferHashJoinVersusIndexJoin[] =
 		{
@@ -299,6 +312,7 @@ CICGTest::EresUnittest()
 		// keep test for testing partially supported operators/xforms
 		GPOS_UNITTEST_FUNC(CICGTest::EresUnittest_RunUnsupportedMinidumpTests),
 		GPOS_UNITTEST_FUNC(CICGTest::EresUnittest_NegativeIndexApplyTests),
+		GPOS_UNITTEST_FUNC(CICGTest::EresUnittest_RunParallelMinidumpTests),
 
 #ifndef GPOS_DEBUG
 		// This test is slow in debug build because it has to free a lot of memory structures
@@ -335,6 +349,61 @@ CICGTest::EresUnittest_RunMinidumpTests()
 }
 
 
+//---------------------------------------------------------------------------
+//	@function:
+//		CICGTest::EresUnittest_RunParallelMinidumpTests
+//
+//	@doc:
+//		Run Minidump-based tests with the search spread over several
+//		workers; the plans must match the ones of a serial search
+//
+//---------------------------------------------------------------------------
+GPOS_RESULT
+CICGTest::EresUnittest_RunParallelMinidumpTests()
+{
+	// the engine searches on all but one of the workers in the pool
+	GPOS_ASSERT(2 < CWorkerPoolManager::Pwpm()->UlWorkersMax());
+
+	CAutoTraceFlag atf1(EopttraceParallel, true /*fVal*/);
+
+	// same settings as the serial runs of these minidumps
+	CAutoTraceFlag atf2(EopttraceEnableRedistributeBroadcastHashJoin, true /*fVal*/);
+	CAutoTraceFlag atf3(EopttraceEnumeratePlans, true /*fVal*/);
+	CAutoTraceFlag atf4(EopttraceDeriveStatsForDPE, true /*fVal*/);
+	CAutoTraceFlag atf5(EopttracePreferExpandedMDQAs, true /*fVal*/);
+
+	GPOS_RESULT eres = GPOS_OK;
+	const ULONG ulTests = GPOS_ARRAY_SIZE(rgszParallelFileNames);
+	for (ULONG ul = m_ulParallelTestCounter; GPOS_OK == eres && ul < ulTests; ul++)
+	{
+		CAutoMemoryPool amp;
+		IMemoryPool *pmp = amp.Pmp();
+		ULONG ulFileCounter = 0;
+
+		// workers exploring the same group concurrently may each count the
+		// alternatives they add, so the plan space can only be expected to be
+		// at least as large as the one of the serial search
+		eres = CTestUtils::EresRunMinidumpsUsingOneMDFile
+				(
+				pmp,
+				rgszParallelFileNames[ul],
+				&rgszParallelFileNames[ul],
+				1, // ulTests
+				&ulFileCounter,
+				1, // ulSessionId
+				1, // ulCmdId
+				true, // fMatchPlans
+				1, // iCmpSpaceSize
+				NULL // pceeval
+				);
+		m_ulParallelTestCounter = ul + 1;
+	}
+
+	m_ulParallelTestCounter = 0;
+	return eres;
+}
+
+
 //---------------------------------------------------------------------------
 //	@function:
 //		CICGTest::EresUnittest_RunUnsupportedMinidumpTests